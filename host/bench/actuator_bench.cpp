@@ -0,0 +1,260 @@
+// Actuator engine on the simulated GPIO backend. Three parts:
+//  - two simulated hours of one zone's outputs on the engine's own clock: min on/off
+//    times, pump slew, heater duty per window, dose lengths, mixing time and the hourly
+//    dosing limit, all checked from the pin log
+//  - doses in real time while a control loop with a slow, jittery acquisition stage
+//    queues them, against the same doses switched from that loop: the pulse length error
+//  - what queueing a command costs the control task
+//   actuator_bench [doses]
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "actuator.hpp"
+#include "esp_timer.h"
+#include "sim_actuator_driver.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t PUMP = static_cast<size_t>(ZoneActuator::PUMP);
+constexpr size_t HEATER = static_cast<size_t>(ZoneActuator::HEATER);
+constexpr size_t DOSING = static_cast<size_t>(ZoneActuator::DOSING);
+
+// As main.cpp
+const ActuatorConfig CONFIGS[ZONE_ACTUATORS] = {
+    { .name = "pump", .pin = { .gpio = 18, .pwm = true, .active_low = false }, .kind = ActuatorKind::DUTY,
+      .min_on_ms = 2000, .min_off_ms = 5000, .max_slew_per_s = 0.5f, .window_ms = 0, .full_dose_ms = 0,
+      .max_on_ms_per_hour = 0 },
+    { .name = "heater", .pin = { .gpio = 19, .pwm = false, .active_low = false },
+      .kind = ActuatorKind::TIME_PROPORTIONAL, .min_on_ms = 1000, .min_off_ms = 1000, .max_slew_per_s = 0.0f,
+      .window_ms = 10000, .full_dose_ms = 0, .max_on_ms_per_hour = 0 },
+    { .name = "dosing", .pin = { .gpio = 20, .pwm = false, .active_low = false }, .kind = ActuatorKind::PULSE,
+      .min_on_ms = 0, .min_off_ms = 60000, .max_slew_per_s = 0.0f, .window_ms = 0, .full_dose_ms = 2000,
+      .max_on_ms_per_hour = 60000 },
+};
+
+struct Interval {
+    int64_t start_us;
+    int64_t end_us;
+};
+
+// On intervals of one channel from the pin log; one still on at end_us ends there
+std::vector<Interval> on_intervals(const std::vector<SimPinEdge>& edges, size_t channel, int64_t end_us) {
+    std::vector<Interval> intervals;
+    bool on = false;
+    for (const SimPinEdge& edge : edges) {
+        if (edge.channel != channel || (edge.duty > 0.0f) == on) {
+            continue;
+        }
+        on = edge.duty > 0.0f;
+        if (on) {
+            intervals.push_back({ edge.time_us, end_us });
+        } else {
+            intervals.back().end_us = edge.time_us;
+        }
+    }
+    return intervals;
+}
+
+uint32_t next_random(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int dose_count = argc > 1 ? std::atoi(argv[1]) : 40;
+    bool ok = true;
+    std::printf("actuator_bench\n");
+
+    // Simulated time: the engine's passes at its own deadlines, control ticks at 1 Hz
+    {
+        SimActuatorDriver driver(false);
+        ActuatorEngine engine(driver);
+        host_set_time_us(1);
+        engine.start(CONFIGS, ZONE_ACTUATORS);
+        const int64_t end_us = 2 * 3600LL * 1000000;
+        int64_t next_tick_us = 1000000;
+        int64_t deadline_us = INT64_MAX;
+        long passes = 0;
+        long ticks = 0;
+        uint32_t random = 7;
+        while (true) {
+            int64_t now_us = std::min(next_tick_us, deadline_us);
+            if (now_us > end_us) {
+                break;
+            }
+            host_set_time_us(now_us);
+            if (now_us == next_tick_us) {
+                // Pump chatters on a noisy level reading, heater wants 35 %, dosing always wants a
+                // full dose: twice what the hourly limit allows
+                bool pump_on = next_random(random) % 3 == 0;
+                engine.set_duty(PUMP, pump_on ? 0.8f : 0.0f);
+                engine.set_duty(HEATER, 0.35f);
+                engine.dose(DOSING, CONFIGS[DOSING].full_dose_ms);
+                next_tick_us += 1000000;
+                ticks++;
+            }
+            deadline_us = engine.service(now_us);
+            passes++;
+        }
+        host_set_time_us(0);
+
+        const std::vector<SimPinEdge>& edges = driver.edges();
+        // Min on / off times on every channel
+        int64_t shortest_on_us[ZONE_ACTUATORS];
+        int64_t shortest_off_us[ZONE_ACTUATORS];
+        bool holds = true;
+        for (size_t c = 0; c < ZONE_ACTUATORS; ++c) {
+            std::vector<Interval> on = on_intervals(edges, c, end_us);
+            shortest_on_us[c] = INT64_MAX;
+            shortest_off_us[c] = INT64_MAX;
+            for (size_t i = 0; i < on.size(); ++i) {
+                if (on[i].end_us < end_us) {
+                    shortest_on_us[c] = std::min(shortest_on_us[c], on[i].end_us - on[i].start_us);
+                }
+                if (i > 0) {
+                    shortest_off_us[c] = std::min(shortest_off_us[c], on[i].start_us - on[i - 1].end_us);
+                }
+            }
+            holds = holds && (c == DOSING || shortest_on_us[c] >= CONFIGS[c].min_on_ms * 1000LL) &&
+                    shortest_off_us[c] >= CONFIGS[c].min_off_ms * 1000LL;
+        }
+        // Pump: never faster than the slew limit, except switching off. Steps under a
+        // millisecond (a control tick just after a slew pass) only show float rounding.
+        float steepest = 0.0f;
+        int64_t last_us = 0;
+        float last_duty = 0.0f;
+        for (const SimPinEdge& edge : edges) {
+            if (edge.channel != PUMP) {
+                continue;
+            }
+            if (edge.duty > 0.0f && last_duty > 0.0f && edge.time_us - last_us >= 1000) {
+                steepest = std::max(steepest, std::fabs(edge.duty - last_duty) / ((edge.time_us - last_us) / 1e6f));
+            }
+            last_us = edge.time_us;
+            last_duty = edge.duty;
+        }
+        // Heater: share of the time on
+        std::vector<Interval> heater = on_intervals(edges, HEATER, end_us);
+        int64_t heater_on_us = 0;
+        for (const Interval& interval : heater) {
+            heater_on_us += interval.end_us - interval.start_us;
+        }
+        double heater_share = static_cast<double>(heater_on_us) / end_us;
+        // Dosing: exact lengths, and within the hourly limit in the second hour (the first
+        // starts with a full budget)
+        std::vector<Interval> doses = on_intervals(edges, DOSING, end_us);
+        int64_t worst_dose_error_us = 0;
+        int64_t second_hour_us = 0;
+        for (const Interval& dose : doses) {
+            int64_t length_us = dose.end_us - dose.start_us;
+            int64_t error_us = std::abs(length_us - static_cast<int64_t>(CONFIGS[DOSING].full_dose_ms) * 1000);
+            worst_dose_error_us = std::max(worst_dose_error_us, error_us);
+            if (dose.start_us >= end_us / 2) {
+                second_hour_us += length_us;
+            }
+        }
+        ActuatorStats dosing_stats = engine.stats(DOSING);
+        std::printf("  2 h simulated: %ld control ticks, %ld engine passes\n", ticks, passes);
+        std::printf("  min on/off kept %s: shortest pump on/off %.1f/%.1f s, heater %.1f/%.1f s, gap between doses %.1f s\n",
+                    holds ? "yes" : "NO", shortest_on_us[PUMP] / 1e6, shortest_off_us[PUMP] / 1e6,
+                    shortest_on_us[HEATER] / 1e6, shortest_off_us[HEATER] / 1e6, shortest_off_us[DOSING] / 1e6);
+        std::printf("  pump slew at most %.2f /s (limit %.2f), heater on %.1f %% of the time (35 %% asked)\n", steepest,
+                    CONFIGS[PUMP].max_slew_per_s, heater_share * 100.0);
+        std::printf("  %zu doses, length error %" PRId64 " us, second hour %.1f s of dosing (limit %.0f s), "
+                    "%" PRIu32 " passes held by the limit\n", doses.size(), worst_dose_error_us, second_hour_us / 1e6,
+                    CONFIGS[DOSING].max_on_ms_per_hour / 1000.0, dosing_stats.limited);
+        ok = ok && holds && steepest <= CONFIGS[PUMP].max_slew_per_s * 1.01f && std::fabs(heater_share - 0.35) < 0.02 &&
+             worst_dose_error_us == 0 && second_hour_us <= (CONFIGS[DOSING].max_on_ms_per_hour + 2000) * 1000LL &&
+             dosing_stats.limited > 0;
+    }
+
+    // Real time: the engine on its timer thread, the control loop on this one with an
+    // acquisition stage that takes 0..60 ms
+    {
+        ActuatorConfig configs[ZONE_ACTUATORS];
+        std::copy(CONFIGS, CONFIGS + ZONE_ACTUATORS, configs);
+        configs[DOSING].min_off_ms = 100;
+        configs[DOSING].max_on_ms_per_hour = 0;
+        SimActuatorDriver driver;
+        ActuatorEngine engine(driver);
+        engine.start(configs, ZONE_ACTUATORS);
+        const auto period = std::chrono::milliseconds(100);
+        uint32_t random = 11;
+        std::vector<int64_t> wanted_us;
+        std::vector<int64_t> loop_error_us;
+        int64_t loop_on_us = 0;
+        int64_t loop_wanted_us = 0;
+        auto next = Clock::now();
+        for (int tick = 0; tick < dose_count * 5; ++tick) {
+            next += period;
+            std::this_thread::sleep_until(next);
+            std::this_thread::sleep_for(std::chrono::microseconds(next_random(random) % 60000));   // Acquisition
+            int64_t now_us = esp_timer_get_time();
+            // Switched from the loop: on at a tick, off at the first tick after it is due
+            if (loop_on_us != 0 && now_us - loop_on_us >= loop_wanted_us) {
+                loop_error_us.push_back(now_us - loop_on_us - loop_wanted_us);
+                loop_on_us = 0;
+            }
+            if (tick % 5 == 0) {
+                uint32_t dose_ms = 20 + next_random(random) % 180;
+                engine.dose(DOSING, dose_ms);
+                wanted_us.push_back(dose_ms * 1000LL);
+                loop_on_us = now_us;
+                loop_wanted_us = dose_ms * 1000LL;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        driver.stop();
+        std::vector<Interval> doses = on_intervals(driver.edges(), DOSING, INT64_MAX);
+        std::vector<int64_t> engine_error_us;
+        for (size_t i = 0; i < doses.size() && i < wanted_us.size(); ++i) {
+            engine_error_us.push_back(std::abs(doses[i].end_us - doses[i].start_us - wanted_us[i]));
+        }
+        std::sort(engine_error_us.begin(), engine_error_us.end());
+        std::sort(loop_error_us.begin(), loop_error_us.end());
+        auto pct = [](const std::vector<int64_t>& v, size_t p) { return v.empty() ? 0 : v[(v.size() - 1) * p / 100]; };
+        const LatencyHistogram& late = engine.late_us();
+        std::printf("  real time, %d doses of 20-200 ms, control every 100 ms with 0-60 ms acquisition:\n",
+                    dose_count);
+        std::printf("    engine timer:  length error p50 %" PRId64 " us, max %" PRId64 " us "
+                    "(timer late p99 %" PRIu32 " us)\n",
+                    pct(engine_error_us, 50), pct(engine_error_us, 100), late.percentile(99));
+        std::printf("    control loop:  length error p50 %" PRId64 " us, max %" PRId64 " us\n", pct(loop_error_us, 50),
+                    pct(loop_error_us, 100));
+        ok = ok && doses.size() == wanted_us.size() && pct(engine_error_us, 50) < 2000 &&
+             pct(engine_error_us, 50) * 10 < pct(loop_error_us, 50);
+    }
+
+    // Cost on the control task: one queued command, drained every 48
+    {
+        SimActuatorDriver driver(false);
+        ActuatorEngine engine(driver);
+        engine.start(CONFIGS, ZONE_ACTUATORS);
+        const long commands = 3000000;
+        double queue_ns = 0.0;
+        for (long i = 0; i < commands; i += 48) {
+            auto start = Clock::now();
+            for (int k = 0; k < 48; ++k) {
+                engine.set_duty(PUMP, (k & 1) ? 0.5f : 0.6f);
+            }
+            queue_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            engine.service(esp_timer_get_time());
+        }
+        std::printf("  queueing a command: %.0f ns, %" PRIu32 " dropped\n", queue_ns / commands, engine.dropped());
+        ok = ok && engine.dropped() == 0;
+    }
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Samples taken by the adaptive sampling rate against the fixed rate it replaces, and how
+// late each change is seen, over hours of simulated tank signals. Each sensor runs its
+// estimator and AdaptiveRate with the settings from zone.cpp; the fixed-rate
+// run is the same with the period pinned at min_period_ms.
+//   adaptive_bench [hours]
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "adaptive_rate.hpp"
+#include "estimator.hpp"
+
+namespace {
+
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    double uniform() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return ((state >> 11) + 0.5) / 9007199254740992.0;
+    }
+    double gaussian() { return std::sqrt(-2.0 * std::log(uniform())) * std::cos(6.283185307179586 * uniform()); }
+};
+
+// A change to watch for: seen once the estimate is past `level` in the direction of `rising`
+struct Event {
+    const char* name;
+    double at_s;
+    double level;
+    bool rising;
+};
+
+struct Scenario {
+    const char* sensor;
+    const char* units;
+    double (*truth)(double t);
+    double noise;
+    EstimatorConfig estimator;
+    AdaptiveRateConfig rate;
+    float watch;
+    const Event* events;
+    size_t event_count;
+};
+
+// TDS: dosing ramp at 1 h, water change at 2 h, then evaporation slowly concentrating
+// the solution up through the 1000 ppm threshold
+double tds_truth(double t) {
+    if (t < 3600.0) return 800.0;
+    if (t < 3750.0) return 800.0 + (t - 3600.0);
+    if (t < 7200.0) return 950.0;
+    if (t < 10800.0) return 700.0;
+    return 700.0 + 0.03 * (t - 10800.0);
+}
+constexpr Event TDS_EVENTS[] = {
+    { "dosing ramp", 3600.0, 820.0, true },
+    { "water change", 7200.0, 825.0, false },
+    { "threshold", 10800.0 + 300.0 / 0.03, 1000.0, true },
+};
+
+// Water temperature: steady, the room warms it through the 25 °C threshold, a cold
+// top-up at 4 h
+double ntc_truth(double t) {
+    if (t < 3600.0) return 23.5;
+    if (t < 7200.0) return 23.5 + 2.0 * (t - 3600.0) / 3600.0;
+    if (t < 14400.0) return 25.5;
+    return 22.0;
+}
+constexpr Event NTC_EVENTS[] = {
+    { "threshold", 3600.0 + 1.5 * 3600.0 / 2.0, 25.0, true },
+    { "cold top-up", 14400.0, 24.5, false },
+};
+
+// Water level: the pump refills from 45 to 60 cm at 2 h, consumption draws it down slowly
+double level_truth(double t) {
+    if (t < 7200.0) return 52.0 - 7.0 * t / 7200.0;
+    if (t < 7500.0) return 45.0 + 15.0 * (t - 7200.0) / 300.0;
+    return 60.0 - 7.0 * (t - 7500.0) / 7200.0;
+}
+constexpr Event LEVEL_EVENTS[] = {
+    { "threshold", 7200.0 * 2.0 / 7.0, 50.0, false },
+    { "refill", 7200.0, 47.0, true },
+};
+
+// Settings from zone.cpp
+const Scenario SCENARIOS[] = {
+    { "tds", "ppm", tds_truth, 5.0,
+      { .process_noise = 0.75f, .measurement_noise = 25.0f, .gate_sigma = 4.0f },
+      { .min_period_ms = 50, .max_period_ms = 2000, .quiet_slope = 1.0f, .quiet_deviation = 3.0f, .approach_band = 50.0f },
+      1000.0f, TDS_EVENTS, sizeof(TDS_EVENTS) / sizeof(TDS_EVENTS[0]) },
+    { "ntc", "C", ntc_truth, 0.1,
+      { .process_noise = 1e-3f, .measurement_noise = 0.01f },
+      { .min_period_ms = 200, .max_period_ms = 5000, .quiet_slope = 0.01f, .quiet_deviation = 0.05f, .approach_band = 0.5f },
+      25.0f, NTC_EVENTS, sizeof(NTC_EVENTS) / sizeof(NTC_EVENTS[0]) },
+    { "level", "cm", level_truth, 0.5,
+      { .process_noise = 0.05f, .measurement_noise = 0.25f, .gate_sigma = 4.0f },
+      { .min_period_ms = 100, .max_period_ms = 1000, .quiet_slope = 0.02f, .quiet_deviation = 0.5f, .approach_band = 2.0f },
+      50.0f, LEVEL_EVENTS, sizeof(LEVEL_EVENTS) / sizeof(LEVEL_EVENTS[0]) },
+};
+
+constexpr size_t MAX_EVENTS = 4;
+
+struct Result {
+    uint64_t samples = 0;
+    double lag_s[MAX_EVENTS] = {};
+};
+
+Result run(const Scenario& s, double duration_s, bool adaptive) {
+    Rng rng;
+    ScalarKalman kalman(s.estimator);
+    AdaptiveRate rate;
+    AdaptiveRateConfig config = s.rate;
+    if (!adaptive) {
+        config.max_period_ms = config.min_period_ms;
+    }
+    rate.configure(config);
+
+    Result result;
+    for (size_t e = 0; e < s.event_count; ++e) {
+        result.lag_s[e] = INFINITY;
+    }
+    int64_t t_us = 0;
+    while (t_us < static_cast<int64_t>(duration_s * 1e6)) {
+        double t = t_us * 1e-6;
+        float reading = static_cast<float>(s.truth(t) + s.noise * rng.gaussian());
+        kalman.update(reading, t_us);
+        float estimate = kalman.estimate();
+        result.samples++;
+
+        for (size_t e = 0; e < s.event_count; ++e) {
+            const Event& event = s.events[e];
+            bool past = event.rising ? estimate >= event.level : estimate <= event.level;
+            if (t >= event.at_s && past && std::isinf(result.lag_s[e])) {
+                result.lag_s[e] = t - event.at_s;
+            }
+        }
+        t_us += static_cast<int64_t>(rate.update(estimate, t_us, s.watch, true)) * 1000;
+    }
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 6.0;
+    double duration_s = hours * 3600.0;
+    std::printf("adaptive_bench: %.1f h per sensor, lag = time until the estimate shows the change\n", hours);
+
+    bool ok = true;
+    for (const Scenario& s : SCENARIOS) {
+        Result fixed = run(s, duration_s, false);
+        Result adaptive = run(s, duration_s, true);
+        std::printf("\n%s: %lu..%lu ms, watch %.1f %s\n", s.sensor, static_cast<unsigned long>(s.rate.min_period_ms),
+                    static_cast<unsigned long>(s.rate.max_period_ms), s.watch, s.units);
+        std::printf("  %-14s %10s %10s  (%.1f%% of fixed)\n", "samples", "fixed", "adaptive",
+                    100.0 * adaptive.samples / fixed.samples);
+        std::printf("  %-14s %10llu %10llu\n", "", static_cast<unsigned long long>(fixed.samples),
+                    static_cast<unsigned long long>(adaptive.samples));
+        for (size_t e = 0; e < s.event_count; ++e) {
+            if (s.events[e].at_s >= duration_s) {
+                continue;
+            }
+            std::printf("  %-14s %8.2f s %8.2f s\n", s.events[e].name, fixed.lag_s[e], adaptive.lag_s[e]);
+            // One max period late at worst, plus the time to notice the change
+            if (adaptive.lag_s[e] > fixed.lag_s[e] + s.rate.max_period_ms / 1000.0 * 2.0) {
+                ok = false;
+            }
+        }
+    }
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL: a change was seen more than two max periods late");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+// Dashboard server on localhost, fed simulated rows at the acquisition rate (10 Hz).
+//   dashboard_bench [max_clients]   load test: WebSocket clients in steps up to max_clients
+//                                   (default and most 1000), each checking every frame it
+//                                   decodes against the rows published; latency from publish
+//                                   to receipt, bytes per frame, frames missed
+//   dashboard_bench serve [port]    serves the page on http://localhost:<port>/ (8080) until
+//                                   interrupted, to look at it in a browser
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "dashboard_view.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MAX_CLIENTS = 1000;
+constexpr size_t ZONES = 2;
+constexpr size_t CHANNELS = ZONES * SensorData::TYPE_COUNT;
+constexpr int64_t ROW_MS = 100;
+constexpr size_t ROWS_KEPT = 1024;
+// Client sockets go above the server's, so the server's stay under FD_SETSIZE
+constexpr int CLIENT_FD_BASE = FD_SETSIZE;
+// RFC 6455's example key and the accept it must produce
+const char WS_KEY[] = "dGhlIHNhbXBsZSBub25jZQ==";
+const char WS_ACCEPT[] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+StaticDashboard<MAX_CLIENTS> dashboard;
+
+// What was published, by row, for the clients to check against
+struct PublishedRow {
+    int64_t time_ms;
+    Clock::time_point at;
+    int32_t values[CHANNELS];
+};
+std::mutex published_mutex;
+PublishedRow published[ROWS_KEPT];
+std::atomic<bool> publishing(true);
+
+// Random walks on the fixed-point grid of each type, so the expected values are exact
+void publish_rows() {
+    const SensorData::Type types[SensorData::TYPE_COUNT] = {
+        SensorData::Type::TDS, SensorData::Type::NTC, SensorData::Type::WATER_LEVEL, SensorData::Type::PH };
+    const int32_t start[SensorData::TYPE_COUNT] = { 800, 2150, 420, 610 };
+    const uint32_t change_per_mille[SensorData::TYPE_COUNT] = { 500, 300, 50, 300 };
+    int32_t values[CHANNELS];
+    for (size_t i = 0; i < CHANNELS; ++i) {
+        values[i] = start[i % SensorData::TYPE_COUNT];
+    }
+    uint32_t random = 1;
+    auto next = Clock::now();
+    for (int64_t time_ms = ROW_MS; publishing.load(std::memory_order_relaxed); time_ms += ROW_MS) {
+        SensorData row[CHANNELS];
+        for (size_t i = 0; i < CHANNELS; ++i) {
+            random = random * 1664525u + 1013904223u;
+            if ((random >> 8) % 1000 < change_per_mille[i % SensorData::TYPE_COUNT]) {
+                values[i] += (random >> 20) & 1 ? 1 : -1;
+            }
+            SensorData::Type type = types[i % SensorData::TYPE_COUNT];
+            row[i] = { type, static_cast<float>(values[i]) / telemetry_scale(type) };
+        }
+        {
+            std::lock_guard<std::mutex> lock(published_mutex);
+            PublishedRow& slot = published[(time_ms / ROW_MS) % ROWS_KEPT];
+            slot.time_ms = time_ms;
+            slot.at = Clock::now();
+            std::memcpy(slot.values, values, sizeof(values));
+        }
+        dashboard.publish(row, CHANNELS, time_ms);
+        next += std::chrono::milliseconds(ROW_MS);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+struct Client {
+    int socket;
+    bool upgraded;
+    std::vector<uint8_t> buffer;
+    DashboardView view;
+    uint32_t frames;
+    uint32_t errors;
+    int64_t first_ms;
+    int64_t last_ms;
+};
+
+int connect_local(uint16_t port) {
+    int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (socket < 0 || ::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (socket >= 0) {
+            close(socket);
+        }
+        return -1;
+    }
+    int high = fcntl(socket, F_DUPFD, CLIENT_FD_BASE);
+    if (high >= 0) {
+        close(socket);
+        socket = high;
+    }
+    return socket;
+}
+
+bool open_websocket(Client& client, uint16_t port) {
+    client = {};
+    client.socket = connect_local(port);
+    if (client.socket < 0) {
+        return false;
+    }
+    char request[256];
+    int length = std::snprintf(request, sizeof(request),
+                               "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                               "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n", WS_KEY);
+    fcntl(client.socket, F_SETFL, fcntl(client.socket, F_GETFL, 0) | O_NONBLOCK);
+    return send(client.socket, request, length, MSG_NOSIGNAL) == length;
+}
+
+// Handshake, then every complete frame in the buffer
+void process(Client& client, std::vector<int64_t>& latencies_us) {
+    std::vector<uint8_t>& buffer = client.buffer;
+    if (!client.upgraded) {
+        std::string text(buffer.begin(), buffer.end());
+        size_t end = text.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            return;
+        }
+        if (text.compare(0, 12, "HTTP/1.1 101") != 0 || text.find(WS_ACCEPT) == std::string::npos) {
+            client.errors++;
+        }
+        client.upgraded = true;
+        buffer.erase(buffer.begin(), buffer.begin() + end + 4);
+    }
+    while (buffer.size() >= 2) {
+        size_t header = 2;
+        size_t length = buffer[1] & 0x7F;
+        if (length == 126) {
+            if (buffer.size() < 4) {
+                return;
+            }
+            length = static_cast<size_t>(buffer[2]) << 8 | buffer[3];
+            header = 4;
+        }
+        if (buffer.size() < header + length) {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        bool decoded = buffer[0] == 0x82 && dashboard_decode(buffer.data() + header, length, client.view) &&
+                       client.view.values.size() == CHANNELS;
+        buffer.erase(buffer.begin(), buffer.begin() + header + length);
+        if (!decoded) {
+            client.errors++;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(published_mutex);
+        const PublishedRow& row = published[(client.view.time_ms / ROW_MS) % ROWS_KEPT];
+        if (row.time_ms != client.view.time_ms ||
+            std::memcmp(row.values, client.view.values.data(), sizeof(row.values)) != 0) {
+            client.errors++;
+            continue;
+        }
+        latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(now - row.at).count());
+        client.first_ms = client.frames == 0 ? client.view.time_ms : client.first_ms;
+        client.last_ms = client.view.time_ms;
+        client.frames++;
+    }
+}
+
+// Reads every client for duration, then reports what they received since the start
+bool measure(std::vector<Client>& clients, std::chrono::milliseconds duration, bool report) {
+    std::vector<pollfd> fds(clients.size());
+    for (Client& client : clients) {
+        client.frames = 0;
+    }
+    std::vector<int64_t> latencies_us;
+    DashboardStats before = dashboard.stats();
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        for (size_t i = 0; i < clients.size(); ++i) {
+            fds[i] = { clients[i].socket, POLLIN, 0 };
+        }
+        if (poll(fds.data(), fds.size(), 10) <= 0) {
+            continue;
+        }
+        for (size_t i = 0; i < clients.size(); ++i) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            uint8_t data[4096];
+            ssize_t received = recv(clients[i].socket, data, sizeof(data), 0);
+            if (received <= 0) {
+                clients[i].errors++;    // Closed by the server
+                continue;
+            }
+            clients[i].buffer.insert(clients[i].buffer.end(), data, data + received);
+            process(clients[i], latencies_us);
+        }
+    }
+    DashboardStats after = dashboard.stats();
+    if (!report) {
+        return true;
+    }
+
+    uint64_t frames = 0;
+    uint64_t missed = 0;
+    uint32_t errors = 0;
+    for (const Client& client : clients) {
+        frames += client.frames;
+        // Rows replaced before the server's pass reached them
+        missed += client.frames > 0 ? (client.last_ms - client.first_ms) / ROW_MS + 1 - client.frames : 0;
+        errors += client.errors;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto pct = [&](size_t p) { return latencies_us.empty() ? 0 : latencies_us[(latencies_us.size() - 1) * p / 100]; };
+    uint32_t sent = (after.key_frames_sent - before.key_frames_sent) + (after.delta_frames_sent - before.delta_frames_sent);
+    double bytes_per_frame = sent > 0 ? static_cast<double>(after.bytes_sent - before.bytes_sent) / sent : 0.0;
+    double rate = static_cast<double>(frames) / clients.size() / (duration.count() / 1000.0);
+    bool ok = errors == 0 && after.slow_dropped == before.slow_dropped && rate > 0.9 * 1000.0 / ROW_MS &&
+              pct(99) < 100000;
+    std::printf("  %5zu clients: %5.1f frames/s each, %llu missed, latency p50 %5.1f ms p99 %5.1f ms max %6.1f ms, "
+                "%.1f B/frame (%" PRIu32 " key + %" PRIu32 " delta), %" PRIu32 " errors %s\n", clients.size(), rate,
+                static_cast<unsigned long long>(missed), pct(50) / 1000.0, pct(99) / 1000.0, pct(100) / 1000.0,
+                bytes_per_frame, after.key_frames_sent - before.key_frames_sent,
+                after.delta_frames_sent - before.delta_frames_sent, errors, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool fetch_page(uint16_t port) {
+    int socket = connect_local(port);
+    const char request[] = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (socket < 0 || send(socket, request, sizeof(request) - 1, MSG_NOSIGNAL) < 0) {
+        return false;
+    }
+    std::string response;
+    char data[4096];
+    ssize_t received;
+    while ((received = recv(socket, data, sizeof(data), 0)) > 0) {
+        response.append(data, received);
+    }
+    close(socket);
+    size_t body = response.find("\r\n\r\n");
+    bool ok = response.compare(0, 15, "HTTP/1.1 200 OK") == 0 && body != std::string::npos &&
+              response.size() - body - 4 == DASHBOARD_PAGE_LENGTH;
+    std::printf("  GET /: %d bytes, %s\n", static_cast<int>(response.size()), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* const names[ZONES] = { "tank1", "tank2" };
+    dashboard.set_zones(names, ZONES);
+
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0) {
+        uint16_t port = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 8080);
+        if (dashboard.start(port, 1, 8192) != ESP_OK) {
+            return 1;
+        }
+        std::printf("http://localhost:%d/\n", dashboard.port());
+        std::thread publisher(publish_rows);
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+            DashboardStats stats = dashboard.stats();
+            std::printf("%" PRIu32 " clients, %" PRIu32 " frames, %llu bytes sent\n", stats.clients, stats.frames,
+                        static_cast<unsigned long long>(stats.bytes_sent));
+        }
+    }
+
+    size_t max_clients = std::min<size_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : MAX_CLIENTS, MAX_CLIENTS);
+    // Two descriptors per client in this process
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, CLIENT_FD_BASE + max_clients + 64);
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < CLIENT_FD_BASE + max_clients) {
+        max_clients = limit.rlim_cur > CLIENT_FD_BASE + 64 ? limit.rlim_cur - CLIENT_FD_BASE - 64 : 0;
+        std::printf("descriptor limit: at most %d clients\n", static_cast<int>(max_clients));
+    }
+
+    std::printf("dashboard_bench: %d zones at %lld ms per row, server polls every %" PRIu32 " ms\n",
+                static_cast<int>(ZONES), static_cast<long long>(ROW_MS), DASHBOARD_POLL_MS);
+    if (dashboard.start(0, 1, 8192) != ESP_OK) {
+        return 1;
+    }
+    std::thread publisher(publish_rows);
+    bool ok = fetch_page(dashboard.port());
+
+    std::vector<Client> clients;
+    for (size_t step : { 1, 10, 100, 250, 500, 1000 }) {
+        step = std::min(step, max_clients);
+        if (step <= clients.size() && !clients.empty()) {
+            break;
+        }
+        while (clients.size() < step) {
+            // No more at once than the server's listen backlog holds
+            if (clients.size() % 8 == 0) {
+                while (dashboard.stats().connections < clients.size() + 1) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            clients.emplace_back();
+            if (!open_websocket(clients.back(), dashboard.port())) {
+                std::printf("  connect failed at %d clients\n", static_cast<int>(clients.size()));
+                clients.pop_back();
+                ok = false;
+                break;
+            }
+        }
+        // Handshakes, the first key frame and what queued up while connecting first
+        measure(clients, std::chrono::milliseconds(1000), false);
+        ok = measure(clients, std::chrono::milliseconds(3000), true) && ok;
+    }
+
+    for (Client& client : clients) {
+        close(client.socket);
+    }
+    dashboard.stop();
+    publishing.store(false);
+    publisher.join();
+    while (dashboard.running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    DashboardStats stats = dashboard.stats();
+    std::printf("  %" PRIu32 " connections, %" PRIu32 " rejected, %" PRIu32 " too slow; %" PRIu32
+                " frames encoded once for all clients, key frame %" PRIu32 " B, delta %" PRIu32 " B\n",
+                stats.connections, stats.rejected, stats.slow_dropped, stats.frames, stats.last_key_bytes,
+                stats.last_delta_bytes);
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
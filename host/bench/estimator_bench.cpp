@@ -0,0 +1,132 @@
+// Latency and noise of the per-sensor Kalman estimator against the 50-tap moving
+// average it replaces, on a simulated TDS signal sampled every 50 ms: a settled level,
+// a dosing ramp and a step (water change), with Gaussian reading noise and spikes.
+//   estimator_bench [noise_ppm]
+// Exits non-zero if what the device runs is noisier than the median + 50-tap average,
+// lags a ramp more than 5% further behind it, or settles after a step no faster.
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "estimator.hpp"
+#include "filter.hpp"
+
+namespace {
+
+constexpr double DT_S = 0.05;          // TDS sampler period
+constexpr double DURATION_S = 240.0;
+// TDS_ESTIMATOR in zone.cpp
+constexpr EstimatorConfig TDS_ESTIMATOR = { .process_noise = 0.75f, .measurement_noise = 25.0f, .gate_sigma = 4.0f };
+
+// 800 ppm, +2 ppm/s dosing from 60 s to 120 s, then a water change to 600 ppm at 180 s
+double truth(double t) {
+    if (t < 60.0) return 800.0;
+    if (t < 120.0) return 800.0 + 2.0 * (t - 60.0);
+    if (t < 180.0) return 920.0;
+    return 600.0;
+}
+
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    double uniform() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return ((state >> 11) + 0.5) / 9007199254740992.0;
+    }
+    double gaussian() { return std::sqrt(-2.0 * std::log(uniform())) * std::cos(6.283185307179586 * uniform()); }
+};
+
+struct Score {
+    double steady_rms = 0.0;    // Error on the settled level
+    double ramp_lag = 0.0;      // Mean error while ramping, in ppm
+    double step_settle_s = 0.0; // Time to within 5 ppm after the step
+    double first_5s_max = 0.0;  // Worst error right after boot
+};
+
+template <typename Filter>
+Score run(Filter filter, double noise) {
+    Rng rng;
+    Score score;
+    double steady_sum = 0.0;
+    int steady_n = 0;
+    double ramp_sum = 0.0;
+    int ramp_n = 0;
+    double settled_at = -1.0;
+    for (int i = 0; static_cast<double>(i) * DT_S < DURATION_S; ++i) {
+        double t = i * DT_S;
+        double reading = truth(t) + noise * rng.gaussian();
+        if (rng.uniform() < 0.002) {
+            reading += 300.0;   // Electrode spike that got past the ADC stage
+        }
+        double error = filter(static_cast<float>(reading), static_cast<int64_t>(t * 1e6)) - truth(t);
+        if (t < 5.0) {
+            score.first_5s_max = std::fmax(score.first_5s_max, std::fabs(error));
+        } else if (t >= 20.0 && t < 60.0) {
+            steady_sum += error * error;
+            steady_n++;
+        } else if (t >= 90.0 && t < 120.0) {
+            ramp_sum += error;
+            ramp_n++;
+        } else if (t >= 180.0) {
+            if (std::fabs(error) > 5.0) {
+                settled_at = -1.0;
+            } else if (settled_at < 0.0) {
+                settled_at = t;
+            }
+        }
+    }
+    score.steady_rms = std::sqrt(steady_sum / steady_n);
+    score.ramp_lag = ramp_sum / ramp_n;
+    score.step_settle_s = settled_at < 0.0 ? INFINITY : settled_at - 180.0;
+    return score;
+}
+
+void report(const char* name, const Score& s) {
+    std::printf("  %-26s %8.2f %10.2f %10.2f s %10.1f\n", name, s.steady_rms, s.ramp_lag, s.step_settle_s, s.first_5s_max);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double noise = argc > 1 ? std::atof(argv[1]) : 5.0;
+    std::printf("estimator_bench: TDS at %.0f ms, reading noise %.1f ppm rms, 0.2%% spikes\n", DT_S * 1000, noise);
+    std::printf("  %-26s %8s %10s %12s %10s\n", "", "rms ppm", "ramp lag", "step settle", "boot max");
+
+    std::vector<float> history(MOVING_AVG_WINDOW);
+    ChannelFilter boxcar;
+    boxcar.configure({ .type = FilterType::MOVING_AVERAGE, .window = MOVING_AVG_WINDOW }, history.data(), history.size());
+    report("moving average, 50 taps", run([&](float z, int64_t) { return boxcar.update(z); }, noise));
+
+    ChannelFilter median_boxcar;
+    median_boxcar.configure({ .type = FilterType::MOVING_AVERAGE, .window = MOVING_AVG_WINDOW, .spike = SpikeFilter::MEDIAN },
+                            history.data(), history.size());
+    Score replaced = run([&](float z, int64_t) { return median_boxcar.update(z); }, noise);
+    report("median + 50 taps", replaced);
+
+    // TDS_ESTIMATOR without and with its gate
+    EstimatorConfig ungated = TDS_ESTIMATOR;
+    ungated.gate_sigma = 0.0f;
+    ScalarKalman kalman(ungated);
+    report("kalman", run([&](float z, int64_t t) { kalman.update(z, t); return kalman.estimate(); }, noise));
+
+    ScalarKalman gated(TDS_ESTIMATOR);
+    report("kalman, 4 sigma gate", run([&](float z, int64_t t) { gated.update(z, t); return gated.estimate(); }, noise));
+
+    // What the device runs: spike rejection in the ADC stage, then the estimator
+    ChannelFilter median;
+    median.configure({ .type = FilterType::NONE, .spike = SpikeFilter::MEDIAN }, nullptr, 0);
+    ScalarKalman device(TDS_ESTIMATOR);
+    Score shipped = run([&](float z, int64_t t) { device.update(median.update(z), t); return device.estimate(); },
+                        noise);
+    report("median + gated kalman", shipped);
+
+    std::printf("  steady-state sigma reported by the estimator: %.2f ppm, %lu readings gated\n",
+                std::sqrt(kalman.variance()), static_cast<unsigned long>(gated.rejected()));
+
+    bool pass = shipped.steady_rms <= replaced.steady_rms &&
+                std::fabs(shipped.ramp_lag) <= std::fabs(replaced.ramp_lag) * 1.05 &&
+                shipped.step_settle_s < replaced.step_settle_s;
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
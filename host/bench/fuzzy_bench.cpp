@@ -0,0 +1,74 @@
+// Micro-benchmark for FuzzyController::evaluate, the inference run by
+// StateMachine::fuzzy_logic_control once per control tick. A second thread keeps
+// swapping rule sets to show evaluation is unaffected by set_rules().
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "fuzzy_rules.hpp"
+#include "latency_histogram.hpp"
+
+namespace {
+
+constexpr double CONTROL_TICK_NS = 1e9;    // StateSchedule::control_ms default
+
+struct Random {
+    uint32_t state = 0xC0FFEEu;
+    float uniform(float lo, float hi) {
+        state = state * 1664525u + 1013904223u;
+        return lo + (hi - lo) * ((state >> 8) / 16777216.0f);
+    }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long evaluations = argc > 1 ? std::atol(argv[1]) : 5000000;
+
+    FuzzyController controller(FUZZY_RULES_GROWTH);
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> swaps(0);
+    std::thread swapper([&] {
+        bool growth = false;
+        while (running.load(std::memory_order_relaxed)) {
+            controller.set_rules(growth ? FUZZY_RULES_GROWTH : FUZZY_RULES_SEEDLING);
+            growth = !growth;
+            swaps.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+
+    Random random;
+    LatencyHistogram per_call_ns;
+    float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < evaluations; ++i) {
+        const float inputs[FUZZY_INPUTS] = {
+            random.uniform(0.0f, 2500.0f),
+            random.uniform(5.0f, 40.0f),
+            random.uniform(3.0f, 9.0f),
+            random.uniform(0.0f, 120.0f),
+        };
+        float outputs[FUZZY_OUTPUTS];
+        auto t0 = std::chrono::steady_clock::now();
+        controller.evaluate(inputs, outputs);
+        auto t1 = std::chrono::steady_clock::now();
+        per_call_ns.record(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        sink += outputs[0] + outputs[1] + outputs[2];
+    }
+    double total_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    running.store(false);
+    swapper.join();
+
+    std::printf("fuzzy evaluate: %ld evaluations, %u rule swaps during the run\n", evaluations, swaps.load());
+    std::printf("  loop average: %.1f ns/evaluation (including input generation and timing)\n", total_ns / evaluations);
+    std::printf("  per call (timer resolution bound): p50 <= %u ns, p99 <= %u ns, max %u ns\n",
+                per_call_ns.percentile(50), per_call_ns.percentile(99), per_call_ns.max());
+    std::printf("  worst case uses %.6f%% of a %.0f ms control tick\n",
+                100.0 * per_call_ns.max() / CONTROL_TICK_NS, CONTROL_TICK_NS / 1e6);
+    std::printf("  (checksum %.3f)\n", sink);
+    return per_call_ns.max() < CONTROL_TICK_NS ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+// On-device time series: a day of one-second rows of one zone into a ZoneHistory<1>.
+//  - memory, bytes per raw row against plain SensorData rows, how far back each ring reaches
+//  - cost of recording a row and of the queries a controller or dashboard would make
+//  - raw samples within the quantisation step of what was recorded, minute and hour
+//    rollups equal to min/max/mean computed from every row
+//  - a reader querying on another thread while rows are recorded never sees a torn chunk
+//  - completed chunks archived to a flash ring decode to the same rows
+//   history_bench [hours]
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "history_decode.hpp"
+#include "ram_flash_region.hpp"
+#include "telemetry.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using History1 = ZoneHistory<1>;
+constexpr size_t CHANNELS = SensorData::TYPE_COUNT;
+constexpr int64_t ROW_MS = 1000;
+
+// Slow drifts plus sensor-sized noise: TDS in ppm, temperature, level, pH
+struct Plant {
+    uint32_t state = 1;
+
+    float noise() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.0f - 0.5f;
+    }
+
+    void row(int64_t time_ms, SensorData* data) {
+        float t = time_ms / 1000.0f;
+        data[0] = { SensorData::Type::TDS, 850.0f + 40.0f * std::sin(t / 3600.0f) + 4.0f * noise() };
+        data[1] = { SensorData::Type::NTC, 22.0f + 1.5f * std::sin(t / 7200.0f) + 0.05f * noise() };
+        data[2] = { SensorData::Type::WATER_LEVEL, 45.0f - 0.0001f * t + 0.3f * noise() };
+        data[3] = { SensorData::Type::PH, 6.1f + 0.2f * std::sin(t / 5400.0f) + 0.02f * noise() };
+    }
+};
+
+struct Reference {
+    uint32_t count = 0;
+    float min = INFINITY;
+    float max = -INFINITY;
+    double sum = 0.0;
+
+    void add(float value) {
+        count++;
+        min = std::fmin(min, value);
+        max = std::fmax(max, value);
+        sum += value;
+    }
+};
+
+template <typename F>
+double time_ns(int repeats, F f) {
+    auto start = Clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        f();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / repeats;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 24.0;
+    const int64_t rows = static_cast<int64_t>(hours * 3600.0);
+    bool ok = true;
+
+    static History1 history;
+    RamFlashRegion region(512 * 1024);
+    FlashRing archive(region);
+    archive.mount();
+    history.set_archive(&archive);
+
+    // Reference rollups of the TDS and pH channels from every row, and the last rows as recorded
+    const size_t CHECKED[] = { 0, 3 };
+    std::map<int64_t, Reference> minutes[CHANNELS];
+    std::map<int64_t, Reference> hours_ref[CHANNELS];
+    std::vector<std::array<float, CHANNELS>> recorded(rows);
+
+    Plant plant;
+    SensorData row[CHANNELS];
+    double record_ns = 0.0;
+    for (int64_t i = 0; i < rows; ++i) {
+        int64_t time_ms = (i + 1) * ROW_MS;
+        plant.row(time_ms, row);
+        auto start = Clock::now();
+        history.record(row, CHANNELS, time_ms);
+        record_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        for (size_t c : CHECKED) {
+            minutes[c][time_ms / HISTORY_MINUTE_MS].add(row[c].value);
+            hours_ref[c][time_ms / HISTORY_HOUR_MS].add(row[c].value);
+        }
+        for (size_t c = 0; c < CHANNELS; ++c) {
+            recorded[i][c] = row[c].value;
+        }
+    }
+    const int64_t now_ms = rows * ROW_MS;
+
+    size_t raw_bytes = 0;
+    size_t raw_rows = 0;
+    history.raw_usage(raw_bytes, raw_rows);
+    int64_t first_ms = 0;
+    int64_t last_ms = 0;
+    history.raw_span(first_ms, last_ms);
+    const size_t plain_row = sizeof(int64_t) + CHANNELS * sizeof(SensorData);
+    std::printf("history_bench: %.1f h of 1 s rows, %zu channels\n", hours, CHANNELS);
+    std::printf("  memory: ZoneHistory<1> %zu bytes (ZoneHistory<2> %zu), chunk %zu, rollup slot %zu\n",
+                sizeof(History1), sizeof(ZoneHistory<2>), sizeof(Seqlock<HistoryChunk>), sizeof(Seqlock<HistoryRollup>));
+    std::printf("  raw: %.2f bytes per row (%zu as SensorData), %zu rows in RAM = %.1f min; "
+                "minutes %.0f h, hours %zu h\n",
+                static_cast<double>(raw_bytes) / raw_rows, plain_row, raw_rows, (last_ms - first_ms) / 60000.0,
+                HISTORY_MINUTES / 60.0, HISTORY_HOURS);
+    const size_t raw_ram = HISTORY_CHUNKS_PER_ZONE * sizeof(Seqlock<HistoryChunk>);
+    std::printf("  plain rows in the %zu bytes of the raw ring would reach %.1f min\n", raw_ram,
+                static_cast<double>(raw_ram) / plain_row / 60.0);
+
+    // Queries a dashboard or controller would make
+    static HistorySample samples[600];
+    static HistoryRollup rollups[HISTORY_MINUTES + HISTORY_HOURS];
+    size_t found = 0;
+    double raw_ns = time_ns(2000, [&] { found += history.query(0, now_ms - 300000, now_ms, samples, 600); });
+    double minute_ns = time_ns(20000, [&] {
+        found += history.query(3, HistoryResolution::MINUTE, now_ms - 2 * HISTORY_HOUR_MS, now_ms, rollups, 200);
+    });
+    double hour_ns = time_ns(20000, [&] {
+        found += history.query(3, HistoryResolution::HOUR, 0, now_ms, rollups, 200);
+    });
+    std::printf("  record %.0f ns/row; query last 5 min raw %.1f us, 2 h of minutes %.2f us, all hours %.2f us\n",
+                record_ns / rows, raw_ns / 1000.0, minute_ns / 1000.0, hour_ns / 1000.0);
+
+    // Raw samples: every row in the span, within half a quantisation step
+    size_t n = history.query(0, first_ms, last_ms, samples, 600);
+    float raw_error = 0.0f;
+    bool contiguous = n > 0 && samples[0].time_ms == first_ms;
+    for (size_t c = 0; c < CHANNELS; ++c) {
+        n = history.query(c, now_ms - 599 * ROW_MS, now_ms, samples, 600);
+        contiguous = contiguous && n == 600;
+        float step = 1.0f / telemetry_scale(static_cast<SensorData::Type>(c));
+        for (size_t i = 0; i < n; ++i) {
+            contiguous = contiguous && samples[i].time_ms == now_ms - static_cast<int64_t>(599 - i) * ROW_MS;
+            int64_t index = samples[i].time_ms / ROW_MS - 1;
+            raw_error = std::fmax(raw_error, std::fabs(samples[i].value - recorded[index][c]) / step);
+        }
+    }
+    std::printf("  raw: last 10 min complete %s, worst error %.3f quantisation steps\n", contiguous ? "yes" : "NO",
+                raw_error);
+    ok = ok && contiguous && raw_error <= 0.501f;
+
+    // Rollups against the reference, for every bucket the rings still hold
+    float rollup_error = 0.0f;
+    size_t minute_buckets = 0;
+    size_t hour_buckets = 0;
+    bool counts = true;
+    for (size_t c : CHECKED) {
+        n = history.query(c, HistoryResolution::MINUTE, 0, now_ms, rollups, HISTORY_MINUTES + HISTORY_HOURS);
+        minute_buckets = n;
+        for (size_t i = 0; i < n; ++i) {
+            const Reference& ref = minutes[c][rollups[i].start_ms / HISTORY_MINUTE_MS];
+            counts = counts && rollups[i].count == ref.count;
+            float mean = static_cast<float>(ref.sum / ref.count);
+            rollup_error = std::fmax(rollup_error, std::fmax(std::fabs(rollups[i].min - ref.min),
+                                                             std::fabs(rollups[i].max - ref.max)));
+            rollup_error = std::fmax(rollup_error, std::fabs(rollups[i].mean - mean) / std::fabs(mean));
+        }
+        n = history.query(c, HistoryResolution::HOUR, 0, now_ms, rollups, HISTORY_MINUTES + HISTORY_HOURS);
+        hour_buckets = n;
+        for (size_t i = 0; i < n; ++i) {
+            Reference ref = hours_ref[c][rollups[i].start_ms / HISTORY_HOUR_MS];
+            // The hour in progress covers its completed minutes only
+            if (rollups[i].start_ms / HISTORY_HOUR_MS == now_ms / HISTORY_HOUR_MS) {
+                ref = Reference();
+                for (const auto& [minute, bucket] : minutes[c]) {
+                    if (minute * HISTORY_MINUTE_MS >= rollups[i].start_ms && minute < now_ms / HISTORY_MINUTE_MS) {
+                        ref.count += bucket.count;
+                        ref.min = std::fmin(ref.min, bucket.min);
+                        ref.max = std::fmax(ref.max, bucket.max);
+                        ref.sum += bucket.sum;
+                    }
+                }
+            }
+            counts = counts && rollups[i].count == ref.count;
+            float mean = static_cast<float>(ref.sum / ref.count);
+            rollup_error = std::fmax(rollup_error, std::fmax(std::fabs(rollups[i].min - ref.min),
+                                                             std::fabs(rollups[i].max - ref.max)));
+            rollup_error = std::fmax(rollup_error, std::fabs(rollups[i].mean - mean) / std::fabs(mean));
+        }
+    }
+    // Up to the hour of the last completed minute
+    int64_t last_complete_ms = (now_ms / HISTORY_MINUTE_MS - 1) * HISTORY_MINUTE_MS;
+    bool reach = minute_buckets == std::min<size_t>(HISTORY_MINUTES, now_ms / HISTORY_MINUTE_MS + 1) &&
+                 hour_buckets == std::min<size_t>(HISTORY_HOURS, last_complete_ms / HISTORY_HOUR_MS + 1);
+    std::printf("  rollups: %zu minutes, %zu hours held%s, counts match %s, worst error %.2e\n", minute_buckets,
+                hour_buckets, reach ? "" : " (SHORT)", counts ? "yes" : "NO", rollup_error);
+    ok = ok && counts && reach && rollup_error < 1e-4f;
+
+    // A reader on another task: each query sees whole chunks, so samples come in time order
+    // and every value is the one recorded at its time. A chunk overwritten while a slow
+    // query runs is skipped, which leaves a gap but nothing torn.
+    static History1 live;
+    std::atomic<bool> done(false);
+    long queries = 0;
+    long torn = 0;
+    std::thread reader([&] {
+        static HistorySample seen[120];
+        while (!done.load(std::memory_order_relaxed)) {
+            int64_t from_ms = 0;
+            int64_t to_ms = 0;
+            live.raw_span(from_ms, to_ms);
+            size_t count = live.query(0, to_ms - 100 * ROW_MS, INT64_MAX, seen, 120);
+            for (size_t i = 0; i < count; ++i) {
+                if ((i > 0 && seen[i].time_ms <= seen[i - 1].time_ms) || seen[i].value != seen[i].time_ms / ROW_MS) {
+                    torn++;
+                }
+            }
+            queries++;
+        }
+    });
+    for (int64_t i = 0; i < 300000; ++i) {
+        int64_t time_ms = (i + 1) * ROW_MS;
+        SensorData ramp[CHANNELS] = { { SensorData::Type::TDS, static_cast<float>(i + 1) },
+                                      { SensorData::Type::NTC, 0.0f },
+                                      { SensorData::Type::WATER_LEVEL, 0.0f },
+                                      { SensorData::Type::PH, 0.0f } };
+        live.record(ramp, CHANNELS, time_ms);
+    }
+    done.store(true);
+    reader.join();
+    std::printf("  concurrent: %ld queries while recording, %ld torn samples\n", queries, torn);
+    ok = ok && torn == 0;
+
+    // Archive: every completed chunk, in order, decodes to the recorded rows
+    std::vector<uint8_t> record(archive.max_record_size());
+    std::vector<SensorData::Type> types;
+    std::vector<int64_t> times_ms;
+    std::vector<float> values;
+    size_t length = 0;
+    size_t chunks = 0;
+    size_t archived_rows = 0;
+    float archive_error = 0.0f;
+    int64_t previous_ms = 0;
+    bool ordered = true;
+    while (archive.pending() > 0 && archive.peek(record.data(), record.size(), length) == ESP_OK) {
+        archive.pop();
+        if (!history_decode(record.data(), length, types, times_ms, values) || types.size() != CHANNELS) {
+            ordered = false;
+            continue;
+        }
+        for (size_t r = 0; r < times_ms.size(); ++r) {
+            ordered = ordered && times_ms[r] > previous_ms;
+            previous_ms = times_ms[r];
+            int64_t index = times_ms[r] / ROW_MS - 1;
+            for (size_t c = 0; c < CHANNELS; ++c) {
+                float step = 1.0f / telemetry_scale(types[c]);
+                archive_error = std::fmax(archive_error, std::fabs(values[r * CHANNELS + c] - recorded[index][c]) / step);
+            }
+        }
+        archived_rows += times_ms.size();
+        chunks++;
+    }
+    std::printf("  archive: %" PRIu32 " chunks written, %zu kept in 512 KiB (%zu rows = %.1f h), "
+                "decode error %.3f steps%s\n",
+                history.archived(), chunks, archived_rows, archived_rows / 3600.0, archive_error,
+                ordered ? "" : ", OUT OF ORDER");
+    ok = ok && ordered && chunks > 0 && archive_error <= 0.501f && history.archive_errors() == 0;
+
+    std::printf("  (%zu results)\n%s\n", found, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
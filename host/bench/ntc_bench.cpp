@@ -0,0 +1,113 @@
+// NTC conversion cost and accuracy: the Steinhart-Hart formula NTC::read used to
+// evaluate per sample (logf, cube, reciprocal) against the compile-time NtcTable.
+// Reports cycles per conversion from the TSC on x86 hosts, ns everywhere.
+//   ntc_bench [conversions]
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "ntc.hpp"
+
+namespace {
+
+// The per-sample formula from before the table, in float as it ran on the device
+float steinhart_hart(float voltage) {
+    float r_ntc = static_cast<float>(NTC_PROBE.r_ref) * ((static_cast<float>(NTC_PROBE.v_supply) / voltage) - 1.0f);
+    float ln_r = logf(r_ntc);
+    float ln_r_cube = ln_r * ln_r * ln_r;
+    float temp_k = 1.0f / (static_cast<float>(NTC_PROBE.a) + static_cast<float>(NTC_PROBE.b) * ln_r +
+                           static_cast<float>(NTC_PROBE.c) * ln_r_cube);
+    return temp_k - 273.15f;
+}
+
+uint64_t cycles() {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Cost {
+    double ns;
+    double cycles;
+};
+
+template <typename Convert>
+Cost measure(const std::vector<float>& voltages, long conversions, Convert convert, double& checksum) {
+    float sum = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t start_cycles = cycles();
+    for (long i = 0; i < conversions; ++i) {
+        sum += convert(voltages[static_cast<size_t>(i) & (voltages.size() - 1)]);
+    }
+    uint64_t elapsed_cycles = cycles() - start_cycles;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    checksum += sum;
+    return { ns / conversions, static_cast<double>(elapsed_cycles) / conversions };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long conversions = argc > 1 ? std::atol(argv[1]) : 20000000;
+
+    // Inputs spread over the whole table range, in an order the branch predictor can't learn
+    std::vector<float> voltages(4096);    // Power of two, indexed with a mask
+    uint32_t state = 1;
+    for (float& v : voltages) {
+        state = state * 1664525u + 1013904223u;
+        v = NtcTable::v_min() + (NtcTable::v_max() - NtcTable::v_min()) * ((state >> 8) / 16777216.0f);
+    }
+
+    double checksum = 0.0;
+    Cost exact = measure(voltages, conversions, steinhart_hart, checksum);
+    Cost table = measure(voltages, conversions, NtcTable::celsius, checksum);
+
+    // Accuracy on a dense grid, against the formula in double
+    const int PROBES = 200000;
+    double worst = 0.0;
+    double worst_at = 0.0;
+    double worst_water = 0.0;
+    double worst_float = 0.0;
+    for (int k = 0; k <= PROBES; ++k) {
+        float v = NtcTable::v_min() + (NtcTable::v_max() - NtcTable::v_min()) * k / PROBES;
+        double reference = NTC_PROBE.celsius(v);
+        double error = std::fabs(NtcTable::celsius(v) - reference);
+        if (error > worst) {
+            worst = error;
+            worst_at = reference;
+        }
+        if (reference >= 0.0 && reference <= 50.0) {
+            worst_water = error > worst_water ? error : worst_water;
+        }
+        worst_float = std::fmax(worst_float, std::fabs(steinhart_hart(v) - reference));
+    }
+
+    std::printf("ntc_bench: %ld conversions per method, table %.3f..%.3f V (-40..125 °C)\n",
+                conversions, NtcTable::v_min(), NtcTable::v_max());
+#ifdef HAVE_TSC
+    std::printf("  steinhart-hart (logf)  %6.2f ns  %6.1f cycles/conversion\n", exact.ns, exact.cycles);
+    std::printf("  lookup table           %6.2f ns  %6.1f cycles/conversion\n", table.ns, table.cycles);
+#else
+    std::printf("  steinhart-hart (logf)  %6.2f ns/conversion\n", exact.ns);
+    std::printf("  lookup table           %6.2f ns/conversion\n", table.ns);
+#endif
+    std::printf("  speedup %.1fx\n", exact.ns / table.ns);
+    std::printf("  table error: max %.4f °C (at %.1f °C), max %.4f °C over 0..50 °C, compile-time bound %.4f °C\n",
+                worst, worst_at, worst_water, NtcTable::max_error_c());
+    std::printf("  float formula error: max %.4f °C\n", worst_float);
+    std::printf("  (checksum %.3f)\n", checksum);
+
+    bool ok = worst < 0.15;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+// Closed-loop tank simulation for the PID controllers used by StateMachine::pid_control.
+// Runs the heater, dosing and fill-pump loops against simple first-order plant models
+// for millions of 1 s steps, and reports per-update cost and settling behaviour for
+// both the float and the Q16 fixed-point controller.
+//   pid_bench [steps]
+// Exits non-zero if a Q16 output strays more than PID_GAIN_TOLERANCE of the output range
+// from the float one on the same noise, or a default gain does not fit Q16 within it.
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "pid.hpp"
+
+namespace {
+
+// Same gains as state_machine.cpp
+constexpr PidGains PUMP_GAINS = { .kp = 0.05f, .ki = 0.002f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f };
+constexpr PidGains HEATER_GAINS = { .kp = 0.4f, .ki = 0.01f, .kd = 2.0f, .out_min = 0.0f, .out_max = 1.0f };
+constexpr PidGains DOSING_GAINS = { .kp = 0.002f, .ki = 0.0001f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f };
+
+constexpr float DT_S = 1.0f;
+constexpr float TEMP_SETPOINT = 25.0f;
+constexpr float TDS_SETPOINT = 1000.0f;
+constexpr float LEVEL_SETPOINT = 50.0f;
+
+struct Tank {
+    double temp_c = 18.0;
+    double tds_ppm = 400.0;
+    double level_cm = 20.0;
+
+    // 100 L tank, 300 W heater, 8 W/K loss to an 18 °C room
+    // Dosing pump adds 2 ppm/s at full duty, plants take up 0.02 % per second
+    // Fill pump adds 0.1 cm/s at full duty, evaporation and uptake remove 0.002 cm/s
+    void step(float heater, float dosing, float pump, double dt) {
+        temp_c += dt * (300.0 * heater - 8.0 * (temp_c - 18.0)) / 418600.0;
+        tds_ppm += dt * (2.0 * dosing - 0.0002 * tds_ppm);
+        level_cm += dt * (0.1 * pump - 0.002);
+        if (level_cm < 0.0) level_cm = 0.0;
+    }
+};
+
+struct Noise {
+    uint32_t state = 0x12345678u;
+    float next(float amplitude) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return amplitude * ((state & 0xFFFF) / 32768.0f - 1.0f);
+    }
+};
+
+struct Settling {
+    float band;
+    float setpoint;
+    long settled_at = -1;
+    double peak = -1e30;
+
+    void observe(long step, double value) {
+        if (value > peak) peak = value;
+        if (std::fabs(value - setpoint) > band) {
+            settled_at = -1;
+        } else if (settled_at < 0) {
+            settled_at = step;
+        }
+    }
+};
+
+// Heater, dosing and pump outputs of every step go to outputs, 3 per step
+template <typename T>
+void run_closed_loop(const char* name, long steps, std::vector<float>& outputs) {
+    Pid<T> heater(HEATER_GAINS, DT_S);
+    Pid<T> dosing(DOSING_GAINS, DT_S);
+    Pid<T> pump(PUMP_GAINS, DT_S);
+    Tank tank;
+    Noise noise;
+    Settling temp = { 0.25f, TEMP_SETPOINT };
+    Settling tds = { 20.0f, TDS_SETPOINT };
+    Settling level = { 1.0f, LEVEL_SETPOINT };
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < steps; ++i) {
+        float h = static_cast<float>(heater.update(T(TEMP_SETPOINT), T(static_cast<float>(tank.temp_c) + noise.next(0.05f))));
+        float d = static_cast<float>(dosing.update(T(TDS_SETPOINT), T(static_cast<float>(tank.tds_ppm) + noise.next(5.0f))));
+        float p = static_cast<float>(pump.update(T(LEVEL_SETPOINT), T(static_cast<float>(tank.level_cm) + noise.next(0.3f))));
+        tank.step(h, d, p, DT_S);
+        outputs[3 * i] = h;
+        outputs[3 * i + 1] = d;
+        outputs[3 * i + 2] = p;
+        temp.observe(i, tank.temp_c);
+        tds.observe(i, tank.tds_ppm);
+        level.observe(i, tank.level_cm);
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-6s closed loop: %ld steps, %.1f ns/step (3 PIDs + plant)\n", name, steps, elapsed_ns / steps);
+    std::printf("       temp : settled %6ld s, peak %.2f, final %.2f (setpoint %.1f)\n",
+                temp.settled_at, temp.peak, tank.temp_c, TEMP_SETPOINT);
+    std::printf("       tds  : settled %6ld s, peak %.1f, final %.1f (setpoint %.0f)\n",
+                tds.settled_at, tds.peak, tank.tds_ppm, TDS_SETPOINT);
+    std::printf("       level: settled %6ld s, peak %.2f, final %.2f (setpoint %.1f)\n",
+                level.settled_at, level.peak, tank.level_cm, LEVEL_SETPOINT);
+}
+
+// Controller cost alone, fed from a precomputed measurement trace
+template <typename T>
+void run_update_cost(const char* name, long updates) {
+    std::vector<T> trace(4096);
+    Noise noise;
+    for (auto& value : trace) {
+        value = T(TEMP_SETPOINT + noise.next(3.0f));
+    }
+    Pid<T> pid(HEATER_GAINS, DT_S);
+    T setpoint(TEMP_SETPOINT);
+    T sink = T();
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < updates; ++i) {
+        sink += pid.update(setpoint, trace[i & 4095]);
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-6s update: %.2f ns/update (checksum %.3f)\n", name, elapsed_ns / updates, static_cast<float>(sink));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long steps = argc > 1 ? std::atol(argv[1]) : 2000000;
+    bool pass = true;
+    const char* names[] = { "heater", "dosing", "pump" };
+    const PidGains* gains[] = { &HEATER_GAINS, &DOSING_GAINS, &PUMP_GAINS };
+    for (size_t c = 0; c < 3; ++c) {
+        float error = Pid<Q16>::gain_error(*gains[c], DT_S);
+        std::printf("%-6s gains in Q16: worst error %.4f %%\n", names[c], error * 100.0f);
+        pass = pass && error <= PID_GAIN_TOLERANCE;
+    }
+
+    std::vector<float> float_outputs(3 * steps);
+    std::vector<float> q16_outputs(3 * steps);
+    run_closed_loop<float>("float", steps, float_outputs);
+    run_closed_loop<Q16>("q16", steps, q16_outputs);
+    float worst[3] = {};
+    for (long i = 0; i < 3 * steps; ++i) {
+        worst[i % 3] = std::fmax(worst[i % 3], std::fabs(float_outputs[i] - q16_outputs[i]));
+    }
+    for (size_t c = 0; c < 3; ++c) {
+        float range = gains[c]->out_max - gains[c]->out_min;
+        std::printf("%-6s q16 against float: largest output difference %.5f (limit %.5f)\n", names[c], worst[c],
+                    PID_GAIN_TOLERANCE * range);
+        pass = pass && worst[c] <= PID_GAIN_TOLERANCE * range;
+    }
+
+    run_update_cost<float>("float", steps * 10);
+    run_update_cost<Q16>("q16", steps * 10);
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// Sensor pipeline throughput on the host, with simulated ADC waveforms and SEN0311
+// byte streams behind the HAL. Measures each stage on its own and then the whole
+// chain: Adc::read -> TDS/NTC/PH::read -> SensorBoard -> SensorRegistry -> StateMachine.
+//   pipeline_bench [iterations]
+// Exits non-zero if a stage returns errors, so it doubles as a smoke test.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "adc.hpp"
+#include "ntc.hpp"
+#include "ph.hpp"
+#include "sen0311.hpp"
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+#include "state_machine.hpp"
+#include "tds.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ~900 ppm TDS, ~22 °C on the NTC divider, pH ~6
+void set_waveforms(SimAdcDriver& driver) {
+    driver.set_waveform(0, { .offset_v = 0.09f, .amplitude_v = 0.005f, .period_s = 30.0f, .noise_v = 0.004f,
+                             .spike_probability = 0.01f, .spike_v = 0.5f });
+    driver.set_waveform(1, { .offset_v = 1.65f, .amplitude_v = 0.02f, .period_s = 120.0f, .noise_v = 0.01f });
+    driver.set_waveform(2, { .offset_v = 1.80f, .amplitude_v = 0.01f, .period_s = 60.0f, .noise_v = 0.005f,
+                             .spike_probability = 0.005f, .spike_v = 0.3f });
+}
+
+struct Result {
+    double ns_per_op;
+    long errors;
+};
+
+template <typename Op>
+Result measure(long iterations, Op op) {
+    long errors = 0;
+    auto start = Clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        errors += op() ? 0 : 1;
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return { ns / iterations, errors };
+}
+
+void report(const char* name, const Result& result, long iterations, int samples_per_op = 1) {
+    std::printf("  %-34s %9.1f ns/op %12.0f samples/s", name, result.ns_per_op,
+                1e9 / result.ns_per_op * samples_per_op);
+    if (result.errors > 0) {
+        std::printf("  (%ld of %ld failed)", result.errors, iterations);
+    }
+    std::printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    long failures = 0;
+
+    std::printf("pipeline_bench: %ld iterations per stage\n", iterations);
+
+    // Stage 1: ADC conversion and filtering, then the sensor conversions on top
+    {
+        AdcConfigs configs = default_adc_configs();
+        SimAdcDriver driver;
+        set_waveforms(driver);
+        SensorAdc adc(driver, configs, AdcMode::ONESHOT);
+        TDS tds(adc, configs[0], 0);
+        NTC ntc(adc, configs[1], 1);
+        PH ph(adc, configs[2], 2);
+
+        for (size_t channel = 0; channel < configs.size(); ++channel) {
+            char name[40];
+            std::snprintf(name, sizeof(name), "Adc::read ch%d (%s)", static_cast<int>(channel),
+                          channel == 1 ? "EMA" : (channel == 0 ? "MA16+median" : "MA10+trimmed"));
+            Result result = measure(iterations, [&] {
+                float voltage;
+                return adc.read(channel, voltage) == ESP_OK;
+            });
+            report(name, result, iterations);
+            failures += result.errors;
+        }
+
+        Sensor* sensors[] = { &tds, &ntc, &ph };
+        const char* names[] = { "TDS::read", "NTC::read", "PH::read" };
+        for (size_t i = 0; i < 3; ++i) {
+            Result result = measure(iterations, [&] {
+                float value;
+                return sensors[i]->read(value) == ESP_OK;
+            });
+            report(names[i], result, iterations);
+            failures += result.errors;
+        }
+    }
+
+    // Stage 2: SEN0311 decoding from a byte stream with 1% corrupted frames
+    {
+        std::vector<uint8_t> stream;
+        stream.reserve(static_cast<size_t>(iterations) * 4);
+        uint32_t random = 1;
+        long corrupted = 0;
+        for (long i = 0; i < iterations; ++i) {
+            uint8_t frame[4];
+            SimUartDriver::encode_frame(30.0f + (i % 1000) * 0.1f, frame);
+            random = random * 1664525u + 1013904223u;
+            if (random % 100 == 0) {
+                frame[3] ^= 0x5A;
+                corrupted++;
+            }
+            stream.insert(stream.end(), frame, frame + 4);
+        }
+        Sen0311Parser parser;
+        const size_t chunk = 16;    // Roughly what one UART_DATA event carries at 9600 baud
+        auto start = Clock::now();
+        for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+            size_t length = stream.size() - offset < chunk ? stream.size() - offset : chunk;
+            parser.feed(stream.data() + offset, length, 1);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        Sen0311Stats stats = parser.stats();
+        Result result = { ns / iterations, static_cast<long>(iterations - corrupted) - static_cast<long>(stats.frames) };
+        report("Sen0311Parser::feed (per frame)", result, iterations);
+        std::printf("  %-34s %9.1f MB/s, %u frames, %u checksum errors\n", "", stream.size() / ns * 1e3,
+                    stats.frames, stats.checksum_errors);
+        failures += result.errors != 0 ? 1 : 0;
+    }
+
+    // Stage 3: everything behind one StateMachine pass, four sensors per step
+    {
+        SimAdcDriver adc_driver;
+        set_waveforms(adc_driver);
+        SimUartDriver uart_driver(0.0f);
+        UartConfig uart_config = { .port = UART_NUM_1, .tx_pin = 16, .rx_pin = 17, .baud_rate = 9600 };
+        SensorAdc adc(adc_driver, default_adc_configs(), AdcMode::ONESHOT);
+        Uart level_link(uart_driver, uart_config);
+        Zone tank("tank1", adc, 0, level_link, 100.0f);
+        StateMachine state_machine(tank);
+
+        long steps = iterations / 10 > 0 ? iterations / 10 : 1;
+        Result result = measure(steps, [&] {
+            uint8_t frame[4];
+            SimUartDriver::encode_frame(42.0f, frame);
+            uart_driver.inject(frame, sizeof(frame));
+            state_machine.step();
+            return true;
+        });
+        report("StateMachine::step (4 sensors)", result, steps, 4);
+
+        // What the "metrics" console command prints
+        char metrics[METRICS_REPORT_BYTES];
+        state_machine.metrics_report(metrics, sizeof(metrics), MetricsFormat::TEXT);
+        std::printf("\n%s\n", metrics);
+    }
+
+    std::printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+// Record-and-replay on the host. Four parts:
+//  - what recording costs the driver tasks (Capture::record) and the drain task (encoding)
+//  - how many flash records a slow stream costs through FlashCaptureSink: full blocks,
+//    plus a partial one per CAPTURE_FLASH_FLUSH_MS, not one per drain
+//  - a round trip: a few seconds of the simulated drivers recorded through the recording
+//    drivers, oneshot and continuous, then replayed; the replay must decode the same
+//    SEN0311 frames and land on the same sensor values
+//  - a long continuous-mode dataset written straight to a capture and replayed, to show
+//    how much faster than real time a dataset goes through the pipeline
+//   replay_bench [hours] [capture.bin]
+// With a path, the long capture is kept there for host/build/replay.
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "esp_timer.h"
+#include "ram_flash_region.hpp"
+#include "recording_driver.hpp"
+#include "replay.hpp"
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ~900 ppm TDS, ~22 °C on the NTC divider, pH ~6, as pipeline_bench
+void set_waveforms(SimAdcDriver& driver) {
+    driver.set_waveform(0, { .offset_v = 0.09f, .amplitude_v = 0.005f, .period_s = 30.0f, .noise_v = 0.004f,
+                             .spike_probability = 0.01f, .spike_v = 0.5f });
+    driver.set_waveform(1, { .offset_v = 1.65f, .amplitude_v = 0.02f, .period_s = 120.0f, .noise_v = 0.01f });
+    driver.set_waveform(2, { .offset_v = 1.80f, .amplitude_v = 0.01f, .period_s = 60.0f, .noise_v = 0.005f,
+                             .spike_probability = 0.005f, .spike_v = 0.3f });
+}
+
+class NullSink : public CaptureSink {
+    public:
+        uint64_t bytes = 0;
+        esp_err_t write(const uint8_t*, size_t length) override {
+            bytes += length;
+            return ESP_OK;
+        }
+};
+
+using Values = std::array<float, SensorData::TYPE_COUNT>;
+
+Values zone_values(const Zone& zone) {
+    Values values;
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = zone.data()[i].value;
+    }
+    return values;
+}
+
+struct LiveRun {
+    std::vector<Values> cycles;     // After every control cycle
+    Sen0311Stats link;
+    CaptureStats capture;
+};
+
+// The sampler tasks and the states run on the calling thread at their periods on the wall
+// clock, as replay runs them on the captured clock; the drivers run their own threads
+LiveRun record_live(AdcMode mode, double seconds, FILE* out) {
+    Capture capture;
+    FileCaptureSink sink(out);
+    SimAdcDriver sim_adc;
+    set_waveforms(sim_adc);
+    RecordingAdcDriver adc_driver(sim_adc, capture);
+    SensorAdc adc(adc_driver, default_adc_configs(), mode);
+    SimUartDriver sim_uart(10.0f);
+    sim_uart.set_distance_cm(42.0f);
+    RecordingUartDriver uart_driver(sim_uart, capture);
+    UartConfig uart_config = { .port = UART_NUM_1, .tx_pin = 16, .rx_pin = 17, .baud_rate = 9600 };
+    Uart link(uart_driver, uart_config);
+    Zone tank("tank1", adc, 0, link, 100.0f);
+
+    capture.start(sink);
+    const StateSchedule schedule;
+    StateMachine state_machine(tank, schedule);
+
+    LiveRun run;
+    int64_t start_us = esp_timer_get_time();
+    std::array<int64_t, ZONE_SENSORS> sampler_due;
+    sampler_due.fill(start_us);
+    const int64_t state_period_us[StateMachine::STATE_COUNT] = {
+        schedule.acquisition_ms * 1000LL, schedule.control_ms * 1000LL, schedule.telemetry_ms * 1000LL };
+    int64_t state_due[StateMachine::STATE_COUNT] = { start_us, start_us, start_us };
+    int64_t next_drain_us = start_us;
+    while (esp_timer_get_time() - start_us < static_cast<int64_t>(seconds * 1e6)) {
+        int64_t now_us = esp_timer_get_time();
+        for (size_t i = 0; i < ZONE_SENSORS; ++i) {
+            if (sampler_due[i] <= now_us) {
+                tank.samplers()[i].sample_once();
+                sampler_due[i] += tank.samplers()[i].period_ms() * 1000LL;
+            }
+        }
+        for (size_t s = 0; s < StateMachine::STATE_COUNT; ++s) {
+            if (state_due[s] <= now_us) {
+                state_machine.step(static_cast<StateMachine::State>(s));
+                state_due[s] += state_period_us[s];
+                if (static_cast<StateMachine::State>(s) == StateMachine::State::ACTUATOR_CONTROL) {
+                    run.cycles.push_back(zone_values(tank));
+                }
+            }
+        }
+        if (next_drain_us <= now_us) {
+            capture.drain();
+            next_drain_us += 50000;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    // No frame may reach the parser after the capture ends
+    uart_driver.stop();
+    capture.stop();
+    capture.drain();
+    run.link = link.sen0311_stats();
+    run.capture = capture.stats();
+    return run;
+}
+
+bool round_trip(AdcMode mode, double seconds) {
+    const char* name = mode == AdcMode::CONTINUOUS ? "continuous" : "oneshot";
+    FILE* file = std::tmpfile();
+    LiveRun live = record_live(mode, seconds, file);
+    long size = std::ftell(file);
+    std::rewind(file);
+
+    CaptureReader reader(file);
+    Replay replay(reader, ReplayOptions());
+    std::vector<Values> replayed;
+    auto start = Clock::now();
+    esp_err_t ret = replay.run([&](const StateMachine& state_machine, int64_t) {
+        replayed.push_back(zone_values(state_machine.zone(0)));
+    });
+    double wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fclose(file);
+    if (ret != ESP_OK) {
+        std::printf("  %-10s replay failed: %s\n", name, esp_err_to_name(ret));
+        return false;
+    }
+
+    // The estimators see the same readings at slightly different times: compare what
+    // control acted on, cycle by cycle, once the first cycle is past
+    const char* const SENSOR_NAMES[] = { "tds", "temp", "level", "ph" };
+    size_t cycles = std::min(live.cycles.size(), replayed.size());
+    double worst = 0.0;
+    size_t worst_sensor = 0;
+    for (size_t c = 1; c < cycles; ++c) {
+        for (size_t i = 0; i < SensorData::TYPE_COUNT; ++i) {
+            double scale = std::fabs(live.cycles[c][i]) > 1.0 ? std::fabs(live.cycles[c][i]) : 1.0;
+            double error = std::fabs(replayed[c][i] - live.cycles[c][i]) / scale;
+            if (error > worst) {
+                worst = error;
+                worst_sensor = i;
+            }
+        }
+    }
+    Sen0311Stats link = replay.uart(0).sen0311_stats();
+    const ReplayStats& stats = replay.stats();
+    std::printf("  %-10s %6.1f s, %7ld bytes (%5.0f B/s), %6llu events, replayed in %6.1f ms\n", name, seconds,
+                size, size / seconds, static_cast<unsigned long long>(live.capture.events), wall_ms);
+    std::printf("  %-10s frames live %lu replay %lu, control cycles %d/%d, worst difference %.3f%% (%s), "
+                "reads repeated %llu, unread %llu\n",
+                "", static_cast<unsigned long>(live.link.frames), static_cast<unsigned long>(link.frames),
+                static_cast<int>(live.cycles.size()), static_cast<int>(replayed.size()), worst * 100.0,
+                SENSOR_NAMES[worst_sensor], static_cast<unsigned long long>(stats.repeated_reads),
+                static_cast<unsigned long long>(stats.overrun_reads));
+    bool ok = live.capture.dropped == 0 && link.frames == live.link.frames && cycles >= 2 && worst < 0.01;
+    if (!ok) {
+        std::printf("  %-10s FAIL: dropped %lu, frames or values differ\n", name,
+                    static_cast<unsigned long>(live.capture.dropped));
+    }
+    return ok;
+}
+
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    double uniform() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return ((state >> 11) + 0.5) / 9007199254740992.0;
+    }
+};
+
+// Continuous-mode capture as the device writes it: scan frames at ~94 Hz, a SEN0311
+// frame every 100 ms, signals drifting over hours
+void write_dataset(FILE* out, double hours) {
+    FileCaptureSink sink(out);
+    CaptureWriter writer(sink);
+    const float full_scale_mv[ZONE_ADC_CHANNELS] = { 2150.0f, 3300.0f, 3300.0f };
+    CaptureAdcSetup adc = {};
+    adc.channels = ZONE_ADC_CHANNELS;
+    adc.continuous = true;
+    AdcConfigs configs = default_adc_configs();
+    for (size_t i = 0; i < ZONE_ADC_CHANNELS; ++i) {
+        adc.config[i].channel = static_cast<uint8_t>(configs[i].channel);
+        adc.config[i].atten = static_cast<uint8_t>(configs[i].atten);
+        adc.config[i].calibrated = true;
+        for (size_t p = 0; p < ADC_CURVE_POINTS; ++p) {
+            adc.config[i].curve.mv[p] = static_cast<uint16_t>(adc_curve_raw(p) * full_scale_mv[i] / 4095.0f + 0.5f);
+        }
+    }
+    writer.write_adc_setup(0, adc, 1000);
+    writer.write_uart_setup(0, { 1, 9600 }, 1000);
+
+    Rng rng;
+    const int64_t frame_us = 10667;     // 64 conversions of 6 kHz per frame
+    const int64_t end_us = static_cast<int64_t>(hours * 3600e6);
+    int64_t next_level_us = 100000;
+    for (int64_t t = 100000; t < end_us; t += frame_us) {
+        double hours_in = t / 3600e6;
+        const double volts[ZONE_ADC_CHANNELS] = {
+            0.09 + 0.01 * std::sin(hours_in * 0.7) + 0.004 * (rng.uniform() - 0.5),
+            1.65 + 0.05 * std::sin(hours_in * 0.26) + 0.01 * (rng.uniform() - 0.5),
+            1.80 + 0.02 * std::sin(hours_in * 0.5) + 0.005 * (rng.uniform() - 0.5),
+        };
+        CaptureEvent scan = {};
+        scan.time_us = t;
+        scan.kind = CaptureKind::ADC_SCAN;
+        scan.length = ZONE_ADC_CHANNELS;
+        for (size_t i = 0; i < ZONE_ADC_CHANNELS; ++i) {
+            scan.scan[i] = static_cast<int16_t>(volts[i] * 1000.0 / full_scale_mv[i] * 4095.0 + 0.5);
+        }
+        writer.write(scan);
+
+        if (t >= next_level_us) {
+            CaptureEvent data = {};
+            data.time_us = t;
+            data.kind = CaptureKind::UART_DATA;
+            data.length = 4;
+            SimUartDriver::encode_frame(static_cast<float>(45.0 + 5.0 * std::sin(hours_in * 0.3) + 0.3 * rng.uniform()),
+                                        data.data);
+            writer.write(data);
+            next_level_us += 100000;
+        }
+    }
+    writer.flush();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 24.0;
+    const char* dataset_path = argc > 2 ? argv[2] : nullptr;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    bool ok = true;
+
+    // Recorder cost: a scan frame into the ring from a driver task, and its encoding
+    {
+        Capture capture;
+        NullSink sink;
+        capture.start(sink);
+        CaptureEvent event = {};
+        event.kind = CaptureKind::ADC_SCAN;
+        event.length = ZONE_ADC_CHANNELS;
+        const long events = 1000000;
+        double record_ns = 0.0;
+        double drain_ns = 0.0;
+        for (long i = 0; i < events; i += 64) {
+            auto start = Clock::now();
+            for (long j = 0; j < 64; ++j) {
+                event.time_us = (i + j) * 10667;
+                event.scan[0] = static_cast<int16_t>(100 + (j & 7));
+                event.scan[1] = static_cast<int16_t>(2000 + (j & 3));
+                event.scan[2] = static_cast<int16_t>(2200 - (j & 5));
+                capture.record(event);
+            }
+            auto recorded = Clock::now();
+            capture.drain();
+            record_ns += std::chrono::duration<double, std::nano>(recorded - start).count();
+            drain_ns += std::chrono::duration<double, std::nano>(Clock::now() - recorded).count();
+        }
+        CaptureStats stats = capture.stats();
+        std::printf("replay_bench: recording costs %.1f ns per event on the driver task, %.1f ns to encode; "
+                    "%.2f bytes per scan frame\n",
+                    record_ns / events, drain_ns / events, static_cast<double>(stats.bytes) / events);
+        ok = ok && stats.dropped == 0;
+    }
+
+    // Flash wear: ten minutes of SEN0311 frames drained every 200 ms on the simulated clock
+    {
+        RamFlashRegion region(256 * 1024);
+        FlashRing ring(region);
+        FlashCaptureSink sink(ring);
+        Capture capture;
+        ring.mount();
+        capture.start(sink);
+        CaptureEvent event = {};
+        event.kind = CaptureKind::UART_DATA;
+        event.length = 4;
+        const int64_t duration_us = 600000000;
+        uint32_t drains = 0;
+        for (int64_t now_us = 1; now_us <= duration_us; now_us += 100000) {
+            host_set_time_us(now_us);
+            event.time_us = now_us;
+            capture.record(event);
+            if (now_us % 200000 == 1) {
+                capture.drain();
+                drains++;
+            }
+        }
+        capture.stop();
+        capture.drain();
+        host_set_time_us(0);    // Back to the wall clock
+        CaptureStats stats = capture.stats();
+        uint64_t full_blocks = stats.bytes / (sizeof(CaptureBlockHeader) + CAPTURE_BLOCK_BYTES);
+        uint64_t partial_allowed = duration_us / 1000 / CAPTURE_FLASH_FLUSH_MS + 1;
+        std::printf("replay_bench: flash sink, 10 min at 10 Hz: %lu blocks for %.1f KB over %lu drains "
+                    "(%lu partial allowed)\n", static_cast<unsigned long>(stats.blocks), stats.bytes / 1024.0,
+                    static_cast<unsigned long>(drains), static_cast<unsigned long>(partial_allowed));
+        ok = ok && stats.dropped == 0 && ring.pending() == stats.blocks &&
+             stats.blocks <= full_blocks + partial_allowed + 1;
+    }
+
+    std::printf("\nround trip, simulated drivers -> capture -> replay:\n");
+    ok = round_trip(AdcMode::ONESHOT, 3.0) && ok;
+    ok = round_trip(AdcMode::CONTINUOUS, 3.0) && ok;
+
+    std::printf("\n%.1f h continuous-mode dataset:\n", hours);
+    FILE* file = dataset_path ? std::fopen(dataset_path, "w+b") : std::tmpfile();
+    if (!file) {
+        std::perror(dataset_path);
+        return 1;
+    }
+    auto start = Clock::now();
+    write_dataset(file, hours);
+    double write_s = std::chrono::duration<double>(Clock::now() - start).count();
+    long size = std::ftell(file);
+    std::rewind(file);
+
+    CaptureReader reader(file);
+    Replay replay(reader, ReplayOptions());
+    float min_level = INFINITY;
+    float max_level = -INFINITY;
+    start = Clock::now();
+    esp_err_t ret = replay.run([&](const StateMachine& state_machine, int64_t time_us) {
+        if (time_us < 2000000) {
+            return;     // Before the first frames
+        }
+        float level = state_machine.zone(0).data()[static_cast<size_t>(SensorData::Type::WATER_LEVEL)].value;
+        min_level = std::min(min_level, level);
+        max_level = std::max(max_level, level);
+    });
+    double replay_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::fclose(file);
+    const ReplayStats& stats = replay.stats();
+    double captured_s = (stats.last_us - stats.first_us) / 1e6;
+    std::printf("  capture %.1f MB (%.1f MB per day), written in %.2f s\n", size / 1e6, size / 1e6 * 24.0 / hours,
+                write_s);
+    std::printf("  replayed %.0f s in %.2f s: %.0fx real time, %.2f M events/s, %llu sensor reads, %lu control cycles\n",
+                captured_s, replay_s, captured_s / replay_s, stats.events / replay_s / 1e6,
+                static_cast<unsigned long long>(stats.samples), static_cast<unsigned long>(stats.control_cycles));
+    std::printf("  level seen by control %.1f..%.1f cm (captured distances 40..50.3 cm in a 100 cm tank)\n", min_level, max_level);
+    ok = ok && ret == ESP_OK && reader.skipped_bytes() == 0 && reader.bad_records() == 0 &&
+         stats.control_cycles + 2 >= static_cast<uint32_t>(captured_s) && min_level > 49.0f && max_level < 60.5f;
+
+    std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// Boot to first valid control decision, on the host: the state machine runs on its
+// own task with the simulated ADC and a SEN0311 reporting at 10 Hz, as on the device.
+// Prints the startup timeline (see StartupStats) against what it would take the
+// unprimed moving averages to fill.
+//   startup_bench [oneshot|continuous]
+// Exits non-zero if no valid decision is taken within 5 s.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "esp_timer.h"
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+#include "state_machine.hpp"
+
+namespace {
+
+void run_task(void* arg) {
+    static_cast<StateMachine*>(arg)->run();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool continuous = argc > 1 && std::strcmp(argv[1], "continuous") == 0;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    int64_t boot_us = esp_timer_get_time();
+
+    // Objects outlive main: the state machine task is never stopped
+    static SimAdcDriver adc_driver;
+    adc_driver.set_waveform(0, { .offset_v = 0.09f, .noise_v = 0.004f, .spike_probability = 0.01f, .spike_v = 0.5f });
+    adc_driver.set_waveform(1, { .offset_v = 1.65f, .noise_v = 0.01f });
+    adc_driver.set_waveform(2, { .offset_v = 1.80f, .noise_v = 0.005f });
+    static SimUartDriver uart_driver(10.0f);
+    uart_driver.set_distance_cm(42.0f);
+    UartConfig uart_config = { .port = UART_NUM_1, .tx_pin = 16, .rx_pin = 17, .baud_rate = 9600 };
+    static SensorAdc adc(adc_driver, default_adc_configs(), continuous ? AdcMode::CONTINUOUS : AdcMode::ONESHOT);
+    static Uart level_link(uart_driver, uart_config);
+    static Zone tank("tank1", adc, 0, level_link, 100.0f);
+    static StateMachine state_machine(tank);
+    xTaskCreate(run_task, "state_machine", 8192, &state_machine, 5, nullptr);
+
+    StartupStats stats = {};
+    for (int waited_ms = 0; stats.first_control_us == 0 && waited_ms < 5000; ++waited_ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = state_machine.startup_stats();
+    }
+
+    std::printf("startup_bench: %s ADC, SEN0311 at 10 Hz\n", continuous ? "continuous" : "oneshot");
+    if (stats.first_control_us == 0) {
+        std::printf("  no valid control decision within 5 s\nFAIL\n");
+        std::fflush(stdout);
+        std::_Exit(1);
+    }
+    std::printf("  %-32s %8.1f ms\n", "ADC primed", (stats.adc_primed_us - boot_us) / 1000.0);
+    std::printf("  %-32s %8.1f ms\n", "state machine started", (stats.started_us - boot_us) / 1000.0);
+    std::printf("  %-32s %8.1f ms\n", "every sensor settled", (stats.inputs_ready_us - boot_us) / 1000.0);
+    std::printf("  %-32s %8.1f ms\n", "first valid control decision", (stats.first_control_us - boot_us) / 1000.0);
+    // Without priming a moving average is biased until its window is full of real samples
+    std::printf("  %-32s %8.1f ms (TDS window of 16 at 50 ms)\n", "unprimed TDS average full", 16 * 50.0);
+    std::printf("PASS\n");
+    std::fflush(stdout);
+    std::_Exit(0);
+}
@@ -0,0 +1,184 @@
+// Telemetry pipeline simulation: feeds a few hours of simulated sensor data at the
+// acquisition rate through TelemetryPublisher, with a broker outage in the middle
+// and a reboot during the outage. Batches go to a real broker when one answers at
+// host:port (e.g. `mosquitto -p 1883`), otherwise to an in-process sink. Every
+// delivered batch is decoded to check nothing was lost or reordered.
+//   telemetry_sim [hours] [host] [port]
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "telemetry_decode.hpp"
+#include "flash_ring.hpp"
+#include "posix_mqtt_transport.hpp"
+#include "ram_flash_region.hpp"
+
+namespace {
+
+constexpr int64_t ACQUISITION_MS = 100;     // StateSchedule defaults
+constexpr int64_t TELEMETRY_MS = 10000;
+constexpr size_t SPILL_BYTES = 64 * 1024;
+constexpr size_t READING_JSON_BYTES = 60;  // {"type":"tds","value":912.34,"ts":1712345678901}, for comparison
+
+// Forwards to the broker if there is one, counts and checks every batch either way
+class SimTransport : public TelemetryTransport {
+    PosixMqttTransport* broker_;
+    bool online_ = true;
+
+    public:
+        size_t messages = 0;
+        size_t bytes = 0;
+        size_t samples = 0;
+        size_t reordered = 0;
+        size_t malformed = 0;
+        int64_t last_time_ms = -1;
+
+        explicit SimTransport(PosixMqttTransport* broker) : broker_(broker) {}
+
+        void set_online(bool online) {
+            online_ = online;
+            if (broker_ != nullptr) {
+                if (online) {
+                    broker_->connect();
+                } else {
+                    broker_->disconnect();
+                }
+            }
+        }
+
+        bool connected() const override { return online_ && (broker_ == nullptr || broker_->connected()); }
+
+        esp_err_t publish(const char* topic, const uint8_t* data, size_t length) override {
+            if (!connected()) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (broker_ != nullptr) {
+                esp_err_t ret = broker_->publish(topic, data, length);
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+            }
+            std::vector<SensorData::Type> types;
+            std::vector<int64_t> times;
+            std::vector<float> values;
+            if (!telemetry_decode(data, length, types, times, values)) {
+                malformed++;
+            }
+            for (int64_t t : times) {
+                if (t <= last_time_ms) {
+                    reordered++;
+                }
+                last_time_ms = t;
+            }
+            messages++;
+            bytes += length;
+            samples += times.size();
+            return ESP_OK;
+        }
+};
+
+std::vector<SensorData> make_readings(int64_t time_ms, uint32_t& noise) {
+    auto jitter = [&noise](float amplitude) {
+        noise = noise * 1664525u + 1013904223u;
+        return amplitude * (((noise >> 8) / 16777216.0f) - 0.5f);
+    };
+    double hours = time_ms / 3600000.0;
+    return {
+        { SensorData::Type::TDS, 900.0f + 50.0f * static_cast<float>(std::sin(hours)) + jitter(4.0f) },
+        { SensorData::Type::NTC, 22.5f + 1.5f * static_cast<float>(std::sin(hours / 3.0)) + jitter(0.05f) },
+        { SensorData::Type::WATER_LEVEL, 60.0f - 2.0f * static_cast<float>(hours) + jitter(0.3f) },
+        { SensorData::Type::PH, 6.0f + 0.2f * static_cast<float>(std::cos(hours)) + jitter(0.02f) },
+    };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::atof(argv[1]) : 4.0;
+    std::string host = argc > 2 ? argv[2] : "localhost";
+    int port = argc > 3 ? std::atoi(argv[3]) : 1883;
+
+    PosixMqttTransport broker(host, port, "hydroponics-sim");
+    bool use_broker = broker.connect() == ESP_OK;
+    std::printf("telemetry_sim: %.1f h simulated, %s\n", hours,
+                use_broker ? ("publishing to " + host + ":" + std::to_string(port)).c_str()
+                           : "no broker reachable, using in-process sink");
+    SimTransport transport(use_broker ? &broker : nullptr);
+
+    RamFlashRegion region(SPILL_BYTES);
+    auto spill = std::make_unique<FlashRing>(region);
+    spill->mount();
+    TelemetryConfig config;
+    config.topic = "hydroponics/sim/telemetry";
+    auto publisher = std::make_unique<TelemetryPublisher>(transport, spill.get(), config);
+
+    const int64_t end_ms = static_cast<int64_t>(hours * 3600000.0);
+    const int64_t outage_start_ms = end_ms / 4;
+    const int64_t outage_end_ms = end_ms / 2;
+    const int64_t reboot_ms = (outage_start_ms + outage_end_ms) / 2;
+    uint32_t noise = 12345;
+    size_t max_pending = 0;
+    size_t produced = 0;
+    TelemetryStats totals = {};
+    auto accumulate = [&totals](const TelemetryStats& s) {
+        totals.samples += s.samples;
+        totals.batches += s.batches;
+        totals.published += s.published;
+        totals.spilled += s.spilled;
+        totals.drained += s.drained;
+        totals.dropped += s.dropped;
+    };
+
+    for (int64_t now = 0; now < end_ms; now += ACQUISITION_MS) {
+        if (now == outage_start_ms) {
+            transport.set_online(false);
+        } else if (now == outage_end_ms) {
+            transport.set_online(true);
+        }
+        if (now == reboot_ms) {
+            // Power loss: RAM state is gone, only what was spilled to flash survives
+            accumulate(publisher->stats());
+            publisher.reset();
+            spill = std::make_unique<FlashRing>(region);
+            spill->mount();
+            publisher = std::make_unique<TelemetryPublisher>(transport, spill.get(), config);
+        }
+        std::vector<SensorData> readings = make_readings(now, noise);
+        publisher->add(readings.data(), readings.size(), now);
+        produced += now % config.sample_interval_ms == 0 ? 1 : 0;
+        if (now % TELEMETRY_MS == 0) {
+            publisher->service();
+            max_pending = spill->pending() > max_pending ? spill->pending() : max_pending;
+        }
+    }
+    publisher->flush();
+    while (spill->pending() > 0) {
+        publisher->service();
+    }
+    publisher->service();
+    accumulate(publisher->stats());
+
+    // Without spill overflow, only the reboot loses data: whatever was still in RAM
+    size_t lost = produced - transport.samples;
+    size_t ram_capacity = (TELEMETRY_QUEUE_DEPTH + 1) * config.samples_per_batch;
+    size_t raw_sample_bytes = 8 + 4 * sizeof(float);
+    std::printf("  samples: %zu produced, %zu delivered in %zu messages, %zu lost\n",
+                produced, transport.samples, transport.messages, lost);
+    std::printf("  batches: %u built, %u published, %u spilled to flash, %u drained, %u dropped, peak %zu pending\n",
+                totals.batches, totals.published, totals.spilled, totals.drained, totals.dropped, max_pending);
+    std::printf("  payload: %zu bytes, %.2f bytes/sample (raw struct %zu, JSON per reading ~%zu)\n",
+                transport.bytes, static_cast<double>(transport.bytes) / transport.samples,
+                raw_sample_bytes, 4 * READING_JSON_BYTES);
+    std::printf("  messages per hour: %.0f (one per reading would be %.0f)\n",
+                transport.messages / hours, 4 * 3600.0 * 1000 / config.sample_interval_ms);
+    std::printf("  reordered: %zu, malformed: %zu\n", transport.reordered, transport.malformed);
+
+    bool ok = transport.reordered == 0 && transport.malformed == 0 && totals.dropped == 0 &&
+              transport.samples <= produced && lost <= ram_capacity;
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
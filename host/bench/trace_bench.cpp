@@ -0,0 +1,109 @@
+// Cost of logging in the sensor loop: StateMachine::step() with the trace log off, on
+// (binary records only, drained outside the loop as the low-priority task would), and
+// with every record formatted inside the loop, which is what per-cycle printf costs.
+//   trace_bench [steps] [capture.bin]
+// With a capture path the "on" run also writes a binary capture for trace_decode.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+#include "state_machine.hpp"
+#include "trace.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class NullTraceSink : public TraceSink {
+    public:
+        void write(const TraceRecord*, size_t, uint32_t) override {}
+};
+
+void set_levels(esp_log_level_t level) {
+    for (size_t i = 0; i < TRACE_MODULE_COUNT; ++i) {
+        trace_log().set_level(static_cast<TraceModule>(i), level);
+    }
+}
+
+// Mean ns per step; sink is drained after every step, inside the timing if inline
+double run(StateMachine& state_machine, SimUartDriver& uart_driver, long steps, TraceSink& sink, bool inline_drain) {
+    double ns = 0.0;
+    for (long i = 0; i < steps; ++i) {
+        uint8_t frame[4];
+        SimUartDriver::encode_frame(42.0f, frame);
+        uart_driver.inject(frame, sizeof(frame));
+        auto start = Clock::now();
+        state_machine.step();
+        if (inline_drain) {
+            trace_log().drain(sink);
+        }
+        ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (!inline_drain) {
+            trace_log().drain(sink);
+        }
+    }
+    return ns / steps;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long steps = argc > 1 ? std::atol(argv[1]) : 100000;
+    const char* capture_path = argc > 2 ? argv[2] : nullptr;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    SimAdcDriver adc_driver;
+    adc_driver.set_waveform(0, { .offset_v = 0.09f, .noise_v = 0.004f });
+    adc_driver.set_waveform(1, { .offset_v = 1.65f, .noise_v = 0.01f });
+    adc_driver.set_waveform(2, { .offset_v = 1.80f, .noise_v = 0.005f });
+    SimUartDriver uart_driver(0.0f);
+    UartConfig uart_config = { .port = UART_NUM_1, .tx_pin = 16, .rx_pin = 17, .baud_rate = 9600 };
+    SensorAdc adc(adc_driver, default_adc_configs(), AdcMode::ONESHOT);
+    Uart level_link(uart_driver, uart_config);
+    Zone tank("tank1", adc, 0, level_link, 100.0f);
+    StateMachine state_machine(tank);
+
+    NullTraceSink null_sink;
+    FILE* dev_null = std::fopen("/dev/null", "w");
+    TextTraceSink text_sink(dev_null);
+    FILE* capture = capture_path ? std::fopen(capture_path, "wb") : nullptr;
+    BinaryTraceSink binary_sink(capture);
+
+    std::printf("trace_bench: %ld steps, 4 sensors per step\n", steps);
+    struct Case {
+        const char* name;
+        esp_log_level_t level;
+        TraceSink* sink;
+        bool inline_drain;
+    };
+    const Case cases[] = {
+        { "trace off", ESP_LOG_NONE, &null_sink, false },
+        { "trace on, info", ESP_LOG_INFO, capture ? static_cast<TraceSink*>(&binary_sink) : &null_sink, false },
+        { "trace on, debug", ESP_LOG_DEBUG, &null_sink, false },
+        { "formatted in loop, info", ESP_LOG_INFO, &text_sink, true },
+        { "formatted in loop, debug", ESP_LOG_DEBUG, &text_sink, true },
+    };
+    set_levels(ESP_LOG_NONE);
+    run(state_machine, uart_driver, steps, null_sink, false);    // Settle caches and branch predictors
+    double baseline = 0.0;
+    for (const Case& c : cases) {
+        set_levels(c.level);
+        run(state_machine, uart_driver, steps / 10 + 1, *c.sink, c.inline_drain);   // Warm up
+        double ns = run(state_machine, uart_driver, steps, *c.sink, c.inline_drain);
+        if (baseline == 0.0) {
+            baseline = ns;
+        }
+        std::printf("  %-28s %9.1f ns/step  %+7.1f%%\n", c.name, ns, (ns / baseline - 1.0) * 100.0);
+    }
+    std::printf("  %lu records dropped\n", static_cast<unsigned long>(trace_log().dropped()));
+
+    if (capture) {
+        std::fclose(capture);
+        std::printf("  capture written to %s\n", capture_path);
+    }
+    std::fclose(dev_null);
+    return 0;
+}
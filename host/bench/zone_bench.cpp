@@ -0,0 +1,188 @@
+// Loop time as tanks are added: 1 to MAX_ZONES zones, two per simulated ADC unit and
+// one SEN0311 link each, driven by one StateMachine. Times each stage of a pass on its
+// own (sampling every sensor, acquisition, control, telemetry with batching and the
+// metrics report) and what the default schedule costs per second of CPU.
+//   zone_bench [passes]
+// Exits non-zero if a zone never settles or the metrics report does not fit.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+#include "state_machine.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t ZONES_PER_UNIT = 2;
+using UnitAdc = ZoneAdc<ZONES_PER_UNIT>;
+
+// The default channel setup for every zone on a unit
+std::array<AdcConfig, ZONES_PER_UNIT * ZONE_ADC_CHANNELS> unit_configs() {
+    std::array<AdcConfigs, ZONES_PER_UNIT> zones;
+    zones.fill(default_adc_configs());
+    return zone_adc_configs<ZONES_PER_UNIT>(zones);
+}
+
+// Connected, accepts everything: measures encoding and batching, not the network
+class NullTransport : public TelemetryTransport {
+    public:
+        uint32_t messages = 0;
+        bool connected() const override { return true; }
+        esp_err_t publish(const char*, const uint8_t*, size_t) override {
+            messages++;
+            return ESP_OK;
+        }
+};
+
+// Drivers, links and zones of one configuration; all heap-allocated, unlike the device
+struct Plant {
+    std::vector<std::unique_ptr<SimAdcDriver>> adc_drivers;
+    std::vector<std::unique_ptr<UnitAdc>> adcs;
+    std::vector<std::unique_ptr<SimUartDriver>> uart_drivers;
+    std::vector<std::unique_ptr<Uart>> links;
+    std::vector<std::unique_ptr<Zone>> zones;
+    std::vector<Zone*> zone_ptrs;
+    std::vector<std::string> names;
+
+    explicit Plant(size_t zone_count) {
+        names.reserve(zone_count);
+        for (size_t z = 0; z < zone_count; ++z) {
+            if (z % ZONES_PER_UNIT == 0) {
+                adc_drivers.push_back(std::make_unique<SimAdcDriver>());
+                SimAdcDriver& driver = *adc_drivers.back();
+                for (size_t c = 0; c < ZONES_PER_UNIT * ZONE_ADC_CHANNELS; c += ZONE_ADC_CHANNELS) {
+                    driver.set_waveform(c, { .offset_v = 0.09f, .noise_v = 0.004f });
+                    driver.set_waveform(c + 1, { .offset_v = 1.65f, .noise_v = 0.01f });
+                    driver.set_waveform(c + 2, { .offset_v = 1.80f, .noise_v = 0.005f });
+                }
+                adcs.push_back(std::make_unique<UnitAdc>(driver, unit_configs(), AdcMode::ONESHOT));
+            }
+            uart_drivers.push_back(std::make_unique<SimUartDriver>(0.0f));
+            UartConfig uart_config = { .port = static_cast<uart_port_t>(1 + z), .tx_pin = 16, .rx_pin = 17,
+                                       .baud_rate = 9600 };
+            links.push_back(std::make_unique<Uart>(*uart_drivers.back(), uart_config));
+            names.push_back("tank" + std::to_string(z + 1));
+            zones.push_back(std::make_unique<Zone>(names.back().c_str(), *adcs.back(),
+                                                   (z % ZONES_PER_UNIT) * ZONE_ADC_CHANNELS, *links.back(), 100.0f));
+            zone_ptrs.push_back(zones.back().get());
+        }
+    }
+
+    // One SEN0311 frame per link, as if each had just reported
+    void feed(float distance_cm) {
+        uint8_t frame[4];
+        SimUartDriver::encode_frame(distance_cm, frame);
+        for (auto& driver : uart_drivers) {
+            driver->inject(frame, sizeof(frame));
+        }
+    }
+};
+
+struct StageTimes {
+    double sampling_ns = 0.0;
+    double acquisition_ns = 0.0;
+    double control_ns = 0.0;
+    double telemetry_ns = 0.0;
+};
+
+template <typename Op>
+double timed(Op op) {
+    auto start = Clock::now();
+    op();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long passes = argc > 1 ? std::atol(argv[1]) : 5000;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    bool ok = true;
+
+    // Default schedule: acquisition 10 Hz, control 1 Hz, telemetry 0.1 Hz; the samplers at
+    // their full rates, 20 + 5 + 20 + 10 reads per second per zone
+    const StateSchedule schedule;
+    const double reads_per_s_per_zone = 55.0;
+
+    std::printf("zone_bench: %ld passes, %d zones per ADC unit, sizeof(Zone) %d, sizeof(StateMachine) %d bytes\n",
+                passes, static_cast<int>(ZONES_PER_UNIT), static_cast<int>(sizeof(Zone)),
+                static_cast<int>(sizeof(StateMachine)));
+    std::printf("  %5s %10s %10s %10s %10s %10s %11s %9s\n", "zones", "sample us", "acquire us", "control us",
+                "telem us", "pass us", "us/zone", "cpu/s us");
+
+    for (size_t zone_count : { 1, 2, 4, 8 }) {
+        if (zone_count > MAX_ZONES) {
+            break;
+        }
+        Plant plant(zone_count);
+        StateMachine state_machine(plant.zone_ptrs.data(), plant.zone_ptrs.size(), schedule);
+        NullTransport transport;
+        TelemetryConfig telemetry_config;
+        telemetry_config.sample_interval_ms = 0;    // Every acquisition pass goes into a batch
+        TelemetryPublisher telemetry(transport, nullptr, telemetry_config);
+        state_machine.set_telemetry(&telemetry);
+
+        // Settle every zone, then time each stage separately
+        for (int i = 0; i < 50; ++i) {
+            plant.feed(42.0f);
+            state_machine.step();
+        }
+        for (size_t z = 0; z < zone_count; ++z) {
+            if (!state_machine.zone(z).ready()) {
+                std::printf("  zone %s never settled\n", state_machine.zone(z).name());
+                ok = false;
+            }
+        }
+        StageTimes t;
+        for (long i = 0; i < passes; ++i) {
+            plant.feed(42.0f);
+            t.sampling_ns += timed([&] {
+                for (Zone* zone : plant.zone_ptrs) {
+                    zone->sample_once();
+                }
+            });
+            t.acquisition_ns += timed([&] { state_machine.step(StateMachine::State::SENSOR_DATA_ACQUISITION); });
+            t.control_ns += timed([&] { state_machine.step(StateMachine::State::ACTUATOR_CONTROL); });
+            // The telemetry stage runs at 0.1 Hz; once every 10 passes keeps the numbers honest
+            if (i % 10 == 0) {
+                t.telemetry_ns += timed([&] { state_machine.step(StateMachine::State::MQTT_COMMUNICATION); });
+            }
+        }
+        double sample_us = t.sampling_ns / passes / 1000.0;
+        double acquire_us = t.acquisition_ns / passes / 1000.0;
+        double control_us = t.control_ns / passes / 1000.0;
+        double telemetry_us = t.telemetry_ns / ((passes + 9) / 10) / 1000.0;
+        double pass_us = sample_us + acquire_us + control_us + telemetry_us;
+        // One second of the default schedule: every sensor read at full rate plus each stage at its period
+        double cpu_us = sample_us / ZONE_SENSORS * reads_per_s_per_zone +
+                        acquire_us * (1000.0 / schedule.acquisition_ms) + control_us * (1000.0 / schedule.control_ms) +
+                        telemetry_us * (1000.0 / schedule.telemetry_ms);
+        std::printf("  %5d %10.2f %10.2f %10.2f %10.2f %10.2f %11.2f %9.1f\n", static_cast<int>(zone_count),
+                    sample_us, acquire_us, control_us, telemetry_us, pass_us, pass_us / zone_count, cpu_us);
+
+        char report[METRICS_REPORT_BYTES];
+        size_t length = state_machine.metrics_report(report, sizeof(report), MetricsFormat::JSON);
+        if (length + 1 >= sizeof(report)) {
+            std::printf("  metrics report truncated at %d bytes\n", static_cast<int>(length));
+            ok = false;
+        }
+        if (zone_count == 8) {
+            const TelemetryStats& stats = telemetry.stats();
+            std::printf("  8 zones: metrics JSON %d bytes, telemetry batches of %lu samples, %lu bytes\n",
+                        static_cast<int>(length),
+                        static_cast<unsigned long>(stats.batches > 0 ? stats.samples / stats.batches : 0),
+                        static_cast<unsigned long>(stats.published > 0 ? stats.bytes_published / stats.published : 0));
+        }
+    }
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+// Host stand-in for the ESP-IDF logger: prints to stderr, filtered by esp_log_level_set
+#pragma once
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+// One level for every tag; benchmarks turn INFO off so the console does not dominate
+inline esp_log_level_t host_log_level = ESP_LOG_INFO;
+
+static inline void esp_log_level_set(const char* /*tag*/, esp_log_level_t level) {
+    host_log_level = level;
+}
+
+#define HOST_LOG(level, letter, tag, format, ...) \
+    do { \
+        if (host_log_level >= (level)) { \
+            fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
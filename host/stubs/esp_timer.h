@@ -0,0 +1,27 @@
+// Host stand-in for esp_timer: microseconds on the monotonic clock since the first call,
+// or the simulated time a replay has set
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+// Host only: replay runs on the recorded timestamps instead of the wall clock. A time
+// above 0 replaces the clock; 0 goes back to it. FreeRTOS ticks stay on the wall clock.
+inline std::atomic<int64_t>& host_simulated_time_us() {
+    static std::atomic<int64_t> time_us(0);
+    return time_us;
+}
+
+inline void host_set_time_us(int64_t time_us) {
+    host_simulated_time_us().store(time_us, std::memory_order_relaxed);
+}
+
+inline int64_t esp_timer_get_time() {
+    int64_t simulated_us = host_simulated_time_us().load(std::memory_order_relaxed);
+    if (simulated_us > 0) {
+        return simulated_us;
+    }
+    // Start at 1: callers use a timestamp of 0 for "never"
+    static const auto start = std::chrono::steady_clock::now() - std::chrono::microseconds(1);
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,16 @@
+// Host stand-in for FreeRTOS: one tick per millisecond
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdFAIL              0
+#define pdPASS              1
@@ -0,0 +1,45 @@
+// Host stand-in for FreeRTOS tasks on std::thread. Tasks run detached until the process
+// exits; deleting another task is not supported (vTaskDelete only forgets the handle),
+// so only start tasks whose objects live for the whole program.
+#pragma once
+#include <chrono>
+#include <thread>
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct HostTask* TaskHandle_t;
+
+inline TickType_t xTaskGetTickCount(void) {
+    static const auto start = std::chrono::steady_clock::now();
+    return static_cast<TickType_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t task, const char* /*name*/, uint32_t /*stack*/, void* arg,
+                              UBaseType_t /*priority*/, TaskHandle_t* handle) {
+    xTaskGetTickCount();    // Pin the tick origin before the task can use it
+    std::thread(task, arg).detach();
+    if (handle) {
+        static char dummy;
+        *handle = reinterpret_cast<TaskHandle_t>(&dummy);
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t /*task*/) {
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline BaseType_t xTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    *previous_wake = wake;
+    if (static_cast<int32_t>(wake - now) <= 0) {
+        return pdFALSE;
+    }
+    vTaskDelay(wake - now);
+    return pdTRUE;
+}
@@ -0,0 +1,4 @@
+// Host stand-in: UART port numbers used by UartConfig
+#pragma once
+
+typedef enum { UART_NUM_0, UART_NUM_1, UART_NUM_2, UART_NUM_MAX } uart_port_t;
@@ -0,0 +1,2 @@
+// Host stand-in, mirrors the esp32c6 target: no FPU, so control math runs in Q16
+#pragma once
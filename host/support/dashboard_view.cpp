@@ -0,0 +1,85 @@
+#include "dashboard_view.hpp"
+
+static bool get_varint(const uint8_t* data, size_t length, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < length; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+bool dashboard_decode(const uint8_t* data, size_t length, DashboardView& view) {
+    size_t pos = 1;
+    uint64_t sequence = 0;
+    uint64_t time_ms = 0;
+    if (length < 2) {
+        return false;
+    }
+    if (data[0] == 'K') {
+        if (data[pos++] != DASHBOARD_FORMAT_VERSION || !get_varint(data, length, pos, sequence) ||
+            !get_varint(data, length, pos, time_ms) || pos >= length) {
+            return false;
+        }
+        size_t zones = data[pos++];
+        view.zone_names.clear();
+        for (size_t z = 0; z < zones; ++z) {
+            if (pos >= length || pos + 1 + data[pos] > length) {
+                return false;
+            }
+            size_t name_length = data[pos++];
+            view.zone_names.emplace_back(reinterpret_cast<const char*>(data + pos), name_length);
+            pos += name_length;
+        }
+        if (pos >= length) {
+            return false;
+        }
+        size_t channels = data[pos++];
+        if (channels > DASHBOARD_MAX_CHANNELS || pos + channels > length) {
+            return false;
+        }
+        view.types.clear();
+        view.values.assign(channels, 0);
+        for (size_t i = 0; i < channels; ++i) {
+            if (data[pos] >= SensorData::TYPE_COUNT) {
+                return false;
+            }
+            view.types.push_back(static_cast<SensorData::Type>(data[pos++]));
+        }
+        for (size_t i = 0; i < channels; ++i) {
+            uint64_t zz;
+            if (!get_varint(data, length, pos, zz)) {
+                return false;
+            }
+            view.values[i] = unzigzag(static_cast<uint32_t>(zz));
+        }
+        view.sequence = static_cast<uint32_t>(sequence);
+        view.time_ms = static_cast<int64_t>(time_ms);
+        return pos == length;
+    }
+    uint64_t changed;
+    if (data[0] != 'D' || !get_varint(data, length, pos, sequence) || !get_varint(data, length, pos, time_ms) ||
+        !get_varint(data, length, pos, changed) || view.sequence == 0 || sequence != view.sequence + 1u) {
+        return false;
+    }
+    for (size_t i = 0; i < view.values.size(); ++i) {
+        uint64_t zz;
+        if (changed & (1ull << i)) {
+            if (!get_varint(data, length, pos, zz)) {
+                return false;
+            }
+            view.values[i] = static_cast<int32_t>(static_cast<uint32_t>(view.values[i]) +
+                                                  static_cast<uint32_t>(unzigzag(static_cast<uint32_t>(zz))));
+        }
+    }
+    view.sequence = static_cast<uint32_t>(sequence);
+    view.time_ms += static_cast<int64_t>(time_ms);
+    return pos == length;
+}
@@ -0,0 +1,25 @@
+#ifndef DASHBOARD_VIEW_HPP
+#define DASHBOARD_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dashboard.hpp"
+
+// Client side of the dashboard WebSocket format (see Dashboard), for host tools and tests:
+// what a browser shows after the messages applied so far
+struct DashboardView {
+    uint32_t sequence = 0;
+    int64_t time_ms = 0;
+    std::vector<std::string> zone_names;
+    std::vector<SensorData::Type> types;
+    std::vector<int32_t> values;    // Fixed point
+    float value(size_t channel) const { return static_cast<float>(values[channel]) / telemetry_scale(types[channel]); }
+};
+
+// Applies one message payload to the view; false on malformed input or a delta that does
+// not follow the view's sequence
+bool dashboard_decode(const uint8_t* data, size_t length, DashboardView& view);
+
+#endif // DASHBOARD_VIEW_HPP
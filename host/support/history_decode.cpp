@@ -0,0 +1,66 @@
+#include "history_decode.hpp"
+
+#include "telemetry.hpp"
+
+static bool get_varint(const uint8_t* data, size_t length, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < length; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+bool history_decode(const uint8_t* data, size_t length,
+                    std::vector<SensorData::Type>& types, std::vector<int64_t>& times_ms,
+                    std::vector<float>& values) {
+    types.clear();
+    times_ms.clear();
+    values.clear();
+    if (length < HISTORY_ARCHIVE_HEADER_BYTES || data[0] != 'H' || data[1] != 'S' ||
+        data[2] != HISTORY_FORMAT_VERSION) {
+        return false;
+    }
+    size_t channels = data[3];
+    size_t pos = HISTORY_ARCHIVE_HEADER_BYTES;
+    if (channels == 0 || channels > HISTORY_MAX_CHANNELS || pos + channels > length) {
+        return false;
+    }
+    for (size_t i = 0; i < channels; ++i) {
+        if (data[pos] >= SensorData::TYPE_COUNT) {
+            return false;
+        }
+        types.push_back(static_cast<SensorData::Type>(data[pos++]));
+    }
+
+    // The keyframe is coded against time 0 and all-zero values, like every later row
+    int64_t time_ms = 0;
+    std::vector<int32_t> row(channels, 0);
+    while (pos < length) {
+        uint64_t dt_ms;
+        if (!get_varint(data, length, pos, dt_ms)) {
+            return false;
+        }
+        time_ms += static_cast<int64_t>(dt_ms);
+        for (size_t i = 0; i < channels; ++i) {
+            uint64_t zz;
+            if (!get_varint(data, length, pos, zz)) {
+                return false;
+            }
+            row[i] = static_cast<int32_t>(static_cast<uint32_t>(row[i]) +
+                                          static_cast<uint32_t>(unzigzag(static_cast<uint32_t>(zz))));
+        }
+        times_ms.push_back(time_ms);
+        for (size_t i = 0; i < channels; ++i) {
+            values.push_back(static_cast<float>(row[i]) / telemetry_scale(types[i]));
+        }
+    }
+    return true;
+}
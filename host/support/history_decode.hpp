@@ -0,0 +1,16 @@
+#ifndef HISTORY_DECODE_HPP
+#define HISTORY_DECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "history.hpp"
+
+// Decodes one chunk archived by History (see HISTORY_ARCHIVE_HEADER_BYTES and HistoryChunk
+// for the layout): the channel types, then each row's time and values. Returns false on
+// malformed input.
+bool history_decode(const uint8_t* data, size_t length,
+                    std::vector<SensorData::Type>& types, std::vector<int64_t>& times_ms,
+                    std::vector<float>& values);
+
+#endif // HISTORY_DECODE_HPP
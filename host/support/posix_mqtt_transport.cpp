@@ -0,0 +1,135 @@
+#include "posix_mqtt_transport.hpp"
+
+#include <cstring>
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+
+static const char* TAG = "posix_mqtt";
+
+static constexpr uint16_t KEEP_ALIVE_S = 60;
+
+static void put_remaining_length(std::vector<uint8_t>& packet, size_t length) {
+    do {
+        uint8_t byte = length % 128;
+        length /= 128;
+        packet.push_back(length > 0 ? byte | 0x80 : byte);
+    } while (length > 0);
+}
+
+static void put_string(std::vector<uint8_t>& packet, const char* str, size_t length) {
+    packet.push_back(static_cast<uint8_t>(length >> 8));
+    packet.push_back(static_cast<uint8_t>(length));
+    packet.insert(packet.end(), str, str + length);
+}
+
+PosixMqttTransport::PosixMqttTransport(const std::string& host, int port, const std::string& client_id)
+    : host_(host), port_(port), client_id_(client_id), socket_(-1) {
+}
+
+PosixMqttTransport::~PosixMqttTransport() {
+    disconnect();
+}
+
+void PosixMqttTransport::close_socket() {
+    if (socket_ >= 0) {
+        ::close(socket_);
+        socket_ = -1;
+    }
+}
+
+bool PosixMqttTransport::send_all(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = ::send(socket_, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+esp_err_t PosixMqttTransport::connect() {
+    disconnect();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string port = std::to_string(port_);
+    if (getaddrinfo(host_.c_str(), port.c_str(), &hints, &result) != 0) {
+        ESP_LOGE(TAG, "Cannot resolve %s", host_.c_str());
+        return ESP_ERR_NOT_FOUND;
+    }
+    for (addrinfo* ai = result; ai != nullptr && socket_ < 0; ai = ai->ai_next) {
+        socket_ = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (socket_ >= 0 && ::connect(socket_, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close_socket();
+        }
+    }
+    freeaddrinfo(result);
+    if (socket_ < 0) {
+        return ESP_FAIL;
+    }
+
+    std::vector<uint8_t> body;
+    put_string(body, "MQTT", 4);
+    body.push_back(4);      // Protocol level 3.1.1
+    body.push_back(0x02);   // Clean session
+    body.push_back(KEEP_ALIVE_S >> 8);
+    body.push_back(KEEP_ALIVE_S & 0xFF);
+    put_string(body, client_id_.c_str(), client_id_.size());
+    std::vector<uint8_t> packet = { 0x10 };
+    put_remaining_length(packet, body.size());
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    uint8_t connack[4];
+    size_t received = 0;
+    if (!send_all(packet.data(), packet.size())) {
+        close_socket();
+        return ESP_FAIL;
+    }
+    while (received < sizeof(connack)) {
+        ssize_t n = ::recv(socket_, connack + received, sizeof(connack) - received, 0);
+        if (n <= 0) {
+            close_socket();
+            return ESP_FAIL;
+        }
+        received += static_cast<size_t>(n);
+    }
+    if (connack[0] != 0x20 || connack[1] != 0x02 || connack[3] != 0) {
+        ESP_LOGE(TAG, "Broker refused connection, return code %d", connack[3]);
+        close_socket();
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+void PosixMqttTransport::disconnect() {
+    if (socket_ >= 0) {
+        const uint8_t packet[] = { 0xE0, 0x00 };
+        send_all(packet, sizeof(packet));
+        close_socket();
+    }
+}
+
+esp_err_t PosixMqttTransport::publish(const char* topic, const uint8_t* data, size_t length) {
+    if (socket_ < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t topic_length = std::strlen(topic);
+    std::vector<uint8_t> packet = { 0x30 };   // PUBLISH, QoS 0
+    put_remaining_length(packet, 2 + topic_length + length);
+    put_string(packet, topic, topic_length);
+    packet.insert(packet.end(), data, data + length);
+    if (!send_all(packet.data(), packet.size())) {
+        ESP_LOGW(TAG, "Send failed, connection lost");
+        close_socket();
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,28 @@
+#ifndef POSIX_MQTT_TRANSPORT_HPP
+#define POSIX_MQTT_TRANSPORT_HPP
+
+#include <string>
+#include "telemetry.hpp"
+
+// Minimal MQTT 3.1.1 client over a TCP socket, QoS 0 publish only. Enough to
+// push telemetry at a local broker (e.g. mosquitto on localhost:1883).
+class PosixMqttTransport : public TelemetryTransport {
+    std::string host_;
+    int port_;
+    std::string client_id_;
+    int socket_;
+
+    bool send_all(const uint8_t* data, size_t length);
+    void close_socket();
+
+    public:
+        PosixMqttTransport(const std::string& host, int port, const std::string& client_id);
+        ~PosixMqttTransport();
+        // CONNECT and wait for CONNACK
+        esp_err_t connect();
+        void disconnect();
+        bool connected() const override { return socket_ >= 0; }
+        esp_err_t publish(const char* topic, const uint8_t* data, size_t length) override;
+};
+
+#endif // POSIX_MQTT_TRANSPORT_HPP
@@ -0,0 +1,51 @@
+#ifndef RAM_BLOB_STORE_HPP
+#define RAM_BLOB_STORE_HPP
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "blob_store.hpp"
+
+// BlobStore in RAM, standing in for NVS; a copy of one is a reboot with the same flash
+class RamBlobStore : public BlobStore {
+    std::map<std::string, std::vector<uint8_t>> blobs_;
+    uint32_t writes_ = 0;
+
+    public:
+        esp_err_t read(const char* key, void* data, size_t length) override {
+            auto it = blobs_.find(key);
+            if (it == blobs_.end()) {
+                return ESP_ERR_NOT_FOUND;
+            }
+            if (it->second.size() != length) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            std::memcpy(data, it->second.data(), length);
+            return ESP_OK;
+        }
+
+        esp_err_t write(const char* key, const void* data, size_t length) override {
+            if (std::strlen(key) > BLOB_KEY_MAX) {
+                return ESP_ERR_INVALID_ARG;     // As NVS
+            }
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            blobs_[key].assign(bytes, bytes + length);
+            writes_++;
+            return ESP_OK;
+        }
+
+        esp_err_t erase(const char* key) override {
+            blobs_.erase(key);
+            return ESP_OK;
+        }
+
+        // For corrupting a record on purpose
+        std::vector<uint8_t>* blob(const char* key) {
+            auto it = blobs_.find(key);
+            return it == blobs_.end() ? nullptr : &it->second;
+        }
+        uint32_t writes() const { return writes_; }
+};
+
+#endif // RAM_BLOB_STORE_HPP
@@ -0,0 +1,48 @@
+#ifndef RAM_FLASH_REGION_HPP
+#define RAM_FLASH_REGION_HPP
+
+#include <cstring>
+#include <vector>
+#include "flash_ring.hpp"
+
+// FlashRegion in RAM with the same NOR rules as the real partition: writes can
+// only clear bits, so a missing erase shows up as corrupted data here too
+class RamFlashRegion : public FlashRegion {
+    std::vector<uint8_t> data_;
+    size_t sector_size_;
+
+    public:
+        RamFlashRegion(size_t size, size_t sector_size = 4096) : data_(size, 0xFF), sector_size_(sector_size) {}
+
+        esp_err_t read(size_t offset, void* dst, size_t length) override {
+            if (offset + length > data_.size()) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            std::memcpy(dst, data_.data() + offset, length);
+            return ESP_OK;
+        }
+
+        esp_err_t write(size_t offset, const void* src, size_t length) override {
+            if (offset + length > data_.size()) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            const uint8_t* bytes = static_cast<const uint8_t*>(src);
+            for (size_t i = 0; i < length; ++i) {
+                data_[offset + i] &= bytes[i];
+            }
+            return ESP_OK;
+        }
+
+        esp_err_t erase_sector(size_t offset) override {
+            if (offset % sector_size_ != 0 || offset >= data_.size()) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            std::memset(data_.data() + offset, 0xFF, sector_size_);
+            return ESP_OK;
+        }
+
+        size_t size() const override { return data_.size(); }
+        size_t sector_size() const override { return sector_size_; }
+};
+
+#endif // RAM_FLASH_REGION_HPP
@@ -0,0 +1,301 @@
+#include "replay.hpp"
+
+#include <algorithm>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "replay";
+
+ReplayAdcDriver::ReplayAdcDriver(const CaptureAdcSetup& setup)
+    : setup_(setup), pending_{}, pending_head_{}, pending_count_{}, last_{}, has_last_{}, listener_(nullptr),
+      repeated_reads_(0), overrun_reads_(0) {
+}
+
+void ReplayAdcDriver::deliver(const CaptureEvent& event) {
+    if (event.kind == CaptureKind::ADC_SCAN) {
+        if (listener_ == nullptr) {
+            return;
+        }
+        int raw[ADC_MAX_CHANNELS] = {};
+        uint32_t count[ADC_MAX_CHANNELS] = {};
+        for (size_t i = 0; i < event.length; ++i) {
+            raw[i] = event.scan[i] < 0 ? 0 : event.scan[i];
+            count[i] = event.scan[i] < 0 ? 0 : 1;
+        }
+        listener_->on_scan(raw, count, event.length);
+        return;
+    }
+
+    size_t channel = event.channel;
+    if (channel >= setup_.channels) {
+        return;
+    }
+    if (pending_count_[channel] == REPLAY_PENDING_READS) {
+        // Nothing read this channel for a while: keep the latest conversions
+        pending_head_[channel] = (pending_head_[channel] + 1) % REPLAY_PENDING_READS;
+        pending_count_[channel]--;
+        overrun_reads_++;
+    }
+    Conversion& slot = pending_[channel][(pending_head_[channel] + pending_count_[channel]) % REPLAY_PENDING_READS];
+    slot.raw = event.kind == CaptureKind::ADC_READ ? event.raw : 0;
+    slot.status = event.kind == CaptureKind::ADC_READ ? ESP_OK : static_cast<esp_err_t>(event.error);
+    pending_count_[channel]++;
+}
+
+esp_err_t ReplayAdcDriver::init(const AdcConfig_t* configs, size_t count) {
+    if (count != setup_.channels) {
+        ESP_LOGE(TAG, "Adc has %d channels, the capture %d", count, setup_.channels);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (configs[i].channel != setup_.config[i].channel || configs[i].atten != setup_.config[i].atten) {
+            ESP_LOGW(TAG, "Channel %d is set up differently from the capture", i);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ReplayAdcDriver::read_raw(size_t channel_idx, int& raw) {
+    if (channel_idx >= setup_.channels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pending_count_[channel_idx] > 0) {
+        last_[channel_idx] = pending_[channel_idx][pending_head_[channel_idx]];
+        has_last_[channel_idx] = true;
+        pending_head_[channel_idx] = (pending_head_[channel_idx] + 1) % REPLAY_PENDING_READS;
+        pending_count_[channel_idx]--;
+    } else if (has_last_[channel_idx]) {
+        repeated_reads_++;
+    } else {
+        return ESP_ERR_TIMEOUT;     // Nothing captured for this channel yet
+    }
+    raw = last_[channel_idx].raw;
+    return last_[channel_idx].status;
+}
+
+esp_err_t ReplayAdcDriver::start_continuous(const AdcContinuousConfig& /*config*/, AdcScanListener& listener) {
+    if (!setup_.continuous) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    listener_ = &listener;
+    return ESP_OK;
+}
+
+esp_err_t ReplayAdcDriver::raw_to_mv(size_t channel_idx, int raw, int& mv) {
+    if (channel_idx >= setup_.channels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return capture_raw_to_mv(setup_.config[channel_idx], raw, mv);
+}
+
+void ReplayUartDriver::deliver(const CaptureEvent& event) {
+    if (listener_ == nullptr) {
+        return;
+    }
+    switch (event.kind) {
+        case CaptureKind::UART_DATA:
+            listener_->on_data(event.data, event.length, event.time_us);
+            break;
+        case CaptureKind::UART_IDLE:
+            listener_->on_idle();
+            break;
+        case CaptureKind::UART_OVERFLOW:
+            listener_->on_overflow();
+            break;
+        default:
+            break;
+    }
+}
+
+Replay::Replay(CaptureReader& reader, const ReplayOptions& options)
+    : reader_(reader), options_(options), stats_{} {
+}
+
+Replay::~Replay() {
+    host_set_time_us(0);
+}
+
+static bool is_setup(const CaptureEvent& event) {
+    return event.kind == CaptureKind::ADC_SETUP || event.kind == CaptureKind::UART_SETUP;
+}
+
+esp_err_t Replay::build() {
+    names_.reserve(MAX_ZONES);
+    for (uint8_t stream = 0; stream < CAPTURE_MAX_STREAMS; ++stream) {
+        const CaptureUartSetup* setup = reader_.uart_setup(stream);
+        if (setup == nullptr) {
+            break;
+        }
+        uart_drivers_.push_back(std::make_unique<ReplayUartDriver>());
+        UartConfig config = { .port = static_cast<uart_port_t>(setup->port), .tx_pin = -1, .rx_pin = -1,
+                              .baud_rate = static_cast<int>(setup->baud_rate) };
+        uarts_.push_back(std::make_unique<Uart>(*uart_drivers_.back(), config));
+    }
+
+    for (uint8_t stream = 0; stream < CAPTURE_MAX_STREAMS; ++stream) {
+        const CaptureAdcSetup* setup = reader_.adc_setup(stream);
+        if (setup == nullptr) {
+            break;
+        }
+        size_t zones = setup->channels / ZONE_ADC_CHANNELS;
+        if (setup->channels % ZONE_ADC_CHANNELS != 0 || zones == 0 || zones > 2) {
+            ESP_LOGE(TAG, "ADC unit %d: %d channels are not one or two zones", stream, setup->channels);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        std::array<AdcConfigs, 2> zone_configs;
+        for (size_t z = 0; z < zones; ++z) {
+            zone_configs[z] = options_.zone_channels;
+            for (size_t c = 0; c < ZONE_ADC_CHANNELS; ++c) {
+                const CaptureAdcChannel& captured = setup->config[z * ZONE_ADC_CHANNELS + c];
+                zone_configs[z][c].channel = static_cast<adc_channel_t>(captured.channel);
+                zone_configs[z][c].atten = static_cast<adc_atten_t>(captured.atten);
+            }
+        }
+        adc_drivers_.push_back(std::make_unique<ReplayAdcDriver>(*setup));
+        AdcMode mode = setup->continuous ? AdcMode::CONTINUOUS : AdcMode::ONESHOT;
+        if (zones == 1) {
+            adcs_.push_back(std::make_unique<ZoneAdc<1>>(*adc_drivers_.back(), zone_configs[0], mode));
+        } else {
+            adcs_.push_back(std::make_unique<ZoneAdc<2>>(
+                *adc_drivers_.back(), zone_adc_configs<2>({ zone_configs[0], zone_configs[1] }), mode));
+        }
+
+        for (size_t z = 0; z < zones; ++z) {
+            size_t index = zones_.size();
+            if (index >= uarts_.size() || index >= MAX_ZONES) {
+                ESP_LOGE(TAG, "Zone %d has no UART link in the capture", index);
+                return ESP_ERR_NOT_FOUND;
+            }
+            names_.push_back("tank" + std::to_string(index + 1));
+            zones_.push_back(std::make_unique<Zone>(names_.back().c_str(), *adcs_.back(), z * ZONE_ADC_CHANNELS,
+                                                    *uarts_[index], options_.tank_height_cm));
+            zone_ptrs_.push_back(zones_.back().get());
+        }
+    }
+    if (zones_.empty()) {
+        ESP_LOGE(TAG, "No ADC unit in the capture");
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+bool Replay::next(CaptureEvent& event) {
+    return reader_.next(event) && reader_.session() == options_.session;
+}
+
+void Replay::deliver(const CaptureEvent& event) {
+    stats_.events++;
+    switch (event.kind) {
+        case CaptureKind::ADC_READ:
+        case CaptureKind::ADC_ERROR:
+        case CaptureKind::ADC_SCAN:
+            if (event.stream < adc_drivers_.size()) {
+                adc_drivers_[event.stream]->deliver(event);
+                return;
+            }
+            break;
+        case CaptureKind::UART_DATA:
+        case CaptureKind::UART_IDLE:
+        case CaptureKind::UART_OVERFLOW:
+            if (event.stream < uart_drivers_.size()) {
+                uart_drivers_[event.stream]->deliver(event);
+                return;
+            }
+            break;
+        case CaptureKind::DROPPED:
+            stats_.dropped += event.dropped;
+            return;
+        default:
+            return;     // A setup repeated within the session
+    }
+    stats_.unknown_events++;
+}
+
+esp_err_t Replay::run(const ControlCallback& on_control) {
+    // Skip to the session and past its setup records
+    CaptureEvent event;
+    bool have = false;
+    while ((have = reader_.next(event)) && (reader_.session() < options_.session || is_setup(event))) {
+    }
+    if (!have || reader_.session() != options_.session) {
+        ESP_LOGE(TAG, "No data in session %lu", static_cast<unsigned long>(options_.session));
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = build();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // What the device captured while the state machine primed its ADC units
+    int64_t now_us = event.time_us > 0 ? event.time_us : 1;
+    stats_.first_us = now_us;
+    host_set_time_us(now_us);
+    while (have && event.time_us <= stats_.first_us + options_.prime_window_us) {
+        deliver(event);
+        have = next(event);
+    }
+    now_us = stats_.first_us + options_.prime_window_us;
+    host_set_time_us(now_us);
+    state_machine_ = std::make_unique<StateMachine>(zone_ptrs_.data(), zone_ptrs_.size(), options_.schedule);
+
+    // The sampler tasks and the state machine's deadlines, on the capture's clock
+    std::vector<SensorSampler*> samplers;
+    for (Zone* zone : zone_ptrs_) {
+        for (SensorSampler& sampler : zone->samplers()) {
+            samplers.push_back(&sampler);
+        }
+    }
+    std::vector<int64_t> sampler_due(samplers.size(), now_us);
+    const int64_t state_period_us[StateMachine::STATE_COUNT] = {
+        static_cast<int64_t>(options_.schedule.acquisition_ms) * 1000,
+        static_cast<int64_t>(options_.schedule.control_ms) * 1000,
+        static_cast<int64_t>(options_.schedule.telemetry_ms) * 1000,
+    };
+    int64_t state_due[StateMachine::STATE_COUNT] = { now_us, now_us, now_us };
+
+    while (have) {
+        int64_t next_us = event.time_us;
+        for (int64_t due : sampler_due) {
+            next_us = std::min(next_us, due);
+        }
+        for (int64_t due : state_due) {
+            next_us = std::min(next_us, due);
+        }
+        // Producers on different tasks may land slightly out of order: time never goes back
+        now_us = std::max(now_us, next_us);
+        host_set_time_us(now_us);
+
+        while (have && event.time_us <= now_us) {
+            deliver(event);
+            have = next(event);
+        }
+        for (size_t i = 0; i < samplers.size(); ++i) {
+            if (sampler_due[i] <= now_us) {
+                samplers[i]->sample_once();
+                stats_.samples++;
+                sampler_due[i] += std::max<int64_t>(samplers[i]->period_ms(), 1) * 1000;
+            }
+        }
+        for (size_t s = 0; s < StateMachine::STATE_COUNT; ++s) {
+            if (state_due[s] > now_us) {
+                continue;
+            }
+            StateMachine::State state = static_cast<StateMachine::State>(s);
+            state_machine_->step(state);
+            state_due[s] += state_period_us[s];
+            if (state == StateMachine::State::ACTUATOR_CONTROL) {
+                stats_.control_cycles++;
+                if (on_control) {
+                    on_control(*state_machine_, now_us);
+                }
+            }
+        }
+    }
+    stats_.last_us = now_us;
+    for (const auto& driver : adc_drivers_) {
+        stats_.repeated_reads += driver->repeated_reads();
+        stats_.overrun_reads += driver->overrun_reads();
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,129 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "capture.hpp"
+#include "state_machine.hpp"
+
+// Conversions of one channel that the replay clock has passed but no read has taken yet
+static constexpr size_t REPLAY_PENDING_READS = 32;
+
+// AdcDriver that plays back one captured ADC unit. Oneshot reads return the channel's
+// captured conversions in order as the replay clock passes them; a read with none left
+// returns the previous one again. Scan frames go to Adc as the clock passes them.
+// Calibrated conversions use the curves captured from the chip.
+class ReplayAdcDriver : public AdcDriver {
+    struct Conversion {
+        int raw;
+        esp_err_t status;
+    };
+
+    CaptureAdcSetup setup_;
+    Conversion pending_[ADC_MAX_CHANNELS][REPLAY_PENDING_READS];
+    size_t pending_head_[ADC_MAX_CHANNELS];
+    size_t pending_count_[ADC_MAX_CHANNELS];
+    Conversion last_[ADC_MAX_CHANNELS];
+    bool has_last_[ADC_MAX_CHANNELS];
+    AdcScanListener* listener_;
+    uint64_t repeated_reads_;
+    uint64_t overrun_reads_;
+
+    public:
+        explicit ReplayAdcDriver(const CaptureAdcSetup& setup);
+        // ADC_READ, ADC_ERROR or ADC_SCAN of this unit, at the current replay time
+        void deliver(const CaptureEvent& event);
+        // Reads with no new conversion, and conversions no read took before the queue filled
+        uint64_t repeated_reads() const { return repeated_reads_; }
+        uint64_t overrun_reads() const { return overrun_reads_; }
+
+        esp_err_t init(const AdcConfig_t* configs, size_t count) override;
+        esp_err_t start_oneshot() override { return ESP_OK; }
+        esp_err_t read_raw(size_t channel_idx, int& raw) override;
+        // Only if the capture was taken in continuous mode; Adc falls back to oneshot otherwise
+        esp_err_t start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) override;
+        void stop_continuous() override { listener_ = nullptr; }
+        // The capture already holds only the frames the chip scanned
+        esp_err_t suspend_continuous() override { return ESP_OK; }
+        esp_err_t resume_continuous() override { return ESP_OK; }
+        esp_err_t raw_to_mv(size_t channel_idx, int raw, int& mv) override;
+};
+
+// UartDriver that hands captured reads, timeouts and overflows to Uart
+class ReplayUartDriver : public UartDriver {
+    UartListener* listener_;
+
+    public:
+        ReplayUartDriver() : listener_(nullptr) {}
+        // UART_DATA, UART_IDLE or UART_OVERFLOW of this link, at the current replay time
+        void deliver(const CaptureEvent& event);
+
+        esp_err_t start(const UartConfig& /*config*/, UartListener& listener) override {
+            listener_ = &listener;
+            return ESP_OK;
+        }
+        void stop() override { listener_ = nullptr; }
+        esp_err_t set_listening(bool /*listening*/) override { return ESP_OK; }
+};
+
+struct ReplayOptions {
+    uint32_t session = 0;           // See CaptureReader::session()
+    StateSchedule schedule;
+    // Filters of a zone's channels; channel and attenuation come from the capture
+    AdcConfigs zone_channels = default_adc_configs();
+    float tank_height_cm = 100.0f;
+    int64_t prime_window_us = 50000;    // Captured before the state machine primes the ADC units
+};
+
+struct ReplayStats {
+    uint64_t events;            // Delivered to the drivers
+    int64_t first_us;           // Capture time of the first and last event replayed
+    int64_t last_us;
+    uint64_t samples;           // Sensor reads by the samplers
+    uint32_t control_cycles;
+    uint64_t repeated_reads;    // See ReplayAdcDriver
+    uint64_t overrun_reads;
+    uint32_t dropped;           // Events the device lost to a full capture ring
+    uint64_t unknown_events;    // For a stream without a setup record
+};
+
+// Plays one session of a capture through the Adc, Uart, sensors, samplers and state
+// machine of this source tree, as fast as the host runs them: no tasks and no sleeping,
+// with esp_timer on the captured timestamps. Each sampler runs at its own (adaptive)
+// period and each state at its schedule, all on the calling thread. The zones follow the
+// capture: ADC unit k's channels in threes, in unit order, each zone with the UART link
+// of the same index.
+class Replay {
+    CaptureReader& reader_;
+    ReplayOptions options_;
+    std::vector<std::unique_ptr<ReplayAdcDriver>> adc_drivers_;
+    std::vector<std::unique_ptr<Adc>> adcs_;
+    std::vector<std::unique_ptr<ReplayUartDriver>> uart_drivers_;
+    std::vector<std::unique_ptr<Uart>> uarts_;
+    std::vector<std::string> names_;
+    std::vector<std::unique_ptr<Zone>> zones_;
+    std::vector<Zone*> zone_ptrs_;
+    std::unique_ptr<StateMachine> state_machine_;
+    ReplayStats stats_;
+
+    esp_err_t build();
+    bool next(CaptureEvent& event);
+    void deliver(const CaptureEvent& event);
+
+    public:
+        using ControlCallback = std::function<void(const StateMachine& state_machine, int64_t time_us)>;
+
+        Replay(CaptureReader& reader, const ReplayOptions& options);
+        ~Replay();
+        // Replays the session to its end; on_control runs after every control cycle
+        esp_err_t run(const ControlCallback& on_control = nullptr);
+        const ReplayStats& stats() const { return stats_; }
+        // Valid once run() has built it
+        const StateMachine* state_machine() const { return state_machine_.get(); }
+        const Uart& uart(size_t index) const { return *uarts_[index]; }
+};
+
+#endif // REPLAY_HPP
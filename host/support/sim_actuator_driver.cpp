@@ -0,0 +1,92 @@
+#include "sim_actuator_driver.hpp"
+
+#include <chrono>
+
+#include "esp_timer.h"
+
+SimActuatorDriver::SimActuatorDriver(bool timer_thread)
+    : timer_thread_(timer_thread),
+      channels_(0),
+      duty_{},
+      listener_(nullptr),
+      deadline_us_(INT64_MAX),
+      wake_now_(false),
+      running_(false) {
+}
+
+SimActuatorDriver::~SimActuatorDriver() {
+    stop();
+}
+
+esp_err_t SimActuatorDriver::init(const ActuatorPin* /*pins*/, size_t count, ActuatorTimerListener& listener) {
+    if (count > ACTUATOR_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    channels_ = count;
+    listener_ = &listener;
+    if (timer_thread_ && !running_) {
+        running_ = true;
+        thread_ = std::thread(&SimActuatorDriver::run, this);
+    }
+    return ESP_OK;
+}
+
+void SimActuatorDriver::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+esp_err_t SimActuatorDriver::set(size_t channel, float duty) {
+    if (channel >= channels_) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    duty_[channel].store(duty, std::memory_order_relaxed);
+    edges_.push_back({ esp_timer_get_time(), channel, duty });
+    return ESP_OK;
+}
+
+esp_err_t SimActuatorDriver::wake_at(int64_t time_us) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deadline_us_ = time_us;
+    }
+    wake_.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t SimActuatorDriver::wake_now() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_now_ = true;
+    }
+    wake_.notify_all();
+    return ESP_OK;
+}
+
+void SimActuatorDriver::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        int64_t now_us = esp_timer_get_time();
+        if (wake_now_ || now_us >= deadline_us_) {
+            wake_now_ = false;
+            if (now_us >= deadline_us_) {
+                deadline_us_ = INT64_MAX;   // One-shot, like esp_timer_start_once
+            }
+            lock.unlock();
+            listener_->on_timer();
+            lock.lock();
+            continue;
+        }
+        if (deadline_us_ == INT64_MAX) {
+            wake_.wait(lock);
+        } else {
+            wake_.wait_for(lock, std::chrono::microseconds(deadline_us_ - now_us));
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SIM_ACTUATOR_DRIVER_HPP
+#define SIM_ACTUATOR_DRIVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "actuator_driver.hpp"
+
+// One change of a simulated pin
+struct SimPinEdge {
+    int64_t time_us;    // esp_timer clock, simulated or not
+    size_t channel;
+    float duty;
+};
+
+// ActuatorDriver with simulated GPIO: every change is logged with its time. Its timer is
+// a thread that calls the listener at the armed time on the esp_timer clock, the way the
+// esp_timer task does on the device. Without the thread (timer_thread false) nothing
+// calls the listener: the caller runs ActuatorEngine::service on its own clock.
+class SimActuatorDriver : public ActuatorDriver {
+    bool timer_thread_;
+    size_t channels_;
+    std::atomic<float> duty_[ACTUATOR_MAX_CHANNELS];
+    std::vector<SimPinEdge> edges_;     // Written on the timer thread only
+    ActuatorTimerListener* listener_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    int64_t deadline_us_;
+    bool wake_now_;
+    bool running_;
+    std::thread thread_;
+
+    void run();
+
+    public:
+        explicit SimActuatorDriver(bool timer_thread = true);
+        ~SimActuatorDriver();
+        // Joins the timer thread; edges() is safe to read afterwards
+        void stop();
+        float duty(size_t channel) const { return duty_[channel].load(std::memory_order_relaxed); }
+        const std::vector<SimPinEdge>& edges() const { return edges_; }
+
+        esp_err_t init(const ActuatorPin* pins, size_t count, ActuatorTimerListener& listener) override;
+        esp_err_t set(size_t channel, float duty) override;
+        esp_err_t wake_at(int64_t time_us) override;
+        esp_err_t wake_now() override;
+};
+
+#endif // SIM_ACTUATOR_DRIVER_HPP
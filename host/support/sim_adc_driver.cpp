@@ -0,0 +1,125 @@
+#include "sim_adc_driver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "esp_timer.h"
+
+static constexpr uint32_t RESULT_BYTES = 4;     // SOC_ADC_DIGI_RESULT_BYTES on the esp32c6
+static constexpr int RAW_MAX = 4095;
+
+SimAdcDriver::SimAdcDriver()
+    : noise_state_(0x12345678u), conversions_(0), listener_(nullptr), scanning_(false) {
+}
+
+SimAdcDriver::~SimAdcDriver() {
+    stop_continuous();
+}
+
+void SimAdcDriver::set_waveform(size_t channel_idx, const SimWaveform& waveform) {
+    if (channel_idx >= waveforms_.size()) {
+        waveforms_.resize(channel_idx + 1);
+    }
+    waveforms_[channel_idx] = waveform;
+}
+
+esp_err_t SimAdcDriver::init(const AdcConfig_t* configs, size_t count) {
+    if (count > ADC_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    configs_.assign(configs, configs + count);
+    if (waveforms_.size() < count) {
+        waveforms_.resize(count);
+    }
+    return ESP_OK;
+}
+
+int SimAdcDriver::convert(size_t channel_idx, int64_t now_us) {
+    const SimWaveform& w = waveforms_[channel_idx];
+    auto uniform = [this]() {
+        noise_state_ = noise_state_ * 1664525u + 1013904223u;
+        return (noise_state_ >> 8) / 16777216.0f;
+    };
+    float t = now_us / 1e6f;
+    float volts = w.offset_v + w.amplitude_v * std::sin(6.2831853f * t / w.period_s) + w.noise_v * (uniform() - 0.5f);
+    if (w.spike_probability > 0.0f && uniform() < w.spike_probability) {
+        volts += w.spike_v;
+    }
+    // Same full-scale voltages as the Adc fallback conversion
+    float full_scale = configs_[channel_idx].atten == ADC_ATTEN_DB_6 ? 2.15f : 3.3f;
+    int raw = static_cast<int>(volts / full_scale * RAW_MAX + 0.5f);
+    conversions_.fetch_add(1, std::memory_order_relaxed);
+    return raw < 0 ? 0 : (raw > RAW_MAX ? RAW_MAX : raw);
+}
+
+esp_err_t SimAdcDriver::read_raw(size_t channel_idx, int& raw) {
+    if (channel_idx >= configs_.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    raw = convert(channel_idx, esp_timer_get_time());
+    return ESP_OK;
+}
+
+esp_err_t SimAdcDriver::start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) {
+    if (scanning_.load() || configs_.empty() || config.sample_freq_hz == 0 || config.frame_size < RESULT_BYTES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cont_config_ = config;
+    listener_ = &listener;
+    scanning_.store(true);
+    scan_thread_ = std::thread(&SimAdcDriver::scan_loop, this);
+    return ESP_OK;
+}
+
+void SimAdcDriver::stop_continuous() {
+    scanning_.store(false);
+    if (scan_thread_.joinable()) {
+        scan_thread_.join();
+    }
+}
+
+esp_err_t SimAdcDriver::suspend_continuous() {
+    if (listener_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stop_continuous();
+    return ESP_OK;
+}
+
+esp_err_t SimAdcDriver::resume_continuous() {
+    if (listener_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!scanning_.exchange(true)) {
+        scan_thread_ = std::thread(&SimAdcDriver::scan_loop, this);
+    }
+    return ESP_OK;
+}
+
+void SimAdcDriver::scan_loop() {
+    const size_t channels = configs_.size();
+    const uint32_t per_frame = cont_config_.frame_size / RESULT_BYTES;
+    const auto frame_period = std::chrono::microseconds(1000000ull * per_frame / cont_config_.sample_freq_hz);
+    std::vector<int> raw(channels);
+    std::vector<uint32_t> sum(channels);
+    std::vector<uint32_t> count(channels);
+    auto deadline = std::chrono::steady_clock::now();
+    size_t next_channel = 0;
+    while (scanning_.load(std::memory_order_relaxed)) {
+        deadline += frame_period;
+        std::this_thread::sleep_until(deadline);
+        int64_t now_us = esp_timer_get_time();
+        std::fill(sum.begin(), sum.end(), 0);
+        std::fill(count.begin(), count.end(), 0);
+        for (uint32_t k = 0; k < per_frame; ++k) {
+            sum[next_channel] += convert(next_channel, now_us);
+            count[next_channel]++;
+            next_channel = (next_channel + 1) % channels;
+        }
+        for (size_t i = 0; i < channels; ++i) {
+            raw[i] = count[i] > 0 ? static_cast<int>((sum[i] + count[i] / 2) / count[i]) : 0;
+        }
+        listener_->on_scan(raw.data(), count.data(), channels);
+    }
+}
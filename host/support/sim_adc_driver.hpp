@@ -0,0 +1,55 @@
+#ifndef SIM_ADC_DRIVER_HPP
+#define SIM_ADC_DRIVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "adc_driver.hpp"
+
+// Voltage on one simulated ADC pin
+struct SimWaveform {
+    float offset_v = 1.0f;
+    float amplitude_v = 0.0f;       // Sine around offset_v
+    float period_s = 60.0f;
+    float noise_v = 0.0f;           // Uniform noise, peak to peak
+    float spike_probability = 0.0f; // Per conversion
+    float spike_v = 0.0f;           // Added on a spike
+};
+
+// AdcDriver with synthetic waveforms on the host clock. Oneshot reads convert on the
+// calling thread; continuous mode runs a scan thread that delivers one result per
+// channel per frame, at the frame rate the real DMA would have.
+class SimAdcDriver : public AdcDriver {
+    std::vector<AdcConfig_t> configs_;
+    std::vector<SimWaveform> waveforms_;
+    uint32_t noise_state_;
+    std::atomic<uint64_t> conversions_;
+    AdcContinuousConfig cont_config_;
+    AdcScanListener* listener_;
+    std::atomic<bool> scanning_;
+    std::thread scan_thread_;
+
+    int convert(size_t channel_idx, int64_t now_us);
+    void scan_loop();
+
+    public:
+        SimAdcDriver();
+        ~SimAdcDriver();
+        // Set before starting continuous mode
+        void set_waveform(size_t channel_idx, const SimWaveform& waveform);
+        uint64_t conversions() const { return conversions_.load(std::memory_order_relaxed); }
+
+        esp_err_t init(const AdcConfig_t* configs, size_t count) override;
+        esp_err_t start_oneshot() override { return ESP_OK; }
+        esp_err_t read_raw(size_t channel_idx, int& raw) override;
+        esp_err_t start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) override;
+        void stop_continuous() override;
+        // Ends and restarts the scan thread, like the DMA stopping and starting again
+        esp_err_t suspend_continuous() override;
+        esp_err_t resume_continuous() override;
+        // Uncalibrated, like a chip without eFuse calibration: Adc uses its linear fallback
+        esp_err_t raw_to_mv(size_t, int, int&) override { return ESP_ERR_NOT_SUPPORTED; }
+};
+
+#endif // SIM_ADC_DRIVER_HPP
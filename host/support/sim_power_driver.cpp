@@ -0,0 +1,85 @@
+#include "sim_power_driver.hpp"
+
+#include "esp_timer.h"
+
+// One SEN0311 frame on the wire: 4 bytes of 10 bits at 9600 baud
+static constexpr int64_t FRAME_US = 4 * 10 * 1000000 / 9600;
+
+SimPowerDriver::SimPowerDriver(int64_t wake_latency_us, int64_t min_sleep_us)
+    : wake_latency_us_(wake_latency_us),
+      min_sleep_us_(min_sleep_us),
+      sen0311_(nullptr),
+      frame_period_us_(0),
+      frame_due_us_(0),
+      totals_{} {
+}
+
+void SimPowerDriver::attach_sen0311(SimUartDriver& uart, uint32_t frame_period_ms) {
+    sen0311_ = &uart;
+    frame_period_us_ = static_cast<int64_t>(frame_period_ms) * 1000;
+}
+
+esp_err_t SimPowerDriver::start(const PowerConfig& /*config*/) {
+    // From here on the clock only moves when the state task sleeps
+    if (host_simulated_time_us().load() == 0) {
+        host_set_time_us(esp_timer_get_time());
+    }
+    return ESP_OK;
+}
+
+void SimPowerDriver::sleep(int64_t from_us, int64_t to_us, bool late) {
+    if (to_us - from_us < min_sleep_us_) {
+        host_set_time_us(to_us);
+        return;
+    }
+    totals_.sleeps++;
+    totals_.slept_us += static_cast<uint64_t>(to_us - from_us);
+    host_set_time_us(to_us + (late ? wake_latency_us_ : 0));
+}
+
+void SimPowerDriver::sleep_until(int64_t wake_us) {
+    int64_t now_us = esp_timer_get_time();
+    if (wake_us <= now_us) {
+        return;
+    }
+    while (true) {
+        if (frame_due_us_ > 0) {
+            // Held awake by the listening link until its frame is in
+            if (frame_due_us_ > wake_us) {
+                host_set_time_us(wake_us > now_us ? wake_us : now_us);
+                return;
+            }
+            host_set_time_us(frame_due_us_);
+            frame_due_us_ = 0;
+            uint8_t frame[4];
+            SimUartDriver::encode_frame(sen0311_->distance_cm(), frame);
+            sen0311_->inject(frame, sizeof(frame));
+            now_us = esp_timer_get_time();
+            continue;
+        }
+        if (sen0311_ != nullptr && frame_period_us_ > 0 && sen0311_->listening()) {
+            int64_t frame_us = (now_us / frame_period_us_ + 1) * frame_period_us_;
+            if (frame_us >= wake_us && frame_us < wake_us + wake_latency_us_ && wake_us - now_us >= min_sleep_us_) {
+                // Starts while the timer wakes the chip: lost the same way
+                sleep(now_us, wake_us, true);
+                frame_due_us_ = frame_us + frame_period_us_ + FRAME_US;
+                return;
+            }
+            if (frame_us < wake_us) {
+                bool asleep = frame_us - now_us >= min_sleep_us_;
+                sleep(now_us, frame_us, false);
+                if (asleep) {
+                    // The frame that woke the chip is lost; the next one arrives whole
+                    totals_.uart_wakeups++;
+                    frame_due_us_ = frame_us + frame_period_us_ + FRAME_US;
+                } else {
+                    frame_due_us_ = frame_us + FRAME_US;
+                }
+                now_us = frame_us;
+                continue;
+            }
+        }
+        sleep(now_us, wake_us, true);
+        return;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SIM_POWER_DRIVER_HPP
+#define SIM_POWER_DRIVER_HPP
+
+#include <cstdint>
+#include "power_driver.hpp"
+#include "sim_uart_driver.hpp"
+
+// PowerDriver on the simulated esp_timer clock (host_set_time_us): sleep_until() moves the
+// clock forward instead of blocking. A wait of at least min_sleep_us is a light sleep that
+// ends wake_latency_us late. With a SEN0311 attached (a SimUartDriver without its frame
+// thread), a listening link wakes the chip at the sensor's next frame, loses that frame to
+// the wake-up and holds the chip awake until the following one arrives whole, as UART
+// wake-up does on the device. Frames only arrive that way.
+class SimPowerDriver : public PowerDriver {
+    int64_t wake_latency_us_;
+    int64_t min_sleep_us_;
+    SimUartDriver* sen0311_;
+    int64_t frame_period_us_;
+    int64_t frame_due_us_;      // Held awake until then for a frame; 0 if not
+    PowerSleepTotals totals_;
+
+    void sleep(int64_t from_us, int64_t to_us, bool late);
+
+    public:
+        explicit SimPowerDriver(int64_t wake_latency_us = 400, int64_t min_sleep_us = 3000);
+        void attach_sen0311(SimUartDriver& uart, uint32_t frame_period_ms);
+
+        esp_err_t start(const PowerConfig& config) override;
+        void sleep_until(int64_t wake_us) override;
+        PowerSleepTotals totals() const override { return totals_; }
+};
+
+#endif // SIM_POWER_DRIVER_HPP
@@ -0,0 +1,83 @@
+#include "sim_uart_driver.hpp"
+
+#include <chrono>
+
+#include "esp_timer.h"
+
+static constexpr int64_t IDLE_US = 100000;     // Receive interval of the device driver
+
+SimUartDriver::SimUartDriver(float frame_rate_hz)
+    : frame_rate_hz_(frame_rate_hz),
+      distance_cm_(40.0f),
+      corrupt_probability_(0.0f),
+      frames_sent_(0),
+      listening_(false),
+      listener_(nullptr),
+      running_(false) {
+}
+
+SimUartDriver::~SimUartDriver() {
+    stop();
+}
+
+void SimUartDriver::encode_frame(float distance_cm, uint8_t frame[4]) {
+    int mm = static_cast<int>(distance_cm * 10.0f + 0.5f);
+    mm = mm < 0 ? 0 : (mm > 0xFFFF ? 0xFFFF : mm);
+    frame[0] = 0xFF;
+    frame[1] = static_cast<uint8_t>(mm >> 8);
+    frame[2] = static_cast<uint8_t>(mm);
+    frame[3] = static_cast<uint8_t>(frame[0] + frame[1] + frame[2]);
+}
+
+void SimUartDriver::inject(const uint8_t* data, size_t length) {
+    if (listener_ != nullptr) {
+        listener_->on_data(data, length, esp_timer_get_time());
+    }
+}
+
+esp_err_t SimUartDriver::start(const UartConfig& /*config*/, UartListener& listener) {
+    listener_ = &listener;
+    if (frame_rate_hz_ > 0.0f && !running_.exchange(true)) {
+        thread_ = std::thread(&SimUartDriver::run, this);
+    }
+    return ESP_OK;
+}
+
+void SimUartDriver::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SimUartDriver::run() {
+    const auto period = std::chrono::microseconds(static_cast<int64_t>(1e6f / frame_rate_hz_));
+    uint32_t random = 0xBADC0DEu;
+    auto next = std::chrono::steady_clock::now();
+    int64_t last_data_us = esp_timer_get_time();
+    while (running_.load(std::memory_order_relaxed)) {
+        next += period;
+        // Sleep in receive-interval steps so idle callbacks come at the device's rate
+        while (std::chrono::steady_clock::now() < next) {
+            std::this_thread::sleep_until(std::min(next, std::chrono::steady_clock::now() + std::chrono::microseconds(IDLE_US)));
+            if (esp_timer_get_time() - last_data_us >= IDLE_US) {
+                listener_->on_idle();
+                last_data_us = esp_timer_get_time();
+            }
+        }
+
+        uint8_t frame[4];
+        encode_frame(distance_cm_.load(), frame);
+        random = random * 1664525u + 1013904223u;
+        if ((random >> 8) / 16777216.0f < corrupt_probability_.load()) {
+            frame[3] ^= 0x5A;
+        }
+        // The UART FIFO hands data over in arbitrary pieces
+        size_t split = 1 + (random >> 28) % 3;
+        int64_t now_us = esp_timer_get_time();
+        listener_->on_data(frame, split, now_us);
+        listener_->on_data(frame + split, sizeof(frame) - split, now_us);
+        last_data_us = now_us;
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
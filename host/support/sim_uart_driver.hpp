@@ -0,0 +1,47 @@
+#ifndef SIM_UART_DRIVER_HPP
+#define SIM_UART_DRIVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "uart_driver.hpp"
+
+// UartDriver that plays a SEN0311: frames at frame_rate_hz for the current distance,
+// split into random chunks, with an optional share of corrupted frames. With a rate
+// of 0 no thread runs and bytes only arrive through inject().
+class SimUartDriver : public UartDriver {
+    float frame_rate_hz_;
+    std::atomic<float> distance_cm_;
+    std::atomic<float> corrupt_probability_;
+    std::atomic<uint32_t> frames_sent_;
+    std::atomic<bool> listening_;
+    UartListener* listener_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    void run();
+
+    public:
+        explicit SimUartDriver(float frame_rate_hz = 10.0f);
+        ~SimUartDriver();
+        void set_distance_cm(float distance_cm) { distance_cm_.store(distance_cm); }
+        float distance_cm() const { return distance_cm_.load(); }
+        void set_corrupt_probability(float probability) { corrupt_probability_.store(probability); }
+        uint32_t frames_sent() const { return frames_sent_.load(); }
+        // Set by Uart::listen(); the frame thread sends regardless, SimPowerDriver does not
+        bool listening() const { return listening_.load(); }
+        // Delivers bytes on the calling thread, as if the driver had just read them
+        void inject(const uint8_t* data, size_t length);
+
+        esp_err_t start(const UartConfig& config, UartListener& listener) override;
+        void stop() override;
+        esp_err_t set_listening(bool listening) override {
+            listening_.store(listening);
+            return ESP_OK;
+        }
+
+        // One SEN0311 frame: 0xFF, distance mm high, low, checksum
+        static void encode_frame(float distance_cm, uint8_t frame[4]);
+};
+
+#endif // SIM_UART_DRIVER_HPP
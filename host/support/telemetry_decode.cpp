@@ -0,0 +1,61 @@
+#include "telemetry_decode.hpp"
+
+static bool get_varint(const uint8_t* data, size_t length, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < length; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+bool telemetry_decode(const uint8_t* data, size_t length,
+                      std::vector<SensorData::Type>& types, std::vector<int64_t>& times_ms,
+                      std::vector<float>& values) {
+    types.clear();
+    times_ms.clear();
+    values.clear();
+    if (length < 5 || data[0] != 'H' || data[1] != 'T' || data[2] != TELEMETRY_FORMAT_VERSION) {
+        return false;
+    }
+    size_t channels = data[3];
+    size_t pos = 4;
+    if (channels > TELEMETRY_MAX_CHANNELS || pos + channels + 1 > length) {
+        return false;
+    }
+    for (size_t i = 0; i < channels; ++i) {
+        if (data[pos] >= SensorData::TYPE_COUNT) {
+            return false;
+        }
+        types.push_back(static_cast<SensorData::Type>(data[pos++]));
+    }
+    size_t samples = data[pos++];
+    uint64_t raw;
+    if (!get_varint(data, length, pos, raw)) {
+        return false;
+    }
+    int64_t time_ms = static_cast<int64_t>(raw);
+    int32_t last[TELEMETRY_MAX_CHANNELS] = {};
+    for (size_t s = 0; s < samples; ++s) {
+        if (!get_varint(data, length, pos, raw)) {
+            return false;
+        }
+        time_ms += static_cast<int64_t>(raw);
+        times_ms.push_back(time_ms);
+        for (size_t i = 0; i < channels; ++i) {
+            if (!get_varint(data, length, pos, raw)) {
+                return false;
+            }
+            last[i] = static_cast<int32_t>(static_cast<uint32_t>(last[i]) + static_cast<uint32_t>(unzigzag(static_cast<uint32_t>(raw))));
+            values.push_back(static_cast<float>(last[i]) / telemetry_scale(types[i]));
+        }
+    }
+    return pos == length;
+}
@@ -0,0 +1,15 @@
+#ifndef TELEMETRY_DECODE_HPP
+#define TELEMETRY_DECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "telemetry.hpp"
+
+// Decodes one batch written by TelemetryEncoder: the channel types, then each sample's
+// time and values. Returns false on malformed input.
+bool telemetry_decode(const uint8_t* data, size_t length,
+                      std::vector<SensorData::Type>& types, std::vector<int64_t>& times_ms,
+                      std::vector<float>& values);
+
+#endif // TELEMETRY_DECODE_HPP
@@ -0,0 +1,83 @@
+// The fill pump follows the water level, not the SEN0311 distance: in every control mode a
+// low tank turns the pump on and a full one turns it off. One zone on the simulated drivers
+// with a 100 cm tank and a 50 cm level setpoint; TDS and temperature stay below their
+// thresholds so only the level can ask for the pump.
+//   level_control_test
+// Exits non-zero on the first case that fails.
+#include <cstdio>
+
+#include "fuzzy_rules.hpp"
+#include "sim_adc_driver.hpp"
+#include "sim_uart_driver.hpp"
+#include "zone.hpp"
+
+namespace {
+
+constexpr float TANK_HEIGHT_CM = 100.0f;
+
+// Pump duty of a settled zone whose SEN0311 reports distance_cm, and the level it saw
+float pump_duty(ControlMode mode, float distance_cm, float& level_cm) {
+    SimAdcDriver adc_driver;
+    adc_driver.set_waveform(0, { .offset_v = 0.09f });     // ~100 ppm
+    adc_driver.set_waveform(1, { .offset_v = 1.65f });     // ~25 °C
+    adc_driver.set_waveform(2, { .offset_v = 1.80f });
+    SimUartDriver uart_driver(0.0f);
+    UartConfig uart_config = { .port = UART_NUM_1, .tx_pin = 16, .rx_pin = 17, .baud_rate = 9600 };
+    SensorAdc adc(adc_driver, default_adc_configs(), AdcMode::ONESHOT);
+    Uart level_link(uart_driver, uart_config);
+    Zone zone("tank1", adc, 0, level_link, TANK_HEIGHT_CM);
+    ControlConfig config = {
+        .tds_threshold = 5000.0f,
+        .temp_threshold = 40.0f,
+        .water_level_threshold = 50.0f,
+        .mode = mode,
+        .pump_pid = { .kp = 0.05f, .ki = 0.002f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f },
+        .heater_pid = { .kp = 0.4f, .ki = 0.01f, .kd = 2.0f, .out_min = 0.0f, .out_max = 1.0f },
+        .dosing_pid = { .kp = 0.002f, .ki = 0.0001f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f },
+        .version = 0,
+    };
+    zone.configure(config, 1.0f);
+    FuzzyController fuzzy(FUZZY_RULES_GROWTH);
+
+    uint8_t frame[4];
+    SimUartDriver::encode_frame(distance_cm, frame);
+    for (int pass = 0; pass < 20 && !zone.acquire(); ++pass) {
+        uart_driver.inject(frame, sizeof(frame));
+        zone.sample_once();
+    }
+    level_cm = zone.data()[static_cast<size_t>(SensorData::Type::WATER_LEVEL)].value;
+    if (!zone.ready()) {
+        return -1.0f;
+    }
+    zone.control(fuzzy, 0);
+    return zone.outputs().pump;
+}
+
+}  // namespace
+
+int main() {
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    struct Case {
+        const char* mode_name;
+        ControlMode mode;
+    };
+    const Case modes[] = {
+        { "on/off", ControlMode::ON_OFF_CONTROL },
+        { "pid", ControlMode::PID_CONTROL },
+        { "fuzzy", ControlMode::FUZZY_LOGIC_CONTROL },
+    };
+    bool pass = true;
+    for (const Case& c : modes) {
+        // 80 cm down to the water is a low tank, 10 cm a full one
+        float low_level_cm = 0.0f;
+        float full_level_cm = 0.0f;
+        float low = pump_duty(c.mode, 80.0f, low_level_cm);
+        float full = pump_duty(c.mode, 10.0f, full_level_cm);
+        bool ok = low > 0.5f && full == 0.0f && low_level_cm < 25.0f && full_level_cm > 85.0f;
+        std::printf("  %-7s level %5.1f cm: pump %.2f, level %5.1f cm: pump %.2f  %s\n", c.mode_name, low_level_cm,
+                    low, full_level_cm, full, ok ? "ok" : "FAIL");
+        pass = pass && ok;
+    }
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
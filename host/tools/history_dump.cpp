@@ -0,0 +1,72 @@
+// Prints the raw history archived in the history partition as CSV, oldest row first.
+//   parttool.py read_partition --partition-name history --output history.bin
+//   history_dump history.bin > history.csv
+// Times are ms since the boot that recorded them; a reboot starts again from 0.
+#include <cstdio>
+#include <vector>
+
+#include "history_decode.hpp"
+#include "ram_flash_region.hpp"
+
+int main(int argc, char** argv) {
+    static const char* const SENSOR_NAMES[SensorData::TYPE_COUNT] = { "tds", "ntc", "level", "ph" };
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s history.bin\n", argv[0]);
+        return 2;
+    }
+    FILE* in = std::fopen(argv[1], "rb");
+    if (!in) {
+        std::perror(argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    std::fclose(in);
+
+    const size_t sector_size = 4096;
+    RamFlashRegion region((image.size() + sector_size - 1) / sector_size * sector_size, sector_size);
+    region.write(0, image.data(), image.size());
+    FlashRing ring(region);
+    if (ring.mount() != ESP_OK) {
+        std::fprintf(stderr, "%s: not a history partition\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> record(ring.max_record_size());
+    std::vector<SensorData::Type> types;
+    std::vector<SensorData::Type> header;
+    std::vector<int64_t> times_ms;
+    std::vector<float> values;
+    size_t length = 0;
+    size_t chunks = 0;
+    size_t bad = 0;
+    while (ring.pending() > 0 && ring.peek(record.data(), record.size(), length) == ESP_OK) {
+        ring.pop();
+        if (!history_decode(record.data(), length, types, times_ms, values)) {
+            bad++;
+            continue;
+        }
+        // A new header whenever the layout changes, e.g. a zone added between boots
+        if (types != header) {
+            header = types;
+            std::printf("time_ms");
+            for (size_t i = 0; i < types.size(); ++i) {
+                std::printf(",%s%d", SENSOR_NAMES[static_cast<size_t>(types[i])], static_cast<int>(i / SensorData::TYPE_COUNT));
+            }
+            std::printf("\n");
+        }
+        for (size_t row = 0; row < times_ms.size(); ++row) {
+            std::printf("%lld", static_cast<long long>(times_ms[row]));
+            for (size_t i = 0; i < types.size(); ++i) {
+                std::printf(",%g", values[row * types.size() + i]);
+            }
+            std::printf("\n");
+        }
+        chunks++;
+    }
+    std::fprintf(stderr, "%zu chunks, %zu malformed\n", chunks, bad);
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Plays a driver capture (CONFIG_HYDRO_CAPTURE_CONSOLE or _FLASH, or replay_bench's) through
+// this source tree's filters, sensors, estimators and controllers, as fast as the host runs.
+//   replay capture.bin [values.csv] [--session N] [--flash]
+// values.csv gets one row per control cycle: the time and every zone's TDS, temperature,
+// level, pH and actuator outputs; diff two of them to see what a change does to a dataset.
+// --flash reads a dump of the capture partition (parttool.py read_partition
+// --partition-name capture), whose blocks are put back in order first.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ram_flash_region.hpp"
+#include "replay.hpp"
+
+namespace {
+
+// The FlashRing records of a partition dump, oldest first, as one capture stream
+FILE* unpack_flash_dump(FILE* dump) {
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), dump)) > 0) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    const size_t sector_size = 4096;
+    RamFlashRegion region((image.size() + sector_size - 1) / sector_size * sector_size, sector_size);
+    region.write(0, image.data(), image.size());
+    FlashRing ring(region);
+    if (ring.mount() != ESP_OK) {
+        return nullptr;
+    }
+    FILE* out = std::tmpfile();
+    std::vector<uint8_t> record(ring.max_record_size());
+    size_t length = 0;
+    while (ring.pending() > 0 && ring.peek(record.data(), record.size(), length) == ESP_OK) {
+        std::fwrite(record.data(), 1, length, out);
+        ring.pop();
+    }
+    std::rewind(out);
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* capture_path = nullptr;
+    const char* csv_path = nullptr;
+    ReplayOptions options;
+    bool flash = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--session") == 0 && i + 1 < argc) {
+            options.session = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--flash") == 0) {
+            flash = true;
+        } else if (!capture_path) {
+            capture_path = argv[i];
+        } else {
+            csv_path = argv[i];
+        }
+    }
+    if (!capture_path) {
+        std::fprintf(stderr, "usage: %s capture.bin [values.csv] [--session N] [--flash]\n", argv[0]);
+        return 2;
+    }
+    FILE* in = std::fopen(capture_path, "rb");
+    if (!in) {
+        std::perror(capture_path);
+        return 1;
+    }
+    if (flash) {
+        FILE* unpacked = unpack_flash_dump(in);
+        std::fclose(in);
+        if (!unpacked) {
+            std::fprintf(stderr, "%s: not a capture partition\n", capture_path);
+            return 1;
+        }
+        in = unpacked;
+    }
+    FILE* csv = nullptr;
+    if (csv_path) {
+        csv = std::fopen(csv_path, "w");
+        if (!csv) {
+            std::perror(csv_path);
+            return 1;
+        }
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    CaptureReader reader(in);
+    Replay replay(reader, options);
+    bool header_written = false;
+    auto start = std::chrono::steady_clock::now();
+    esp_err_t ret = replay.run([&](const StateMachine& state_machine, int64_t time_us) {
+        if (!csv) {
+            return;
+        }
+        if (!header_written) {
+            std::fprintf(csv, "time_s");
+            for (size_t z = 0; z < state_machine.zone_count(); ++z) {
+                const char* name = state_machine.zone(z).name();
+                std::fprintf(csv, ",%s.tds,%s.temp,%s.level,%s.ph,%s.pump,%s.heater,%s.dosing", name, name, name, name,
+                             name, name, name);
+            }
+            std::fprintf(csv, "\n");
+            header_written = true;
+        }
+        std::fprintf(csv, "%.3f", time_us / 1e6);
+        for (size_t z = 0; z < state_machine.zone_count(); ++z) {
+            const Zone& zone = state_machine.zone(z);
+            for (const SensorData& data : zone.data()) {
+                std::fprintf(csv, ",%.3f", data.value);
+            }
+            const ActuatorOutputs& outputs = zone.outputs();
+            std::fprintf(csv, ",%.3f,%.3f,%.3f", outputs.pump, outputs.heater, outputs.dosing);
+        }
+        std::fprintf(csv, "\n");
+    });
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (csv) {
+        std::fclose(csv);
+    }
+    std::fclose(in);
+    if (ret != ESP_OK) {
+        std::fprintf(stderr, "%s: %s\n", capture_path, esp_err_to_name(ret));
+        return 1;
+    }
+
+    const ReplayStats& stats = replay.stats();
+    double captured_s = (stats.last_us - stats.first_us) / 1e6;
+    std::printf("replay: session %lu of %s, %d zones\n", static_cast<unsigned long>(options.session), capture_path,
+                static_cast<int>(replay.state_machine()->zone_count()));
+    std::printf("  %.1f s of capture in %.2f s (%.0fx), %llu events, %llu sensor reads, %lu control cycles\n",
+                captured_s, wall_s, wall_s > 0.0 ? captured_s / wall_s : 0.0,
+                static_cast<unsigned long long>(stats.events), static_cast<unsigned long long>(stats.samples),
+                static_cast<unsigned long>(stats.control_cycles));
+    std::printf("  reads repeated %llu, conversions unread %llu, dropped on the device %lu, "
+                "bytes skipped %llu, bad records %lu\n",
+                static_cast<unsigned long long>(stats.repeated_reads), static_cast<unsigned long long>(stats.overrun_reads),
+                static_cast<unsigned long>(stats.dropped), static_cast<unsigned long long>(reader.skipped_bytes()),
+                static_cast<unsigned long>(reader.bad_records()));
+    char report[METRICS_REPORT_BYTES];
+    replay.state_machine()->metrics_report(report, sizeof(report), MetricsFormat::TEXT);
+    std::printf("%s", report);
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Decodes a binary trace capture (CONFIG_HYDRO_TRACE_BINARY, or trace_bench's output)
+// into log lines, with the format strings of this source tree's trace_events.hpp.
+//   trace_decode capture.bin
+// A serial capture may start mid-stream: everything before the first header is skipped.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "trace.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s capture.bin\n", argv[0]);
+        return 2;
+    }
+    FILE* in = std::fopen(argv[1], "rb");
+    if (!in) {
+        std::perror(argv[1]);
+        return 1;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    std::fclose(in);
+
+    size_t offset = 0;
+    TraceCaptureHeader header;
+    while (offset + sizeof(header) <= data.size()) {
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        if (std::memcmp(header.magic, "HTRC", 4) == 0) {
+            break;
+        }
+        offset++;
+    }
+    if (offset + sizeof(header) > data.size()) {
+        std::fprintf(stderr, "%s: no trace header found\n", argv[1]);
+        return 1;
+    }
+    if (header.version != TRACE_CAPTURE_VERSION || header.record_size != sizeof(TraceRecord)) {
+        std::fprintf(stderr, "%s: capture version %u with %u-byte records, expected %u with %zu\n", argv[1],
+                     header.version, header.record_size, TRACE_CAPTURE_VERSION, sizeof(TraceRecord));
+        return 1;
+    }
+    offset += sizeof(header);
+
+    TextTraceSink sink(stdout);
+    size_t records = 0;
+    while (offset + sizeof(TraceRecord) <= data.size()) {
+        TraceRecord record;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        sink.write(&record, 1, 0);
+        offset += sizeof(record);
+        records++;
+    }
+    std::fprintf(stderr, "%zu records, %zu trailing bytes\n", records, data.size() - offset);
+    return 0;
+}
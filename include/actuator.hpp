@@ -0,0 +1,123 @@
+#ifndef ACTUATOR_HPP
+#define ACTUATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "actuator_driver.hpp"
+#include "latency_histogram.hpp"
+#include "mpsc_ring.hpp"
+#include "seqlock.hpp"
+
+// Outputs of one zone in order: fill pump, heater, dosing pump; zone i owns 3i..3i+2
+enum class ZoneActuator {
+    PUMP,
+    HEATER,
+    DOSING
+};
+static constexpr size_t ZONE_ACTUATORS = 3;
+// Commands between two engine passes; a zone sends three per control tick
+static constexpr size_t ACTUATOR_QUEUE_DEPTH = 64;
+
+enum class ActuatorKind {
+    DUTY,               // PWM at the commanded duty, e.g. a pump's speed
+    TIME_PROPORTIONAL,  // On for duty x window_ms of every window, e.g. a heater relay
+    PULSE               // On for each dose's duration, e.g. a dosing pump
+};
+
+struct ActuatorConfig {
+    const char* name;
+    ActuatorPin pin;
+    ActuatorKind kind;
+    uint32_t min_on_ms;             // Once switched on, stays on at least this long (not a dose)
+    uint32_t min_off_ms;            // Once switched off, stays off at least this long
+    float max_slew_per_s;           // DUTY: largest duty change per second, 0 for none
+    uint32_t window_ms;             // TIME_PROPORTIONAL: switching period
+    uint32_t full_dose_ms;          // PULSE: dose for a control output of 1
+    uint32_t max_on_ms_per_hour;    // Rate limit on on-time, refilled evenly; 0 for none
+};
+
+enum class ActuatorCommandType : uint8_t {
+    DUTY,   // DUTY and TIME_PROPORTIONAL channels
+    DOSE    // PULSE channels; replaces a dose still waiting, 0 cancels it
+};
+
+struct ActuatorCommand {
+    uint8_t channel;
+    ActuatorCommandType type;
+    float duty;
+    uint32_t dose_ms;
+};
+
+// Counters of one channel, published by the engine after every pass
+struct ActuatorStats {
+    float duty;             // Applied now
+    float target;           // Commanded
+    uint32_t pending_ms;    // Dose waiting for min_off_ms or the rate limit
+    uint32_t commands;
+    uint32_t switches;      // Off to on
+    uint32_t doses;
+    uint64_t dosed_us;      // Sum of the doses' actual durations
+    uint64_t on_us;         // Duty-weighted on-time
+    uint32_t held;          // Changes delayed by min_on_ms / min_off_ms
+    uint32_t limited;       // Passes where the rate limit kept the output down
+    uint32_t rejected;      // Commands for another kind of channel or out of range
+};
+
+// Drives pumps, heaters and dosing pumps from commands, without the control task ever
+// waiting: actuator_control queues commands (lock-free, MpscRing) and the engine applies
+// them on the driver's timer task, with min on/off times, slew and rate limits. The engine
+// is tickless: each pass computes the next time something has to change (a dose ending,
+// a window edge, a hold expiring) and arms the driver's timer for exactly then, so a dose
+// lasts its duration however long the state machine's stages take.
+class ActuatorEngine : public ActuatorTimerListener {
+    struct Channel {
+        ActuatorConfig config;
+        float target;
+        float duty;
+        int64_t changed_us;         // Last switch between off and on
+        int64_t updated_us;         // Last pass
+        int64_t window_start_us;
+        int64_t dose_end_us;        // 0 when no dose is running
+        int64_t dose_start_us;
+        uint32_t pending_ms;
+        double budget_ms;           // Rate limit: on-time left; a pass adds far below a float's step
+        ActuatorStats stats;
+    };
+
+    ActuatorDriver& driver_;
+    Channel channels_[ACTUATOR_MAX_CHANNELS];
+    size_t channel_count_;
+    MpscRing<ActuatorCommand, ACTUATOR_QUEUE_DEPTH> queue_;
+    Seqlock<ActuatorStats> published_[ACTUATOR_MAX_CHANNELS];
+    LatencyHistogram late_us_;      // Timer passes after their deadline
+    int64_t deadline_us_;
+    bool started_;
+
+    void apply(const ActuatorCommand& command);
+    int64_t update(size_t channel, int64_t now_us);
+    bool submit(const ActuatorCommand& command);
+
+    public:
+        explicit ActuatorEngine(ActuatorDriver& driver);
+        // Copies the configs (at most ACTUATOR_MAX_CHANNELS), initialises the driver with every output off
+        esp_err_t start(const ActuatorConfig* configs, size_t count);
+
+        // Any task, never blocks; false if the queue is full (counted in dropped())
+        bool set_duty(size_t channel, float duty) { return submit({ static_cast<uint8_t>(channel), ActuatorCommandType::DUTY, duty, 0 }); }
+        bool dose(size_t channel, uint32_t dose_ms) { return submit({ static_cast<uint8_t>(channel), ActuatorCommandType::DOSE, 0.0f, dose_ms }); }
+
+        // Applies the queued commands and updates every output at now_us; returns when the
+        // next pass is due (INT64_MAX for never). The driver's timer calls it; hosts with
+        // their own clock may call it directly instead of starting the timer.
+        int64_t service(int64_t now_us);
+        void on_timer() override;
+
+        size_t channels() const { return channel_count_; }
+        const ActuatorConfig& config(size_t channel) const { return channels_[channel].config; }
+        // Any task
+        ActuatorStats stats(size_t channel) const { return published_[channel].load(); }
+        uint32_t dropped() const { return queue_.dropped(); }
+        const LatencyHistogram& late_us() const { return late_us_; }
+};
+
+#endif // ACTUATOR_HPP
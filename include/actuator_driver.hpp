@@ -0,0 +1,43 @@
+#ifndef ACTUATOR_DRIVER_HPP
+#define ACTUATOR_DRIVER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+// Outputs one driver handles: three per zone in up to eight zones
+static constexpr size_t ACTUATOR_MAX_CHANNELS = 24;
+
+// One output pin: PWM for loads driven proportionally (a DC pump on a MOSFET), plain
+// on/off for relays, SSRs and dosing pumps
+struct ActuatorPin {
+    int gpio;
+    bool pwm;
+    bool active_low;
+};
+
+// Receives the driver's timer, on the driver's timer task
+class ActuatorTimerListener {
+    public:
+        virtual ~ActuatorTimerListener() = default;
+        virtual void on_timer() = 0;
+};
+
+// Hardware side of ActuatorEngine: LEDC, GPIO and esp_timer on the device
+// (EspActuatorDriver), a simulated GPIO log and timer thread on the host. Channel indices
+// follow the pins passed to init().
+class ActuatorDriver {
+    public:
+        virtual ~ActuatorDriver() = default;
+        // Every pin configured and inactive
+        virtual esp_err_t init(const ActuatorPin* pins, size_t count, ActuatorTimerListener& listener) = 0;
+        // duty 0..1; an on/off pin is on for any duty above 0. Timer task only.
+        virtual esp_err_t set(size_t channel, float duty) = 0;
+        // One call of the listener at time_us on the esp_timer clock, replacing the previous
+        // one; INT64_MAX cancels it. Timer task only.
+        virtual esp_err_t wake_at(int64_t time_us) = 0;
+        // A call of the listener as soon as possible, independent of wake_at; any task
+        virtual esp_err_t wake_now() = 0;
+};
+
+#endif // ACTUATOR_DRIVER_HPP
@@ -0,0 +1,46 @@
+#ifndef ADAPTIVE_RATE_HPP
+#define ADAPTIVE_RATE_HPP
+
+#include <cstdint>
+
+struct AdaptiveRateConfig {
+    uint32_t min_period_ms = 0;     // Fastest rate, during change; 0 disables adaptation
+    uint32_t max_period_ms = 0;     // Slowest rate, for a steady signal
+    float quiet_slope = 0.0f;       // Below this rate of change (units/s) the signal is steady
+    float quiet_deviation = 0.0f;   // and below this mean reading-to-prediction deviation (units)
+    float approach_band = 0.0f;     // Fastest rate within this distance of the watched threshold
+    uint32_t quiet_readings = 4;    // Steady readings before each halving of the rate
+    uint32_t slope_window_ms = 10000; // Slope baseline; short ones mostly measure noise
+};
+
+// Sample period policy for one sensor. Tracks the slope over a time window and the mean
+// deviation of each reading from the straight-line prediction; backs off exponentially towards
+// max_period_ms while both stay small, and drops straight to min_period_ms on a step, a
+// ramp, or when the value nears a watched threshold, e.g. a control setpoint.
+class AdaptiveRate {
+    AdaptiveRateConfig config_;
+    uint32_t period_ms_;
+    float last_value_;
+    int64_t last_time_us_;
+    float anchor_value_;    // Start of the current slope window
+    int64_t anchor_time_us_;
+    float slope_;           // Units per second, over the last full window
+    float deviation_;       // Mean |reading - prediction|
+    uint32_t quiet_count_;
+    bool valid_;
+
+    public:
+        AdaptiveRate();
+        void configure(const AdaptiveRateConfig& config);
+        bool enabled() const { return config_.min_period_ms > 0 && config_.max_period_ms >= config_.min_period_ms; }
+        void reset();
+        // Folds in one reading and returns the period until the next one
+        uint32_t update(float value, int64_t time_us, float watch, bool has_watch);
+        // After a failed read: sample fast until readings come back
+        uint32_t on_error();
+
+        uint32_t period_ms() const { return period_ms_; }
+        float slope() const { return slope_; }
+};
+
+#endif // ADAPTIVE_RATE_HPP
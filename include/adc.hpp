@@ -1,35 +1,111 @@
 #ifndef ADC_HPP
 #define ADC_HPP
 
-#include <vector>
-#include "driver/adc.h"
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-
-typedef struct AdcConfig {
-    adc_channel_t channel;
-    adc_atten_t atten;
-} AdcConfig_t;
-
-static constexpr size_t MOVING_AVG_WINDOW = 50;
-
-class Adc {
-    adc_oneshot_unit_handle_t handle_;
-    std::vector<AdcConfig_t> configs_;
-    std::vector<adc_cali_handle_t> cali_handles_;
-    std::vector<bool> do_calibration_;
-    std::vector<std::vector<float>> voltage_history_;
-    std::vector<size_t> voltage_history_index_;
-    std::vector<float> reference_voltages_;
+#include <array>
+#include <atomic>
+#include "adc_driver.hpp"
+#include "filter.hpp"
+#include "metrics.hpp"
+#include "seqlock.hpp"
+
+// Conversions averaged into a channel's filter state before its first reading
+static constexpr size_t ADC_PRIME_SAMPLES = 16;
+
+// Continuous mode: a channel's latest filtered value with the status of the frame behind
+// it, published together so a reader never pairs a new status with an old voltage
+struct AdcReading {
+    float voltage;
+    esp_err_t status;
+};
+
+// Where an Adc keeps its per-channel state: parallel arrays with one entry per channel,
+// plus one pool of moving-average history that the channels split between them
+struct AdcStorage {
+    size_t channels;
+    AdcConfig_t* configs;
+    ChannelFilter* filters;
+    float* reference_voltages;
+    // Continuous mode: latest reading per channel, written by the scan task
+    Seqlock<AdcReading>* latest;
+    OpMetrics* metrics;     // Latency and outcome of read(), per channel
+    bool* primed;           // Oneshot mode: the priming burst was taken
+    float* history;
+    size_t history_size;
+};
+
+// Channel logic shared by every StaticAdc; the storage belongs to the derived class
+class Adc : public AdcScanListener {
+    AdcDriver& driver_;
+    AdcMode mode_;
+    AdcContinuousConfig cont_config_;
+    AdcStorage storage_;
+    bool suspended_;
+    std::atomic<bool> rearm_;   // The next frame restarts every filter
 
     public:
-        Adc(const std::vector<AdcConfig_t>& configs);
         ~Adc();
         esp_err_t read(size_t channel_idx, float& voltage);
+        // Brings every channel to a settled value: oneshot mode bursts ADC_PRIME_SAMPLES
+        // conversions per channel into its filter, continuous mode waits for the first
+        // frame. Without it the first read of each channel does the same; a channel whose
+        // burst was all out of range is then read one conversion at a time.
+        esp_err_t prime(uint32_t timeout_ms);
+        // Power-managed mode: stops the continuous scan so the chip can light-sleep. A
+        // oneshot unit converts only inside read() and has nothing to stop.
+        esp_err_t suspend();
+        // Restarts the scan and waits up to timeout_ms for a frame of every channel. The
+        // filters start over from that frame, as after prime(), instead of averaging it
+        // with values from before the sleep.
+        esp_err_t resume(uint32_t timeout_ms);
+        bool suspended() const { return suspended_; }
+        AdcMode mode() const { return mode_; }
+        size_t channels() const { return storage_.channels; }
+        const AdcConfig_t& config(size_t channel_idx) const { return storage_.configs[channel_idx]; }
+        const OpMetrics& metrics(size_t channel_idx) const { return storage_.metrics[channel_idx]; }
+        // Continuous mode: one frame's worth of results from the driver
+        void on_scan(const int* raw, const uint32_t* count, size_t channels) override;
+
+    protected:
+        // configs holds storage.channels entries
+        Adc(AdcDriver& driver, const AdcStorage& storage, const AdcConfig_t* configs, AdcMode mode,
+            const AdcContinuousConfig& cont_config);
 
     private:
         void init();
-        float compute_moving_average(float new_voltage, size_t channel_idx);
+        esp_err_t wait_frames(uint32_t timeout_ms);
+        esp_err_t read_oneshot(size_t channel_idx, float& voltage);
+        esp_err_t prime_oneshot(size_t channel_idx, float& voltage);
+        esp_err_t raw_to_voltage(size_t channel_idx, int raw_adc, float& voltage);
+};
+
+// Backing arrays of a StaticAdc. A separate base so they are constructed before Adc uses them.
+template <size_t N, size_t HistorySize>
+struct AdcArrays {
+    static_assert(N > 0 && N <= ADC_MAX_CHANNELS, "unsupported channel count");
+
+    AdcConfig_t configs[N];
+    ChannelFilter filters[N];
+    float reference_voltages[N];
+    Seqlock<AdcReading> latest[N];
+    OpMetrics read_metrics[N];
+    bool primed[N];
+    float history[HistorySize > 0 ? HistorySize : 1];
+
+    AdcStorage storage() {
+        return { N, configs, filters, reference_voltages, latest, read_metrics, primed, history, HistorySize };
+    }
+};
+
+// Adc for N channels whose moving averages share HistorySize samples, e.g. windows of
+// 200 and 10 need 210. All state is inside the object: nothing is allocated when it is
+// constructed or read, so its size is known at compile time.
+template <size_t N, size_t HistorySize>
+class StaticAdc : private AdcArrays<N, HistorySize>, public Adc {
+    public:
+        StaticAdc(AdcDriver& driver, const std::array<AdcConfig_t, N>& configs, AdcMode mode = AdcMode::ONESHOT,
+                  const AdcContinuousConfig& cont_config = AdcContinuousConfig())
+            : AdcArrays<N, HistorySize>(),
+              Adc(driver, AdcArrays<N, HistorySize>::storage(), configs.data(), mode, cont_config) {}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,53 @@
+#ifndef ADC_CURVE_HPP
+#define ADC_CURVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+// A channel's calibrated raw -> mV conversion, sampled every ADC_CURVE_STEP raw counts
+// with the last point at the 12-bit maximum. The IDF schemes add a low-order error
+// polynomial to a line, so interpolating between the points follows them closely while
+// costing one index and one multiply-add instead of their 64-bit arithmetic.
+static constexpr size_t ADC_CURVE_POINTS = 33;
+static constexpr int ADC_CURVE_STEP = 128;
+static constexpr int ADC_RAW_MAX = 4095;
+
+struct AdcCurve {
+    uint16_t mv[ADC_CURVE_POINTS];
+};
+
+// Raw value of point i
+constexpr int adc_curve_raw(size_t point) {
+    return point + 1 < ADC_CURVE_POINTS ? static_cast<int>(point) * ADC_CURVE_STEP : ADC_RAW_MAX;
+}
+
+// Fills curve from to_mv(raw, mv), an esp_err_t conversion such as AdcDriver::raw_to_mv;
+// stops at the first error
+template <typename ToMv>
+esp_err_t adc_curve_sample(ToMv&& to_mv, AdcCurve& curve) {
+    for (size_t p = 0; p < ADC_CURVE_POINTS; ++p) {
+        int mv = 0;
+        esp_err_t ret = to_mv(adc_curve_raw(p), mv);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        curve.mv[p] = static_cast<uint16_t>(mv < 0 ? 0 : mv);
+    }
+    return ESP_OK;
+}
+
+inline int adc_curve_mv(const AdcCurve& curve, int raw) {
+    raw = raw < 0 ? 0 : (raw > ADC_RAW_MAX ? ADC_RAW_MAX : raw);
+    size_t i = static_cast<size_t>(raw) / ADC_CURVE_STEP;
+    if (i >= ADC_CURVE_POINTS - 1) {
+        i = ADC_CURVE_POINTS - 2;
+    }
+    int x0 = adc_curve_raw(i);
+    int x1 = adc_curve_raw(i + 1);
+    int y0 = curve.mv[i];
+    int y1 = curve.mv[i + 1];
+    return y0 + ((y1 - y0) * (raw - x0) + (x1 - x0) / 2) / (x1 - x0);
+}
+
+#endif // ADC_CURVE_HPP
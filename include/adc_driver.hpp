@@ -0,0 +1,58 @@
+#ifndef ADC_DRIVER_HPP
+#define ADC_DRIVER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "hal/adc_types.h"
+#include "filter.hpp"
+
+typedef struct AdcConfig {
+    adc_channel_t channel;
+    adc_atten_t atten;
+    FilterConfig filter;    // Per-channel smoothing / spike rejection
+} AdcConfig_t;
+
+// Channels one driver handles; ADC1 on the esp32c6 has 7
+static constexpr size_t ADC_MAX_CHANNELS = 8;
+
+enum class AdcMode {
+    ONESHOT,    // Blocking adc_oneshot_read on every Adc::read
+    CONTINUOUS  // DMA scan of all channels, Adc::read returns the latest value
+};
+
+struct AdcContinuousConfig {
+    uint32_t sample_freq_hz = 6000;  // Total conversion rate, shared by all channels
+    uint32_t frame_size = 256;       // Bytes per DMA frame; the pool holds two frames. EspAdcDriver takes at most 1024
+    uint32_t task_priority = 6;      // Above the state machine task
+    uint32_t task_stack = 3072;
+};
+
+// Receives continuous-mode results, called on the driver's scan task
+class AdcScanListener {
+    public:
+        virtual ~AdcScanListener() = default;
+        // raw[i] is channel i averaged over count[i] conversions; count[i] is 0 if it was not in the frame
+        virtual void on_scan(const int* raw, const uint32_t* count, size_t channels) = 0;
+};
+
+// Hardware side of Adc: the ESP-IDF ADC drivers on the device (EspAdcDriver),
+// simulated waveforms on the host. Channel indices follow the configs passed to init().
+class AdcDriver {
+    public:
+        virtual ~AdcDriver() = default;
+        // Copies the channel list (at most ADC_MAX_CHANNELS) and sets up calibration
+        virtual esp_err_t init(const AdcConfig_t* configs, size_t count) = 0;
+        virtual esp_err_t start_oneshot() = 0;
+        virtual esp_err_t read_raw(size_t channel_idx, int& raw) = 0;
+        virtual esp_err_t start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) = 0;
+        virtual void stop_continuous() = 0;
+        // Stops a running scan without releasing it, so the chip can light-sleep; resume
+        // starts it again with the same channels and listener, dropping frames from before
+        virtual esp_err_t suspend_continuous() = 0;
+        virtual esp_err_t resume_continuous() = 0;
+        // Calibrated conversion, ESP_ERR_NOT_SUPPORTED if the channel has no calibration
+        virtual esp_err_t raw_to_mv(size_t channel_idx, int raw, int& mv) = 0;
+};
+
+#endif // ADC_DRIVER_HPP
@@ -0,0 +1,28 @@
+#ifndef BLOB_STORE_HPP
+#define BLOB_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+// Keys are at most BLOB_KEY_MAX characters, the NVS limit
+static constexpr size_t BLOB_KEY_MAX = 15;
+
+// Small named records that survive reboots: NVS on the device (NvsBlobStore), RAM on
+// the host
+class BlobStore {
+    public:
+        virtual ~BlobStore() = default;
+        // ESP_ERR_NOT_FOUND if the key is absent, ESP_ERR_INVALID_SIZE if it holds another length
+        virtual esp_err_t read(const char* key, void* data, size_t length) = 0;
+        virtual esp_err_t write(const char* key, const void* data, size_t length) = 0;
+        // ESP_OK if the key was already absent
+        virtual esp_err_t erase(const char* key) = 0;
+};
+
+// A record with a version and checksum in front: one written by a firmware with another
+// layout (version), or torn or corrupted, loads as ESP_ERR_NOT_FOUND
+esp_err_t blob_load(BlobStore& store, const char* key, uint16_t version, void* data, size_t length);
+esp_err_t blob_save(BlobStore& store, const char* key, uint16_t version, const void* data, size_t length);
+
+#endif // BLOB_STORE_HPP
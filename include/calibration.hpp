@@ -0,0 +1,118 @@
+#ifndef CALIBRATION_HPP
+#define CALIBRATION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "blob_store.hpp"
+#include "esp_err.h"
+
+// Points of one sensor's calibration, e.g. three pH buffers
+static constexpr size_t CAL_MAX_POINTS = 8;
+// Entries of the table a curve is turned into, evenly spaced over the calibrated span
+static constexpr size_t CAL_TABLE_POINTS = 64;
+// Layout of a stored CalibrationCurve; a curve saved with another version is ignored
+static constexpr uint16_t CALIBRATION_VERSION = 1;
+
+// A sensor input (V at the ADC pin) and the value it stands for (pH, ppm)
+struct CalibrationPoint {
+    float input;
+    float output;
+};
+
+// Piecewise-linear curve through points in increasing input order; beyond the first and
+// last point the end segments are extended
+struct CalibrationCurve {
+    uint32_t points;
+    CalibrationPoint point[CAL_MAX_POINTS];
+};
+
+// Two to CAL_MAX_POINTS finite points, inputs strictly increasing and at least 1 mV apart
+esp_err_t calibration_validate(const CalibrationCurve& curve);
+// The curve itself, segment search and division included; for building tables and checking them
+float calibration_evaluate(const CalibrationCurve& curve, float input);
+// Adds a point in input order; a point within 1 mV of an existing one replaces it.
+// ESP_ERR_NO_MEM when the curve is full.
+esp_err_t calibration_add_point(CalibrationCurve& curve, const CalibrationPoint& point);
+
+// A curve sampled at CAL_TABLE_POINTS evenly spaced inputs: a conversion is one index and
+// one multiply-add, with no segment search or division, as ThermistorTable does for the
+// NTC. Exact on every segment except the table steps that contain a calibration point.
+class CalibrationTable {
+    CalibrationCurve curve_;
+    float input_min_;
+    float input_max_;
+    float scale_;           // Table steps per volt
+    float low_slope_;       // End segments, for inputs outside the calibrated span
+    float high_slope_;
+    float table_[CAL_TABLE_POINTS];
+
+    public:
+        CalibrationTable();
+        esp_err_t build(const CalibrationCurve& curve);
+
+        float apply(float input) const {
+            float position = (input - input_min_) * scale_;
+            if (!(position > 0.0f)) {
+                return table_[0] + (input - input_min_) * low_slope_;
+            }
+            if (position >= static_cast<float>(CAL_TABLE_POINTS - 1)) {
+                return table_[CAL_TABLE_POINTS - 1] + (input - input_max_) * high_slope_;
+            }
+            size_t i = static_cast<size_t>(position);
+            float fraction = position - static_cast<float>(i);
+            return table_[i] + (table_[i + 1] - table_[i]) * fraction;
+        }
+
+        const CalibrationCurve& curve() const { return curve_; }
+        // Worst deviation from calibration_evaluate over the calibrated span, probed at
+        // probes_per_step points in every table step
+        float max_error(size_t probes_per_step = 16) const;
+};
+
+// One sensor's calibration: the built-in default and the table in use. New curves come
+// from one task (boot, the console) and reach the one task that reads the sensor without
+// locks, the way ControlConfigStore hands over config: the reader marks the table it
+// uses and the writer builds into a slot that is neither current nor marked.
+class Calibration {
+    static constexpr size_t SLOTS = 3;
+    CalibrationTable slots_[SLOTS];
+    std::atomic<const CalibrationTable*> current_;
+    std::atomic<const CalibrationTable*> in_use_;
+    std::atomic<float> last_input_;
+    CalibrationCurve defaults_;
+
+    public:
+        explicit Calibration(const CalibrationCurve& defaults);
+        Calibration(const Calibration& other);
+
+        // Reader: the sensor's task
+        float apply(float input) {
+            last_input_.store(input, std::memory_order_relaxed);
+            const CalibrationTable* table = current_.load();
+            while (true) {
+                in_use_.store(table);
+                const CalibrationTable* again = current_.load();
+                if (again == table) {
+                    return table->apply(input);
+                }
+                table = again;
+            }
+        }
+        // Input of the latest conversion, for taking a calibration point; any task
+        float last_input() const { return last_input_.load(std::memory_order_relaxed); }
+
+        // Writer: one task at a time
+        esp_err_t set(const CalibrationCurve& curve);
+        void reset() { set(defaults_); }
+        const CalibrationCurve& curve() const { return current_.load()->curve(); }
+        const CalibrationCurve& defaults() const { return defaults_; }
+        bool is_default() const;
+        float max_error() const { return current_.load()->max_error(); }
+
+        // The curve stored under key, if any and valid, replaces the current one
+        esp_err_t load(BlobStore& store, const char* key);
+        esp_err_t save(BlobStore& store, const char* key) const;
+};
+
+#endif // CALIBRATION_HPP
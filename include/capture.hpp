@@ -0,0 +1,250 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "adc_curve.hpp"
+#include "adc_driver.hpp"
+#include "flash_ring.hpp"
+#include "mpsc_ring.hpp"
+
+// Capture of what the drivers handed to Adc and Uart: every oneshot conversion, every
+// continuous scan frame and every UART read, with its esp_timer time. The recording
+// drivers (recording_driver.hpp) queue events into a lock-free ring; a low-priority task
+// encodes them and writes them to a sink, the console or a flash partition. On the host,
+// host/support/replay.hpp feeds a capture back through the same Adc, Uart and sensors.
+//
+// Format: a sequence of self-checking blocks, so a reader can start anywhere in a serial
+// stream, skip log text between blocks and drop a torn write.
+//   block   CaptureBlockHeader, then `length` bytes of records
+//   record  tag (kind << 4 | stream), zigzag varint time delta in µs, payload
+// The first record of a block carries the absolute time; raw ADC values are zigzag deltas
+// against the channel's previous value in the same block. Payloads by kind:
+//   ADC_SETUP      channels, continuous, per channel: channel, atten, calibrated,
+//                  and if calibrated its AdcCurve
+//   UART_SETUP     port, varint baud rate
+//   ADC_READ       channel index, raw delta
+//   ADC_ERROR      channel index, zigzag esp_err_t
+//   ADC_SCAN       channel count, bitmask of channels in the frame, raw delta per channel
+//   UART_DATA      length, bytes
+//   UART_IDLE, UART_OVERFLOW   nothing
+//   DROPPED        varint count of events lost to a full ring
+enum class CaptureKind : uint8_t {
+    ADC_SETUP,
+    UART_SETUP,
+    ADC_READ,
+    ADC_ERROR,
+    ADC_SCAN,
+    UART_DATA,
+    UART_IDLE,
+    UART_OVERFLOW,
+    DROPPED,
+};
+
+static constexpr uint16_t CAPTURE_VERSION = 1;
+static constexpr size_t CAPTURE_MAX_STREAMS = 8;    // ADC units, and separately UART links
+static constexpr size_t CAPTURE_CAPACITY = 128;     // Queued events; a power of two
+static constexpr size_t CAPTURE_DATA_BYTES = 16;    // UART bytes per event; longer reads are split
+static constexpr size_t CAPTURE_BLOCK_BYTES = 1024; // Largest block payload
+static constexpr uint8_t CAPTURE_NO_STREAM = 0xFF;
+// Longest a partial block waits in RAM before going to flash; full blocks go at once
+static constexpr uint32_t CAPTURE_FLASH_FLUSH_MS = 60000;
+
+struct CaptureBlockHeader {
+    char magic[4];          // "HCAP"
+    uint16_t version;
+    uint16_t length;        // Record bytes after the header
+    uint32_t checksum;      // FNV-1a of the record bytes
+};
+static_assert(sizeof(CaptureBlockHeader) == 12, "CaptureBlockHeader is the capture format");
+
+// One driver callback, as queued by the recorder and as returned by CaptureReader
+struct CaptureEvent {
+    int64_t time_us;
+    CaptureKind kind;
+    uint8_t stream;
+    uint8_t channel;        // ADC_READ, ADC_ERROR: channel index
+    uint8_t length;         // ADC_SCAN: channels in scan; UART_DATA: bytes in data
+    union {
+        int32_t raw;                        // ADC_READ
+        int32_t error;                      // ADC_ERROR, an esp_err_t
+        uint32_t dropped;                   // DROPPED
+        int16_t scan[ADC_MAX_CHANNELS];     // ADC_SCAN: -1 for a channel not in the frame
+        uint8_t data[CAPTURE_DATA_BYTES];   // UART_DATA
+    };
+};
+
+// What replay needs to rebuild an ADC unit: its channels and calibration curves
+struct CaptureAdcChannel {
+    uint8_t channel;        // adc_channel_t
+    uint8_t atten;          // adc_atten_t
+    bool calibrated;        // Without calibration Adc uses its linear fallback
+    AdcCurve curve;
+};
+
+struct CaptureAdcSetup {
+    uint8_t channels;
+    bool continuous;
+    CaptureAdcChannel config[ADC_MAX_CHANNELS];
+};
+
+struct CaptureUartSetup {
+    uint8_t port;
+    uint32_t baud_rate;
+};
+
+// Calibrated mV of raw on a captured curve, ESP_ERR_NOT_SUPPORTED if it had none
+esp_err_t capture_raw_to_mv(const CaptureAdcChannel& channel, int raw, int& mv);
+
+// Where encoded blocks go
+class CaptureSink {
+    public:
+        virtual ~CaptureSink() = default;
+        virtual esp_err_t write(const uint8_t* data, size_t length) = 0;
+        // How long Capture::drain() may hold a partial block; 0 writes it on every drain
+        virtual uint32_t flush_interval_ms() const { return 0; }
+};
+
+// Streams blocks to a file, or the console on the device
+class FileCaptureSink : public CaptureSink {
+    FILE* out_;
+
+    public:
+        explicit FileCaptureSink(FILE* out) : out_(out) {}
+        esp_err_t write(const uint8_t* data, size_t length) override;
+};
+
+// One block per FlashRing record: the partition keeps the latest captures across reboots,
+// oldest dropped when full. Partial blocks are held for CAPTURE_FLASH_FLUSH_MS so the
+// sectors wear by full blocks, not by drain period; a reset loses at most that much.
+class FlashCaptureSink : public CaptureSink {
+    FlashRing& ring_;
+
+    public:
+        explicit FlashCaptureSink(FlashRing& ring) : ring_(ring) {}
+        esp_err_t write(const uint8_t* data, size_t length) override { return ring_.push(data, length); }
+        uint32_t flush_interval_ms() const override { return CAPTURE_FLASH_FLUSH_MS; }
+};
+
+// Encodes events into blocks; a block goes to the sink when full or on flush()
+class CaptureWriter {
+    CaptureSink* sink_;
+    uint8_t block_[sizeof(CaptureBlockHeader) + CAPTURE_BLOCK_BYTES];
+    size_t length_;
+    int64_t last_time_us_;
+    int32_t last_raw_[CAPTURE_MAX_STREAMS][ADC_MAX_CHANNELS];
+    uint32_t blocks_;
+    uint64_t bytes_;
+
+    // Encodes with encode(record) against the current block; starts a new block if it does not fit
+    template <typename Encode>
+    esp_err_t append(int64_t time_us, Encode encode);
+    size_t put_tag(uint8_t* out, CaptureKind kind, uint8_t stream, int64_t time_us) const;
+    void begin_block();
+
+    public:
+        CaptureWriter();
+        explicit CaptureWriter(CaptureSink& sink);
+        // Starts over on sink: a new block, counters cleared
+        void begin(CaptureSink& sink);
+        esp_err_t write(const CaptureEvent& event);
+        esp_err_t write_adc_setup(uint8_t stream, const CaptureAdcSetup& setup, int64_t time_us);
+        esp_err_t write_uart_setup(uint8_t stream, const CaptureUartSetup& setup, int64_t time_us);
+        esp_err_t flush();
+        uint32_t blocks() const { return blocks_; }
+        uint64_t bytes() const { return bytes_; }
+};
+
+// Decodes blocks from a file: a serial log, a flash dump or a host recording. Bytes that
+// are not part of a valid block are skipped and counted.
+class CaptureReader {
+    FILE* in_;
+    uint8_t buffer_[2 * (sizeof(CaptureBlockHeader) + CAPTURE_BLOCK_BYTES)];
+    size_t buffered_;
+    uint8_t block_[CAPTURE_BLOCK_BYTES];
+    size_t block_length_;
+    size_t position_;       // Next record in block_
+    int64_t time_us_;
+    int32_t last_raw_[CAPTURE_MAX_STREAMS][ADC_MAX_CHANNELS];
+    CaptureAdcSetup adc_[CAPTURE_MAX_STREAMS];
+    CaptureUartSetup uart_[CAPTURE_MAX_STREAMS];
+    bool adc_known_[CAPTURE_MAX_STREAMS];
+    bool uart_known_[CAPTURE_MAX_STREAMS];
+    bool data_seen_;
+    uint32_t session_;
+    uint32_t blocks_;
+    uint64_t skipped_bytes_;
+    uint32_t bad_records_;
+
+    bool next_block();
+    bool decode(CaptureEvent& event);
+    void discard(size_t count, bool skipped);
+
+    public:
+        explicit CaptureReader(FILE* in);
+        // The next event in capture order, setup records included; false at the end
+        bool next(CaptureEvent& event);
+        const CaptureAdcSetup* adc_setup(uint8_t stream) const;
+        const CaptureUartSetup* uart_setup(uint8_t stream) const;
+        // Counts from 0; a setup record after data starts the next one, e.g. after a reboot
+        uint32_t session() const { return session_; }
+        uint32_t blocks() const { return blocks_; }
+        uint64_t skipped_bytes() const { return skipped_bytes_; }
+        uint32_t bad_records() const { return bad_records_; }
+};
+
+struct CaptureStats {
+    uint64_t events;        // Encoded, setup records included
+    uint32_t dropped;       // Lost to a full ring
+    uint32_t blocks;
+    uint64_t bytes;
+};
+
+// The recorder: drivers register their streams and queue events from any task; drain()
+// encodes them on one consumer task. Nothing is queued while stopped.
+class Capture {
+    MpscRing<CaptureEvent, CAPTURE_CAPACITY> ring_;
+    std::atomic<bool> recording_;
+    const CaptureAdcSetup* adc_[CAPTURE_MAX_STREAMS];
+    const CaptureUartSetup* uart_[CAPTURE_MAX_STREAMS];
+    size_t adc_count_;
+    size_t uart_count_;
+    CaptureSink* sink_;
+    std::atomic<bool> setup_pending_;   // start() was called, drain() writes the setups first
+    CaptureWriter writer_;              // Consumer only
+    uint64_t events_;
+    uint32_t dropped_;
+    uint32_t drain_period_ms_;
+    int64_t flushed_us_;                // Last partial block written, consumer only
+    TaskHandle_t drain_task_;
+
+    static void drain_task(void* arg);
+
+    public:
+        Capture();
+        // Stream ids for the recording drivers, CAPTURE_NO_STREAM when all are taken.
+        // setup must outlive the capture; the drivers fill it in as they start.
+        uint8_t add_adc(const CaptureAdcSetup* setup);
+        uint8_t add_uart(const CaptureUartSetup* setup);
+        // Records into sink until stop() or a sink error; the next drain() writes every
+        // registered setup ahead of the events. Call start() and stop() from one task.
+        esp_err_t start(CaptureSink& sink);
+        void stop();
+        bool recording() const { return recording_.load(std::memory_order_relaxed); }
+        // Producer side, any task; false if not recording or the ring was full
+        bool record(const CaptureEvent& event);
+        // Consumer side: encodes everything queued so far. The partial block is written
+        // once the sink's flush interval has passed since the last one, or after stop().
+        size_t drain();
+        // Drains every period_ms on a task of its own, below the loops it records
+        esp_err_t start_drain(UBaseType_t priority, uint32_t stack_size, uint32_t period_ms);
+        // Updated by drain(): read on the drain task, or after stop() and a last drain()
+        CaptureStats stats() const;
+};
+
+#endif // CAPTURE_HPP
@@ -0,0 +1,30 @@
+#ifndef CONSOLE_HPP
+#define CONSOLE_HPP
+
+#include "esp_err.h"
+
+class StateMachine;
+class BlobStore;
+
+// Serial console REPL with diagnostics commands:
+//   metrics                   per-sensor, ADC, SEN0311 and per-state latency and error counters
+//   metrics json              the same as the telemetry report
+//   trace <module> <level>    trace verbosity, e.g. "trace sensors debug"
+//   cal                       TDS and pH calibration of every zone
+//   cal <zone> <tds|ph> point <value>
+//                             with the probe in a reference solution: averages the input
+//                             for a few seconds and takes it as the point for value
+//   cal <zone> <tds|ph> save  the points taken become the curve, stored in calibration_store
+//   cal <zone> <tds|ph> reset back to the built-in curve
+//   history                   span of the raw history, and this hour's rollup of every sensor
+//   history <zone> <tds|ntc|level|ph> [raw|minute|hour] [count]
+//                             the newest raw samples or rollups of one sensor
+//   actuators                 every output's duty, doses, on-time and hold/limit counters
+//   actuators <channel> dose <ms>
+//                             one dose, e.g. to prime a dosing pump's tubing
+//   dashboard                 web dashboard clients, frames and bytes sent
+//   power                     light sleep residency, wake latency, ADC re-arms and SEN0311 listens
+// state_machine and calibration_store must outlive the console.
+esp_err_t console_start(StateMachine& state_machine, BlobStore* calibration_store = nullptr);
+
+#endif // CONSOLE_HPP
@@ -0,0 +1,95 @@
+#ifndef CONTROL_CONFIG_HPP
+#define CONTROL_CONFIG_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "pid.hpp"
+#include "soc/soc_caps.h"
+
+// Controller arithmetic: float where the CPU has an FPU, Q16.16 fixed point otherwise
+#if SOC_CPU_HAS_FPU
+using ControlScalar = float;
+#else
+using ControlScalar = Q16;
+#endif
+
+enum class ControlMode : uint8_t {
+    ON_OFF_CONTROL,
+    PID_CONTROL,
+    FUZZY_LOGIC_CONTROL
+};
+
+// Everything the control stage can be tuned with at runtime
+struct ControlConfig {
+    float tds_threshold;            // ppm
+    float temp_threshold;           // °C
+    float water_level_threshold;    // cm
+    ControlMode mode;
+    PidGains pump_pid;
+    PidGains heater_pid;
+    PidGains dosing_pid;
+    uint32_t version;               // Set by ControlConfigStore::publish
+};
+
+// Applies the fields present in a JSON object on top of `config`, e.g.
+//   {"tds_threshold": 950, "mode": "pid", "heater_pid": {"kp": 0.5, "ki": 0.02}}
+// mode is "on_off", "pid" or "fuzzy". Unknown keys or malformed input fail the
+// whole update and leave `config` partially written; parse into a copy.
+esp_err_t control_config_parse(const char* json, size_t length, ControlConfig& config);
+
+// Range checks; tank_height_cm bounds the level threshold. PID gains must also survive
+// ControlScalar at the control period control_dt_s within PID_GAIN_TOLERANCE.
+esp_err_t control_config_validate(const ControlConfig& config, float tank_height_cm, float control_dt_s);
+
+// Hands immutable ControlConfig blocks from one writer task to one reader, the
+// control loop, without locks. The reader marks the block it uses, the writer
+// fills a slot that is neither current nor marked, then swaps the current pointer.
+class ControlConfigStore {
+    static constexpr size_t SLOTS = 3;
+    ControlConfig slots_[SLOTS];
+    std::atomic<const ControlConfig*> current_;
+    std::atomic<const ControlConfig*> in_use_;
+    uint32_t next_version_;
+
+    public:
+        explicit ControlConfigStore(const ControlConfig& initial) : slots_{}, next_version_(0) {
+            slots_[0] = initial;
+            slots_[0].version = next_version_++;
+            current_.store(&slots_[0]);
+            in_use_.store(&slots_[0]);
+        }
+
+        // Reader: the returned block stays unchanged until the next acquire()
+        const ControlConfig& acquire() {
+            const ControlConfig* config = current_.load();
+            while (true) {
+                in_use_.store(config);
+                const ControlConfig* again = current_.load();
+                if (again == config) {
+                    return *config;
+                }
+                config = again;
+            }
+        }
+
+        // Writer: copy of the current block, to build the next one from
+        ControlConfig latest() const { return *current_.load(); }
+
+        // Writer: publishes a copy of config, returns its version
+        uint32_t publish(const ControlConfig& config) {
+            const ControlConfig* current = current_.load();
+            const ControlConfig* in_use = in_use_.load();
+            ControlConfig* slot = &slots_[0];
+            while (slot == current || slot == in_use) {
+                ++slot;
+            }
+            *slot = config;
+            slot->version = next_version_++;
+            current_.store(slot);
+            return slot->version;
+        }
+};
+
+#endif // CONTROL_CONFIG_HPP
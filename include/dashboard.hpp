@@ -0,0 +1,181 @@
+#ifndef DASHBOARD_HPP
+#define DASHBOARD_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sensor.hpp"
+#include "seqlock.hpp"
+#include "telemetry.hpp"
+
+static constexpr size_t DASHBOARD_MAX_CHANNELS = TELEMETRY_MAX_CHANNELS;
+static constexpr size_t DASHBOARD_MAX_ZONES = DASHBOARD_MAX_CHANNELS / SensorData::TYPE_COUNT;
+static constexpr size_t DASHBOARD_NAME_LEN = 16;
+static constexpr uint8_t DASHBOARD_FORMAT_VERSION = 1;
+// Encoded frames kept while clients are still sending them; a client this far behind in
+// the middle of a frame is disconnected
+static constexpr size_t DASHBOARD_FRAME_SLOTS = 4;
+static constexpr size_t DASHBOARD_FRAME_BYTES = 512;
+// One request header line; longer lines are cut, none the server reads is that long
+static constexpr size_t DASHBOARD_LINE_BYTES = 160;
+// Longest wait for a new row while a WebSocket is open; without one the server waits
+// for connections only, waking every DASHBOARD_IDLE_MS to see whether to stop
+static constexpr uint32_t DASHBOARD_POLL_MS = 50;
+static constexpr uint32_t DASHBOARD_IDLE_MS = 1000;
+// Requests and page transfers that take longer are dropped
+static constexpr uint32_t DASHBOARD_HTTP_TIMEOUT_MS = 5000;
+
+// Latest row handed over by publish()
+struct DashboardRow {
+    int64_t time_ms;
+    size_t count;
+    SensorData data[DASHBOARD_MAX_CHANNELS];
+};
+
+enum class DashboardClientState : uint8_t {
+    FREE,
+    REQUEST,    // Reading the HTTP request
+    RESPONSE,   // Sending a page, an error or the WebSocket handshake
+    WEBSOCKET   // Receiving frames
+};
+
+// One connection. Frames are sent straight from the server's shared slots, so a client
+// holds only its request line and the handshake response.
+struct DashboardClient {
+    int socket;
+    DashboardClientState state;
+    bool requested;             // Request line read
+    bool upgrade;               // GET /ws
+    bool page;                  // GET /
+    bool keyed;                 // Sec-WebSocket-Key seen
+    int64_t opened_us;
+    char line[DASHBOARD_LINE_BYTES];   // Request line, then the handshake response, then frame headers
+    size_t line_length;
+    char key[32];               // Sec-WebSocket-Key
+    const uint8_t* out;         // Being sent: the response, the page or a shared frame
+    size_t out_length;
+    size_t out_sent;
+    const uint8_t* next;        // Sent after out, e.g. the page after its headers
+    size_t next_length;
+    uint32_t frame;             // Sequence of the last frame sent (or being sent), 0 for none
+    bool sending_frame;
+    uint64_t skip;              // Payload bytes of an incoming frame still to discard
+};
+
+struct DashboardStats {
+    uint32_t clients;           // WebSockets open now
+    uint32_t connections;       // Accepted since start
+    uint32_t rejected;          // Turned away: every slot in use
+    uint32_t pages;
+    uint32_t frames;            // Encoded, each sent to every client
+    uint32_t key_frames_sent;
+    uint32_t delta_frames_sent;
+    uint32_t slow_dropped;      // Disconnected for falling DASHBOARD_FRAME_SLOTS frames behind
+    uint32_t timeouts;
+    uint64_t bytes_sent;
+    uint32_t last_key_bytes;
+    uint32_t last_delta_bytes;
+};
+
+// Live dashboard on the device: a small HTTP server serving one static page at / and
+// pushing sensor rows over a WebSocket at /ws. The row is encoded once per change into a
+// shared frame: a key frame with every value for clients that just connected or skipped a
+// frame, and a delta frame with only the values that changed for everyone else. Every
+// client is sent from those same buffers, so more clients cost sends but no sampling,
+// encoding or copies. Plain BSD sockets on one task: lwIP on the device, the host's
+// sockets on Linux.
+//
+// Payload of each binary WebSocket message, integers as LEB128 varints:
+//   key:   'K' version sequence time_ms zone_count (name_length name)[zone_count]
+//          channel_count type[channel_count] zigzag(value)[channel_count]
+//   delta: 'D' sequence dt_ms changed_mask zigzag(value - previous)[per bit set in changed_mask]
+// Values are fixed point per type (see telemetry_scale). A delta applies to the frame
+// with the sequence before it.
+class Dashboard {
+    struct Frame {
+        uint32_t sequence;      // 0 while empty
+        uint8_t key[DASHBOARD_FRAME_BYTES];
+        size_t key_length;
+        uint8_t delta[DASHBOARD_FRAME_BYTES];
+        size_t delta_length;
+    };
+
+    DashboardClient* clients_;
+    size_t client_capacity_;
+    Seqlock<DashboardRow> row_;
+    Seqlock<DashboardStats> published_stats_;
+    DashboardStats stats_;      // Server task
+    Frame frames_[DASHBOARD_FRAME_SLOTS];
+    uint32_t sequence_;         // Newest frame
+    uint32_t row_version_;      // Version of row_ it was encoded from
+    int64_t sent_time_ms_;
+    size_t sent_count_;
+    int32_t sent_values_[DASHBOARD_MAX_CHANNELS];
+    char names_[DASHBOARD_MAX_ZONES][DASHBOARD_NAME_LEN];
+    size_t zone_count_;
+    int listen_socket_;
+    uint16_t port_;
+    std::atomic<bool> stopping_;
+    std::atomic<bool> running_;
+    char page_header_[128];
+    size_t page_header_length_;
+
+    static void server_task(void* arg);
+    void serve();
+    void accept_clients();
+    void encode(const DashboardRow& row);
+    void receive(DashboardClient& client);
+    void parse_line(DashboardClient& client);
+    void respond(DashboardClient& client);
+    void next_frame(DashboardClient& client);
+    bool send_pending(DashboardClient& client);
+    void close_client(DashboardClient& client);
+
+    public:
+        Dashboard(const Dashboard&) = delete;
+        Dashboard& operator=(const Dashboard&) = delete;
+
+        // Zone names for the page, in row order; call before start(). Names are cut at
+        // DASHBOARD_NAME_LEN - 1 characters.
+        void set_zones(const char* const* names, size_t count);
+        // The newest row; any one task, never blocks. Rows between two server passes
+        // replace each other, so clients get the newest, not every one.
+        void publish(const SensorData* data, size_t count, int64_t time_ms);
+        // Listens on port (0 picks a free one, see port()) and starts the server task
+        esp_err_t start(uint16_t port, UBaseType_t priority, uint32_t stack_size);
+        // Closes every connection and ends the task within DASHBOARD_IDLE_MS; for hosts,
+        // the device runs the server for good
+        void stop();
+        bool running() const { return running_.load(std::memory_order_acquire); }
+        uint16_t port() const { return port_; }
+        size_t capacity() const { return client_capacity_; }
+        // Any task
+        DashboardStats stats() const { return published_stats_.load(); }
+
+    protected:
+        Dashboard(DashboardClient* clients, size_t capacity);
+};
+
+// Backing array of a StaticDashboard. A separate base so it is constructed before Dashboard uses it.
+template <size_t Clients>
+struct DashboardArrays {
+    static_assert(Clients > 0, "a dashboard needs a client slot");
+    DashboardClient clients[Clients];
+};
+
+// Dashboard with Clients WebSocket and page connections at a time. On the device each
+// is one lwIP socket, and CONFIG_LWIP_MAX_SOCKETS also covers MQTT and the listener.
+template <size_t Clients>
+class StaticDashboard : private DashboardArrays<Clients>, public Dashboard {
+    public:
+        StaticDashboard() : DashboardArrays<Clients>(), Dashboard(DashboardArrays<Clients>::clients, Clients) {}
+};
+
+// The page at /: connects to /ws, decodes the frames and shows every zone with a trend
+extern const char DASHBOARD_PAGE[];
+extern const size_t DASHBOARD_PAGE_LENGTH;
+
+#endif // DASHBOARD_HPP
@@ -0,0 +1,37 @@
+#ifndef ESP_ACTUATOR_DRIVER_HPP
+#define ESP_ACTUATOR_DRIVER_HPP
+
+#include "actuator_driver.hpp"
+#include "esp_pm.h"
+#include "esp_timer.h"
+
+// PWM carrier for the DUTY outputs: above hearing for pump motors
+static constexpr uint32_t ACTUATOR_PWM_HZ = 20000;
+
+// ActuatorDriver on the ESP-IDF drivers: LEDC channels on one timer for PWM pins, GPIO
+// for on/off pins, and two esp_timer one-shots (the systimer) for the engine, one for its
+// deadlines and one for new commands. Both run on the esp_timer task, one at a time.
+// Under power management on/off pins hold their level through light sleep, and a PWM
+// output with a duty above 0 keeps the chip out of it, since LEDC stops with its clock.
+class EspActuatorDriver : public ActuatorDriver {
+    ActuatorPin pins_[ACTUATOR_MAX_CHANNELS];
+    int ledc_channel_[ACTUATOR_MAX_CHANNELS];   // -1 for on/off pins
+    size_t channels_;
+    ActuatorTimerListener* listener_;
+    esp_timer_handle_t deadline_timer_;
+    esp_timer_handle_t wake_timer_;
+    esp_pm_lock_handle_t pwm_lock_;
+    uint32_t pwm_running_;      // Bit per channel with a PWM duty above 0
+
+    static void on_timer(void* arg);
+
+    public:
+        EspActuatorDriver();
+        ~EspActuatorDriver();
+        esp_err_t init(const ActuatorPin* pins, size_t count, ActuatorTimerListener& listener) override;
+        esp_err_t set(size_t channel, float duty) override;
+        esp_err_t wake_at(int64_t time_us) override;
+        esp_err_t wake_now() override;
+};
+
+#endif // ESP_ACTUATOR_DRIVER_HPP
@@ -0,0 +1,58 @@
+#ifndef ESP_ADC_DRIVER_HPP
+#define ESP_ADC_DRIVER_HPP
+
+#include "adc_curve.hpp"
+#include "adc_driver.hpp"
+#include "blob_store.hpp"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Largest AdcContinuousConfig::frame_size; the scan task reads frames into a buffer this big
+static constexpr uint32_t ESP_ADC_MAX_FRAME_SIZE = 1024;
+
+// AdcDriver on one ADC unit with the ESP-IDF oneshot, continuous (DMA) and calibration
+// drivers. Only one unit can scan continuously at a time; on a second, Adc falls back to
+// oneshot reads. Conversions to mV interpolate in each channel's AdcCurve, sampled from
+// the IDF calibration scheme once and kept in the cache store if there is one, so later
+// boots neither create the schemes nor sample them.
+class EspAdcDriver : public AdcDriver {
+    adc_unit_t unit_;
+    adc_oneshot_unit_handle_t handle_;
+    adc_continuous_handle_t cont_handle_;
+    AdcContinuousConfig cont_config_;
+    TaskHandle_t cont_task_;
+    AdcScanListener* listener_;
+    size_t channels_;
+    AdcConfig_t configs_[ADC_MAX_CHANNELS];
+    AdcCurve curves_[ADC_MAX_CHANNELS];
+    bool calibrated_[ADC_MAX_CHANNELS];
+    BlobStore* cache_;
+    uint8_t frame_[ESP_ADC_MAX_FRAME_SIZE];     // Scan task only
+
+    public:
+        explicit EspAdcDriver(adc_unit_t unit = ADC_UNIT_1, BlobStore* cache = nullptr);
+        ~EspAdcDriver();
+        esp_err_t init(const AdcConfig_t* configs, size_t count) override;
+        esp_err_t start_oneshot() override;
+        esp_err_t read_raw(size_t channel_idx, int& raw) override;
+        esp_err_t start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) override;
+        void stop_continuous() override;
+        // Stops the DMA, which releases its power management lock; the handle and the scan
+        // task stay, so a wake costs no allocation
+        esp_err_t suspend_continuous() override;
+        esp_err_t resume_continuous() override;
+        esp_err_t raw_to_mv(size_t channel_idx, int raw, int& mv) override;
+
+    private:
+        void cache_key(size_t channel_idx, char* key, size_t size) const;
+        esp_err_t load_curve(size_t channel_idx);
+        esp_err_t sample_curve(size_t channel_idx);
+        void process_frame(const uint8_t* frame, uint32_t length);
+        static void continuous_task(void* arg);
+        static bool on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* user_data);
+};
+
+#endif // ESP_ADC_DRIVER_HPP
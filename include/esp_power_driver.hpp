@@ -0,0 +1,33 @@
+#ifndef ESP_POWER_DRIVER_HPP
+#define ESP_POWER_DRIVER_HPP
+
+#include "power_driver.hpp"
+#include "seqlock.hpp"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// PowerDriver on ESP-IDF power management: frequency scaling and automatic light sleep,
+// which the tickless idle task enters until the nearest FreeRTOS timeout or esp_timer
+// alarm once every task waits. sleep_until() arms an esp_timer one-shot for the deadline,
+// to the microsecond, instead of rounding it to ticks. Needs CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE; sleeps are counted with CONFIG_PM_LIGHT_SLEEP_CALLBACKS.
+class EspPowerDriver : public PowerDriver {
+    esp_timer_handle_t wake_timer_;
+    TaskHandle_t waiting_task_;
+    PowerSleepTotals counted_;      // Idle task, in the sleep exit callback
+    Seqlock<PowerSleepTotals> totals_;
+
+    static void on_wake_timer(void* arg);
+    static esp_err_t on_sleep_exit(int64_t slept_us, void* arg);
+
+    public:
+        EspPowerDriver();
+        ~EspPowerDriver();
+        esp_err_t start(const PowerConfig& config) override;
+        // One task at a time
+        void sleep_until(int64_t wake_us) override;
+        PowerSleepTotals totals() const override { return totals_.load(); }
+};
+
+#endif // ESP_POWER_DRIVER_HPP
@@ -0,0 +1,44 @@
+#ifndef ESP_UART_DRIVER_HPP
+#define ESP_UART_DRIVER_HPP
+
+#include <atomic>
+#include "uart_driver.hpp"
+#include "driver/uart.h"
+#include "esp_pm.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+constexpr size_t RX_BUFFER_SIZE = 128;
+constexpr int READ_TIMEOUT_MS = 100;
+constexpr int EVENT_QUEUE_SIZE = 16;
+// RX edges that wake the chip from light sleep; the characters that carry them are lost
+constexpr int UART_WAKEUP_EDGES = 3;
+
+// UartDriver on the ESP-IDF UART driver: a receive task waits on the driver's event queue.
+// Listening arms UART wake-up; the wake, or any data, takes a no-light-sleep lock that is
+// held until listening ends (a frame or Uart's listen timeout). Once listening was used the receive task stops its periodic
+// idle timeout outside listening, which would wake the chip every READ_TIMEOUT_MS.
+class EspUartDriver : public UartDriver {
+    UartConfig config_;
+    uint8_t* rx_buffer_;
+    QueueHandle_t event_queue_;
+    TaskHandle_t rx_task_;
+    UartListener* listener_;
+    esp_pm_lock_handle_t rx_lock_;  // Created by start() with CONFIG_PM_ENABLE
+    std::atomic<bool> listening_;
+    std::atomic<bool> managed_;     // set_listening() was called
+    bool locked_;                   // Receive task only
+    void hold_awake();
+    static void rx_task(void* arg);
+
+    public:
+        EspUartDriver();
+        ~EspUartDriver();
+        esp_err_t start(const UartConfig& config, UartListener& listener) override;
+        void stop() override;
+        // true from any task; false from the receive task, where Uart ends it
+        esp_err_t set_listening(bool listening) override;
+};
+
+#endif // ESP_UART_DRIVER_HPP
@@ -0,0 +1,41 @@
+#ifndef ESTIMATOR_HPP
+#define ESTIMATOR_HPP
+
+#include <cstdint>
+
+struct EstimatorConfig {
+    float process_noise = 0.0f;     // Variance the true value gains per second (units²/s); 0 disables
+    float measurement_noise = 1.0f; // Variance of one reading (units²)
+    float gate_sigma = 0.0f;        // Reject readings this many σ from the prediction; 0 accepts all
+    uint32_t max_rejects = 5;       // Consecutive rejections before restarting from the new level
+    float ready_variance = 0.0f;    // Settled once the variance is at or below this; 0: on the first reading
+};
+
+// Scalar Kalman filter with a random-walk model: the estimate follows the readings with
+// a gain set by how fast the value can move against how noisy one reading is. Unlike a
+// moving average it has no history to fill: the first reading is taken as is, with the
+// measurement variance, and the gain starts high and settles as confidence builds.
+class ScalarKalman {
+    EstimatorConfig config_;
+    float estimate_;
+    float variance_;
+    int64_t last_time_us_;
+    bool valid_;
+    uint32_t consecutive_rejects_;
+    uint32_t rejected_;
+
+    public:
+        explicit ScalarKalman(const EstimatorConfig& config = EstimatorConfig());
+        void configure(const EstimatorConfig& config);
+        void reset();
+        bool enabled() const { return config_.process_noise > 0.0f; }
+        // Folds in one reading taken at time_us; false if the gate rejected it
+        bool update(float measurement, int64_t time_us);
+
+        float estimate() const { return estimate_; }
+        float variance() const { return variance_; }
+        bool valid() const { return valid_; }
+        uint32_t rejected() const { return rejected_; }
+};
+
+#endif // ESTIMATOR_HPP
@@ -0,0 +1,67 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <cstddef>
+
+enum class FilterType {
+    NONE,           // Pass samples through unchanged
+    MOVING_AVERAGE, // Running-sum ring buffer, O(1) per sample
+    EMA             // Exponential moving average
+};
+
+enum class SpikeFilter {
+    NONE,
+    MEDIAN,         // Median of the last spike_window samples
+    TRIMMED_MEAN    // Mean of the last spike_window samples without min and max
+};
+
+static constexpr size_t MOVING_AVG_WINDOW = 50;
+static constexpr size_t MAX_SPIKE_WINDOW = 9;
+static constexpr size_t MAX_PRIME_SAMPLES = 32;
+// Moving-average samples between re-sums of the ring; float rounding in the running sum
+// stays far below one ADC step over this many (see filter.cpp)
+static constexpr size_t MOVING_AVG_RESYNC_SAMPLES = 65536;
+
+struct FilterConfig {
+    FilterType type = FilterType::MOVING_AVERAGE;
+    size_t window = MOVING_AVG_WINDOW; // Moving average length in samples
+    float ema_alpha = 0.1f;            // EMA smoothing factor (0, 1]
+    SpikeFilter spike = SpikeFilter::NONE;
+    size_t spike_window = 5;           // Spike rejection length, clamped to MAX_SPIKE_WINDOW
+};
+
+// Per-channel filter stage: optional spike rejection followed by a smoothing filter.
+// Every update is constant time with respect to the smoothing window. The moving
+// average ring lives in memory owned by the caller, so the filter never allocates.
+class ChannelFilter {
+    FilterConfig config_;
+    float* ring_;
+    size_t ring_index_;
+    size_t ring_count_;
+    float running_sum_;
+    size_t resync_countdown_;   // Samples until the running sum is re-summed from the ring
+    float ema_;
+    bool ema_valid_;
+    float spike_buf_[MAX_SPIKE_WINDOW];
+    size_t spike_index_;
+    size_t spike_count_;
+
+    public:
+        ChannelFilter();    // Pass-through until configured
+        // history holds at least config.window samples; a longer window is clamped to capacity
+        void configure(const FilterConfig& config, float* history, size_t capacity);
+        float update(float sample);
+        // Seeds the whole state from a burst of real readings, as if the input had been
+        // steady at their median for a full window; returns that median
+        float prime(const float* samples, size_t count);
+        // No sample seen since configure() or reset()
+        bool empty() const { return ring_count_ == 0 && !ema_valid_ && spike_count_ == 0; }
+        void reset();
+        const FilterConfig& config() const { return config_; }
+
+    private:
+        float reject_spike(float sample);
+        float moving_average(float sample);
+};
+
+#endif // FILTER_HPP
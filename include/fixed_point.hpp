@@ -0,0 +1,107 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint>
+
+// Signed Q16.16 fixed-point number with saturating arithmetic, for control
+// math on targets without an FPU. Range is about +/-32768 with 1/65536 resolution.
+class Q16 {
+    int32_t raw_;
+
+    static constexpr int32_t saturate(int64_t value) {
+        return value > INT32_MAX ? INT32_MAX : (value < INT32_MIN ? INT32_MIN : static_cast<int32_t>(value));
+    }
+
+    public:
+        static constexpr int FRAC_BITS = 16;
+        static constexpr int32_t ONE = 1 << FRAC_BITS;
+
+        constexpr Q16() : raw_(0) {}
+        constexpr explicit Q16(float value)
+            : raw_(saturate(static_cast<int64_t>(value * ONE + (value >= 0 ? 0.5f : -0.5f)))) {}
+        constexpr explicit Q16(int value) : raw_(saturate(static_cast<int64_t>(value) * ONE)) {}
+
+        static constexpr Q16 from_raw(int32_t raw) {
+            Q16 q;
+            q.raw_ = raw;
+            return q;
+        }
+        constexpr int32_t raw() const { return raw_; }
+        constexpr float to_float() const { return static_cast<float>(raw_) / ONE; }
+        constexpr explicit operator float() const { return to_float(); }
+
+        constexpr Q16 operator-() const { return from_raw(saturate(-static_cast<int64_t>(raw_))); }
+        constexpr Q16 operator+(Q16 other) const { return from_raw(saturate(static_cast<int64_t>(raw_) + other.raw_)); }
+        constexpr Q16 operator-(Q16 other) const { return from_raw(saturate(static_cast<int64_t>(raw_) - other.raw_)); }
+        constexpr Q16 operator*(Q16 other) const {
+            return from_raw(saturate((static_cast<int64_t>(raw_) * other.raw_) >> FRAC_BITS));
+        }
+        constexpr Q16 operator/(Q16 other) const {
+            if (other.raw_ == 0) {
+                return from_raw(raw_ >= 0 ? INT32_MAX : INT32_MIN);
+            }
+            return from_raw(saturate((static_cast<int64_t>(raw_) * ONE) / other.raw_));
+        }
+        constexpr Q16& operator+=(Q16 other) { return *this = *this + other; }
+        constexpr Q16& operator-=(Q16 other) { return *this = *this - other; }
+        constexpr Q16& operator*=(Q16 other) { return *this = *this * other; }
+
+        constexpr bool operator<(Q16 other) const { return raw_ < other.raw_; }
+        constexpr bool operator>(Q16 other) const { return raw_ > other.raw_; }
+        constexpr bool operator<=(Q16 other) const { return raw_ <= other.raw_; }
+        constexpr bool operator>=(Q16 other) const { return raw_ >= other.raw_; }
+        constexpr bool operator==(Q16 other) const { return raw_ == other.raw_; }
+        constexpr bool operator!=(Q16 other) const { return raw_ != other.raw_; }
+};
+
+// Signed Q8.24 fixed point for gains and accumulators that need more resolution than
+// Q16 over a smaller range: about +/-128 with 1/16777216 resolution. Times a Q16 it
+// gives a Q16, a gain applied to a value, or with mul_fine() a Q24 product.
+class Q24 {
+    int32_t raw_;
+
+    static constexpr int32_t saturate(int64_t value) {
+        return value > INT32_MAX ? INT32_MAX : (value < INT32_MIN ? INT32_MIN : static_cast<int32_t>(value));
+    }
+
+    public:
+        static constexpr int FRAC_BITS = 24;
+        static constexpr int32_t ONE = 1 << FRAC_BITS;
+
+        constexpr Q24() : raw_(0) {}
+        constexpr explicit Q24(float value)
+            : raw_(saturate(static_cast<int64_t>(static_cast<double>(value) * ONE + (value >= 0 ? 0.5 : -0.5)))) {}
+        constexpr explicit Q24(Q16 value)
+            : raw_(saturate(static_cast<int64_t>(value.raw()) << (FRAC_BITS - Q16::FRAC_BITS))) {}
+
+        static constexpr Q24 from_raw(int32_t raw) {
+            Q24 q;
+            q.raw_ = raw;
+            return q;
+        }
+        constexpr int32_t raw() const { return raw_; }
+        constexpr float to_float() const { return static_cast<float>(raw_) / ONE; }
+        constexpr explicit operator float() const { return to_float(); }
+        // Rounded to the nearest Q16
+        constexpr Q16 to_q16() const {
+            return Q16::from_raw(static_cast<int32_t>(
+                (static_cast<int64_t>(raw_) + (1 << (FRAC_BITS - Q16::FRAC_BITS - 1))) >> (FRAC_BITS - Q16::FRAC_BITS)));
+        }
+
+        constexpr Q24 operator+(Q24 other) const { return from_raw(saturate(static_cast<int64_t>(raw_) + other.raw_)); }
+        constexpr Q24 operator-(Q24 other) const { return from_raw(saturate(static_cast<int64_t>(raw_) - other.raw_)); }
+        constexpr Q16 operator*(Q16 value) const {
+            return Q16::from_raw(saturate((static_cast<int64_t>(raw_) * value.raw() + (1 << (FRAC_BITS - 1))) >> FRAC_BITS));
+        }
+        constexpr Q24 mul_fine(Q16 value) const {
+            return from_raw(saturate((static_cast<int64_t>(raw_) * value.raw() + (1 << (Q16::FRAC_BITS - 1))) >>
+                                     Q16::FRAC_BITS));
+        }
+
+        constexpr bool operator<(Q24 other) const { return raw_ < other.raw_; }
+        constexpr bool operator>(Q24 other) const { return raw_ > other.raw_; }
+        constexpr bool operator==(Q24 other) const { return raw_ == other.raw_; }
+        constexpr bool operator!=(Q24 other) const { return raw_ != other.raw_; }
+};
+
+#endif // FIXED_POINT_HPP
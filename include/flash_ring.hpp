@@ -0,0 +1,48 @@
+#ifndef FLASH_RING_HPP
+#define FLASH_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+// Raw flash area with NOR semantics: erase sets a sector to 0xFF, writes only clear bits
+class FlashRegion {
+    public:
+        virtual ~FlashRegion() = default;
+        virtual esp_err_t read(size_t offset, void* dst, size_t length) = 0;
+        virtual esp_err_t write(size_t offset, const void* src, size_t length) = 0;
+        virtual esp_err_t erase_sector(size_t offset) = 0;
+        virtual size_t size() const = 0;
+        virtual size_t sector_size() const = 0;
+};
+
+// Persistent FIFO of variable-length records in a FlashRegion, oldest dropped when full.
+// Records never straddle sectors. A popped record has its magic cleared in place, so
+// what was already sent is not sent again after a reboot.
+class FlashRing {
+    FlashRegion& region_;
+    size_t head_;       // Next write offset
+    size_t tail_;       // Oldest pending record, == head_ when empty
+    uint32_t next_seq_;
+    size_t pending_;
+    uint32_t dropped_;
+
+    public:
+        FlashRing(FlashRegion& region);
+        // Scans the region to rebuild head/tail after boot
+        esp_err_t mount();
+        esp_err_t push(const uint8_t* data, size_t length);
+        // Copies the oldest pending record without removing it
+        esp_err_t peek(uint8_t* dst, size_t capacity, size_t& length);
+        esp_err_t pop();
+        size_t pending() const { return pending_; }
+        uint32_t dropped() const { return dropped_; }
+        size_t max_record_size() const;
+
+    private:
+        esp_err_t erase_for_write(size_t sector_offset);
+        esp_err_t advance_tail();
+        size_t sector_of(size_t offset) const { return offset - offset % region_.sector_size(); }
+};
+
+#endif // FLASH_RING_HPP
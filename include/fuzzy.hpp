@@ -0,0 +1,82 @@
+#ifndef FUZZY_HPP
+#define FUZZY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class FuzzyInput : uint8_t { TDS, TEMPERATURE, PH, WATER_LEVEL };
+enum class FuzzyOutput : uint8_t { PUMP, HEATER, DOSING };
+
+static constexpr size_t FUZZY_INPUTS = 4;
+static constexpr size_t FUZZY_OUTPUTS = 3;
+static constexpr size_t FUZZY_MAX_TERMS = 5;
+static constexpr size_t FUZZY_MAX_RULES = 32;
+static constexpr int8_t FUZZY_ANY = -1;    // Rule does not look at this input
+
+// Trapezoidal membership: 0 below a, rising to 1 at b, 1 until c, falling to 0 at d.
+// a == b or c == d give open shoulders, b == c a triangle.
+struct Trapezoid {
+    float a, b, c, d;
+
+    constexpr float operator()(float x) const {
+        if (x < a || x > d) return 0.0f;
+        if (x < b) return (x - a) / (b - a);
+        if (x <= c) return 1.0f;
+        return (x - d) / (c - d);
+    }
+};
+
+struct FuzzyVariable {
+    Trapezoid terms[FUZZY_MAX_TERMS];
+    uint8_t term_count;
+};
+
+// Zero-order Sugeno rule: IF all listed input terms THEN output = value, weighted by min()
+struct FuzzyRule {
+    int8_t terms[FUZZY_INPUTS];   // Term index per input, or FUZZY_ANY
+    FuzzyOutput output;
+    float value;
+};
+
+struct FuzzyRuleSet {
+    const char* name;
+    FuzzyVariable inputs[FUZZY_INPUTS];
+    FuzzyRule rules[FUZZY_MAX_RULES];
+    uint8_t rule_count;
+};
+
+// Compile-time consistency check for rule tables, use in a static_assert
+constexpr bool fuzzy_rules_valid(const FuzzyRuleSet& set) {
+    if (set.rule_count == 0 || set.rule_count > FUZZY_MAX_RULES) return false;
+    for (size_t i = 0; i < FUZZY_INPUTS; ++i) {
+        if (set.inputs[i].term_count == 0 || set.inputs[i].term_count > FUZZY_MAX_TERMS) return false;
+        for (size_t t = 0; t < set.inputs[i].term_count; ++t) {
+            const Trapezoid& m = set.inputs[i].terms[t];
+            if (!(m.a <= m.b && m.b <= m.c && m.c <= m.d)) return false;
+        }
+    }
+    for (size_t r = 0; r < set.rule_count; ++r) {
+        for (size_t i = 0; i < FUZZY_INPUTS; ++i) {
+            int8_t term = set.rules[r].terms[i];
+            if (term != FUZZY_ANY && (term < 0 || term >= set.inputs[i].term_count)) return false;
+        }
+        if (static_cast<size_t>(set.rules[r].output) >= FUZZY_OUTPUTS) return false;
+    }
+    return true;
+}
+
+// Table-driven fuzzy inference. Evaluation allocates nothing and is bounded by
+// FUZZY_INPUTS * FUZZY_MAX_TERMS membership evaluations plus FUZZY_MAX_RULES rules.
+class FuzzyController {
+    std::atomic<const FuzzyRuleSet*> rules_;
+
+    public:
+        explicit FuzzyController(const FuzzyRuleSet& rules) : rules_(&rules) {}
+        // Lock-free swap, safe from any task; rule sets must have static storage
+        void set_rules(const FuzzyRuleSet& rules) { rules_.store(&rules, std::memory_order_release); }
+        const FuzzyRuleSet& rules() const { return *rules_.load(std::memory_order_acquire); }
+        void evaluate(const float (&inputs)[FUZZY_INPUTS], float (&outputs)[FUZZY_OUTPUTS]) const;
+};
+
+#endif // FUZZY_HPP
@@ -0,0 +1,75 @@
+#ifndef FUZZY_RULES_HPP
+#define FUZZY_RULES_HPP
+
+#include "fuzzy.hpp"
+
+// Term indices shared by the built-in rule sets (cold/ok/hot, acid/ok/alkaline, ...)
+enum FuzzyTerm : int8_t { TERM_LOW = 0, TERM_OK = 1, TERM_HIGH = 2 };
+
+constexpr FuzzyRule fuzzy_rule(int8_t tds, int8_t temp, int8_t ph, int8_t level, FuzzyOutput output, float value) {
+    return { { tds, temp, ph, level }, output, value };
+}
+
+// Vegetative growth: ~1000 ppm, 22-26 °C, pH 5.8-6.5, level 45-70 cm
+inline constexpr FuzzyRuleSet FUZZY_RULES_GROWTH = {
+    "growth",
+    {
+        { { { 0, 0, 600, 900 }, { 700, 900, 1100, 1300 }, { 1100, 1400, 5000, 5000 } }, 3 },   // TDS (ppm)
+        { { { -10, -10, 18, 22 }, { 19, 22, 26, 28 }, { 26, 29, 50, 50 } }, 3 },               // Temperature (°C)
+        { { { 0, 0, 5.0f, 5.6f }, { 5.2f, 5.8f, 6.5f, 7.0f }, { 6.6f, 7.2f, 14, 14 } }, 3 },   // pH
+        { { { 0, 0, 30, 45 }, { 35, 45, 70, 80 }, { 70, 85, 500, 500 } }, 3 },                 // Water level (cm)
+    },
+    {
+        // Fill pump: top up when low, dilute when concentrated
+        fuzzy_rule(FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, TERM_LOW, FuzzyOutput::PUMP, 1.0f),
+        fuzzy_rule(TERM_HIGH, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.6f),
+        fuzzy_rule(TERM_OK, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.0f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.0f),
+        fuzzy_rule(FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, TERM_HIGH, FuzzyOutput::PUMP, 0.0f),
+        // Heater
+        fuzzy_rule(FUZZY_ANY, TERM_LOW, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 1.0f),
+        fuzzy_rule(FUZZY_ANY, TERM_OK, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 0.2f),
+        fuzzy_rule(FUZZY_ANY, TERM_HIGH, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 0.0f),
+        // Nutrient dosing, held back while the water is low (dosing would overshoot) or acidic
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_OK, TERM_OK, FuzzyOutput::DOSING, 1.0f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_HIGH, TERM_OK, FuzzyOutput::DOSING, 0.8f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_LOW, FUZZY_ANY, FuzzyOutput::DOSING, 0.2f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, FUZZY_ANY, TERM_LOW, FuzzyOutput::DOSING, 0.0f),
+        fuzzy_rule(TERM_OK, FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::DOSING, 0.1f),
+        fuzzy_rule(TERM_HIGH, FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::DOSING, 0.0f),
+    },
+    14
+};
+
+// Seedlings: weaker solution (~600 ppm) and a cooler, narrower temperature band
+inline constexpr FuzzyRuleSet FUZZY_RULES_SEEDLING = {
+    "seedling",
+    {
+        { { { 0, 0, 350, 500 }, { 400, 550, 650, 800 }, { 700, 900, 5000, 5000 } }, 3 },      // TDS (ppm)
+        { { { -10, -10, 17, 20 }, { 18, 20, 23, 25 }, { 23, 26, 50, 50 } }, 3 },              // Temperature (°C)
+        { { { 0, 0, 5.2f, 5.7f }, { 5.4f, 5.8f, 6.3f, 6.8f }, { 6.5f, 7.0f, 14, 14 } }, 3 },   // pH
+        { { { 0, 0, 30, 45 }, { 35, 45, 70, 80 }, { 70, 85, 500, 500 } }, 3 },                 // Water level (cm)
+    },
+    {
+        fuzzy_rule(FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, TERM_LOW, FuzzyOutput::PUMP, 1.0f),
+        fuzzy_rule(TERM_HIGH, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.8f),
+        fuzzy_rule(TERM_OK, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.0f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, FUZZY_ANY, TERM_OK, FuzzyOutput::PUMP, 0.0f),
+        fuzzy_rule(FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, TERM_HIGH, FuzzyOutput::PUMP, 0.0f),
+        fuzzy_rule(FUZZY_ANY, TERM_LOW, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 0.8f),
+        fuzzy_rule(FUZZY_ANY, TERM_OK, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 0.1f),
+        fuzzy_rule(FUZZY_ANY, TERM_HIGH, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::HEATER, 0.0f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_OK, TERM_OK, FuzzyOutput::DOSING, 0.5f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_HIGH, TERM_OK, FuzzyOutput::DOSING, 0.4f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, TERM_LOW, FUZZY_ANY, FuzzyOutput::DOSING, 0.1f),
+        fuzzy_rule(TERM_LOW, FUZZY_ANY, FUZZY_ANY, TERM_LOW, FuzzyOutput::DOSING, 0.0f),
+        fuzzy_rule(TERM_OK, FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::DOSING, 0.05f),
+        fuzzy_rule(TERM_HIGH, FUZZY_ANY, FUZZY_ANY, FUZZY_ANY, FuzzyOutput::DOSING, 0.0f),
+    },
+    14
+};
+
+static_assert(fuzzy_rules_valid(FUZZY_RULES_GROWTH), "growth rule table is inconsistent");
+static_assert(fuzzy_rules_valid(FUZZY_RULES_SEEDLING), "seedling rule table is inconsistent");
+
+#endif // FUZZY_RULES_HPP
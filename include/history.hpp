@@ -0,0 +1,162 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "sensor.hpp"
+#include "seqlock.hpp"
+#include "flash_ring.hpp"
+
+static constexpr size_t HISTORY_CHUNK_BYTES = 256;
+static constexpr size_t HISTORY_MAX_CHANNELS = 32;     // Four sensors in each of up to eight zones
+static constexpr uint8_t HISTORY_FORMAT_VERSION = 1;
+// Archived chunk: 'H' 'S' version channel_count, then type[channel_count] and the chunk data
+static constexpr size_t HISTORY_ARCHIVE_HEADER_BYTES = 4;
+static constexpr int64_t HISTORY_MINUTE_MS = 60 * 1000;
+static constexpr int64_t HISTORY_HOUR_MS = 60 * HISTORY_MINUTE_MS;
+// Defaults of a ZoneHistory: at one row per second a chunk holds about 40 s of one zone
+static constexpr size_t HISTORY_CHUNKS_PER_ZONE = 32;
+static constexpr size_t HISTORY_MINUTES = 120;
+static constexpr size_t HISTORY_HOURS = 48;
+
+// Raw rows, LEB128 varints and values fixed point per type as in telemetry batches
+// (telemetry_scale). A chunk starts with a keyframe, so it decodes on its own:
+//   keyframe:   time_ms, then per channel zigzag(value)
+//   later rows: dt_ms, then per channel zigzag(value - previous value)
+struct HistoryChunk {
+    uint32_t sequence;      // 1 for the first chunk written; 0 in a slot never used
+    uint16_t length;
+    uint16_t rows;
+    int64_t first_ms;
+    int64_t last_ms;
+    uint8_t data[HISTORY_CHUNK_BYTES];
+};
+
+struct HistorySample {
+    int64_t time_ms;
+    float value;
+};
+
+// One channel over one minute or hour
+struct HistoryRollup {
+    int64_t start_ms;   // Aligned to the bucket length on the esp_timer clock
+    uint32_t count;     // Raw samples it covers
+    float min;
+    float max;
+    float mean;
+};
+
+enum class HistoryResolution {
+    MINUTE,
+    HOUR
+};
+
+// Rollup being filled; written by the recording task only
+struct HistoryAccumulator {
+    int64_t start_ms;
+    uint32_t count;
+    float min;
+    float max;
+    float sum;
+};
+
+// Where a History keeps its rings; rollup arrays are channel-major
+struct HistoryStorage {
+    size_t channels;
+    SensorData::Type* types;
+    Seqlock<HistoryChunk>* chunks;
+    size_t chunk_count;
+    Seqlock<HistoryRollup>* minutes;
+    size_t minute_count;
+    Seqlock<HistoryRollup>* hours;
+    size_t hour_count;
+    HistoryAccumulator* open_minutes;
+    HistoryAccumulator* open_hours;
+};
+
+// Time series of every channel of a sensor row: the newest raw rows in a ring of
+// delta-coded chunks, plus min/max/mean per minute and per hour. Minutes are rolled up
+// from the rows and hours from the minutes; the minute in progress is queryable as it
+// fills, the hour in progress covers its completed minutes. Oldest data is overwritten.
+// One task records; any task may query at the same time without locks.
+class History {
+    HistoryStorage storage_;
+    HistoryChunk open_;     // Copy of the newest chunk, appended to and then published
+    int32_t last_values_[HISTORY_MAX_CHANNELS];
+    std::atomic<uint32_t> newest_chunk_;    // Sequence of the newest chunk, 0 before the first row
+    std::atomic<uint32_t> newest_minute_;   // Minutes since boot of the newest row, plus one
+    FlashRing* archive_;
+    uint32_t archived_;
+    uint32_t archive_errors_;
+
+    public:
+        // Writer: one task. count must be at least channels(); the first row fixes the types.
+        esp_err_t record(const SensorData* data, size_t count, int64_t time_ms);
+        // Completed chunks are also pushed to ring, e.g. to keep more raw history in flash
+        // than in RAM; host/support/history_decode.hpp reads them back
+        void set_archive(FlashRing* ring) { archive_ = ring; }
+        uint32_t archived() const { return archived_; }
+        uint32_t archive_errors() const { return archive_errors_; }
+
+        // Any task. Raw samples of one channel with from_ms <= time <= to_ms, oldest first,
+        // at most max of them; returns the number written to out
+        size_t query(size_t channel, int64_t from_ms, int64_t to_ms, HistorySample* out, size_t max) const;
+        // Minute or hour rollups whose bucket starts within [from_ms, to_ms], oldest first
+        size_t query(size_t channel, HistoryResolution resolution, int64_t from_ms, int64_t to_ms,
+                     HistoryRollup* out, size_t max) const;
+        size_t channels() const { return storage_.channels; }
+        // Valid once a row has been recorded
+        SensorData::Type type(size_t channel) const { return storage_.types[channel]; }
+        // Time span of the raw rows still in RAM, false before the first row
+        bool raw_span(int64_t& first_ms, int64_t& last_ms) const;
+        // Bytes taken by the encoded rows still in RAM, and how many rows that is
+        void raw_usage(size_t& bytes, size_t& rows) const;
+
+    protected:
+        explicit History(const HistoryStorage& storage);
+
+    private:
+        void seal();
+        void roll_up(size_t channel, float value, int64_t time_ms);
+        void publish(Seqlock<HistoryRollup>* slots, size_t count, size_t channel, const HistoryAccumulator& bucket,
+                     int64_t length_ms);
+        size_t query_buckets(const Seqlock<HistoryRollup>* slots, size_t count, int64_t length_ms, int64_t newest,
+                             int64_t from_ms, int64_t to_ms, HistoryRollup* out, size_t max) const;
+};
+
+// Backing arrays of a StaticHistory. A separate base so they are constructed before History uses them.
+template <size_t Channels, size_t Chunks, size_t Minutes, size_t Hours>
+struct HistoryArrays {
+    static_assert(Channels > 0 && Channels <= HISTORY_MAX_CHANNELS, "unsupported channel count");
+    static_assert(Chunks >= 2 && Minutes >= 2 && Hours >= 2, "rings need at least two slots");
+
+    SensorData::Type types[Channels];
+    Seqlock<HistoryChunk> chunks[Chunks];
+    Seqlock<HistoryRollup> minutes[Channels * Minutes];
+    Seqlock<HistoryRollup> hours[Channels * Hours];
+    HistoryAccumulator open_minutes[Channels];
+    HistoryAccumulator open_hours[Channels];
+
+    HistoryStorage storage() {
+        return { Channels, types, chunks, Chunks, minutes, Minutes, hours, Hours, open_minutes, open_hours };
+    }
+};
+
+// History of Channels channels keeping Chunks raw chunks, Minutes minute and Hours hour
+// rollups per channel. All state is inside the object, so its size is known at compile time.
+template <size_t Channels, size_t Chunks, size_t Minutes, size_t Hours>
+class StaticHistory : private HistoryArrays<Channels, Chunks, Minutes, Hours>, public History {
+    public:
+        StaticHistory()
+            : HistoryArrays<Channels, Chunks, Minutes, Hours>(),
+              History(HistoryArrays<Channels, Chunks, Minutes, Hours>::storage()) {}
+};
+
+// History of the telemetry row of Zones zones, i.e. every zone's sensors zone by zone
+template <size_t Zones>
+using ZoneHistory = StaticHistory<Zones * SensorData::TYPE_COUNT, Zones * HISTORY_CHUNKS_PER_ZONE, HISTORY_MINUTES,
+                                  HISTORY_HOURS>;
+
+#endif // HISTORY_HPP
@@ -0,0 +1,72 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log2-bucketed histogram of microsecond durations. Bucket b holds values in
+// [2^(b-1), 2^b), bucket 0 holds 0. One writer; readers on other tasks see
+// relaxed but never torn counters.
+class LatencyHistogram {
+    public:
+        static constexpr size_t BUCKETS = 33;
+
+    private:
+        std::atomic<uint32_t> buckets_[BUCKETS];
+        std::atomic<uint32_t> count_;
+        std::atomic<uint32_t> min_;
+        std::atomic<uint32_t> max_;
+
+    public:
+        LatencyHistogram() { reset(); }
+
+        void reset() {
+            for (auto& bucket : buckets_) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            count_.store(0, std::memory_order_relaxed);
+            min_.store(UINT32_MAX, std::memory_order_relaxed);
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        void record(uint32_t value_us) {
+            size_t bucket = value_us == 0 ? 0 : 32 - __builtin_clz(value_us);
+            buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            if (value_us < min_.load(std::memory_order_relaxed)) {
+                min_.store(value_us, std::memory_order_relaxed);
+            }
+            if (value_us > max_.load(std::memory_order_relaxed)) {
+                max_.store(value_us, std::memory_order_relaxed);
+            }
+        }
+
+        uint32_t count() const { return count_.load(std::memory_order_relaxed); }
+        uint32_t min() const { return count() ? min_.load(std::memory_order_relaxed) : 0; }
+        uint32_t max() const { return max_.load(std::memory_order_relaxed); }
+        uint32_t bucket(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+        // Upper bound of the bucket holding the given percentile (0-100), capped at max()
+        uint32_t percentile(uint32_t pct) const {
+            uint32_t total = count();
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = (static_cast<uint64_t>(total) * pct + 99) / 100;
+            if (rank == 0) {
+                rank = 1;
+            }
+            uint64_t seen = 0;
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                seen += bucket(b);
+                if (seen >= rank) {
+                    uint32_t upper = b == 0 ? 0 : (b >= 32 ? UINT32_MAX : (1u << b) - 1);
+                    return upper < max() ? upper : max();
+                }
+            }
+            return max();
+        }
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,51 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "latency_histogram.hpp"
+
+// What went wrong with a read, by the esp_err_t the drivers and sensors return
+enum class ErrorKind : uint8_t {
+    NO_DATA,        // ESP_ERR_NOT_FINISHED: nothing received or not settled yet
+    TIMEOUT,        // ESP_ERR_TIMEOUT: stale or missing data
+    OVER_RANGE,     // ESP_ERR_INVALID_STATE: ADC near full scale, NTC open or shorted
+    OUT_OF_RANGE,   // ESP_ERR_INVALID_RESPONSE: implausible converted value
+    DRIVER,         // Anything else: read or calibration failures
+};
+static constexpr size_t ERROR_KIND_COUNT = 5;
+
+ErrorKind error_kind(esp_err_t status);
+const char* error_kind_name(ErrorKind kind);
+
+enum class MetricsFormat {
+    TEXT,   // Aligned lines for the console
+    JSON,   // One object, for telemetry
+};
+static constexpr size_t METRICS_REPORT_BYTES = 6144;    // MAX_ZONES zones take about 5.2 KB of JSON
+
+// Latency histogram and outcome counters of one operation, e.g. one sensor's read().
+// One writer; any task may read, counters are relaxed but never torn.
+class OpMetrics {
+    LatencyHistogram latency_us_;
+    std::atomic<uint32_t> errors_[ERROR_KIND_COUNT];
+
+    public:
+        OpMetrics() { reset(); }
+        void reset();
+        void record(esp_err_t status, uint32_t elapsed_us) {
+            latency_us_.record(elapsed_us);
+            if (status != ESP_OK) {
+                errors_[static_cast<size_t>(error_kind(status))].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        const LatencyHistogram& latency_us() const { return latency_us_; }
+        uint32_t calls() const { return latency_us_.count(); }
+        uint32_t errors(ErrorKind kind) const { return errors_[static_cast<size_t>(kind)].load(std::memory_order_relaxed); }
+        uint32_t error_total() const;
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,75 @@
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded multi-producer, single-consumer queue with a sequence number per slot: a
+// producer claims a slot by moving head_ on, fills it in place, then publishes it by
+// advancing the slot's sequence. Producers never block; when the ring is full the item
+// is dropped and counted. Used by the trace log and the driver capture.
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T item;
+    };
+
+    Slot slots_[Capacity];
+    std::atomic<uint32_t> head_;
+    uint32_t tail_;                     // Consumer only
+    std::atomic<uint32_t> dropped_;
+
+    public:
+        MpscRing() : head_(0), tail_(0), dropped_(0) {
+            for (size_t i = 0; i < Capacity; ++i) {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // fill(T&) writes the claimed slot; false if the ring was full
+        template <typename Fill>
+        bool push(Fill&& fill) {
+            uint32_t position = head_.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &slots_[position & (Capacity - 1)];
+                int32_t diff = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - position);
+                if (diff == 0) {
+                    if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    // The consumer has not freed this slot yet: the ring is full
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    position = head_.load(std::memory_order_relaxed);
+                }
+            }
+            fill(slot->item);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: the oldest published item, false if there is none
+        bool pop(T& item) {
+            Slot& slot = slots_[tail_ & (Capacity - 1)];
+            if (static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - (tail_ + 1)) < 0) {
+                return false;   // Not published yet
+            }
+            item = slot.item;
+            slot.sequence.store(tail_ + Capacity, std::memory_order_release);
+            tail_++;
+            return true;
+        }
+
+        // Items lost to a full ring since the last take_dropped()
+        uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+        uint32_t take_dropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+};
+
+#endif // MPSC_RING_HPP
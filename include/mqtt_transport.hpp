@@ -0,0 +1,36 @@
+#ifndef MQTT_TRANSPORT_HPP
+#define MQTT_TRANSPORT_HPP
+
+#include <atomic>
+#include "mqtt_client.h"
+#include "telemetry.hpp"
+
+// TelemetryTransport over esp-mqtt. Messages are handed to the client's outbox
+// (QoS 1) and sent by its own task, so publish() never waits on the network.
+class EspMqttTransport : public TelemetryTransport {
+    static constexpr size_t MAX_SUBSCRIPTIONS = 4;
+
+    struct Subscription {
+        const char* topic;
+        MessageHandler handler;
+        void* arg;
+    };
+
+    esp_mqtt_client_handle_t client_;
+    std::atomic<bool> connected_;
+    Subscription subscriptions_[MAX_SUBSCRIPTIONS];
+    size_t subscription_count_;
+    static void event_handler(void* arg, esp_event_base_t base, int32_t event_id, void* event_data);
+    void dispatch(const esp_mqtt_event_t& event);
+
+    public:
+        EspMqttTransport(const char* broker_uri, const char* client_id);
+        ~EspMqttTransport();
+        esp_err_t start();
+        bool connected() const override { return connected_.load(std::memory_order_relaxed); }
+        esp_err_t publish(const char* topic, const uint8_t* data, size_t length) override;
+        // Call before start(); subscriptions are renewed on every reconnect
+        esp_err_t subscribe(const char* topic, MessageHandler handler, void* arg) override;
+};
+
+#endif // MQTT_TRANSPORT_HPP
@@ -3,6 +3,15 @@
 
 #include "sensor.hpp"
 #include "adc.hpp"
+#include "thermistor.hpp"
+
+// 10 kΩ NTC probe above a 10 kΩ reference resistor on 3.3 V
+inline constexpr SteinhartHart NTC_PROBE = { 0.8999648402e-3, 2.494581846e-4, 2.002476456e-7, 10000.0, 3.3 };
+
+// -40..125 °C, the probe's rated range, in 128 segments (516 bytes of flash). Worst
+// error against Steinhart-Hart is 0.12 °C at the hot end and under 0.003 °C over
+// 0..50 °C; ntc.cpp checks the bound at compile time.
+using NtcTable = ThermistorTable<NTC_PROBE, 129, -40, 125>;
 
 class NTC : public Sensor {
     Adc& adc_;
@@ -14,4 +23,4 @@ class NTC : public Sensor {
         esp_err_t read(float& value) override;
 };
 
-#endif // NTC_SENSOR_HPP
\ No newline at end of file
+#endif // NTC_SENSOR_HPP
@@ -0,0 +1,24 @@
+#ifndef NVS_BLOB_STORE_HPP
+#define NVS_BLOB_STORE_HPP
+
+#include "blob_store.hpp"
+#include "nvs.h"
+
+// BlobStore in one NVS namespace. Requires nvs_flash_init() to have run; every write is
+// committed before it returns.
+class NvsBlobStore : public BlobStore {
+    const char* namespace_;
+    nvs_handle_t handle_;
+    bool open_;
+
+    esp_err_t open();
+
+    public:
+        explicit NvsBlobStore(const char* name_space);
+        ~NvsBlobStore();
+        esp_err_t read(const char* key, void* data, size_t length) override;
+        esp_err_t write(const char* key, const void* data, size_t length) override;
+        esp_err_t erase(const char* key) override;
+};
+
+#endif // NVS_BLOB_STORE_HPP
@@ -0,0 +1,21 @@
+#ifndef PARTITION_REGION_HPP
+#define PARTITION_REGION_HPP
+
+#include "esp_partition.h"
+#include "flash_ring.hpp"
+
+// FlashRegion backed by a data partition from partitions.csv
+class PartitionRegion : public FlashRegion {
+    const esp_partition_t* partition_;
+
+    public:
+        PartitionRegion(const char* label);
+        bool valid() const { return partition_ != nullptr; }
+        esp_err_t read(size_t offset, void* dst, size_t length) override;
+        esp_err_t write(size_t offset, const void* src, size_t length) override;
+        esp_err_t erase_sector(size_t offset) override;
+        size_t size() const override { return partition_ ? partition_->size : 0; }
+        size_t sector_size() const override { return partition_ ? partition_->erase_size : 0; }
+};
+
+#endif // PARTITION_REGION_HPP
@@ -0,0 +1,125 @@
+#ifndef PID_HPP
+#define PID_HPP
+
+#include <cmath>
+#include "fixed_point.hpp"
+
+struct PidGains {
+    float kp;
+    float ki;       // Per second
+    float kd;       // Seconds
+    float out_min;
+    float out_max;
+};
+
+// Largest relative error kp, ki * dt and kd / dt may pick up when stored in the
+// controller's format; control_config_validate rejects gains that lose more
+static constexpr float PID_GAIN_TOLERANCE = 0.01f;
+
+// Where the gains and the integral live. Fixed point keeps them in Q8.24: a dosing
+// ki * dt of 1e-4 is raw 7 in Q16, 7% off, and each step's integral increment rounds
+// the same way, while Q8.24 holds both to a few ppm.
+template <typename T>
+struct PidPrecision {
+    using Fine = T;
+    static Fine fine(T value) { return value; }
+    static T coarse(Fine value) { return value; }
+    static Fine mul_fine(Fine gain, T value) { return gain * value; }
+};
+
+template <>
+struct PidPrecision<Q16> {
+    using Fine = Q24;
+    static Fine fine(Q16 value) { return Q24(value); }
+    static Q16 coarse(Fine value) { return value.to_q16(); }
+    static Fine mul_fine(Fine gain, Q16 value) { return gain.mul_fine(value); }
+};
+
+// Allocation-free PID controller, T is float or Q16.
+//  - derivative on measurement, so setpoint steps do not kick the output
+//  - output clamped to [out_min, out_max]
+//  - conditional integration: the integral stops growing while the output is saturated
+//  - transfer() preloads the integral for a bumpless switch from another controller
+template <typename T>
+class Pid {
+    using P = PidPrecision<T>;
+    using Fine = typename P::Fine;
+
+    Fine kp_;
+    Fine ki_dt_;        // ki * dt, precomputed
+    Fine kd_over_dt_;   // kd / dt, precomputed
+    T out_min_;
+    T out_max_;
+    Fine integral_;
+    T prev_measurement_;
+    bool primed_;
+
+    template <typename V>
+    static V clamp(V value, V lo, V hi) { return value < lo ? lo : (value > hi ? hi : value); }
+
+    public:
+        Pid(const PidGains& gains, float dt_s) : integral_(), prev_measurement_(), primed_(false) {
+            set_gains(gains, dt_s);
+        }
+
+        void set_gains(const PidGains& gains, float dt_s) {
+            kp_ = Fine(gains.kp);
+            ki_dt_ = Fine(gains.ki * dt_s);
+            kd_over_dt_ = Fine(dt_s > 0.0f ? gains.kd / dt_s : 0.0f);
+            out_min_ = T(gains.out_min);
+            out_max_ = T(gains.out_max);
+            integral_ = clamp(integral_, P::fine(out_min_), P::fine(out_max_));
+        }
+
+        // Largest relative error of kp, ki * dt and kd / dt once stored, saturation included
+        static float gain_error(const PidGains& gains, float dt_s) {
+            const float wanted[] = { gains.kp, gains.ki * dt_s, dt_s > 0.0f ? gains.kd / dt_s : 0.0f };
+            float worst = 0.0f;
+            for (float gain : wanted) {
+                if (gain != 0.0f) {
+                    worst = std::fmax(worst, std::fabs(static_cast<float>(Fine(gain)) - gain) / std::fabs(gain));
+                }
+            }
+            return worst;
+        }
+
+        T update(T setpoint, T measurement) {
+            T error = setpoint - measurement;
+            T derivative = primed_ ? kd_over_dt_ * (prev_measurement_ - measurement) : T();
+            prev_measurement_ = measurement;
+            primed_ = true;
+
+            Fine integral = clamp(integral_ + P::mul_fine(ki_dt_, error), P::fine(out_min_), P::fine(out_max_));
+            T output = kp_ * error + P::coarse(integral) + derivative;
+            if (output > out_max_) {
+                output = out_max_;
+                if (error > T()) {
+                    integral = integral_;
+                }
+            } else if (output < out_min_) {
+                output = out_min_;
+                if (error < T()) {
+                    integral = integral_;
+                }
+            }
+            integral_ = integral;
+            return output;
+        }
+
+        // Take over from another controller that is currently driving `output`
+        void transfer(T setpoint, T measurement, T output) {
+            integral_ = clamp(P::fine(output - kp_ * (setpoint - measurement)), P::fine(out_min_), P::fine(out_max_));
+            prev_measurement_ = measurement;
+            primed_ = true;
+        }
+
+        void reset() {
+            integral_ = Fine();
+            prev_measurement_ = T();
+            primed_ = false;
+        }
+
+        T integral() const { return P::coarse(integral_); }
+};
+
+#endif // PID_HPP
@@ -0,0 +1,60 @@
+#ifndef POWER_HPP
+#define POWER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "latency_histogram.hpp"
+#include "power_driver.hpp"
+
+struct PowerStats {
+    bool enabled;
+    uint32_t waits;             // Deadlines the state task slept toward
+    uint32_t sleeps;            // Light sleeps of the chip, whichever task's deadline ended them
+    uint32_t uart_wakeups;
+    uint64_t slept_us;
+    uint64_t elapsed_us;        // Since start()
+    uint32_t residency_permille;    // Share of elapsed_us in light sleep
+    // From a deadline to the state task running, over the waits the chip slept in
+    uint32_t wake_p50_us;
+    uint32_t wake_p99_us;
+    uint32_t wake_max_us;
+    uint32_t rearms;            // Wakes that restarted an ADC scan
+    uint32_t rearm_p99_us;      // Restart to the first frame of every channel
+    uint32_t rearm_max_us;
+    uint32_t listens;           // SEN0311 listens started ahead of a level reading
+};
+
+// Power-managed mode of the state machine (see StateMachine::set_power): one task samples
+// every sensor and runs every stage, then sleeps until the earliest next deadline, and the
+// chip light-sleeps whenever every task waits. Keeps the wake latency and sleep residency
+// that the coalescing and listen lead in PowerConfig trade against sampling latency.
+class PowerManager {
+    PowerDriver& driver_;
+    PowerConfig config_;
+    std::atomic<bool> enabled_;
+    int64_t started_us_;
+    std::atomic<uint32_t> waits_;
+    std::atomic<uint32_t> rearms_;
+    std::atomic<uint32_t> listens_;
+    LatencyHistogram wake_us_;
+    LatencyHistogram rearm_us_;
+
+    public:
+        explicit PowerManager(PowerDriver& driver);
+        PowerManager(const PowerManager&) = delete;
+        PowerManager& operator=(const PowerManager&) = delete;
+
+        // Before the state machine runs; it stays on its own tasks unless this succeeds
+        esp_err_t start(const PowerConfig& config = PowerConfig());
+        bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+        const PowerConfig& config() const { return config_; }
+
+        // State task: blocks until deadline_us, recording how late it woke
+        void wait_until(int64_t deadline_us);
+        void record_rearm(uint32_t duration_us);
+        void record_listen() { listens_.fetch_add(1, std::memory_order_relaxed); }
+        // Any task
+        PowerStats stats() const;
+};
+
+#endif // POWER_HPP
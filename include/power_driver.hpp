@@ -0,0 +1,44 @@
+#ifndef POWER_DRIVER_HPP
+#define POWER_DRIVER_HPP
+
+#include <cstdint>
+#include "esp_err.h"
+
+// Power-managed mode of one deployment: how deep the chip sleeps and how much sampling
+// latency it trades for fewer wakes
+struct PowerConfig {
+    bool light_sleep = true;            // Off: frequency scaling only
+    uint32_t max_cpu_mhz = 160;
+    uint32_t min_cpu_mhz = 40;
+    // Sensors due within this of a wake are sampled on it instead of waking again, up to
+    // this much early
+    uint32_t coalesce_ms = 20;
+    // The SEN0311 link starts listening this long before the level may be read (its
+    // deadline less coalesce_ms). The frame that wakes the chip is lost and the next one
+    // has to be in by then, so more than two frame intervals (~100 ms each).
+    uint32_t listen_lead_ms = 250;
+    // Longest wait for the first frame of a re-armed ADC scan
+    uint32_t adc_rearm_timeout_ms = 100;
+};
+
+// Light sleep since start(), as the driver counted it
+struct PowerSleepTotals {
+    uint32_t sleeps;
+    uint32_t uart_wakeups;  // Sleeps ended by UART wake-up
+    uint64_t slept_us;
+};
+
+// Hardware side of PowerManager: ESP-IDF power management and tickless idle on the device
+// (EspPowerDriver), a simulated clock on the host
+class PowerDriver {
+    public:
+        virtual ~PowerDriver() = default;
+        virtual esp_err_t start(const PowerConfig& config) = 0;
+        // Blocks the calling task until wake_us on the esp_timer clock. The chip
+        // light-sleeps meanwhile whenever no other task has work.
+        virtual void sleep_until(int64_t wake_us) = 0;
+        // Any task
+        virtual PowerSleepTotals totals() const = 0;
+};
+
+#endif // POWER_DRIVER_HPP
@@ -0,0 +1,56 @@
+#ifndef RECORDING_DRIVER_HPP
+#define RECORDING_DRIVER_HPP
+
+#include "adc_driver.hpp"
+#include "uart_driver.hpp"
+#include "capture.hpp"
+
+// AdcDriver between Adc and the real driver: passes every call through and records the
+// conversions and scan frames it returns while the capture runs. init() samples each
+// channel's calibration curve, so a replay converts raw values the way this chip did.
+class RecordingAdcDriver : public AdcDriver, public AdcScanListener {
+    AdcDriver& driver_;
+    Capture& capture_;
+    CaptureAdcSetup setup_;
+    uint8_t stream_;
+    AdcScanListener* listener_;
+
+    public:
+        RecordingAdcDriver(AdcDriver& driver, Capture& capture);
+        uint8_t stream() const { return stream_; }
+
+        esp_err_t init(const AdcConfig_t* configs, size_t count) override;
+        esp_err_t start_oneshot() override { return driver_.start_oneshot(); }
+        esp_err_t read_raw(size_t channel_idx, int& raw) override;
+        esp_err_t start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) override;
+        void stop_continuous() override;
+        esp_err_t suspend_continuous() override { return driver_.suspend_continuous(); }
+        esp_err_t resume_continuous() override { return driver_.resume_continuous(); }
+        esp_err_t raw_to_mv(size_t channel_idx, int raw, int& mv) override { return driver_.raw_to_mv(channel_idx, raw, mv); }
+        void on_scan(const int* raw, const uint32_t* count, size_t channels) override;
+};
+
+// UartDriver between Uart and the real driver: records every read, receive timeout and
+// overflow on the driver's receive task before Uart sees it
+class RecordingUartDriver : public UartDriver, public UartListener {
+    UartDriver& driver_;
+    Capture& capture_;
+    CaptureUartSetup setup_;
+    uint8_t stream_;
+    UartListener* listener_;
+
+    void record(CaptureKind kind, int64_t now_us);
+
+    public:
+        RecordingUartDriver(UartDriver& driver, Capture& capture);
+        uint8_t stream() const { return stream_; }
+
+        esp_err_t start(const UartConfig& config, UartListener& listener) override;
+        void stop() override { driver_.stop(); }
+        esp_err_t set_listening(bool listening) override { return driver_.set_listening(listening); }
+        void on_data(const uint8_t* data, size_t length, int64_t now_us) override;
+        void on_idle() override;
+        void on_overflow() override;
+};
+
+#endif // RECORDING_DRIVER_HPP
@@ -0,0 +1,64 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "latency_histogram.hpp"
+
+struct ScheduleStats {
+    uint32_t period_ms;
+    uint32_t runs;
+    uint32_t overruns;      // Runs that finished after their next deadline
+    uint32_t exec_min_us;
+    uint32_t exec_p50_us;
+    uint32_t exec_p99_us;
+    uint32_t exec_max_us;
+    uint32_t jitter_p99_us; // Start time relative to the deadline
+    uint32_t jitter_max_us;
+};
+
+// Fixed-rate scheduler with absolute deadlines. Each slot has its own period;
+// deadlines advance by whole periods so run time never shifts the schedule.
+class Scheduler {
+    public:
+        static constexpr size_t MAX_SLOTS = 8;
+
+    private:
+        struct Slot {
+            uint32_t period_ms;
+            TickType_t period_ticks;
+            TickType_t deadline;
+            int64_t deadline_us;    // Same deadline on the esp_timer clock, for jitter
+            int64_t started_us;
+            std::atomic<uint32_t> runs;
+            std::atomic<uint32_t> overruns;
+            LatencyHistogram exec_us;
+            LatencyHistogram jitter_us;
+        };
+
+        Slot slots_[MAX_SLOTS];
+        size_t slot_count_;
+        TickType_t last_wake_;
+
+    public:
+        Scheduler();
+        // Returns the slot id, or MAX_SLOTS if the table is full
+        size_t add(uint32_t period_ms);
+        // Aligns every slot's first deadline to now
+        void start();
+        bool due(size_t id) const;
+        void begin(size_t id);
+        void end(size_t id);
+        // Blocks until the earliest deadline across all slots
+        void wait_next();
+        TickType_t next_deadline() const;
+        // Next deadline of one slot on the esp_timer clock, for loops that sleep on it
+        int64_t deadline_us(size_t id) const { return slots_[id].deadline_us; }
+        ScheduleStats stats(size_t id) const;
+        size_t size() const { return slot_count_; }
+};
+
+#endif // SCHEDULER_HPP
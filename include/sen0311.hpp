@@ -0,0 +1,55 @@
+#ifndef SEN0311_HPP
+#define SEN0311_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "seqlock.hpp"
+
+struct Sen0311Reading {
+    float distance_cm;
+    int64_t timestamp_us;   // esp_timer time of the frame, 0 if none yet
+};
+
+struct Sen0311Stats {
+    uint32_t frames;            // Valid frames decoded
+    uint32_t checksum_errors;
+    uint32_t range_errors;      // Valid frames outside 30..4500 mm
+    uint32_t discarded_bytes;   // Bytes skipped while hunting for the 0xFF header
+    uint32_t timeouts;          // Receive intervals without any data
+    uint32_t overflows;         // RX FIFO / ring buffer overflows
+};
+
+// Streaming decoder for the SEN0311 UART protocol: 0xFF, distance high, distance low, checksum.
+// Bytes can arrive in any chunking; the parser resyncs on the next header after an error.
+class Sen0311Parser {
+    enum class Stage { HEADER, HIGH, LOW, CHECKSUM };
+
+    Stage stage_;
+    uint8_t frame_[4];
+    Seqlock<Sen0311Reading> latest_;
+    std::atomic<uint32_t> frames_;
+    std::atomic<uint32_t> checksum_errors_;
+    std::atomic<uint32_t> range_errors_;
+    std::atomic<uint32_t> discarded_bytes_;
+    std::atomic<uint32_t> timeouts_;
+    std::atomic<uint32_t> overflows_;
+
+    public:
+        Sen0311Parser();
+        // Decoder side, called from the UART receive task only
+        void feed(const uint8_t* data, size_t length, int64_t now_us);
+        void reset();
+        void on_timeout() { timeouts_.fetch_add(1, std::memory_order_relaxed); }
+        void on_overflow() { overflows_.fetch_add(1, std::memory_order_relaxed); }
+
+        // Reader side, safe from any task
+        Sen0311Reading latest() const { return latest_.load(); }
+        Sen0311Stats stats() const;
+
+    private:
+        bool complete_frame(int64_t now_us);
+        void resync();
+};
+
+#endif // SEN0311_HPP
@@ -12,6 +12,7 @@ struct SensorData {
         WATER_LEVEL,
         PH
     };
+    static constexpr size_t TYPE_COUNT = 4;
     Type type;
     float value; // TDS (ppm), Temperature (°C), or Water Level (cm), etc..
 };
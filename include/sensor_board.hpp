@@ -0,0 +1,33 @@
+#ifndef SENSOR_BOARD_HPP
+#define SENSOR_BOARD_HPP
+
+#include <cstdint>
+#include "esp_err.h"
+#include "sensor.hpp"
+#include "seqlock.hpp"
+
+struct SensorSample {
+    float value;
+    esp_err_t status;       // Result of the Sensor::read that produced value
+    int64_t timestamp_us;   // esp_timer time of the read, 0 if never sampled
+    float variance;         // Of value, when an estimator produced it; 0 for unfiltered readings
+};
+
+// Latest-value board with one slot per SensorData::Type. Each slot has a single
+// writer (its sampler task); any number of readers copy values out without locking.
+class SensorBoard {
+    Seqlock<SensorSample> slots_[SensorData::TYPE_COUNT];
+
+    public:
+        void publish(SensorData::Type type, const SensorSample& sample) {
+            slots_[static_cast<size_t>(type)].store(sample);
+        }
+        SensorSample latest(SensorData::Type type) const {
+            return slots_[static_cast<size_t>(type)].load();
+        }
+        uint32_t version(SensorData::Type type) const {
+            return slots_[static_cast<size_t>(type)].version();
+        }
+};
+
+#endif // SENSOR_BOARD_HPP
@@ -0,0 +1,53 @@
+#ifndef SENSOR_REGISTRY_HPP
+#define SENSOR_REGISTRY_HPP
+
+#include <cstdint>
+#include "esp_err.h"
+#include "sensor.hpp"
+#include "sensor_board.hpp"
+
+constexpr uint32_t sensor_bit(SensorData::Type type) { return 1u << static_cast<uint32_t>(type); }
+
+// Turns a raw reading into the reported value; inputs holds this cycle's reported
+// values indexed by SensorData::Type, with every declared dependency already current.
+// The raw variance is passed through: the compensations used are close to unity gain.
+using SensorDerive = float (*)(float raw, const SensorSample* inputs);
+
+// Reported sensor values, one slot per SensorData::Type. Raw readings come from the
+// SensorBoard; a sensor that declares dependencies (e.g. pH and TDS on temperature) is
+// derived from its raw reading and the dependencies' values of the same cycle. Sensors
+// are evaluated in dependency order, and a value is only recomputed when its raw
+// reading or one of its dependencies changed.
+class SensorRegistry {
+    struct Node {
+        bool registered;
+        uint32_t depends_on;        // sensor_bit mask
+        SensorDerive derive;        // nullptr: report the raw reading
+        uint32_t raw_version;       // SensorBoard version the value was computed from
+        uint32_t changed_cycle;     // Last cycle the value or status changed
+    };
+
+    Node nodes_[SensorData::TYPE_COUNT];
+    SensorSample values_[SensorData::TYPE_COUNT];
+    SensorData::Type order_[SensorData::TYPE_COUNT];
+    size_t order_count_;
+    uint32_t cycle_;
+    uint32_t recomputed_;
+    uint32_t skipped_;
+
+    public:
+        SensorRegistry();
+        // Call for every sensor, then finalize() before evaluate()
+        esp_err_t add(SensorData::Type type, uint32_t depends_on = 0, SensorDerive derive = nullptr);
+        // Orders the sensors so dependencies come first; fails on a cycle or an unregistered dependency
+        esp_err_t finalize();
+        // One cycle: pulls raw readings from the board and brings every value up to date
+        void evaluate(const SensorBoard& board);
+
+        const SensorSample& value(SensorData::Type type) const { return values_[static_cast<size_t>(type)]; }
+        // Values recomputed and left as they were because nothing they depend on changed
+        uint32_t recomputed() const { return recomputed_; }
+        uint32_t skipped() const { return skipped_; }
+};
+
+#endif // SENSOR_REGISTRY_HPP
@@ -0,0 +1,59 @@
+#ifndef SENSOR_SAMPLER_HPP
+#define SENSOR_SAMPLER_HPP
+
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sensor.hpp"
+#include "sensor_board.hpp"
+#include "estimator.hpp"
+#include "metrics.hpp"
+#include "adaptive_rate.hpp"
+
+// Samples one sensor on its own task at a fixed period and publishes to the board,
+// optionally through a Kalman estimator that sees every reading. Until the sensor has
+// settled (see EstimatorConfig::ready_variance) its readings go out as ESP_ERR_NOT_FINISHED.
+// With an AdaptiveRate the period follows the signal between its min and max.
+class SensorSampler {
+    Sensor& sensor_;
+    SensorBoard& board_;
+    const char* name_;
+    std::atomic<uint32_t> period_ms_;
+    TaskHandle_t task_;
+    ScalarKalman estimator_;
+    float ready_variance_;
+    std::atomic<bool> ready_;
+    OpMetrics metrics_;         // Sensor::read(), before the estimator
+    AdaptiveRate rate_;         // Sampler task only
+    std::atomic<float> watch_;  // Threshold that keeps the rate up; NAN: none
+    int64_t next_us_;           // poll(): deadline of the next sample
+
+    static void task(void* arg);
+
+    public:
+        SensorSampler(Sensor& sensor, SensorBoard& board, const char* name, uint32_t period_ms);
+        ~SensorSampler();
+        // Call before start(); the board then gets the estimate and its variance
+        void set_estimator(const EstimatorConfig& config);
+        // Call before start(); the period then starts at config.min_period_ms
+        void set_adaptive(const AdaptiveRateConfig& config);
+        // Any task: the value the control loop acts on, e.g. its setpoint; NAN for none
+        void set_watch(float threshold) { watch_.store(threshold, std::memory_order_relaxed); }
+        esp_err_t start(UBaseType_t priority, uint32_t stack_size);
+        // One read and publish on the calling task; what the sampler task does every period
+        void sample_once();
+        // Power-managed mode, instead of start(): sample_once() on the calling task if the
+        // next sample is due by horizon_us. Deadlines follow the period from the previous
+        // one, or from now once the caller has fallen a period behind. True if it sampled.
+        bool poll(int64_t horizon_us);
+        int64_t next_sample_us() const { return next_us_; }
+        void set_period_ms(uint32_t period_ms) { period_ms_.store(period_ms, std::memory_order_relaxed); }
+        uint32_t period_ms() const { return period_ms_.load(std::memory_order_relaxed); }
+        // Has published a settled reading; stays set from then on
+        bool ready() const { return ready_.load(std::memory_order_acquire); }
+        const OpMetrics& metrics() const { return metrics_; }
+        Sensor& sensor() { return sensor_; }
+        SensorData::Type type() const { return sensor_.get_type(); }
+};
+
+#endif // SENSOR_SAMPLER_HPP
@@ -0,0 +1,45 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// Single-writer, multi-reader latest-value cell. Readers never block the writer;
+// they retry if a store raced with their copy.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+    std::atomic<uint32_t> seq_;
+    T value_;
+
+    public:
+        Seqlock() : seq_(0), value_() {}
+
+        // Must only be called from one task at a time
+        void store(const T& value) {
+            uint32_t seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            value_ = value;
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+
+        T load() const {
+            T value;
+            uint32_t before, after;
+            do {
+                before = seq_.load(std::memory_order_acquire);
+                value = value_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = seq_.load(std::memory_order_relaxed);
+            } while ((before & 1) || before != after);
+            return value;
+        }
+
+        // Even, and bumped by 2 on every store; 0 means never written
+        uint32_t version() const { return seq_.load(std::memory_order_acquire) & ~1u; }
+};
+
+#endif // SEQLOCK_HPP
@@ -1,11 +1,37 @@
 #ifndef STATE_MACHINE_HPP
 #define STATE_MACHINE_HPP
 
-#include "adc.hpp"
-#include "uart.hpp"
-#include "sensor.hpp"
-#include <vector>
-#include <memory>
+#include "zone.hpp"
+#include "scheduler.hpp"
+#include "fuzzy.hpp"
+#include "telemetry.hpp"
+#include "history.hpp"
+#include "actuator.hpp"
+#include "dashboard.hpp"
+#include "power.hpp"
+#include "control_config.hpp"
+#include "metrics.hpp"
+#include <array>
+#include <atomic>
+
+// Tanks one state machine drives; telemetry carries every zone's sensors in one sample
+static constexpr size_t MAX_ZONES = 8;
+static_assert(MAX_ZONES * SensorData::TYPE_COUNT <= TELEMETRY_MAX_CHANNELS, "telemetry cannot carry every zone");
+
+// Period of each state; every state runs on its own absolute-deadline schedule
+struct StateSchedule {
+    uint32_t acquisition_ms = 100;   // 10 Hz
+    uint32_t control_ms = 1000;      // 1 Hz, the PID sample period
+    uint32_t telemetry_ms = 10000;   // 0.1 Hz
+};
+
+// Boot timeline on the esp_timer clock, in µs since boot; 0 until the event happens
+struct StartupStats {
+    int64_t adc_primed_us;      // Every ADC channel holds a settled, filtered value
+    int64_t started_us;         // run() or the first step()
+    int64_t inputs_ready_us;    // Every sensor has reported a settled value
+    int64_t first_control_us;   // First control decision taken on valid inputs
+};
 
 class StateMachine {
 public:
@@ -14,35 +40,102 @@ public:
         ACTUATOR_CONTROL,
         MQTT_COMMUNICATION
     };
+    static constexpr size_t STATE_COUNT = 3;
 
-    enum class ActuatorSubstate {
-        ON_OFF_CONTROL,
-        PID_CONTROL,
-        FUZZY_LOGIC_CONTROL
-    };
+    using ActuatorSubstate = ControlMode;
 
-    StateMachine(const std::vector<AdcConfig>& adc_configs, const UartConfig& uart_config, float tank_height_cm);
+    // Drives zone_count zones (at most MAX_ZONES) in one pass per state; the zones, and the
+    // ADC units and UARTs behind them, must outlive the state machine. Primes every ADC unit.
+    StateMachine(Zone* const* zones, size_t zone_count, const StateSchedule& schedule = StateSchedule());
+    explicit StateMachine(Zone& zone, const StateSchedule& schedule = StateSchedule());
     void run();
+    // One pass of the power-managed loop on the calling task: samples the sensors due,
+    // with the ADC scan re-armed only for them, runs the stages due and starts the SEN0311
+    // listening ahead of the level reading. Returns the deadline of the next pass, the
+    // earliest across every sensor and stage; run() sleeps until it. Needs set_power();
+    // hosts call it on a simulated clock. Do not mix with run() or step().
+    int64_t power_step();
+    // One pass without tasks or timing: sample every sensor on the calling task, then run
+    // every state once. For host simulation and benchmarks; do not mix with run(). The
+    // schedule stats count every pass, with each state due when the pass starts.
+    void step();
+    // One state on the calling task, e.g. to time the stages separately
+    void step(State state) { run_state(state); }
+    // Execution time, jitter and overrun counters of one state; safe to call from any task
+    ScheduleStats state_stats(State state) const { return scheduler_.stats(static_cast<size_t>(state)); }
+    static const char* state_name(State state);
+    // Per-zone sensor and SEN0311, per-ADC-channel and per-state metrics; safe to call from
+    // any task. Returns the length written, truncated to fit size.
+    size_t metrics_report(char* out, size_t size, MetricsFormat format) const;
+    // All zero until the first valid control decision, then the whole boot timeline
+    StartupStats startup_stats() const {
+        return startup_done_.load(std::memory_order_acquire) ? startup_ : StartupStats{};
+    }
+    // Swap the fuzzy rule table without blocking the control loop; safe from any task
+    void set_fuzzy_rules(const FuzzyRuleSet& rules) { fuzzy_.set_rules(rules); }
+    // Batched telemetry output; call before run(). Without one the telemetry state only logs.
+    void set_telemetry(TelemetryPublisher* telemetry) { telemetry_ = telemetry; }
+    // Time series of the telemetry row, one row per control tick once the inputs are ready;
+    // call before run(). ESP_ERR_INVALID_SIZE unless it has a channel per zone and sensor.
+    esp_err_t set_history(History* history);
+    const History* history() const { return history_; }
+    // Where each control decision goes: zone z drives channels ZONE_ACTUATORS * z onwards
+    // (pump duty, heater duty, dosing pulses). Call before run(). ESP_ERR_INVALID_SIZE
+    // unless the engine has the channels of every zone. Without one the outputs are only traced.
+    esp_err_t set_actuators(ActuatorEngine* actuators);
+    // Commands to it are safe from any task
+    ActuatorEngine* actuators() const { return actuators_; }
+    // Live view: every acquisition hands the telemetry row to it. Call before run() and
+    // before the dashboard's start(); gives it the zone names.
+    void set_dashboard(Dashboard* dashboard);
+    const Dashboard* dashboard() const { return dashboard_; }
+    // Power-managed mode; call before run(). With a started manager run() samples every
+    // sensor on its own task instead of one task per sensor and sleeps between deadlines
+    // (see power_step). Acquisition then follows the sensors instead of its period, so its
+    // schedule stats stay empty.
+    void set_power(PowerManager* power) { power_ = power; }
+    const PowerManager* power() const { return power_; }
+    // Parses and validates a JSON config update (see control_config_parse) and hands it to
+    // the control loop, which applies it to every zone on its next tick. Call from one task
+    // only, e.g. the MQTT task; never blocks the control loop. version receives the
+    // published version.
+    esp_err_t update_config(const char* json, size_t length, uint32_t* version = nullptr);
+
+    size_t zone_count() const { return zone_count_; }
+    const Zone& zone(size_t index) const { return *zones_[index]; }
+    // For what a zone allows from other tasks, e.g. replacing a calibration
+    Zone& zone(size_t index) { return *zones_[index]; }
 
 private:
-    Adc adc_;
-    Uart uart_;
-    float tank_height_cm_;
-    std::vector<std::unique_ptr<Sensor>> sensors_;
-    std::vector<SensorData> sensor_data_;
+    std::array<Zone*, MAX_ZONES> zones_;
+    size_t zone_count_;
+    // Distinct ADC units behind the zones, in order of first use
+    std::array<Adc*, MAX_ZONES> adcs_;
+    size_t adc_count_;
+    std::array<SensorData, MAX_ZONES * SensorData::TYPE_COUNT> telemetry_row_; // Every zone's values, zone by zone
+    Scheduler scheduler_;
     State current_state_;
-    ActuatorSubstate actuator_substate_;
-    // Placeholder thresholds (could be updated via MQTT)
-    float tds_threshold_ = 1000.0f; // ppm
-    float temp_threshold_ = 25.0f;  // °C
-    float water_level_threshold_ = 50.0f; // cm
+    FuzzyController fuzzy_;     // One rule table for every zone
+    TelemetryPublisher* telemetry_;
+    History* history_;
+    ActuatorEngine* actuators_;
+    Dashboard* dashboard_;
+    PowerManager* power_;
+    std::array<int64_t, MAX_ZONES> listened_for_us_;    // Level deadline each zone last listened ahead of
+    ControlConfigStore config_;
+    uint32_t applied_config_version_;
+    char metrics_json_[METRICS_REPORT_BYTES];   // Telemetry stage only
+    StartupStats startup_;
+    std::atomic<bool> startup_done_;
+    bool inputs_ready_;     // Every zone has reported settled values
 
     void sensor_data_acquisition();
     void actuator_control();
+    void apply_config(const ControlConfig& config);
+    void drive_actuators();
     void mqtt_communication();
-    void on_off_control();
-    void pid_control();
-    void fuzzy_logic_control();
+    void log_schedule_stats() const;
+    void run_state(State state);
 };
 
 #endif // STATE_MACHINE_HPP
\ No newline at end of file
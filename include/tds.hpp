@@ -3,16 +3,24 @@
 
 #include "sensor.hpp"
 #include "adc.hpp"
+#include "sensor_board.hpp"
+#include "calibration.hpp"
 
 class TDS : public Sensor {
     Adc& adc_;
     AdcConfig config_;
     size_t channel_idx_;
-    const std::vector<SensorData>& sensor_data_;  // Reference to StateMachine's sensor_data_
+    Calibration calibration_;   // Voltage -> ppm
     
     public:
-    	TDS(Adc& adc, const AdcConfig& config, size_t channel_idx, const std::vector<SensorData>& sensor_data);
+    	TDS(Adc& adc, const AdcConfig& config, size_t channel_idx);
+        // TDS at the water temperature, before compensation
         esp_err_t read(float& value) override;
+        // Curve in use; replaced at runtime from the console or the stored calibration
+        Calibration& calibration() { return calibration_; }
+        const Calibration& calibration() const { return calibration_; }
+        // SensorDerive: compensates to 25 °C with the NTC value of the same cycle
+        static float compensate(float tds_raw, const SensorSample* inputs);
 
 };
 
@@ -0,0 +1,113 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "sensor.hpp"
+#include "flash_ring.hpp"
+
+// Called for each message on a subscribed topic, on the transport's own task
+using MessageHandler = void (*)(void* arg, const char* topic, const uint8_t* data, size_t length);
+
+// Where telemetry batches go: esp-mqtt on the device, a plain socket client on the host
+class TelemetryTransport {
+    public:
+        virtual ~TelemetryTransport() = default;
+        virtual bool connected() const = 0;
+        // Must not block on the network; queue the message or fail
+        virtual esp_err_t publish(const char* topic, const uint8_t* data, size_t length) = 0;
+        // topic must outlive the transport
+        virtual esp_err_t subscribe(const char* /*topic*/, MessageHandler /*handler*/, void* /*arg*/) { return ESP_ERR_NOT_SUPPORTED; }
+};
+
+static constexpr size_t TELEMETRY_MAX_BATCH_BYTES = 512;
+static constexpr size_t TELEMETRY_MAX_CHANNELS = 32;   // Four sensors in each of up to eight zones
+static constexpr uint8_t TELEMETRY_FORMAT_VERSION = 1;
+static constexpr size_t TELEMETRY_QUEUE_DEPTH = 4;  // Completed batches held in RAM between service() calls
+
+// Compact batch encoding, all multi-byte integers are LEB128 varints:
+//   'H' 'T' version channel_count type[channel_count] sample_count base_time_ms
+//   then per sample: dt_ms, and per channel zigzag(value - previous value)
+// Values are fixed point per type (see telemetry_scale), the first sample is
+// delta-coded against 0, later ones against the previous sample. With several zones the
+// types repeat, one group of channels per zone in zone order.
+class TelemetryEncoder {
+    uint8_t buffer_[TELEMETRY_MAX_BATCH_BYTES];
+    size_t length_;
+    size_t count_offset_;
+    uint8_t channels_;
+    uint8_t samples_;
+    int64_t last_time_ms_;
+    int32_t last_values_[TELEMETRY_MAX_CHANNELS];
+
+    public:
+        TelemetryEncoder();
+        void begin(const SensorData* layout, size_t count, int64_t time_ms);
+        // False if the sample does not fit; the batch is left unchanged
+        bool add(const SensorData* data, size_t count, int64_t time_ms);
+        uint8_t samples() const { return samples_; }
+        const uint8_t* data() const { return buffer_; }
+        size_t length() const { return length_; }
+};
+
+int32_t telemetry_scale(SensorData::Type type);
+
+struct TelemetryConfig {
+    const char* topic = "hydroponics/telemetry";
+    size_t samples_per_batch = 30;
+    uint32_t sample_interval_ms = 1000;   // Samples closer together than this are skipped
+    size_t drain_per_service = 4;         // Spilled batches re-sent per service() call
+    const char* metrics_topic = "hydroponics/metrics";
+};
+
+struct TelemetryStats {
+    uint32_t samples;
+    uint32_t batches;
+    uint32_t published;
+    uint32_t spilled;       // Written to flash while offline
+    uint32_t drained;       // Re-sent from flash after reconnecting
+    uint32_t dropped;       // Lost: RAM queue overflow, flash full or no spill store
+    uint32_t bytes_published;
+    uint32_t metrics_published;
+};
+
+// Collects samples into batches and publishes one message per batch. While the
+// transport is offline batches are spilled to a FlashRing and drained, oldest
+// first, once it is back.
+class TelemetryPublisher {
+    struct Batch {
+        uint8_t data[TELEMETRY_MAX_BATCH_BYTES];
+        size_t length;
+    };
+
+    TelemetryTransport& transport_;
+    FlashRing* spill_;
+    TelemetryConfig config_;
+    TelemetryEncoder encoder_;
+    bool open_;
+    int64_t last_sample_ms_;
+    Batch queue_[TELEMETRY_QUEUE_DEPTH];
+    size_t queue_head_;
+    size_t queue_count_;
+    uint8_t drain_buffer_[TELEMETRY_MAX_BATCH_BYTES];
+    TelemetryStats stats_;
+
+    public:
+        TelemetryPublisher(TelemetryTransport& transport, FlashRing* spill, const TelemetryConfig& config = TelemetryConfig());
+        // Cheap, called from the acquisition stage
+        void add(const SensorData* data, size_t count, int64_t time_ms);
+        // Publishes completed batches, spills or drains; called from the telemetry stage
+        void service();
+        // Publishes a metrics report on metrics_topic if online; never spilled
+        esp_err_t publish_metrics(const char* json, size_t length);
+        // Closes the current batch early, e.g. before sleeping
+        void flush();
+        const TelemetryStats& stats() const { return stats_; }
+
+    private:
+        void close_batch();
+        esp_err_t send(const uint8_t* data, size_t length);
+};
+
+#endif // TELEMETRY_HPP
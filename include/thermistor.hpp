@@ -0,0 +1,124 @@
+#ifndef THERMISTOR_HPP
+#define THERMISTOR_HPP
+
+#include <array>
+#include <cstddef>
+
+// Natural log usable in constant expressions: range reduction to [1, 2), then the
+// atanh series. Only for table generation, never on the sample path.
+constexpr double constexpr_ln(double x) {
+    if (!(x > 0.0)) {
+        return -1e300;
+    }
+    constexpr double LN2 = 0.69314718055994530942;
+    int exponent = 0;
+    while (x >= 2.0) {
+        x *= 0.5;
+        ++exponent;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        --exponent;
+    }
+    double z = (x - 1.0) / (x + 1.0);
+    double z2 = z * z;
+    double term = z;
+    double sum = 0.0;
+    for (int n = 1; n < 200 && term > 1e-18; n += 2) {
+        sum += term / n;
+        term *= z2;
+    }
+    return exponent * LN2 + 2.0 * sum;
+}
+
+// Steinhart-Hart model of an NTC divider: the NTC from v_supply to the ADC pin,
+// r_ref from the pin to ground
+struct SteinhartHart {
+    double a;
+    double b;
+    double c;
+    double r_ref;       // Ω
+    double v_supply;    // V
+
+    constexpr double resistance(double voltage) const { return r_ref * (v_supply / voltage - 1.0); }
+
+    constexpr double celsius(double voltage) const {
+        double ln_r = constexpr_ln(resistance(voltage));
+        return 1.0 / (a + b * ln_r + c * ln_r * ln_r * ln_r) - 273.15;
+    }
+
+    // Pin voltage for a temperature; temperature rises with voltage, so bisect
+    constexpr double voltage(double celsius_target) const {
+        double lo = v_supply * 1e-6;
+        double hi = v_supply * (1.0 - 1e-6);
+        for (int i = 0; i < 64; ++i) {
+            double mid = 0.5 * (lo + hi);
+            if (celsius(mid) < celsius_target) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        return 0.5 * (lo + hi);
+    }
+};
+
+// Temperature from pin voltage by linear interpolation in a table of Points entries,
+// evenly spaced in voltage between MinC and MaxC and generated at compile time from
+// Model. One multiply-add per conversion and no libm, which matters on targets
+// without an FPU where logf and the division cost thousands of cycles.
+template <SteinhartHart Model, size_t Points, int MinC, int MaxC>
+class ThermistorTable {
+    static_assert(Points >= 2, "need at least one segment");
+    static_assert(MinC < MaxC, "empty temperature range");
+
+    static constexpr double V_MIN = Model.voltage(MinC);
+    static constexpr double V_MAX = Model.voltage(MaxC);
+    static constexpr double STEP = (V_MAX - V_MIN) / (Points - 1);
+
+    static constexpr std::array<float, Points> build() {
+        std::array<float, Points> table{};
+        for (size_t i = 0; i < Points; ++i) {
+            table[i] = static_cast<float>(Model.celsius(V_MIN + STEP * i));
+        }
+        return table;
+    }
+
+    static constexpr std::array<float, Points> TABLE = build();
+
+    public:
+        static constexpr float v_min() { return static_cast<float>(V_MIN); }
+        static constexpr float v_max() { return static_cast<float>(V_MAX); }
+        static constexpr bool in_range(float voltage) { return voltage >= v_min() && voltage <= v_max(); }
+
+        // Voltages outside [v_min, v_max] are clamped to MinC / MaxC; check in_range first
+        static constexpr float celsius(float voltage) {
+            float position = (voltage - v_min()) * static_cast<float>(1.0 / STEP);
+            if (!(position > 0.0f)) {
+                return TABLE[0];
+            }
+            if (position >= static_cast<float>(Points - 1)) {
+                return TABLE[Points - 1];
+            }
+            size_t i = static_cast<size_t>(position);
+            float fraction = position - static_cast<float>(i);
+            return TABLE[i] + (TABLE[i + 1] - TABLE[i]) * fraction;
+        }
+
+        // Worst deviation from the exact formula over [MinC, MaxC], in °C, probed at
+        // probes_per_segment points in every segment
+        static constexpr double max_error_c(size_t probes_per_segment = 16) {
+            double worst = 0.0;
+            for (size_t i = 0; i + 1 < Points; ++i) {
+                for (size_t k = 0; k <= probes_per_segment; ++k) {
+                    double voltage = V_MIN + STEP * (i + static_cast<double>(k) / probes_per_segment);
+                    double error = celsius(static_cast<float>(voltage)) - Model.celsius(voltage);
+                    error = error < 0.0 ? -error : error;
+                    worst = error > worst ? error : worst;
+                }
+            }
+            return worst;
+        }
+};
+
+#endif // THERMISTOR_HPP
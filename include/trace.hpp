@@ -0,0 +1,236 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "trace_events.hpp"
+#include "mpsc_ring.hpp"
+
+// Deferred-format trace log. The hot path records an event id, a timestamp and the raw
+// argument words into a lock-free ring; a low-priority task (or a host-side decoder,
+// see host/tools/trace_decode.cpp) does the printf work later. Events and their formats
+// are listed in trace_events.hpp. Use as
+//   TRACE(CONTROL_PID, tds, temp, level, pump, heater, dosing);
+// which checks the argument count and types against the format at compile time.
+// TRACE_ZONE(zone, event, args...) tags the record with the zone it is about.
+
+enum class TraceModule : uint8_t {
+    SENSORS,
+    STATE_MACHINE,
+    CONTROL,
+};
+static constexpr size_t TRACE_MODULE_COUNT = 3;
+
+enum class TraceEvent : uint16_t {
+#define TRACE_EVENT_ID(id, module, level, format) id,
+    TRACE_EVENTS(TRACE_EVENT_ID)
+#undef TRACE_EVENT_ID
+};
+
+struct TraceEventInfo {
+    TraceModule module;
+    esp_log_level_t level;
+    const char* format;
+};
+
+inline constexpr TraceEventInfo TRACE_EVENT_INFO[] = {
+#define TRACE_EVENT_INFO_ENTRY(id, module, level, format) { TraceModule::module, ESP_LOG_##level, format },
+    TRACE_EVENTS(TRACE_EVENT_INFO_ENTRY)
+#undef TRACE_EVENT_INFO_ENTRY
+};
+static constexpr size_t TRACE_EVENT_COUNT = sizeof(TRACE_EVENT_INFO) / sizeof(TRACE_EVENT_INFO[0]);
+
+static constexpr size_t TRACE_MAX_ARGS = 8;
+static constexpr size_t TRACE_CAPACITY = 128;   // Records; a power of two
+static constexpr uint8_t TRACE_NO_ZONE = 0xFF;  // Events about the whole controller
+
+// One event as recorded and as stored in a binary capture
+struct TraceRecord {
+    uint32_t timestamp_us;      // Low 32 bits of esp_timer_get_time(); readers unwrap
+    uint16_t event;
+    uint8_t argc;
+    uint8_t zone;               // Zone index, or TRACE_NO_ZONE
+    uint32_t args[TRACE_MAX_ARGS];  // Floats by bit pattern
+};
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord is the binary capture format");
+
+// Binary capture: this header, then TraceRecords back to back
+struct TraceCaptureHeader {
+    char magic[4];              // "HTRC"
+    uint16_t version;
+    uint16_t record_size;
+};
+static constexpr uint16_t TRACE_CAPTURE_VERSION = 2;
+// Capture marker for records lost to a full ring; args[0] holds the count
+static constexpr uint16_t TRACE_DROPPED_EVENT = 0xFFFF;
+
+// Where drained records go
+class TraceSink {
+    public:
+        virtual ~TraceSink() = default;
+        // dropped: records lost to a full ring since the previous call
+        virtual void write(const TraceRecord* records, size_t count, uint32_t dropped) = 0;
+};
+
+// Formats records as log lines, "I (1234) control: PID Control: ...", unwrapping timestamps
+class TextTraceSink : public TraceSink {
+    FILE* out_;
+    int64_t time_us_;
+    uint32_t last_timestamp_us_;
+
+    public:
+        explicit TextTraceSink(FILE* out);
+        void write(const TraceRecord* records, size_t count, uint32_t dropped) override;
+};
+
+// Writes a binary capture for trace_decode
+class BinaryTraceSink : public TraceSink {
+    FILE* out_;
+    bool header_written_;
+
+    public:
+        explicit BinaryTraceSink(FILE* out) : out_(out), header_written_(false) {}
+        void write(const TraceRecord* records, size_t count, uint32_t dropped) override;
+};
+
+// Multi-producer, single-consumer ring of TraceRecords with per-module verbosity.
+// Producers never block: when the ring is full the record is dropped and counted.
+class TraceLog {
+    MpscRing<TraceRecord, TRACE_CAPACITY> ring_;
+    std::atomic<uint8_t> levels_[TRACE_MODULE_COUNT];
+    TraceSink* sink_;
+    uint32_t drain_period_ms_;
+    TaskHandle_t drain_task_;
+
+    static void drain_task(void* arg);
+
+    public:
+        TraceLog();
+        bool enabled(TraceModule module, esp_log_level_t level) const {
+            return levels_[static_cast<size_t>(module)].load(std::memory_order_relaxed) >= level;
+        }
+        // Runtime verbosity of one module; ESP_LOG_NONE turns it off
+        void set_level(TraceModule module, esp_log_level_t level);
+        esp_log_level_t level(TraceModule module) const;
+        // Copies args into the next free slot; false if the ring was full
+        bool record(TraceEvent event, const uint32_t* args, size_t argc, uint8_t zone = TRACE_NO_ZONE);
+        // Consumer side: hands everything recorded so far to sink, returns the count
+        size_t drain(TraceSink& sink);
+        // Drains into sink every period_ms on a task of its own, at a priority below the loops it traces
+        esp_err_t start_drain(TraceSink& sink, UBaseType_t priority, uint32_t stack_size, uint32_t period_ms);
+        uint32_t dropped() const { return ring_.dropped(); }
+};
+
+// The log every TRACE() goes to
+TraceLog& trace_log();
+
+// Message of one record, without the level, time and module prefix but with the zone
+// ("zone 1: ..."); returns the length
+int trace_format(const TraceRecord& record, char* buffer, size_t size);
+const char* trace_module_name(TraceModule module);
+
+// Compile-time view of an event's format: its conversions in order
+constexpr bool trace_is_conversion(char c) {
+    for (const char* p = "diuxXfeEgGcsp"; *p != '\0'; ++p) {
+        if (*p == c) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr bool trace_is_float_conversion(char c) {
+    return c == 'f' || c == 'e' || c == 'E' || c == 'g' || c == 'G';
+}
+
+// The index-th conversion character of format, '\0' past the last one
+constexpr char trace_conversion(const char* format, size_t index) {
+    for (size_t i = 0; format[i] != '\0'; ++i) {
+        if (format[i] != '%') {
+            continue;
+        }
+        if (format[i + 1] == '%') {
+            ++i;
+            continue;
+        }
+        size_t j = i + 1;
+        while (format[j] != '\0' && !trace_is_conversion(format[j])) {
+            ++j;
+        }
+        if (index == 0) {
+            return format[j];
+        }
+        --index;
+        i = j;
+    }
+    return '\0';
+}
+
+constexpr size_t trace_conversion_count(const char* format) {
+    size_t count = 0;
+    while (trace_conversion(format, count) != '\0') {
+        ++count;
+    }
+    return count;
+}
+
+template <TraceEvent Event, typename... Args, size_t... I>
+constexpr bool trace_types_match(std::index_sequence<I...>) {
+    [[maybe_unused]] const char* format = TRACE_EVENT_INFO[static_cast<size_t>(Event)].format;
+    return (true && ... && (std::is_arithmetic_v<Args> && trace_conversion(format, I) != 's' &&
+                            trace_is_float_conversion(trace_conversion(format, I)) == std::is_floating_point_v<Args>));
+}
+
+template <typename T>
+inline uint32_t trace_word(T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+        float f = static_cast<float>(value);
+        uint32_t word;
+        std::memcpy(&word, &f, sizeof(word));
+        return word;
+    } else {
+        return static_cast<uint32_t>(value);
+    }
+}
+
+template <TraceEvent Event, typename... Args>
+inline void trace_emit(uint8_t zone, Args... args) {
+    constexpr TraceEventInfo info = TRACE_EVENT_INFO[static_cast<size_t>(Event)];
+    static_assert(sizeof...(Args) <= TRACE_MAX_ARGS, "too many trace arguments");
+    static_assert(sizeof...(Args) == trace_conversion_count(info.format), "argument count does not match the format");
+    static_assert(trace_types_match<Event, Args...>(std::index_sequence_for<Args...>()),
+                  "argument types do not match the format: floats for %f/%e/%g, integers otherwise");
+    uint32_t words[sizeof...(Args) > 0 ? sizeof...(Args) : 1] = { trace_word(args)... };
+    trace_log().record(Event, words, sizeof...(Args), zone);
+}
+
+template <TraceEvent Event>
+inline bool trace_enabled() {
+    constexpr TraceEventInfo info = TRACE_EVENT_INFO[static_cast<size_t>(Event)];
+    return trace_log().enabled(info.module, info.level);
+}
+
+// Like ESP_LOGx, the arguments are only evaluated when the event's module is verbose enough
+#define TRACE(event, ...) \
+    do { \
+        if (trace_enabled<TraceEvent::event>()) { \
+            trace_emit<TraceEvent::event>(TRACE_NO_ZONE __VA_OPT__(,) __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define TRACE_ZONE(zone, event, ...) \
+    do { \
+        if (trace_enabled<TraceEvent::event>()) { \
+            trace_emit<TraceEvent::event>(static_cast<uint8_t>(zone) __VA_OPT__(,) __VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif // TRACE_HPP
@@ -0,0 +1,24 @@
+#ifndef TRACE_EVENTS_HPP
+#define TRACE_EVENTS_HPP
+
+// Every trace event: X(id, module, level, format). Only the id and the raw arguments are
+// recorded; the format is applied when the record is drained or decoded on the host, so
+// ids must stay stable across firmware versions that share captures. One printf
+// conversion per argument: %f, %e and %g take a float, %d and %i an int32_t, %u and %x
+// a uint32_t (an l modifier is allowed, %s is not).
+#define TRACE_EVENTS(X) \
+    X(ACQUISITION, STATE_MACHINE, INFO, \
+      "TDS: %.2f±%.2f ppm, pH: %.2f±%.3f pH, Tem: %.2f±%.3f °C, Water-Level : %.2f±%.2f") \
+    X(CONTROL_WAITING, CONTROL, INFO, "Control: waiting for sensors to settle") \
+    X(CONTROL_ON_OFF, CONTROL, INFO, "On/Off Control: TDS=%.0f, Temp=%.2f, Level=%.1f -> pump=%.0f") \
+    X(CONTROL_PID, CONTROL, INFO, \
+      "PID Control: TDS=%.0f, Temp=%.2f, Level=%.1f -> pump=%.2f heater=%.2f dosing=%.2f") \
+    X(CONTROL_FUZZY, CONTROL, INFO, \
+      "Fuzzy Logic Control: TDS=%.0f, Temp=%.2f, pH=%.2f, Level=%.1f -> pump=%.2f heater=%.2f dosing=%.2f") \
+    X(TDS_READING, SENSORS, DEBUG, "TDS Sensor: Voltage=%.3fV, TDS=%.1f") \
+    X(NTC_READING, SENSORS, DEBUG, "NTC Sensor: Voltage=%.3fV, Temperature=%.2f°C") \
+    X(PH_READING, SENSORS, DEBUG, "PH Sensor: Voltage=%.3fV, pH_uncomp=%.3f") \
+    X(LEVEL_READING, SENSORS, DEBUG, "Ultrasonic Sensor: Distance=%.1f cm, age=%lu ms") \
+    X(LEVEL_STALE, SENSORS, DEBUG, "Ultrasonic Sensor: stale reading (%lu ms)")
+
+#endif // TRACE_EVENTS_HPP
@@ -1,30 +1,47 @@
 #ifndef UART_HPP
 #define UART_HPP
 
+#include <atomic>
 #include <cstdint>
-#include <vector>
-#include "driver/uart.h"
-#include "driver/gpio.h"
+#include "uart_driver.hpp"
+#include "sen0311.hpp"
+#include "metrics.hpp"
 
-constexpr size_t RX_BUFFER_SIZE = 128;
-constexpr int READ_TIMEOUT_MS = 100;
+// A listen that decodes no frame in this long ends anyway, so line noise or a sensor
+// sending malformed frames cannot keep the chip awake for good
+constexpr uint32_t UART_LISTEN_TIMEOUT_MS = 1000;
 
-struct UartConfig {
-    uart_port_t port;       // UART port (e.g., UART_NUM_2)
-    int tx_pin;             // TX GPIO
-    int rx_pin;             // RX GPIO
-    int baud_rate;          // Baud rate (e.g., 9600)
-};
-
-class Uart {
+// SEN0311 link: bytes from the driver's receive task go straight into the decoder
+class Uart : public UartListener {
+    UartDriver& driver_;
     UartConfig config_;
-    uint8_t* rx_buffer_;
-    void init();
+    Sen0311Parser sen0311_;
+    OpMetrics read_metrics_;    // read_sen0311_distance(); one reader task
+    std::atomic<bool> listening_;
+    uint32_t listen_frames_;    // Frames decoded when listen() was called
+    int64_t listen_until_us_;   // Listening ends then without a frame
+
+    void end_listen_after(int64_t now_us);
 
     public:
-        Uart(const UartConfig& config);
+        Uart(UartDriver& driver, const UartConfig& config);
         ~Uart();
-        bool read_sen0311_distance(float& distance_cm);
+        // Non-blocking: latest decoded distance and its age, false if no frame was received yet
+        bool read_sen0311_distance(float& distance_cm, uint32_t& age_ms);
+        Sen0311Stats sen0311_stats() const { return sen0311_.stats(); }
+        const OpMetrics& read_metrics() const { return read_metrics_; }
+        // Power-managed mode: keeps the link receiving until the next frame is decoded or
+        // UART_LISTEN_TIMEOUT_MS pass (see UartDriver::set_listening). One task; nothing
+        // while it is still listening.
+        esp_err_t listen();
+        bool listening() const { return listening_.load(std::memory_order_acquire); }
+
+        void on_data(const uint8_t* data, size_t length, int64_t now_us) override;
+        void on_idle() override;
+        void on_overflow() override {
+            sen0311_.reset();
+            sen0311_.on_overflow();
+        }
 };
 
-#endif // UART_HPP
\ No newline at end of file
+#endif // UART_HPP
@@ -0,0 +1,38 @@
+#ifndef UART_DRIVER_HPP
+#define UART_DRIVER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "hal/uart_types.h"
+
+struct UartConfig {
+    uart_port_t port;       // UART port (e.g., UART_NUM_2)
+    int tx_pin;             // TX GPIO
+    int rx_pin;             // RX GPIO
+    int baud_rate;          // Baud rate (e.g., 9600)
+};
+
+// Receives what the driver reads, called on the driver's receive task
+class UartListener {
+    public:
+        virtual ~UartListener() = default;
+        virtual void on_data(const uint8_t* data, size_t length, int64_t now_us) = 0;
+        virtual void on_idle() = 0;         // Nothing received for a receive interval
+        virtual void on_overflow() = 0;     // Input was lost and flushed
+};
+
+// Hardware side of Uart: the ESP-IDF UART driver on the device (EspUartDriver),
+// a simulated byte stream on the host
+class UartDriver {
+    public:
+        virtual ~UartDriver() = default;
+        virtual esp_err_t start(const UartConfig& config, UartListener& listener) = 0;
+        virtual void stop() = 0;
+        // Power-managed mode: while listening, received data wakes the chip from light sleep
+        // and keeps it awake until listening ends, so a streamed frame arrives whole.
+        // Otherwise the link may miss data while the chip sleeps.
+        virtual esp_err_t set_listening(bool listening) = 0;
+};
+
+#endif // UART_DRIVER_HPP
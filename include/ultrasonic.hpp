@@ -4,11 +4,20 @@
 #include "sensor.hpp"
 #include "uart.hpp"
 
+// Readings older than this are reported as a timeout (sensor unplugged or silent)
+constexpr uint32_t ULTRASONIC_STALE_MS = 1000;
+
+// Water level from the SEN0311 mounted above the tank looking down: tank height less the
+// distance to the surface, clamped to 0..tank height
 class Ultrasonic : public Sensor {
     Uart& uart_;
+    float tank_height_cm_;
+    uint32_t age_ms_;
     public:
-        Ultrasonic(Uart& uart);
+        Ultrasonic(Uart& uart, float tank_height_cm);
+        // Level in cm above the tank floor
         esp_err_t read(float& value) override;
+        uint32_t age_ms() const { return age_ms_; } // Age of the value returned by the last read()
 };
 
-#endif // ULTRASONIC_SENSOR_HPP
\ No newline at end of file
+#endif // ULTRASONIC_SENSOR_HPP
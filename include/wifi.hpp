@@ -0,0 +1,10 @@
+#ifndef WIFI_HPP
+#define WIFI_HPP
+
+#include "esp_err.h"
+
+// Brings up the station interface and keeps reconnecting in the background.
+// Requires nvs_flash_init() to have run. Does not wait for an IP address.
+esp_err_t wifi_start_station(const char* ssid, const char* password);
+
+#endif // WIFI_HPP
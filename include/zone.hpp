@@ -0,0 +1,156 @@
+#ifndef ZONE_HPP
+#define ZONE_HPP
+
+#include "adc.hpp"
+#include "uart.hpp"
+#include "sensor.hpp"
+#include "tds.hpp"
+#include "ntc.hpp"
+#include "ph.hpp"
+#include "ultrasonic.hpp"
+#include "sensor_board.hpp"
+#include "sensor_registry.hpp"
+#include "sensor_sampler.hpp"
+#include "pid.hpp"
+#include "fuzzy.hpp"
+#include "control_config.hpp"
+#include <array>
+#include <tuple>
+
+// ADC channels of one zone in order: TDS, NTC, pH
+static constexpr size_t ZONE_ADC_CHANNELS = 3;
+// Moving-average history per zone; the default windows use 26 samples
+static constexpr size_t ZONE_ADC_HISTORY_SAMPLES = 32;
+using AdcConfigs = std::array<AdcConfig, ZONE_ADC_CHANNELS>;
+
+// One ADC unit shared by Zones zones; zone i owns channels 3i..3i+2. ADC1 on the esp32c6
+// has 7 channels, so two zones per unit.
+template <size_t Zones>
+using ZoneAdc = StaticAdc<Zones * ZONE_ADC_CHANNELS, Zones * ZONE_ADC_HISTORY_SAMPLES>;
+using SensorAdc = ZoneAdc<1>;
+
+// Channel list of a ZoneAdc: each zone's channels back to back
+template <size_t Zones>
+std::array<AdcConfig, Zones * ZONE_ADC_CHANNELS> zone_adc_configs(const std::array<AdcConfigs, Zones>& zones) {
+    std::array<AdcConfig, Zones * ZONE_ADC_CHANNELS> configs{};
+    for (size_t z = 0; z < Zones; ++z) {
+        for (size_t c = 0; c < ZONE_ADC_CHANNELS; ++c) {
+            configs[z * ZONE_ADC_CHANNELS + c] = zones[z][c];
+        }
+    }
+    return configs;
+}
+
+// Channels and filters of the first zone, as main.cpp starts it; the host benches and
+// replay use the same. Windows count scan frames in continuous mode (~90 Hz per
+// channel). These only remove conversion noise and spikes; the per-sensor estimators
+// do the slow smoothing.
+inline AdcConfigs default_adc_configs() {
+    return {{
+        // TDS: median rejects electrode spikes
+        { ADC_CHANNEL_1, ADC_ATTEN_DB_6, { .type = FilterType::MOVING_AVERAGE, .window = 16,
+                                           .spike = SpikeFilter::MEDIAN } },
+        // NTC: slow signal, EMA is enough
+        { ADC_CHANNEL_2, ADC_ATTEN_DB_12, { .type = FilterType::EMA, .ema_alpha = 0.05f } },
+        // pH: tight window to keep response fast
+        { ADC_CHANNEL_3, ADC_ATTEN_DB_12, { .type = FilterType::MOVING_AVERAGE, .window = 10,
+                                            .spike = SpikeFilter::TRIMMED_MEAN } }
+    }};
+}
+
+// Actuator commands produced by the control stage, as duty 0..1
+struct ActuatorOutputs {
+    float pump;     // Fill pump
+    float heater;
+    float dosing;   // Nutrient dosing pump
+};
+
+static constexpr size_t ZONE_SENSORS = 4;
+// Samplers in order: TDS, NTC and pH on the ADC, then the water level on the SEN0311
+static constexpr size_t ZONE_LEVEL_SAMPLER = 3;
+static constexpr size_t ZONE_TASK_NAME_LEN = 16;
+
+// One tank: its sensor set on a shared ADC unit and its own SEN0311 link, the samplers
+// and registry behind them, and the control state the state machine drives every tick.
+// Zones share the drivers, the scheduler and the control task; a zone allocates nothing.
+class Zone {
+    const char* name_;
+    Adc& adc_;
+    Uart& uart_;
+    float tank_height_cm_;
+    SensorBoard board_;
+    std::tuple<TDS, NTC, PH, Ultrasonic> sensors_;
+    char sampler_names_[ZONE_SENSORS][ZONE_TASK_NAME_LEN];
+    std::array<SensorSampler, ZONE_SENSORS> samplers_;
+    SensorRegistry registry_;   // Raw board readings -> compensated values, in dependency order
+    std::array<SensorData, SensorData::TYPE_COUNT> sensor_data_; // Snapshot of registry_ taken by acquire()
+    bool inputs_ready_;         // Every sensor has reported a settled value
+    ControlMode mode_;
+    ControlMode active_mode_;   // Mode that produced outputs_
+    ActuatorOutputs outputs_;
+    Pid<ControlScalar> pump_pid_;
+    Pid<ControlScalar> heater_pid_;
+    Pid<ControlScalar> dosing_pid_;
+    float control_dt_s_;
+    // Copied from the latest ControlConfig by apply_config
+    float tds_threshold_;           // ppm
+    float temp_threshold_;          // °C
+    float water_level_threshold_;   // cm
+
+    void on_off_control(size_t index);
+    void pid_control(size_t index);
+    void fuzzy_logic_control(const FuzzyController& fuzzy, size_t index);
+
+    public:
+        // first_channel is the zone's TDS channel on adc; NTC and pH follow it
+        Zone(const char* name, Adc& adc, size_t first_channel, Uart& uart, float tank_height_cm);
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+        // Initial config and PID sample period; the state machine calls it once
+        void configure(const ControlConfig& config, float control_dt_s);
+        // Thresholds, gains and mode of a config update; control task only
+        void apply_config(const ControlConfig& config);
+        void start_samplers(UBaseType_t priority, uint32_t stack_size);
+        // TDS and pH curves stored under calibration_key() replace the built-in ones
+        void load_calibration(BlobStore& store);
+        // One read and publish of every sensor on the calling task
+        void sample_once();
+        // Power-managed mode, instead of start_samplers(): every sensor due by horizon_us
+        // read and published on the calling task (see SensorSampler::poll). Returns how many.
+        size_t sample_due(int64_t horizon_us);
+        // Deadline of the zone's next sample: of any sensor, of one on the ADC, of the level
+        int64_t next_sample_us() const;
+        int64_t next_adc_sample_us() const;
+        int64_t next_level_sample_us() const { return samplers_[ZONE_LEVEL_SAMPLER].next_sample_us(); }
+        // The SEN0311 link receives the next frame even if the chip sleeps (see Uart::listen)
+        esp_err_t listen_level() { return uart_.listen(); }
+
+        // This cycle's compensated values; true once every sensor has settled
+        bool acquire();
+        // One control decision on the last acquire(); index tags the trace events
+        void control(const FuzzyController& fuzzy, size_t index);
+        // Outputs off until the inputs are valid
+        void hold();
+
+        const char* name() const { return name_; }
+        float tank_height_cm() const { return tank_height_cm_; }
+        float control_dt_s() const { return control_dt_s_; }
+        bool ready() const { return inputs_ready_; }
+        const Adc& adc() const { return adc_; }
+        Adc& adc() { return adc_; }
+        const Uart& uart() const { return uart_; }
+        const std::array<SensorData, SensorData::TYPE_COUNT>& data() const { return sensor_data_; }
+        const SensorRegistry& registry() const { return registry_; }
+        const std::array<SensorSampler, ZONE_SENSORS>& samplers() const { return samplers_; }
+        // To run them without their tasks, as replay does
+        std::array<SensorSampler, ZONE_SENSORS>& samplers() { return samplers_; }
+        const ActuatorOutputs& outputs() const { return outputs_; }
+        // TDS and pH calibration; nullptr for the sensors that have none
+        Calibration* calibration(SensorData::Type type);
+        const Calibration* calibration(SensorData::Type type) const;
+        // "<zone>.tds" and "<zone>.ph"; false if the zone name makes it longer than BLOB_KEY_MAX
+        bool calibration_key(SensorData::Type type, char* key, size_t size) const;
+};
+
+#endif // ZONE_HPP
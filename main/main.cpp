@@ -1,17 +1,59 @@
+#include <stdio.h>
+
 #include "state_machine.hpp"
+#include "esp_adc_driver.hpp"
+#include "esp_uart_driver.hpp"
+#include "esp_actuator_driver.hpp"
+#include "driver/gpio.h"
+#include "telemetry.hpp"
+#include "history.hpp"
+#include "mqtt_transport.hpp"
+#include "partition_region.hpp"
+#include "wifi.hpp"
+#include "trace.hpp"
+#include "console.hpp"
+#include "recording_driver.hpp"
+#include "nvs_blob_store.hpp"
+#include "esp_power_driver.hpp"
 #include "esp_log.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char* TAG = "sensor_reader";
 
-void state_machine_task(void* pvParameters) {
-    std::vector<AdcConfig> adc_configs = {
-        { ADC_CHANNEL_1, ADC_ATTEN_DB_6 },
-        { ADC_CHANNEL_2, ADC_ATTEN_DB_12 },
-        { ADC_CHANNEL_3, ADC_ATTEN_DB_12 }
-    };
+#define DEVICE_TOPIC(suffix) "hydroponics/" CONFIG_HYDRO_DEVICE_ID suffix
+
+#if CONFIG_HYDRO_POWER_SAVE
+// Every drain wakes the chip, and the sensors are read far less often than the 10 Hz cycle
+static constexpr uint32_t TRACE_DRAIN_MS = 500;
+// The state task also reads the sensors, ADC re-prime burst included, which the sampler
+// tasks do on 3 KB stacks otherwise; "power" shows how much of it was never used
+static constexpr uint32_t STATE_TASK_STACK = 4096 + 3072;
+#else
+static constexpr uint32_t TRACE_DRAIN_MS = 50;
+static constexpr uint32_t STATE_TASK_STACK = 4096;
+#endif
+
+struct ConfigChannel {
+    StateMachine* state_machine;
+    TelemetryTransport* transport;
+};
 
+// Runs on the MQTT task: parse, validate and hand over, then report the outcome
+static void on_config_message(void* arg, const char* topic, const uint8_t* data, size_t length) {
+    ConfigChannel* channel = static_cast<ConfigChannel*>(arg);
+    uint32_t version = 0;
+    esp_err_t ret = channel->state_machine->update_config(reinterpret_cast<const char*>(data), length, &version);
+    char reply[64];
+    int reply_length = ret == ESP_OK
+        ? snprintf(reply, sizeof(reply), "{\"result\":\"ok\",\"version\":%lu}", version)
+        : snprintf(reply, sizeof(reply), "{\"result\":\"%s\"}", esp_err_to_name(ret));
+    channel->transport->publish(DEVICE_TOPIC("/config/status"), reinterpret_cast<const uint8_t*>(reply), reply_length);
+}
+
+void state_machine_task(void* pvParameters) {
     UartConfig uart_config = {
         .port = UART_NUM_1,
         .tx_pin = GPIO_NUM_16,
@@ -19,11 +61,128 @@ void state_machine_task(void* pvParameters) {
         .baud_rate = 9600
     };
 
+    // Static storage: the zones, the state machine and the telemetry buffers are sized at
+    // compile time and far larger than this task's stack. Another tank is one more Zone on
+    // the free ADC1 channels (a ZoneAdc<2> with zone_adc_configs) and its own UART.
     const float TANK_HEIGHT_CM = 100.0f;
-    StateMachine state_machine(adc_configs, uart_config, TANK_HEIGHT_CM);
+    // ADC calibration curves and the TDS and pH calibrations taken with "cal"
+    static NvsBlobStore calibration_store("calibration");
+    static EspAdcDriver esp_adc_driver(ADC_UNIT_1, &calibration_store);
+    static EspUartDriver esp_uart_driver;
+#if CONFIG_HYDRO_CAPTURE_CONSOLE || CONFIG_HYDRO_CAPTURE_FLASH
+    // Everything the drivers hand over, for host/build/replay
+    static Capture capture;
+    static RecordingAdcDriver adc_driver(esp_adc_driver, capture);
+    static RecordingUartDriver uart_driver(esp_uart_driver, capture);
+#else
+    AdcDriver& adc_driver = esp_adc_driver;
+    UartDriver& uart_driver = esp_uart_driver;
+#endif
+    static SensorAdc adc(adc_driver, default_adc_configs(), AdcMode::CONTINUOUS);
+    static Uart level_link(uart_driver, uart_config);
+    static Zone tank("tank1", adc, 0, level_link, TANK_HEIGHT_CM);
+    tank.load_calibration(calibration_store);
+
+    // Started before the state machine primes the ADC, so replay sees the same start
+#if CONFIG_HYDRO_CAPTURE_CONSOLE
+    static FileCaptureSink capture_sink(stdout);
+    capture.start(capture_sink);
+#elif CONFIG_HYDRO_CAPTURE_FLASH
+    static PartitionRegion capture_region("capture");
+    static FlashRing capture_ring(capture_region);
+    static FlashCaptureSink capture_sink(capture_ring);
+    if (capture_region.valid() && capture_ring.mount() == ESP_OK) {
+        capture.start(capture_sink);
+    }
+#endif
+#if CONFIG_HYDRO_CAPTURE_CONSOLE || CONFIG_HYDRO_CAPTURE_FLASH
+    capture.start_drain(2, 4096, 200);
+#endif
+    static StateMachine state_machine(tank);
+
+    // Trends on the device: raw rows for about 20 minutes, minutes for 2 h, hours for 2 days,
+    // and completed raw chunks kept in the history partition
+    static ZoneHistory<1> history;
+    static PartitionRegion history_region("history");
+    static FlashRing history_ring(history_region);
+    if (history_region.valid() && history_ring.mount() == ESP_OK) {
+        history.set_archive(&history_ring);
+    }
+    state_machine.set_history(&history);
+
+    // Fill pump on PWM with a soft start, heater relay switched in 10 s windows, dosing pump
+    // in doses with a minute for mixing after each and at most a minute of dosing per hour
+    static const ActuatorConfig actuator_configs[ZONE_ACTUATORS] = {
+        { .name = "pump", .pin = { .gpio = 18, .pwm = true, .active_low = false }, .kind = ActuatorKind::DUTY,
+          .min_on_ms = 2000, .min_off_ms = 5000, .max_slew_per_s = 0.5f },
+        { .name = "heater", .pin = { .gpio = 19, .pwm = false, .active_low = false },
+          .kind = ActuatorKind::TIME_PROPORTIONAL, .min_on_ms = 1000, .min_off_ms = 1000, .window_ms = 10000 },
+        { .name = "dosing", .pin = { .gpio = 20, .pwm = false, .active_low = false }, .kind = ActuatorKind::PULSE,
+          .min_off_ms = 60000, .full_dose_ms = 2000, .max_on_ms_per_hour = 60000 },
+    };
+    static EspActuatorDriver actuator_driver;
+    static ActuatorEngine actuators(actuator_driver);
+    if (actuators.start(actuator_configs, ZONE_ACTUATORS) == ESP_OK) {
+        state_machine.set_actuators(&actuators);
+    }
+
+    // Live dashboard in the browser; its task sleeps in select() until someone connects
+#if CONFIG_HYDRO_DASHBOARD_PORT > 0
+    static StaticDashboard<4> dashboard;
+    state_machine.set_dashboard(&dashboard);
+    dashboard.start(CONFIG_HYDRO_DASHBOARD_PORT, 3, 4096);
+#endif
+
+    // Telemetry: one MQTT message per 30 one-second samples, spilled to flash while offline
+    static EspMqttTransport transport(CONFIG_HYDRO_MQTT_BROKER_URI, CONFIG_HYDRO_DEVICE_ID);
+    static PartitionRegion region("telemetry");
+    static FlashRing spill(region);
+    bool spill_ok = region.valid() && spill.mount() == ESP_OK;
+    TelemetryConfig telemetry_config;
+    telemetry_config.topic = DEVICE_TOPIC("/telemetry");
+    telemetry_config.metrics_topic = DEVICE_TOPIC("/metrics");
+    static TelemetryPublisher telemetry(transport, spill_ok ? &spill : nullptr, telemetry_config);
+
+    // Thresholds, PID gains and control mode, e.g. {"mode": "pid", "temp_threshold": 24}
+    static ConfigChannel config_channel = { &state_machine, &transport };
+    transport.subscribe(DEVICE_TOPIC("/config"), on_config_message, &config_channel);
+    if (transport.start() == ESP_OK) {
+        state_machine.set_telemetry(&telemetry);
+    }
+
+    // Battery or solar: sampling and control on this task between light sleeps
+#if CONFIG_HYDRO_POWER_SAVE
+    static EspPowerDriver power_driver;
+    static PowerManager power(power_driver);
+    PowerConfig power_config;
+    power_config.coalesce_ms = CONFIG_HYDRO_POWER_COALESCE_MS;
+    if (power.start(power_config) == ESP_OK) {
+        state_machine.set_power(&power);
+    }
+#endif
+
+    // "metrics" on the serial console shows which sensor is slow or failing, "cal" calibrates,
+    // "history" shows trends, "dashboard" lists the browsers connected, "power" shows how
+    // long the chip sleeps
+    console_start(state_machine, &calibration_store);
     state_machine.run();
 }
 extern "C" void app_main() {
     ESP_LOGI(TAG, "Starting sensor reader with state machine...");
-    xTaskCreate(state_machine_task, "state_machine_task", 4096, NULL, 5, NULL);
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    wifi_start_station(CONFIG_HYDRO_WIFI_SSID, CONFIG_HYDRO_WIFI_PASSWORD);
+
+    // Per-cycle logs go through the trace ring; only this task, just above idle, formats them
+#if CONFIG_HYDRO_TRACE_BINARY
+    static BinaryTraceSink trace_sink(stdout);
+#else
+    static TextTraceSink trace_sink(stdout);
+#endif
+    trace_log().start_drain(trace_sink, 1, 4096, TRACE_DRAIN_MS);
+    xTaskCreate(state_machine_task, "state_machine_task", STATE_TASK_STACK, NULL, 5, NULL);
 }
\ No newline at end of file
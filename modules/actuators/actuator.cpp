@@ -0,0 +1,213 @@
+#include "actuator.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "actuator";
+
+static constexpr int64_t NEVER = INT64_MAX;
+static constexpr int64_t US_PER_HOUR = 3600LL * 1000 * 1000;
+// Passes while a duty is slewing toward its target
+static constexpr int64_t SLEW_STEP_US = 20000;
+// Next look at an output the rate limit holds down
+static constexpr int64_t LIMITED_RETRY_US = 1000000;
+
+ActuatorEngine::ActuatorEngine(ActuatorDriver& driver)
+    : driver_(driver), channels_{}, channel_count_(0), late_us_(), deadline_us_(NEVER), started_(false) {
+}
+
+esp_err_t ActuatorEngine::start(const ActuatorConfig* configs, size_t count) {
+    if (count > ACTUATOR_MAX_CHANNELS) {
+        ESP_LOGE(TAG, "%d actuators exceed the limit of %d", count, ACTUATOR_MAX_CHANNELS);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ActuatorPin pins[ACTUATOR_MAX_CHANNELS];
+    int64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < count; ++i) {
+        Channel& channel = channels_[i];
+        channel = {};
+        channel.config = configs[i];
+        channel.updated_us = now_us;
+        channel.window_start_us = now_us;
+        // Off since long ago: the first switch on is not held by min_off_ms
+        channel.changed_us = now_us - static_cast<int64_t>(configs[i].min_off_ms) * 1000;
+        channel.budget_ms = configs[i].max_on_ms_per_hour;
+        pins[i] = configs[i].pin;
+    }
+    channel_count_ = count;
+    esp_err_t ret = driver_.init(pins, count, *this);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Actuator driver init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    started_ = true;
+    for (size_t i = 0; i < count; ++i) {
+        ESP_LOGI(TAG, "%-10s GPIO%d %s, min on/off %lu/%lu ms, limit %lu ms/h", configs[i].name, configs[i].pin.gpio,
+                 configs[i].kind == ActuatorKind::DUTY ? "PWM" :
+                 configs[i].kind == ActuatorKind::PULSE ? "doses" : "time-proportional",
+                 configs[i].min_on_ms, configs[i].min_off_ms, configs[i].max_on_ms_per_hour);
+    }
+    return ESP_OK;
+}
+
+bool ActuatorEngine::submit(const ActuatorCommand& command) {
+    bool queued = queue_.push([&](ActuatorCommand& slot) { slot = command; });
+    if (queued && started_) {
+        driver_.wake_now();
+    }
+    return queued;
+}
+
+void ActuatorEngine::apply(const ActuatorCommand& command) {
+    if (command.channel >= channel_count_) {
+        return;
+    }
+    Channel& channel = channels_[command.channel];
+    channel.stats.commands++;
+    bool dosing = channel.config.kind == ActuatorKind::PULSE;
+    if (command.type == ActuatorCommandType::DOSE && dosing) {
+        channel.pending_ms = command.dose_ms;
+    } else if (command.type == ActuatorCommandType::DUTY && !dosing && command.duty == command.duty) {
+        channel.target = command.duty < 0.0f ? 0.0f : (command.duty > 1.0f ? 1.0f : command.duty);
+    } else {
+        channel.stats.rejected++;
+    }
+}
+
+int64_t ActuatorEngine::service(int64_t now_us) {
+    ActuatorCommand command;
+    while (queue_.pop(command)) {
+        apply(command);
+    }
+    int64_t next_us = NEVER;
+    for (size_t i = 0; i < channel_count_; ++i) {
+        int64_t due_us = update(i, now_us);
+        next_us = due_us < next_us ? due_us : next_us;
+        published_[i].store(channels_[i].stats);
+    }
+    return next_us;
+}
+
+int64_t ActuatorEngine::update(size_t index, int64_t now_us) {
+    Channel& channel = channels_[index];
+    const ActuatorConfig& config = channel.config;
+    int64_t elapsed_us = now_us - channel.updated_us;
+    elapsed_us = elapsed_us < 0 ? 0 : elapsed_us;
+    channel.updated_us = now_us;
+    channel.stats.on_us += static_cast<uint64_t>(channel.duty * elapsed_us);
+
+    // Rate limit: what was on since the last pass is spent, the budget refills evenly
+    bool limited = config.max_on_ms_per_hour > 0;
+    double refill_per_us = limited ? static_cast<double>(config.max_on_ms_per_hour) / US_PER_HOUR : 0.0;
+    if (limited) {
+        channel.budget_ms += elapsed_us * (refill_per_us - channel.duty / 1000.0);
+        if (channel.budget_ms > config.max_on_ms_per_hour) {
+            channel.budget_ms = config.max_on_ms_per_hour;
+        }
+    }
+
+    float want = 0.0f;
+    int64_t next_us = NEVER;
+    switch (config.kind) {
+        case ActuatorKind::DUTY:
+            want = channel.target;
+            break;
+        case ActuatorKind::TIME_PROPORTIONAL: {
+            const int64_t window_us = static_cast<int64_t>(config.window_ms) * 1000;
+            if (now_us - channel.window_start_us >= window_us) {
+                channel.window_start_us += (now_us - channel.window_start_us) / window_us * window_us;
+            }
+            int64_t on_until_us = channel.window_start_us + static_cast<int64_t>(channel.target * window_us);
+            want = now_us < on_until_us ? 1.0f : 0.0f;
+            if (channel.target > 0.0f && channel.target < 1.0f) {
+                next_us = want > 0.0f ? on_until_us : channel.window_start_us + window_us;
+            }
+            break;
+        }
+        case ActuatorKind::PULSE:
+            if (channel.dose_end_us != 0) {
+                if (now_us < channel.dose_end_us) {
+                    return channel.dose_end_us;     // Running; nothing else can change it
+                }
+                driver_.set(index, 0.0f);
+                channel.duty = 0.0f;
+                channel.changed_us = now_us;
+                channel.dose_end_us = 0;
+                channel.stats.doses++;
+                channel.stats.dosed_us += static_cast<uint64_t>(now_us - channel.dose_start_us);
+            }
+            want = channel.pending_ms > 0 ? 1.0f : 0.0f;
+            break;
+    }
+
+    if (limited && want > 0.0f) {
+        // A dose needs its whole duration in the budget; a duty output needs some left
+        double needed_ms = config.kind == ActuatorKind::PULSE ? channel.pending_ms : 0.0;
+        if (needed_ms > config.max_on_ms_per_hour) {
+            needed_ms = config.max_on_ms_per_hour;
+            channel.pending_ms = config.max_on_ms_per_hour;
+        }
+        if (channel.budget_ms <= needed_ms) {
+            if (channel.duty > 0.0f || config.kind == ActuatorKind::PULSE) {
+                channel.stats.limited++;
+            }
+            int64_t refill_us = needed_ms > 0.0 ? static_cast<int64_t>((needed_ms - channel.budget_ms) / refill_per_us) + 1
+                                                 : LIMITED_RETRY_US;
+            want = 0.0f;
+            next_us = now_us + refill_us;
+        }
+    }
+
+    // Minimum on and off times; a dose ends when it is due whatever min_on_ms says
+    bool on = channel.duty > 0.0f;
+    if ((want > 0.0f) != on) {
+        uint32_t hold_ms = on ? config.min_on_ms : config.min_off_ms;
+        int64_t held_until_us = channel.changed_us + static_cast<int64_t>(hold_ms) * 1000;
+        if (now_us < held_until_us) {
+            channel.stats.held++;
+            return held_until_us < next_us ? held_until_us : next_us;
+        }
+    }
+
+    if (config.kind == ActuatorKind::DUTY && config.max_slew_per_s > 0.0f && on && want > 0.0f) {
+        float step = config.max_slew_per_s * elapsed_us / 1e6f;
+        if (want > channel.duty + step || want < channel.duty - step) {
+            want = want > channel.duty ? channel.duty + step : channel.duty - step;
+            next_us = now_us + SLEW_STEP_US;
+        }
+    } else if (config.kind == ActuatorKind::DUTY && config.max_slew_per_s > 0.0f && !on && want > 0.0f) {
+        // Soft start from the lowest step
+        float step = config.max_slew_per_s * SLEW_STEP_US / 1e6f;
+        if (want > step) {
+            want = step;
+            next_us = now_us + SLEW_STEP_US;
+        }
+    }
+
+    if (config.kind == ActuatorKind::PULSE && want > 0.0f) {
+        channel.dose_start_us = now_us;
+        channel.dose_end_us = now_us + static_cast<int64_t>(channel.pending_ms) * 1000;
+        channel.pending_ms = 0;
+        next_us = channel.dose_end_us;
+    }
+    if (want != channel.duty) {
+        if ((want > 0.0f) != on) {
+            channel.changed_us = now_us;
+            channel.stats.switches += on ? 0 : 1;
+        }
+        driver_.set(index, want);
+        channel.duty = want;
+    }
+    channel.stats.duty = channel.duty;
+    channel.stats.target = config.kind == ActuatorKind::PULSE ? 0.0f : channel.target;
+    channel.stats.pending_ms = channel.pending_ms;
+    return next_us;
+}
+
+void ActuatorEngine::on_timer() {
+    int64_t now_us = esp_timer_get_time();
+    if (deadline_us_ != NEVER && now_us >= deadline_us_) {
+        late_us_.record(static_cast<uint32_t>(now_us - deadline_us_));
+    }
+    deadline_us_ = service(now_us);
+    driver_.wake_at(deadline_us_);
+}
@@ -0,0 +1,156 @@
+#include "esp_actuator_driver.hpp"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+static const char* TAG = "actuator_driver";
+
+static constexpr ledc_mode_t PWM_MODE = LEDC_LOW_SPEED_MODE;
+static constexpr ledc_timer_t PWM_TIMER = LEDC_TIMER_0;
+static constexpr ledc_timer_bit_t PWM_RESOLUTION = LEDC_TIMER_10_BIT;
+static constexpr uint32_t PWM_MAX_DUTY = (1u << 10) - 1;
+
+EspActuatorDriver::EspActuatorDriver()
+    : pins_{}, ledc_channel_{}, channels_(0), listener_(nullptr), deadline_timer_(nullptr), wake_timer_(nullptr),
+      pwm_lock_(nullptr), pwm_running_(0) {
+}
+
+EspActuatorDriver::~EspActuatorDriver() {
+    esp_timer_handle_t timers[] = { deadline_timer_, wake_timer_ };
+    for (esp_timer_handle_t timer : timers) {
+        if (timer) {
+            esp_timer_stop(timer);
+            esp_timer_delete(timer);
+        }
+    }
+    if (pwm_lock_) {
+        if (pwm_running_) {
+            esp_pm_lock_release(pwm_lock_);
+        }
+        esp_pm_lock_delete(pwm_lock_);
+    }
+}
+
+void EspActuatorDriver::on_timer(void* arg) {
+    static_cast<EspActuatorDriver*>(arg)->listener_->on_timer();
+}
+
+esp_err_t EspActuatorDriver::init(const ActuatorPin* pins, size_t count, ActuatorTimerListener& listener) {
+    if (count > ACTUATOR_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    listener_ = &listener;
+    bool any_pwm = false;
+    for (size_t i = 0; i < count; ++i) {
+        any_pwm = any_pwm || pins[i].pwm;
+    }
+    if (any_pwm) {
+        ledc_timer_config_t timer_config = {};
+        timer_config.speed_mode = PWM_MODE;
+        timer_config.duty_resolution = PWM_RESOLUTION;
+        timer_config.timer_num = PWM_TIMER;
+        timer_config.freq_hz = ACTUATOR_PWM_HZ;
+        timer_config.clk_cfg = LEDC_AUTO_CLK;
+        esp_err_t ret = ledc_timer_config(&timer_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC timer: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    int next_ledc = 0;
+    for (size_t i = 0; i < count; ++i) {
+        pins_[i] = pins[i];
+        ledc_channel_[i] = -1;
+        esp_err_t ret;
+        if (pins[i].pwm) {
+            if (next_ledc >= SOC_LEDC_CHANNEL_NUM) {
+                ESP_LOGE(TAG, "GPIO%d: all %d LEDC channels in use", pins[i].gpio, SOC_LEDC_CHANNEL_NUM);
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            ledc_channel_config_t channel_config = {};
+            channel_config.gpio_num = pins[i].gpio;
+            channel_config.speed_mode = PWM_MODE;
+            channel_config.channel = static_cast<ledc_channel_t>(next_ledc);
+            channel_config.timer_sel = PWM_TIMER;
+            channel_config.duty = 0;
+            channel_config.flags.output_invert = pins[i].active_low ? 1 : 0;
+            ret = ledc_channel_config(&channel_config);
+            ledc_channel_[i] = next_ledc++;
+        } else {
+            gpio_config_t gpio = {};
+            gpio.pin_bit_mask = 1ULL << pins[i].gpio;
+            gpio.mode = GPIO_MODE_OUTPUT;
+            // Inactive level before the pin becomes an output
+            gpio_set_level(static_cast<gpio_num_t>(pins[i].gpio), pins[i].active_low ? 1 : 0);
+            ret = gpio_config(&gpio);
+#if CONFIG_PM_ENABLE
+            // Otherwise light sleep switches the pin to its sleep configuration, an input
+            if (ret == ESP_OK) {
+                ret = gpio_sleep_sel_dis(static_cast<gpio_num_t>(pins[i].gpio));
+            }
+#endif
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "GPIO%d: %s", pins[i].gpio, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    channels_ = count;
+#if CONFIG_PM_ENABLE
+    if (any_pwm) {
+        ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "actuator_pwm", &pwm_lock_));
+    }
+#endif
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_timer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "actuator_deadline";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &deadline_timer_));
+    timer_args.name = "actuator_wake";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &wake_timer_));
+    return ESP_OK;
+}
+
+esp_err_t EspActuatorDriver::set(size_t channel, float duty) {
+    if (channel >= channels_) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const ActuatorPin& pin = pins_[channel];
+    if (ledc_channel_[channel] < 0) {
+        bool on = duty > 0.0f;
+        return gpio_set_level(static_cast<gpio_num_t>(pin.gpio), on != pin.active_low ? 1 : 0);
+    }
+    if (pwm_lock_) {
+        uint32_t running = duty > 0.0f ? pwm_running_ | (1u << channel) : pwm_running_ & ~(1u << channel);
+        if (running && !pwm_running_) {
+            esp_pm_lock_acquire(pwm_lock_);
+        } else if (!running && pwm_running_) {
+            esp_pm_lock_release(pwm_lock_);
+        }
+        pwm_running_ = running;
+    }
+    ledc_channel_t ledc = static_cast<ledc_channel_t>(ledc_channel_[channel]);
+    uint32_t counts = static_cast<uint32_t>(duty * PWM_MAX_DUTY + 0.5f);
+    esp_err_t ret = ledc_set_duty(PWM_MODE, ledc, counts > PWM_MAX_DUTY ? PWM_MAX_DUTY : counts);
+    return ret == ESP_OK ? ledc_update_duty(PWM_MODE, ledc) : ret;
+}
+
+esp_err_t EspActuatorDriver::wake_at(int64_t time_us) {
+    esp_timer_stop(deadline_timer_);   // ESP_ERR_INVALID_STATE if it was not armed
+    if (time_us == INT64_MAX) {
+        return ESP_OK;
+    }
+    int64_t delay_us = time_us - esp_timer_get_time();
+    return esp_timer_start_once(deadline_timer_, delay_us > 0 ? static_cast<uint64_t>(delay_us) : 0);
+}
+
+esp_err_t EspActuatorDriver::wake_now() {
+    // Already armed means a pass is coming anyway
+    esp_err_t ret = esp_timer_start_once(wake_timer_, 0);
+    return ret == ESP_ERR_INVALID_STATE ? ESP_OK : ret;
+}
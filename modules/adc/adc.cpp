@@ -4,140 +4,256 @@
 
 #include "adc.hpp"
 #include "esp_log.h"
-#include "esp_adc/adc_cali_scheme.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 static const char* TAG = "adc";
 
-Adc::Adc(const std::vector<AdcConfig_t>& configs)
-    : handle_(nullptr),
-      configs_(configs),
-      cali_handles_(configs.size(), nullptr),
-      do_calibration_(configs.size(), false),
-      voltage_history_(configs.size(), std::vector<float>(MOVING_AVG_WINDOW, 0.0f)),
-      voltage_history_index_(configs.size(), 0),
-      reference_voltages_(configs.size()) {
-    if (configs.empty()) {
-        ESP_LOGE(TAG, "No ADC configurations provided");
-        return;
-    }
-    for (size_t i = 0; i < configs.size(); ++i) {
-        reference_voltages_[i] = configs[i].atten == ADC_ATTEN_DB_6 ? 2.15f : 3.3f;
+Adc::Adc(AdcDriver& driver, const AdcStorage& storage, const AdcConfig_t* configs, AdcMode mode,
+         const AdcContinuousConfig& cont_config)
+    : driver_(driver),
+      mode_(mode),
+      cont_config_(cont_config),
+      storage_(storage),
+      suspended_(false),
+      rearm_(false) {
+    // Hand each moving average its slice of the history pool, in channel order
+    size_t history_used = 0;
+    for (size_t i = 0; i < storage_.channels; ++i) {
+        storage_.configs[i] = configs[i];
+        storage_.reference_voltages[i] = configs[i].atten == ADC_ATTEN_DB_6 ? 2.15f : 3.3f;
+        size_t window = 0;
+        if (configs[i].filter.type == FilterType::MOVING_AVERAGE) {
+            window = configs[i].filter.window > 0 ? configs[i].filter.window : 1;
+        }
+        size_t available = storage_.history_size - history_used;
+        if (window > available) {
+            ESP_LOGW(TAG, "Channel %d: window %d exceeds the %d history samples left", i, window, available);
+            window = available;
+        }
+        storage_.filters[i].configure(configs[i].filter, storage_.history + history_used, window);
+        history_used += window;
+        storage_.latest[i].store({ 0.0f, ESP_ERR_NOT_FINISHED });
+        storage_.primed[i] = false;
     }
     init();
 }
 
 Adc::~Adc() {
-    if (handle_) {
-        adc_oneshot_del_unit(handle_);
-    }
-    for (size_t i = 0; i < cali_handles_.size(); ++i) {
-        if (do_calibration_[i]) {
-            ESP_LOGI(TAG, "Deregister calibration for channel %d", configs_[i].channel);
-            #if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-                adc_cali_delete_scheme_curve_fitting(cali_handles_[i]);
-            #elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-                adc_cali_delete_scheme_line_fitting(cali_handles_[i]);
-            #endif
-        }
+    if (mode_ == AdcMode::CONTINUOUS) {
+        driver_.stop_continuous();
     }
 }
 
 void Adc::init() {
-    if (configs_.empty()) {
-        ESP_LOGE(TAG, "Cannot initialize ADC: No channels configured");
-        return;
-    }
-
-    // Initialize ADC unit
-    adc_oneshot_unit_init_cfg_t init_cfg = {
-        .unit_id = ADC_UNIT_1,
-        .clk_src = ADC_DIGI_CLK_SRC_DEFAULT,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_cfg, &handle_));
-
-    // Configure channels and initialize calibration
-    adc_oneshot_chan_cfg_t chan_cfg = {
-        .bitwidth = ADC_BITWIDTH_12,
-    };
-    for (size_t i = 0; i < configs_.size(); ++i) {
-        chan_cfg.atten = configs_[i].atten;
-        ESP_ERROR_CHECK(adc_oneshot_config_channel(handle_, configs_[i].channel, &chan_cfg));
-
-        // Initialize calibration
-        #if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-        adc_cali_curve_fitting_config_t cali_config = {
-            .unit_id = ADC_UNIT_1,
-            .chan = configs_[i].channel,
-            .atten = configs_[i].atten,
-            .bitwidth = ADC_BITWIDTH_12,
-        };
-        if (adc_cali_create_scheme_curve_fitting(&cali_config, &cali_handles_[i]) == ESP_OK) {
-            do_calibration_[i] = true;
-            ESP_LOGI(TAG, "Calibration (Curve Fitting) enabled for channel %d", configs_[i].channel);
+    ESP_ERROR_CHECK(driver_.init(storage_.configs, storage_.channels));
+
+    if (mode_ == AdcMode::CONTINUOUS) {
+        esp_err_t ret = driver_.start_continuous(cont_config_, *this);
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "ADC initialized for %d channels (continuous, %lu Hz)",
+                     storage_.channels, cont_config_.sample_freq_hz);
+            return;
         }
-        #elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-        adc_cali_line_fitting_config_t cali_config = {
-            .unit_id = ADC_UNIT_1,
-            .atten = configs_[i].atten,
-            .bitwidth = ADC_BITWIDTH_12,
-        };
-        if (adc_cali_create_scheme_line_fitting(&cali_config, &cali_handles_[i]) == ESP_OK) {
-            do_calibration_[i] = true;
-            ESP_LOGI(TAG, "Calibration (Line Fitting) enabled for channel %d", configs_[i].channel);
+        ESP_LOGW(TAG, "Continuous ADC unavailable (%s), falling back to oneshot", esp_err_to_name(ret));
+        driver_.stop_continuous();
+        mode_ = AdcMode::ONESHOT;
+    }
+
+    ESP_ERROR_CHECK(driver_.start_oneshot());
+    ESP_LOGI(TAG, "ADC initialized for %d channels (oneshot)", storage_.channels);
+}
+
+esp_err_t Adc::read(size_t channel_idx, float& voltage) {
+    if (channel_idx >= storage_.channels) {
+        ESP_LOGE(TAG, "Invalid channel index: %d", channel_idx);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret;
+    if (mode_ == AdcMode::CONTINUOUS) {
+        // Never blocks: the scan task keeps the latest filtered value up to date
+        AdcReading latest = storage_.latest[channel_idx].load();
+        ret = latest.status;
+        voltage = latest.voltage;
+    } else {
+        ret = read_oneshot(channel_idx, voltage);
+    }
+    storage_.metrics[channel_idx].record(ret, static_cast<uint32_t>(esp_timer_get_time() - start_us));
+    return ret;
+}
+
+esp_err_t Adc::prime(uint32_t timeout_ms) {
+    int64_t start_us = esp_timer_get_time();
+    if (mode_ == AdcMode::ONESHOT) {
+        for (size_t i = 0; i < storage_.channels; ++i) {
+            float voltage = 0.0f;
+            esp_err_t ret = prime_oneshot(i, voltage);
+            if (ret != ESP_OK) {
+                return ret;
+            }
         }
-        #endif
-        if (!do_calibration_[i]) {
-            ESP_LOGW(TAG, "Calibration not supported for channel %d, using raw ADC", configs_[i].channel);
+    } else {
+        // The scan task primes each filter from its channel's first frame
+        esp_err_t ret = wait_frames(timeout_ms);
+        if (ret != ESP_OK) {
+            return ret;
         }
     }
-
-    ESP_LOGI(TAG, "ADC initialized for %d channels", configs_.size());
+    ESP_LOGI(TAG, "ADC primed in %lld us", esp_timer_get_time() - start_us);
+    return ESP_OK;
 }
 
-float Adc::compute_moving_average(float new_voltage, size_t channel_idx) {
-    voltage_history_[channel_idx][voltage_history_index_[channel_idx]] = new_voltage;
-    voltage_history_index_[channel_idx] = (voltage_history_index_[channel_idx] + 1) % MOVING_AVG_WINDOW;
-    float sum = 0;
-    for (int i = 0; i < MOVING_AVG_WINDOW; i++) {
-        sum += voltage_history_[channel_idx][i];
+esp_err_t Adc::wait_frames(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    size_t pending = storage_.channels;
+    while (pending > 0) {
+        pending = 0;
+        for (size_t i = 0; i < storage_.channels; ++i) {
+            if (storage_.latest[i].load().status == ESP_ERR_NOT_FINISHED) {
+                pending++;
+            }
+        }
+        if (pending > 0) {
+            if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+                ESP_LOGW(TAG, "%d channels without a frame after %lu ms", pending, timeout_ms);
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
     }
-    return sum / MOVING_AVG_WINDOW;
+    return ESP_OK;
 }
 
-esp_err_t Adc::read(size_t channel_idx, float& voltage) {
-    if (channel_idx >= configs_.size()) {
-        ESP_LOGE(TAG, "Invalid channel index: %d", channel_idx);
-        return ESP_ERR_INVALID_ARG;
+esp_err_t Adc::suspend() {
+    if (mode_ != AdcMode::CONTINUOUS || suspended_) {
+        return ESP_OK;
+    }
+    esp_err_t ret = driver_.suspend_continuous();
+    if (ret == ESP_OK) {
+        suspended_ = true;
     }
+    return ret;
+}
 
-    // Read raw ADC value
-    int raw_adc = 0;
-    esp_err_t ret = adc_oneshot_read(handle_, configs_[channel_idx].channel, &raw_adc);
+esp_err_t Adc::resume(uint32_t timeout_ms) {
+    if (!suspended_) {
+        return ESP_OK;
+    }
+    // Reads wait for the first frame after the restart, which the scan task primes from.
+    // The scan is stopped, so this task is the only writer until resume_continuous().
+    for (size_t i = 0; i < storage_.channels; ++i) {
+        storage_.latest[i].store({ storage_.latest[i].load().voltage, ESP_ERR_NOT_FINISHED });
+    }
+    rearm_.store(true, std::memory_order_release);
+    esp_err_t ret = driver_.resume_continuous();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "ADC read error for channel %d: %s", configs_[channel_idx].channel, esp_err_to_name(ret));
         return ret;
     }
+    suspended_ = false;
+    return wait_frames(timeout_ms);
+}
 
-    // Convert to voltage
-    if (do_calibration_[channel_idx]) {
-        int cali_voltage_mv = 0;
-        ret = adc_cali_raw_to_voltage(cali_handles_[channel_idx], raw_adc, &cali_voltage_mv);
+esp_err_t Adc::prime_oneshot(size_t channel_idx, float& voltage) {
+    // Back-to-back conversions, as fast as the driver allows; out-of-range ones are left out
+    float burst[ADC_PRIME_SAMPLES];
+    size_t count = 0;
+    esp_err_t ret = ESP_OK;
+    for (size_t n = 0; n < ADC_PRIME_SAMPLES; ++n) {
+        int raw_adc = 0;
+        ret = driver_.read_raw(channel_idx, raw_adc);
         if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Calibration error for channel %d: %s", configs_[channel_idx].channel, esp_err_to_name(ret));
+            ESP_LOGE(TAG, "ADC read error for channel %d: %s", storage_.configs[channel_idx].channel, esp_err_to_name(ret));
             return ret;
         }
+        ret = raw_to_voltage(channel_idx, raw_adc, burst[count]);
+        if (ret == ESP_OK) {
+            count++;
+        }
+    }
+    // Once per channel: an open probe would otherwise cost a whole burst on every read
+    storage_.primed[channel_idx] = true;
+    if (count == 0) {
+        voltage = burst[0];
+        if (ret == ESP_ERR_INVALID_STATE) {
+            ESP_LOGW(TAG, "Warning: Channel %d voltage %.3fV exceeds safe range!", channel_idx, voltage);
+        }
+        return ret;
+    }
+    voltage = storage_.filters[channel_idx].prime(burst, count);
+    return ESP_OK;
+}
+
+esp_err_t Adc::read_oneshot(size_t channel_idx, float& voltage) {
+    if (!storage_.primed[channel_idx]) {
+        return prime_oneshot(channel_idx, voltage);
+    }
+
+    // Read raw ADC value
+    int raw_adc = 0;
+    esp_err_t ret = driver_.read_raw(channel_idx, raw_adc);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ADC read error for channel %d: %s", storage_.configs[channel_idx].channel, esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = raw_to_voltage(channel_idx, raw_adc, voltage);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "Warning: Channel %d voltage %.3fV exceeds safe range!", channel_idx, voltage);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    voltage = storage_.filters[channel_idx].update(voltage);
+    return ESP_OK;
+}
+
+esp_err_t Adc::raw_to_voltage(size_t channel_idx, int raw_adc, float& voltage) {
+    int cali_voltage_mv = 0;
+    esp_err_t ret = driver_.raw_to_mv(channel_idx, raw_adc, cali_voltage_mv);
+    if (ret == ESP_OK) {
         voltage = cali_voltage_mv / 1000.0f; // Convert mV to V
+    } else if (ret == ESP_ERR_NOT_SUPPORTED) {
+        voltage = raw_adc * storage_.reference_voltages[channel_idx] / 4095.0f; // Fallback to raw conversion
     } else {
-        voltage = raw_adc * reference_voltages_[channel_idx] / 4095.0f; // Fallback to raw conversion
+        ESP_LOGE(TAG, "Calibration error for channel %d: %s", storage_.configs[channel_idx].channel, esp_err_to_name(ret));
+        return ret;
     }
 
     if (voltage < 0) voltage = 0;
-    if (voltage > reference_voltages_[channel_idx] * 0.99f) {
-        ESP_LOGW(TAG, "Warning: Channel %d voltage %.3fV exceeds safe range!", channel_idx, voltage);
+    if (voltage > storage_.reference_voltages[channel_idx] * 0.99f) {
         return ESP_ERR_INVALID_STATE;
     }
-
-    voltage = compute_moving_average(voltage, channel_idx);
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+void Adc::on_scan(const int* raw, const uint32_t* count, size_t channels) {
+    if (rearm_.exchange(false, std::memory_order_acquire)) {
+        for (size_t i = 0; i < storage_.channels; ++i) {
+            storage_.filters[i].reset();
+        }
+    }
+    for (size_t i = 0; i < channels && i < storage_.channels; ++i) {
+        if (count[i] == 0) {
+            continue;
+        }
+        float voltage = 0.0f;
+        esp_err_t ret = raw_to_voltage(i, raw[i], voltage);
+        // Only this task writes the cell, so reading it back cannot race
+        AdcReading latest = storage_.latest[i].load();
+        if (ret == ESP_OK) {
+            // The first frame is already an average of count[i] conversions: seed the
+            // whole filter with it instead of letting the window fill over many frames
+            ChannelFilter& filter = storage_.filters[i];
+            latest.voltage = filter.empty() ? filter.prime(&voltage, 1) : filter.update(voltage);
+        } else if (latest.status != ret) {
+            // Log transitions only, the scan runs far faster than the console
+            ESP_LOGW(TAG, "Channel %d: %s (%.3fV)", i, esp_err_to_name(ret), voltage);
+        }
+        latest.status = ret;
+        storage_.latest[i].store(latest);
+    }
+}
@@ -0,0 +1,338 @@
+#include <stdio.h>
+
+#include "esp_adc_driver.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+static const char* TAG = "esp_adc_driver";
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE             ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_CHANNEL(p_data)     ((p_data)->type1.channel)
+#define ADC_GET_DATA(p_data)        ((p_data)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE             ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_CHANNEL(p_data)     ((p_data)->type2.channel)
+#define ADC_GET_DATA(p_data)        ((p_data)->type2.data)
+#endif
+
+static constexpr size_t CHANNEL_LOOKUP_SIZE = 16;
+
+// Cached calibration curve of one channel. Another IDF release may calibrate differently,
+// so its version is part of the record.
+static constexpr uint16_t CURVE_CACHE_VERSION = 1;
+struct CachedCurve {
+    uint32_t idf_version;
+    uint8_t unit;
+    uint8_t channel;
+    uint8_t atten;
+    AdcCurve curve;
+};
+
+EspAdcDriver::EspAdcDriver(adc_unit_t unit, BlobStore* cache)
+    : unit_(unit),
+      handle_(nullptr),
+      cont_handle_(nullptr),
+      cont_task_(nullptr),
+      listener_(nullptr),
+      channels_(0),
+      configs_{},
+      curves_{},
+      calibrated_{},
+      cache_(cache),
+      frame_{} {
+}
+
+EspAdcDriver::~EspAdcDriver() {
+    stop_continuous();
+    if (handle_) {
+        adc_oneshot_del_unit(handle_);
+    }
+}
+
+esp_err_t EspAdcDriver::init(const AdcConfig_t* configs, size_t count) {
+    if (count > ADC_MAX_CHANNELS) {
+        ESP_LOGE(TAG, "%d channels exceed the limit of %d", count, ADC_MAX_CHANNELS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t start_us = esp_timer_get_time();
+    size_t cached = 0;
+    channels_ = count;
+    for (size_t i = 0; i < channels_; ++i) {
+        configs_[i] = configs[i];
+        calibrated_[i] = false;
+        if (load_curve(i) == ESP_OK) {
+            calibrated_[i] = true;
+            cached++;
+        } else if (sample_curve(i) == ESP_OK) {
+            calibrated_[i] = true;
+        } else {
+            ESP_LOGW(TAG, "Calibration not supported for channel %d, using raw ADC", configs_[i].channel);
+        }
+    }
+    ESP_LOGI(TAG, "Calibration of %d channels in %lld us, %d from cache", channels_,
+             esp_timer_get_time() - start_us, cached);
+    return ESP_OK;
+}
+
+void EspAdcDriver::cache_key(size_t channel_idx, char* key, size_t size) const {
+    snprintf(key, size, "adc%d.%d.%d", unit_, configs_[channel_idx].channel, configs_[channel_idx].atten);
+}
+
+esp_err_t EspAdcDriver::load_curve(size_t channel_idx) {
+    if (cache_ == nullptr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    char key[BLOB_KEY_MAX + 1];
+    cache_key(channel_idx, key, sizeof(key));
+    CachedCurve cached;
+    esp_err_t ret = blob_load(*cache_, key, CURVE_CACHE_VERSION, &cached, sizeof(cached));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (cached.idf_version != ESP_IDF_VERSION || cached.unit != unit_ ||
+        cached.channel != configs_[channel_idx].channel || cached.atten != configs_[channel_idx].atten) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    curves_[channel_idx] = cached.curve;
+    return ESP_OK;
+}
+
+// The scheme is only needed until its curve is sampled
+esp_err_t EspAdcDriver::sample_curve(size_t channel_idx) {
+    adc_cali_handle_t handle = nullptr;
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+    #if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = unit_,
+        .chan = configs_[channel_idx].channel,
+        .atten = configs_[channel_idx].atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
+    #elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = unit_,
+        .atten = configs_[channel_idx].atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
+    #endif
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = adc_curve_sample([&](int raw, int& mv) { return adc_cali_raw_to_voltage(handle, raw, &mv); },
+                           curves_[channel_idx]);
+    #if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_curve_fitting(handle);
+    #elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_line_fitting(handle);
+    #endif
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "Calibration curve sampled for channel %d", configs_[channel_idx].channel);
+
+    if (cache_ != nullptr) {
+        CachedCurve cached = {};
+        cached.idf_version = ESP_IDF_VERSION;
+        cached.unit = static_cast<uint8_t>(unit_);
+        cached.channel = static_cast<uint8_t>(configs_[channel_idx].channel);
+        cached.atten = static_cast<uint8_t>(configs_[channel_idx].atten);
+        cached.curve = curves_[channel_idx];
+        char key[BLOB_KEY_MAX + 1];
+        cache_key(channel_idx, key, sizeof(key));
+        blob_save(*cache_, key, CURVE_CACHE_VERSION, &cached, sizeof(cached));
+    }
+    return ESP_OK;
+}
+
+esp_err_t EspAdcDriver::start_oneshot() {
+    // Initialize ADC unit
+    adc_oneshot_unit_init_cfg_t init_cfg = {
+        .unit_id = unit_,
+        .clk_src = ADC_DIGI_CLK_SRC_DEFAULT,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    esp_err_t ret = adc_oneshot_new_unit(&init_cfg, &handle_);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Configure channels
+    adc_oneshot_chan_cfg_t chan_cfg = {
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    for (size_t i = 0; i < channels_; ++i) {
+        chan_cfg.atten = configs_[i].atten;
+        ret = adc_oneshot_config_channel(handle_, configs_[i].channel, &chan_cfg);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t EspAdcDriver::read_raw(size_t channel_idx, int& raw) {
+    return adc_oneshot_read(handle_, configs_[channel_idx].channel, &raw);
+}
+
+esp_err_t EspAdcDriver::raw_to_mv(size_t channel_idx, int raw, int& mv) {
+    if (!calibrated_[channel_idx]) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    mv = adc_curve_mv(curves_[channel_idx], raw);
+    return ESP_OK;
+}
+
+bool IRAM_ATTR EspAdcDriver::on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* user_data) {
+    BaseType_t must_yield = pdFALSE;
+    vTaskNotifyGiveFromISR(static_cast<EspAdcDriver*>(user_data)->cont_task_, &must_yield);
+    return must_yield == pdTRUE;
+}
+
+void EspAdcDriver::continuous_task(void* arg) {
+    EspAdcDriver* adc = static_cast<EspAdcDriver*>(arg);
+    const uint32_t frame_size = adc->cont_config_.frame_size;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Drain every completed frame in the pool; the DMA keeps filling the other one meanwhile
+        uint32_t length = 0;
+        while (adc_continuous_read(adc->cont_handle_, adc->frame_, frame_size, &length, 0) == ESP_OK) {
+            adc->process_frame(adc->frame_, length);
+        }
+    }
+}
+
+esp_err_t EspAdcDriver::start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) {
+    cont_config_ = config;
+    listener_ = &listener;
+    if (channels_ > SOC_ADC_PATT_LEN_MAX) {
+        ESP_LOGE(TAG, "%d channels exceed the scan pattern limit of %d", channels_, SOC_ADC_PATT_LEN_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cont_config_.frame_size == 0 || cont_config_.frame_size % SOC_ADC_DIGI_RESULT_BYTES != 0) {
+        ESP_LOGE(TAG, "Frame size %lu is not a multiple of %d bytes", cont_config_.frame_size, SOC_ADC_DIGI_RESULT_BYTES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (cont_config_.frame_size > ESP_ADC_MAX_FRAME_SIZE) {
+        ESP_LOGE(TAG, "Frame size %lu exceeds the limit of %lu bytes", cont_config_.frame_size, ESP_ADC_MAX_FRAME_SIZE);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Pool of two frames: one is parsed by the task while DMA fills the other
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = cont_config_.frame_size * 2,
+        .conv_frame_size = cont_config_.frame_size,
+        .flags = {
+            .flush_pool = 1,
+        },
+    };
+    esp_err_t ret = adc_continuous_new_handle(&handle_cfg, &cont_handle_);
+    if (ret != ESP_OK) {
+        cont_handle_ = nullptr;
+        return ret;
+    }
+
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {};
+    for (size_t i = 0; i < channels_; ++i) {
+        pattern[i].atten = configs_[i].atten;
+        pattern[i].channel = configs_[i].channel;
+        pattern[i].unit = unit_;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    adc_continuous_config_t cont_cfg = {
+        .pattern_num = static_cast<uint32_t>(channels_),
+        .adc_pattern = pattern,
+        .sample_freq_hz = cont_config_.sample_freq_hz,
+        .conv_mode = unit_ == ADC_UNIT_1 ? ADC_CONV_SINGLE_UNIT_1 : ADC_CONV_SINGLE_UNIT_2,
+        .format = ADC_OUTPUT_TYPE,
+    };
+    ret = adc_continuous_config(cont_handle_, &cont_cfg);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (xTaskCreate(continuous_task, "adc_scan", cont_config_.task_stack, this,
+                    cont_config_.task_priority, &cont_task_) != pdPASS) {
+        cont_task_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = nullptr,
+    };
+    ret = adc_continuous_register_event_callbacks(cont_handle_, &cbs, this);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return adc_continuous_start(cont_handle_);
+}
+
+void EspAdcDriver::stop_continuous() {
+    if (cont_handle_) {
+        adc_continuous_stop(cont_handle_);
+    }
+    if (cont_task_) {
+        vTaskDelete(cont_task_);
+        cont_task_ = nullptr;
+    }
+    if (cont_handle_) {
+        adc_continuous_deinit(cont_handle_);
+        cont_handle_ = nullptr;
+    }
+}
+
+esp_err_t EspAdcDriver::suspend_continuous() {
+    if (!cont_handle_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return adc_continuous_stop(cont_handle_);
+}
+
+esp_err_t EspAdcDriver::resume_continuous() {
+    if (!cont_handle_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Frames still in the pool were converted before the sleep
+    esp_err_t ret = adc_continuous_flush_pool(cont_handle_);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return adc_continuous_start(cont_handle_);
+}
+
+void EspAdcDriver::process_frame(const uint8_t* frame, uint32_t length) {
+    int8_t lookup[CHANNEL_LOOKUP_SIZE];
+    for (size_t c = 0; c < CHANNEL_LOOKUP_SIZE; ++c) {
+        lookup[c] = -1;
+    }
+    for (size_t i = 0; i < channels_; ++i) {
+        lookup[configs_[i].channel] = static_cast<int8_t>(i);
+    }
+
+    // Oversample: average every conversion of a channel in this frame into one sample
+    uint32_t sum[SOC_ADC_PATT_LEN_MAX] = {};
+    uint32_t count[SOC_ADC_PATT_LEN_MAX] = {};
+    for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t* p = reinterpret_cast<const adc_digi_output_data_t*>(&frame[offset]);
+        uint32_t chan = ADC_GET_CHANNEL(p);
+        if (chan >= CHANNEL_LOOKUP_SIZE || lookup[chan] < 0) {
+            continue;
+        }
+        sum[lookup[chan]] += ADC_GET_DATA(p);
+        count[lookup[chan]]++;
+    }
+
+    int raw[SOC_ADC_PATT_LEN_MAX];
+    for (size_t i = 0; i < channels_; ++i) {
+        raw[i] = count[i] > 0 ? static_cast<int>((sum[i] + count[i] / 2) / count[i]) : 0;
+    }
+    listener_->on_scan(raw, count, channels_);
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+
+#include "filter.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "filter";
+
+ChannelFilter::ChannelFilter()
+    : ring_(nullptr),
+      ring_index_(0),
+      ring_count_(0),
+      running_sum_(0.0f),
+      resync_countdown_(MOVING_AVG_RESYNC_SAMPLES),
+      ema_(0.0f),
+      ema_valid_(false),
+      spike_buf_{},
+      spike_index_(0),
+      spike_count_(0) {
+    config_.type = FilterType::NONE;
+}
+
+void ChannelFilter::configure(const FilterConfig& config, float* history, size_t capacity) {
+    config_ = config;
+    ring_ = nullptr;
+    if (config_.window == 0) {
+        ESP_LOGW(TAG, "Moving average window of 0 requested, using 1");
+        config_.window = 1;
+    }
+    if (config_.spike_window > MAX_SPIKE_WINDOW) {
+        ESP_LOGW(TAG, "Spike window %d clamped to %d", config_.spike_window, MAX_SPIKE_WINDOW);
+        config_.spike_window = MAX_SPIKE_WINDOW;
+    }
+    if (config_.spike_window == 0) {
+        config_.spike = SpikeFilter::NONE;
+    }
+    if (config_.ema_alpha <= 0.0f || config_.ema_alpha > 1.0f) {
+        ESP_LOGW(TAG, "EMA alpha %.3f out of range, using 1.0", config_.ema_alpha);
+        config_.ema_alpha = 1.0f;
+    }
+    if (config_.type == FilterType::MOVING_AVERAGE) {
+        if (history == nullptr || capacity == 0) {
+            ESP_LOGW(TAG, "No history for a moving average, passing samples through");
+            config_.type = FilterType::NONE;
+        } else {
+            if (config_.window > capacity) {
+                ESP_LOGW(TAG, "Moving average window %d clamped to %d", config_.window, capacity);
+                config_.window = capacity;
+            }
+            ring_ = history;
+        }
+    }
+    reset();
+}
+
+void ChannelFilter::reset() {
+    if (ring_ != nullptr) {
+        std::fill(ring_, ring_ + config_.window, 0.0f);
+    }
+    ring_index_ = 0;
+    ring_count_ = 0;
+    running_sum_ = 0.0f;
+    resync_countdown_ = MOVING_AVG_RESYNC_SAMPLES;
+    ema_ = 0.0f;
+    ema_valid_ = false;
+    spike_index_ = 0;
+    spike_count_ = 0;
+}
+
+float ChannelFilter::prime(const float* samples, size_t count) {
+    if (count == 0) {
+        return 0.0f;
+    }
+    // Median of up to MAX_PRIME_SAMPLES readings, robust against a spike in the burst
+    float sorted[MAX_PRIME_SAMPLES];
+    size_t n = count < MAX_PRIME_SAMPLES ? count : MAX_PRIME_SAMPLES;
+    for (size_t i = 0; i < n; ++i) {
+        float v = samples[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = v;
+    }
+    float median = n % 2 == 1 ? sorted[n / 2] : 0.5f * (sorted[n / 2 - 1] + sorted[n / 2]);
+
+    if (ring_ != nullptr) {
+        std::fill(ring_, ring_ + config_.window, median);
+        ring_index_ = 0;
+        ring_count_ = config_.window;
+        running_sum_ = median * config_.window;
+        resync_countdown_ = MOVING_AVG_RESYNC_SAMPLES;
+    }
+    ema_ = median;
+    ema_valid_ = true;
+    std::fill(spike_buf_, spike_buf_ + MAX_SPIKE_WINDOW, median);
+    spike_index_ = 0;
+    spike_count_ = config_.spike != SpikeFilter::NONE ? config_.spike_window : 0;
+    return median;
+}
+
+float ChannelFilter::reject_spike(float sample) {
+    spike_buf_[spike_index_] = sample;
+    spike_index_ = (spike_index_ + 1) % config_.spike_window;
+    if (spike_count_ < config_.spike_window) {
+        spike_count_++;
+    }
+
+    // Insertion sort of at most MAX_SPIKE_WINDOW samples
+    float sorted[MAX_SPIKE_WINDOW];
+    for (size_t i = 0; i < spike_count_; ++i) {
+        float v = spike_buf_[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = v;
+    }
+
+    if (config_.spike == SpikeFilter::MEDIAN) {
+        if (spike_count_ % 2 == 1) {
+            return sorted[spike_count_ / 2];
+        }
+        return 0.5f * (sorted[spike_count_ / 2 - 1] + sorted[spike_count_ / 2]);
+    }
+
+    // Trimmed mean: drop the extremes once there are enough samples to spare them
+    size_t first = spike_count_ > 2 ? 1 : 0;
+    size_t last = spike_count_ > 2 ? spike_count_ - 1 : spike_count_;
+    float sum = 0.0f;
+    for (size_t i = first; i < last; ++i) {
+        sum += sorted[i];
+    }
+    return sum / (last - first);
+}
+
+float ChannelFilter::moving_average(float sample) {
+    running_sum_ += sample - ring_[ring_index_];
+    ring_[ring_index_] = sample;
+    ring_index_ = (ring_index_ + 1) % config_.window;
+    if (ring_count_ < config_.window) {
+        ring_count_++;
+    }
+
+    // The sum stays incremental. Rounding moves the average of a noisy 1.65 V input by up
+    // to ~20 µV over 65536 samples but ~0.4 mV over 20M, so re-sum now and then
+    if (--resync_countdown_ == 0) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < ring_count_; ++i) {
+            sum += ring_[i];
+        }
+        running_sum_ = sum;
+        resync_countdown_ = MOVING_AVG_RESYNC_SAMPLES;
+    }
+    return running_sum_ / ring_count_;
+}
+
+float ChannelFilter::update(float sample) {
+    if (config_.spike != SpikeFilter::NONE) {
+        sample = reject_spike(sample);
+    }
+
+    switch (config_.type) {
+        case FilterType::MOVING_AVERAGE:
+            return moving_average(sample);
+        case FilterType::EMA:
+            if (!ema_valid_) {
+                ema_ = sample;
+                ema_valid_ = true;
+            } else {
+                ema_ += config_.ema_alpha * (sample - ema_);
+            }
+            return ema_;
+        case FilterType::NONE:
+        default:
+            return sample;
+    }
+}
@@ -0,0 +1,53 @@
+#include "blob_store.hpp"
+
+#include <string.h>
+
+// Records are staged whole, header first, so NVS writes them in one operation
+static constexpr size_t BLOB_MAX_BYTES = 256;
+
+struct BlobHeader {
+    uint16_t version;
+    uint16_t length;
+    uint32_t checksum;
+};
+
+static uint32_t fnv1a(const uint8_t* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+esp_err_t blob_load(BlobStore& store, const char* key, uint16_t version, void* data, size_t length) {
+    uint8_t record[BLOB_MAX_BYTES];
+    if (sizeof(BlobHeader) + length > sizeof(record)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t ret = store.read(key, record, sizeof(BlobHeader) + length);
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        return ESP_ERR_NOT_FOUND;   // Another layout
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    BlobHeader header;
+    memcpy(&header, record, sizeof(header));
+    if (header.version != version || header.length != length ||
+        header.checksum != fnv1a(record + sizeof(header), length)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memcpy(data, record + sizeof(header), length);
+    return ESP_OK;
+}
+
+esp_err_t blob_save(BlobStore& store, const char* key, uint16_t version, const void* data, size_t length) {
+    uint8_t record[BLOB_MAX_BYTES];
+    if (sizeof(BlobHeader) + length > sizeof(record)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    BlobHeader header = { version, static_cast<uint16_t>(length), fnv1a(static_cast<const uint8_t*>(data), length) };
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), data, length);
+    return store.write(key, record, sizeof(header) + length);
+}
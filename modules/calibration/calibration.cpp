@@ -0,0 +1,148 @@
+#include "calibration.hpp"
+#include "esp_log.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char* TAG = "calibration";
+
+// Closer points would make a segment's slope mostly noise
+static constexpr float MIN_POINT_SPACING_V = 0.001f;
+
+esp_err_t calibration_validate(const CalibrationCurve& curve) {
+    if (curve.points < 2 || curve.points > CAL_MAX_POINTS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < curve.points; ++i) {
+        if (!isfinite(curve.point[i].input) || !isfinite(curve.point[i].output)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (i > 0 && !(curve.point[i].input - curve.point[i - 1].input >= MIN_POINT_SPACING_V)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+float calibration_evaluate(const CalibrationCurve& curve, float input) {
+    // Segment containing input, or the end segment it extends
+    size_t i = 0;
+    while (i + 2 < curve.points && input > curve.point[i + 1].input) {
+        ++i;
+    }
+    const CalibrationPoint& a = curve.point[i];
+    const CalibrationPoint& b = curve.point[i + 1];
+    return a.output + (input - a.input) * (b.output - a.output) / (b.input - a.input);
+}
+
+esp_err_t calibration_add_point(CalibrationCurve& curve, const CalibrationPoint& point) {
+    size_t i = 0;
+    while (i < curve.points && curve.point[i].input < point.input - MIN_POINT_SPACING_V) {
+        ++i;
+    }
+    if (i < curve.points && fabsf(curve.point[i].input - point.input) < MIN_POINT_SPACING_V) {
+        curve.point[i] = point;
+        return ESP_OK;
+    }
+    if (curve.points >= CAL_MAX_POINTS) {
+        return ESP_ERR_NO_MEM;
+    }
+    memmove(&curve.point[i + 1], &curve.point[i], (curve.points - i) * sizeof(CalibrationPoint));
+    curve.point[i] = point;
+    curve.points++;
+    return ESP_OK;
+}
+
+CalibrationTable::CalibrationTable()
+    : curve_{}, input_min_(0.0f), input_max_(0.0f), scale_(0.0f), low_slope_(0.0f), high_slope_(0.0f), table_{} {
+}
+
+esp_err_t CalibrationTable::build(const CalibrationCurve& curve) {
+    esp_err_t ret = calibration_validate(curve);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    curve_ = curve;
+    const CalibrationPoint* p = curve.point;
+    const size_t last = curve.points - 1;
+    input_min_ = p[0].input;
+    input_max_ = p[last].input;
+    float step = (input_max_ - input_min_) / (CAL_TABLE_POINTS - 1);
+    scale_ = 1.0f / step;
+    low_slope_ = (p[1].output - p[0].output) / (p[1].input - p[0].input);
+    high_slope_ = (p[last].output - p[last - 1].output) / (p[last].input - p[last - 1].input);
+    for (size_t i = 0; i < CAL_TABLE_POINTS; ++i) {
+        table_[i] = calibration_evaluate(curve, input_min_ + step * i);
+    }
+    // Exact at both ends despite rounding in the steps
+    table_[0] = p[0].output;
+    table_[CAL_TABLE_POINTS - 1] = p[last].output;
+    return ESP_OK;
+}
+
+float CalibrationTable::max_error(size_t probes_per_step) const {
+    float step = (input_max_ - input_min_) / (CAL_TABLE_POINTS - 1);
+    float worst = 0.0f;
+    for (size_t i = 0; i + 1 < CAL_TABLE_POINTS; ++i) {
+        for (size_t k = 0; k <= probes_per_step; ++k) {
+            float input = input_min_ + step * (i + static_cast<float>(k) / probes_per_step);
+            float error = fabsf(apply(input) - calibration_evaluate(curve_, input));
+            worst = error > worst ? error : worst;
+        }
+    }
+    return worst;
+}
+
+Calibration::Calibration(const CalibrationCurve& defaults)
+    : slots_{}, current_(&slots_[0]), in_use_(&slots_[0]), last_input_(0.0f), defaults_(defaults) {
+    ESP_ERROR_CHECK(slots_[0].build(defaults));
+}
+
+Calibration::Calibration(const Calibration& other) : Calibration(other.defaults_) {
+    set(other.curve());
+}
+
+esp_err_t Calibration::set(const CalibrationCurve& curve) {
+    const CalibrationTable* current = current_.load();
+    const CalibrationTable* in_use = in_use_.load();
+    CalibrationTable* slot = &slots_[0];
+    while (slot == current || slot == in_use) {
+        ++slot;
+    }
+    esp_err_t ret = slot->build(curve);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    current_.store(slot);
+    return ESP_OK;
+}
+
+bool Calibration::is_default() const {
+    const CalibrationCurve& current = curve();
+    return current.points == defaults_.points &&
+           memcmp(current.point, defaults_.point, current.points * sizeof(CalibrationPoint)) == 0;
+}
+
+esp_err_t Calibration::load(BlobStore& store, const char* key) {
+    CalibrationCurve curve;
+    esp_err_t ret = blob_load(store, key, CALIBRATION_VERSION, &curve, sizeof(curve));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = set(curve);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "%s: stored curve rejected: %s", key, esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "%s: %lu points from %.3f to %.3f V, table within %.4f", key, curve.points,
+             curve.point[0].input, curve.point[curve.points - 1].input, max_error());
+    return ESP_OK;
+}
+
+esp_err_t Calibration::save(BlobStore& store, const char* key) const {
+    CalibrationCurve curve = {};    // Unused points zeroed, so equal curves store equal bytes
+    const CalibrationCurve& current = this->curve();
+    curve.points = current.points;
+    memcpy(curve.point, current.point, current.points * sizeof(CalibrationPoint));
+    return blob_save(store, key, CALIBRATION_VERSION, &curve, sizeof(curve));
+}
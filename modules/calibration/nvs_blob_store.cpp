@@ -0,0 +1,72 @@
+#include "nvs_blob_store.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "nvs_blob_store";
+
+NvsBlobStore::NvsBlobStore(const char* name_space) : namespace_(name_space), handle_(0), open_(false) {
+}
+
+NvsBlobStore::~NvsBlobStore() {
+    if (open_) {
+        nvs_close(handle_);
+    }
+}
+
+// On first use rather than at construction, which may come before nvs_flash_init()
+esp_err_t NvsBlobStore::open() {
+    if (open_) {
+        return ESP_OK;
+    }
+    esp_err_t ret = nvs_open(namespace_, NVS_READWRITE, &handle_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Opening namespace %s failed: %s", namespace_, esp_err_to_name(ret));
+        return ret;
+    }
+    open_ = true;
+    return ESP_OK;
+}
+
+esp_err_t NvsBlobStore::read(const char* key, void* data, size_t length) {
+    esp_err_t ret = open();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t stored = 0;
+    ret = nvs_get_blob(handle_, key, nullptr, &stored);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (stored != length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return nvs_get_blob(handle_, key, data, &stored);
+}
+
+esp_err_t NvsBlobStore::write(const char* key, const void* data, size_t length) {
+    esp_err_t ret = open();
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle_, key, data, length);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle_);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Writing %s.%s failed: %s", namespace_, key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t NvsBlobStore::erase(const char* key) {
+    esp_err_t ret = open();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_erase_key(handle_, key);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    return ret == ESP_OK ? nvs_commit(handle_) : ret;
+}
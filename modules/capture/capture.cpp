@@ -0,0 +1,531 @@
+#include "capture.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char* TAG = "capture";
+
+static const char CAPTURE_MAGIC[4] = { 'H', 'C', 'A', 'P' };
+// Tag, time and the largest payload, an ADC_SETUP with every channel calibrated
+static constexpr size_t MAX_RECORD_BYTES = 1 + 10 + 2 + ADC_MAX_CHANNELS * (3 + sizeof(AdcCurve));
+static_assert(MAX_RECORD_BYTES <= CAPTURE_BLOCK_BYTES, "a setup record must fit in one block");
+static_assert(CAPTURE_MAX_STREAMS <= 16 && ADC_MAX_CHANNELS <= 8, "stream ids and scan masks are 4 and 8 bits");
+
+static uint32_t fnv1a(const uint8_t* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static size_t put_varint(uint8_t* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+static bool get_varint(const uint8_t* data, size_t size, size_t& position, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && position < size; shift += 7) {
+        uint8_t byte = data[position++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t capture_raw_to_mv(const CaptureAdcChannel& channel, int raw, int& mv) {
+    if (!channel.calibrated) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    mv = adc_curve_mv(channel.curve, raw);
+    return ESP_OK;
+}
+
+esp_err_t FileCaptureSink::write(const uint8_t* data, size_t length) {
+    size_t written = fwrite(data, 1, length, out_);
+    fflush(out_);
+    return written == length ? ESP_OK : ESP_FAIL;
+}
+
+CaptureWriter::CaptureWriter()
+    : sink_(nullptr), block_{}, length_(0), last_time_us_(0), last_raw_{}, blocks_(0), bytes_(0) {
+}
+
+CaptureWriter::CaptureWriter(CaptureSink& sink) : CaptureWriter() {
+    begin(sink);
+}
+
+void CaptureWriter::begin(CaptureSink& sink) {
+    sink_ = &sink;
+    blocks_ = 0;
+    bytes_ = 0;
+    begin_block();
+}
+
+void CaptureWriter::begin_block() {
+    // Every block decodes on its own: absolute time first, raw deltas from zero
+    length_ = 0;
+    last_time_us_ = 0;
+    memset(last_raw_, 0, sizeof(last_raw_));
+}
+
+size_t CaptureWriter::put_tag(uint8_t* out, CaptureKind kind, uint8_t stream, int64_t time_us) const {
+    out[0] = static_cast<uint8_t>(static_cast<uint8_t>(kind) << 4 | (stream & 0x0F));
+    return 1 + put_varint(out + 1, zigzag(time_us - last_time_us_));
+}
+
+template <typename Encode>
+esp_err_t CaptureWriter::append(int64_t time_us, Encode encode) {
+    if (sink_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t record[MAX_RECORD_BYTES];
+    size_t length = encode(record);
+    esp_err_t ret = ESP_OK;
+    if (length_ + length > CAPTURE_BLOCK_BYTES) {
+        ret = flush();
+        length = encode(record);
+    }
+    memcpy(block_ + sizeof(CaptureBlockHeader) + length_, record, length);
+    length_ += length;
+    last_time_us_ = time_us;
+    return ret;
+}
+
+esp_err_t CaptureWriter::write(const CaptureEvent& event) {
+    if (event.stream >= CAPTURE_MAX_STREAMS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = append(event.time_us, [&](uint8_t* out) {
+        size_t n = put_tag(out, event.kind, event.stream, event.time_us);
+        const int32_t* last = last_raw_[event.stream];
+        switch (event.kind) {
+            case CaptureKind::ADC_READ:
+                out[n++] = event.channel;
+                n += put_varint(out + n, zigzag(event.raw - last[event.channel % ADC_MAX_CHANNELS]));
+                break;
+            case CaptureKind::ADC_ERROR:
+                out[n++] = event.channel;
+                n += put_varint(out + n, zigzag(event.error));
+                break;
+            case CaptureKind::ADC_SCAN: {
+                size_t channels = event.length < ADC_MAX_CHANNELS ? event.length : ADC_MAX_CHANNELS;
+                uint8_t mask = 0;
+                for (size_t i = 0; i < channels; ++i) {
+                    mask |= event.scan[i] >= 0 ? 1u << i : 0u;
+                }
+                out[n++] = static_cast<uint8_t>(channels);
+                out[n++] = mask;
+                for (size_t i = 0; i < channels; ++i) {
+                    if (event.scan[i] >= 0) {
+                        n += put_varint(out + n, zigzag(event.scan[i] - last[i]));
+                    }
+                }
+                break;
+            }
+            case CaptureKind::UART_DATA: {
+                size_t length = event.length < CAPTURE_DATA_BYTES ? event.length : CAPTURE_DATA_BYTES;
+                out[n++] = static_cast<uint8_t>(length);
+                memcpy(out + n, event.data, length);
+                n += length;
+                break;
+            }
+            case CaptureKind::DROPPED:
+                n += put_varint(out + n, event.dropped);
+                break;
+            default:
+                break;
+        }
+        return n;
+    });
+    // The deltas of the next record start from this one's values
+    if (event.kind == CaptureKind::ADC_READ) {
+        last_raw_[event.stream][event.channel % ADC_MAX_CHANNELS] = event.raw;
+    } else if (event.kind == CaptureKind::ADC_SCAN) {
+        for (size_t i = 0; i < event.length && i < ADC_MAX_CHANNELS; ++i) {
+            if (event.scan[i] >= 0) {
+                last_raw_[event.stream][i] = event.scan[i];
+            }
+        }
+    }
+    return ret;
+}
+
+esp_err_t CaptureWriter::write_adc_setup(uint8_t stream, const CaptureAdcSetup& setup, int64_t time_us) {
+    return append(time_us, [&](uint8_t* out) {
+        size_t n = put_tag(out, CaptureKind::ADC_SETUP, stream, time_us);
+        size_t channels = setup.channels < ADC_MAX_CHANNELS ? setup.channels : ADC_MAX_CHANNELS;
+        out[n++] = static_cast<uint8_t>(channels);
+        out[n++] = setup.continuous ? 1 : 0;
+        for (size_t i = 0; i < channels; ++i) {
+            const CaptureAdcChannel& channel = setup.config[i];
+            out[n++] = channel.channel;
+            out[n++] = channel.atten;
+            out[n++] = channel.calibrated ? 1 : 0;
+            if (channel.calibrated) {
+                memcpy(out + n, channel.curve.mv, sizeof(channel.curve.mv));
+                n += sizeof(channel.curve.mv);
+            }
+        }
+        return n;
+    });
+}
+
+esp_err_t CaptureWriter::write_uart_setup(uint8_t stream, const CaptureUartSetup& setup, int64_t time_us) {
+    return append(time_us, [&](uint8_t* out) {
+        size_t n = put_tag(out, CaptureKind::UART_SETUP, stream, time_us);
+        out[n++] = setup.port;
+        n += put_varint(out + n, setup.baud_rate);
+        return n;
+    });
+}
+
+esp_err_t CaptureWriter::flush() {
+    if (sink_ == nullptr || length_ == 0) {
+        return ESP_OK;
+    }
+    CaptureBlockHeader header;
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.length = static_cast<uint16_t>(length_);
+    header.checksum = fnv1a(block_ + sizeof(header), length_);
+    memcpy(block_, &header, sizeof(header));
+    size_t size = sizeof(header) + length_;
+    esp_err_t ret = sink_->write(block_, size);
+    blocks_++;
+    bytes_ += size;
+    begin_block();
+    return ret;
+}
+
+CaptureReader::CaptureReader(FILE* in)
+    : in_(in), buffered_(0), block_length_(0), position_(0), time_us_(0), last_raw_{}, adc_{}, uart_{},
+      adc_known_{}, uart_known_{}, data_seen_(false), session_(0), blocks_(0), skipped_bytes_(0), bad_records_(0) {
+}
+
+const CaptureAdcSetup* CaptureReader::adc_setup(uint8_t stream) const {
+    return stream < CAPTURE_MAX_STREAMS && adc_known_[stream] ? &adc_[stream] : nullptr;
+}
+
+const CaptureUartSetup* CaptureReader::uart_setup(uint8_t stream) const {
+    return stream < CAPTURE_MAX_STREAMS && uart_known_[stream] ? &uart_[stream] : nullptr;
+}
+
+void CaptureReader::discard(size_t count, bool skipped) {
+    skipped_bytes_ += skipped ? count : 0;
+    buffered_ -= count;
+    memmove(buffer_, buffer_ + count, buffered_);
+}
+
+bool CaptureReader::next_block() {
+    const size_t header_size = sizeof(CaptureBlockHeader);
+    while (true) {
+        buffered_ += fread(buffer_ + buffered_, 1, sizeof(buffer_) - buffered_, in_);
+        if (buffered_ < header_size) {
+            discard(buffered_, true);
+            return false;
+        }
+
+        // Resynchronise on the magic: log text and erased flash in between are skipped.
+        // Without one, the last bytes may still be the start of the next.
+        size_t start = 0;
+        while (start + sizeof(CAPTURE_MAGIC) <= buffered_ &&
+               memcmp(buffer_ + start, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+            start++;
+        }
+        if (start > 0) {
+            discard(start, true);
+            continue;
+        }
+
+        // The buffer holds the largest block, so one that does not fit was cut off
+        CaptureBlockHeader header;
+        memcpy(&header, buffer_, header_size);
+        size_t end = header_size + header.length;
+        if (header.version != CAPTURE_VERSION || header.length == 0 || header.length > CAPTURE_BLOCK_BYTES ||
+            end > buffered_ || fnv1a(buffer_ + header_size, header.length) != header.checksum) {
+            discard(1, true);
+            continue;
+        }
+        memcpy(block_, buffer_ + header_size, header.length);
+        block_length_ = header.length;
+        position_ = 0;
+        time_us_ = 0;
+        memset(last_raw_, 0, sizeof(last_raw_));
+        blocks_++;
+        discard(end, false);
+        return true;
+    }
+}
+
+bool CaptureReader::decode(CaptureEvent& event) {
+    const uint8_t* data = block_;
+    const size_t size = block_length_;
+    uint8_t tag = data[position_++];
+    uint64_t value = 0;
+    if (!get_varint(data, size, position_, value)) {
+        return false;
+    }
+    time_us_ += unzigzag(value);
+    event = {};
+    event.time_us = time_us_;
+    event.kind = static_cast<CaptureKind>(tag >> 4);
+    event.stream = tag & 0x0F;
+    if (event.stream >= CAPTURE_MAX_STREAMS) {
+        return false;
+    }
+    int32_t* last = last_raw_[event.stream];
+
+    switch (event.kind) {
+        case CaptureKind::ADC_SETUP: {
+            if (position_ + 2 > size || data[position_] > ADC_MAX_CHANNELS) {
+                return false;
+            }
+            CaptureAdcSetup& setup = adc_[event.stream];
+            setup = {};
+            setup.channels = data[position_++];
+            setup.continuous = data[position_++] != 0;
+            for (size_t i = 0; i < setup.channels; ++i) {
+                if (position_ + 3 > size) {
+                    return false;
+                }
+                CaptureAdcChannel& channel = setup.config[i];
+                channel.channel = data[position_++];
+                channel.atten = data[position_++];
+                channel.calibrated = data[position_++] != 0;
+                if (channel.calibrated) {
+                    if (position_ + sizeof(channel.curve.mv) > size) {
+                        return false;
+                    }
+                    memcpy(channel.curve.mv, data + position_, sizeof(channel.curve.mv));
+                    position_ += sizeof(channel.curve.mv);
+                }
+            }
+            adc_known_[event.stream] = true;
+            break;
+        }
+        case CaptureKind::UART_SETUP: {
+            if (position_ + 1 > size) {
+                return false;
+            }
+            uart_[event.stream].port = data[position_++];
+            if (!get_varint(data, size, position_, value)) {
+                return false;
+            }
+            uart_[event.stream].baud_rate = static_cast<uint32_t>(value);
+            uart_known_[event.stream] = true;
+            break;
+        }
+        case CaptureKind::ADC_READ:
+        case CaptureKind::ADC_ERROR:
+            if (position_ + 1 > size || data[position_] >= ADC_MAX_CHANNELS) {
+                return false;
+            }
+            event.channel = data[position_++];
+            if (!get_varint(data, size, position_, value)) {
+                return false;
+            }
+            if (event.kind == CaptureKind::ADC_READ) {
+                event.raw = static_cast<int32_t>(last[event.channel] + unzigzag(value));
+                last[event.channel] = event.raw;
+            } else {
+                event.error = static_cast<int32_t>(unzigzag(value));
+            }
+            break;
+        case CaptureKind::ADC_SCAN: {
+            if (position_ + 2 > size || data[position_] > ADC_MAX_CHANNELS) {
+                return false;
+            }
+            event.length = data[position_++];
+            uint8_t mask = data[position_++];
+            for (size_t i = 0; i < event.length; ++i) {
+                event.scan[i] = -1;
+                if ((mask & (1u << i)) == 0) {
+                    continue;
+                }
+                if (!get_varint(data, size, position_, value)) {
+                    return false;
+                }
+                last[i] = static_cast<int32_t>(last[i] + unzigzag(value));
+                event.scan[i] = static_cast<int16_t>(last[i]);
+            }
+            break;
+        }
+        case CaptureKind::UART_DATA:
+            if (position_ + 1 > size || data[position_] > CAPTURE_DATA_BYTES ||
+                position_ + 1 + data[position_] > size) {
+                return false;
+            }
+            event.length = data[position_++];
+            memcpy(event.data, data + position_, event.length);
+            position_ += event.length;
+            break;
+        case CaptureKind::UART_IDLE:
+        case CaptureKind::UART_OVERFLOW:
+            break;
+        case CaptureKind::DROPPED:
+            if (!get_varint(data, size, position_, value)) {
+                return false;
+            }
+            event.dropped = static_cast<uint32_t>(value);
+            break;
+        default:
+            return false;
+    }
+
+    // Setups come first in a session; one after data means the device started over
+    bool setup = event.kind == CaptureKind::ADC_SETUP || event.kind == CaptureKind::UART_SETUP;
+    if (setup && data_seen_) {
+        session_++;
+    }
+    data_seen_ = !setup;
+    return true;
+}
+
+bool CaptureReader::next(CaptureEvent& event) {
+    while (true) {
+        if (position_ >= block_length_ && !next_block()) {
+            return false;
+        }
+        if (decode(event)) {
+            return true;
+        }
+        // The rest of the block cannot be trusted once a record does not parse
+        bad_records_++;
+        position_ = block_length_;
+    }
+}
+
+Capture::Capture()
+    : recording_(false), adc_{}, uart_{}, adc_count_(0), uart_count_(0), sink_(nullptr), setup_pending_(false),
+      events_(0), dropped_(0), drain_period_ms_(0), flushed_us_(0), drain_task_(nullptr) {
+}
+
+uint8_t Capture::add_adc(const CaptureAdcSetup* setup) {
+    if (adc_count_ >= CAPTURE_MAX_STREAMS) {
+        ESP_LOGW(TAG, "No capture stream left for another ADC unit");
+        return CAPTURE_NO_STREAM;
+    }
+    adc_[adc_count_] = setup;
+    return static_cast<uint8_t>(adc_count_++);
+}
+
+uint8_t Capture::add_uart(const CaptureUartSetup* setup) {
+    if (uart_count_ >= CAPTURE_MAX_STREAMS) {
+        ESP_LOGW(TAG, "No capture stream left for another UART");
+        return CAPTURE_NO_STREAM;
+    }
+    uart_[uart_count_] = setup;
+    return static_cast<uint8_t>(uart_count_++);
+}
+
+esp_err_t Capture::start(CaptureSink& sink) {
+    if (recording()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sink_ = &sink;
+    setup_pending_.store(true, std::memory_order_release);
+    recording_.store(true, std::memory_order_release);
+    ESP_LOGI(TAG, "Capture started: %d ADC units, %d UARTs", adc_count_, uart_count_);
+    return ESP_OK;
+}
+
+void Capture::stop() {
+    recording_.store(false, std::memory_order_relaxed);
+}
+
+bool Capture::record(const CaptureEvent& event) {
+    if (!recording()) {
+        return false;
+    }
+    return ring_.push([&](CaptureEvent& slot) { slot = event; });
+}
+
+size_t Capture::drain() {
+    int64_t now_us = esp_timer_get_time();
+    if (setup_pending_.exchange(false, std::memory_order_acquire)) {
+        writer_.begin(*sink_);
+        flushed_us_ = now_us;
+        for (size_t i = 0; i < adc_count_; ++i) {
+            writer_.write_adc_setup(static_cast<uint8_t>(i), *adc_[i], now_us);
+        }
+        for (size_t i = 0; i < uart_count_; ++i) {
+            writer_.write_uart_setup(static_cast<uint8_t>(i), *uart_[i], now_us);
+        }
+        events_ += adc_count_ + uart_count_;
+    }
+
+    size_t count = 0;
+    esp_err_t ret = ESP_OK;
+    uint32_t lost = ring_.take_dropped();
+    if (lost > 0) {
+        CaptureEvent marker = {};
+        marker.time_us = esp_timer_get_time();
+        marker.kind = CaptureKind::DROPPED;
+        marker.dropped = lost;
+        dropped_ += lost;
+        ret = writer_.write(marker);
+        count++;
+    }
+    CaptureEvent event;
+    while (ring_.pop(event)) {
+        esp_err_t written = writer_.write(event);
+        ret = ret == ESP_OK ? written : ret;
+        count++;
+    }
+    // Full blocks went out as they filled; the partial one waits out the sink's interval
+    int64_t interval_us = sink_ ? static_cast<int64_t>(sink_->flush_interval_ms()) * 1000 : 0;
+    if (!recording() || now_us - flushed_us_ >= interval_us) {
+        esp_err_t flushed = writer_.flush();
+        ret = ret == ESP_OK ? flushed : ret;
+        flushed_us_ = now_us;
+    }
+    events_ += count;
+    if (ret != ESP_OK && recording()) {
+        stop();
+        ESP_LOGE(TAG, "Capture stopped: %s", esp_err_to_name(ret));
+    }
+    return count;
+}
+
+esp_err_t Capture::start_drain(UBaseType_t priority, uint32_t stack_size, uint32_t period_ms) {
+    if (drain_task_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    drain_period_ms_ = period_ms;
+    if (xTaskCreate(drain_task, "capture_drain", stack_size, this, priority, &drain_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create capture drain task");
+        drain_task_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void Capture::drain_task(void* arg) {
+    Capture* capture = static_cast<Capture*>(arg);
+    while (true) {
+        capture->drain();
+        vTaskDelay(pdMS_TO_TICKS(capture->drain_period_ms_) > 0 ? pdMS_TO_TICKS(capture->drain_period_ms_) : 1);
+    }
+}
+
+CaptureStats Capture::stats() const {
+    return { events_, dropped_, writer_.blocks(), writer_.bytes() };
+}
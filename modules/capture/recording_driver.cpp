@@ -0,0 +1,122 @@
+#include "recording_driver.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char* TAG = "capture";
+
+RecordingAdcDriver::RecordingAdcDriver(AdcDriver& driver, Capture& capture)
+    : driver_(driver), capture_(capture), setup_{}, stream_(capture.add_adc(&setup_)), listener_(nullptr) {
+}
+
+esp_err_t RecordingAdcDriver::init(const AdcConfig_t* configs, size_t count) {
+    esp_err_t ret = driver_.init(configs, count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    setup_.channels = static_cast<uint8_t>(count < ADC_MAX_CHANNELS ? count : ADC_MAX_CHANNELS);
+    for (size_t i = 0; i < setup_.channels; ++i) {
+        CaptureAdcChannel& channel = setup_.config[i];
+        channel.channel = static_cast<uint8_t>(configs[i].channel);
+        channel.atten = static_cast<uint8_t>(configs[i].atten);
+        channel.calibrated = adc_curve_sample([&](int raw, int& mv) { return driver_.raw_to_mv(i, raw, mv); },
+                                              channel.curve) == ESP_OK;
+    }
+    return ESP_OK;
+}
+
+esp_err_t RecordingAdcDriver::read_raw(size_t channel_idx, int& raw) {
+    esp_err_t ret = driver_.read_raw(channel_idx, raw);
+    if (stream_ != CAPTURE_NO_STREAM && capture_.recording()) {
+        CaptureEvent event = {};
+        event.time_us = esp_timer_get_time();
+        event.stream = stream_;
+        event.channel = static_cast<uint8_t>(channel_idx);
+        if (ret == ESP_OK) {
+            event.kind = CaptureKind::ADC_READ;
+            event.raw = raw;
+        } else {
+            event.kind = CaptureKind::ADC_ERROR;
+            event.error = ret;
+        }
+        capture_.record(event);
+    }
+    return ret;
+}
+
+esp_err_t RecordingAdcDriver::start_continuous(const AdcContinuousConfig& config, AdcScanListener& listener) {
+    listener_ = &listener;
+    esp_err_t ret = driver_.start_continuous(config, *this);
+    setup_.continuous = ret == ESP_OK;
+    return ret;
+}
+
+void RecordingAdcDriver::stop_continuous() {
+    driver_.stop_continuous();
+    setup_.continuous = false;
+}
+
+void RecordingAdcDriver::on_scan(const int* raw, const uint32_t* count, size_t channels) {
+    if (stream_ != CAPTURE_NO_STREAM && capture_.recording()) {
+        CaptureEvent event = {};
+        event.time_us = esp_timer_get_time();
+        event.kind = CaptureKind::ADC_SCAN;
+        event.stream = stream_;
+        event.length = static_cast<uint8_t>(channels < ADC_MAX_CHANNELS ? channels : ADC_MAX_CHANNELS);
+        for (size_t i = 0; i < event.length; ++i) {
+            // Raw frames are 12-bit averages; -1 marks a channel the frame did not hold
+            event.scan[i] = count[i] == 0 ? -1 : static_cast<int16_t>(raw[i] < 0 ? 0 : (raw[i] > 0x7FFF ? 0x7FFF : raw[i]));
+        }
+        capture_.record(event);
+    }
+    listener_->on_scan(raw, count, channels);
+}
+
+RecordingUartDriver::RecordingUartDriver(UartDriver& driver, Capture& capture)
+    : driver_(driver), capture_(capture), setup_{}, stream_(capture.add_uart(&setup_)), listener_(nullptr) {
+}
+
+esp_err_t RecordingUartDriver::start(const UartConfig& config, UartListener& listener) {
+    setup_.port = static_cast<uint8_t>(config.port);
+    setup_.baud_rate = static_cast<uint32_t>(config.baud_rate);
+    listener_ = &listener;
+    ESP_LOGI(TAG, "Recording UART%d as stream %d", config.port, stream_);
+    return driver_.start(config, *this);
+}
+
+void RecordingUartDriver::record(CaptureKind kind, int64_t now_us) {
+    if (stream_ != CAPTURE_NO_STREAM && capture_.recording()) {
+        CaptureEvent event = {};
+        event.time_us = now_us;
+        event.kind = kind;
+        event.stream = stream_;
+        capture_.record(event);
+    }
+}
+
+void RecordingUartDriver::on_data(const uint8_t* data, size_t length, int64_t now_us) {
+    if (stream_ != CAPTURE_NO_STREAM && capture_.recording()) {
+        // Longer reads go out as several events with the same time
+        for (size_t offset = 0; offset < length; offset += CAPTURE_DATA_BYTES) {
+            CaptureEvent event = {};
+            event.time_us = now_us;
+            event.kind = CaptureKind::UART_DATA;
+            event.stream = stream_;
+            event.length = static_cast<uint8_t>(length - offset < CAPTURE_DATA_BYTES ? length - offset : CAPTURE_DATA_BYTES);
+            memcpy(event.data, data + offset, event.length);
+            capture_.record(event);
+        }
+    }
+    listener_->on_data(data, length, now_us);
+}
+
+void RecordingUartDriver::on_idle() {
+    record(CaptureKind::UART_IDLE, esp_timer_get_time());
+    listener_->on_idle();
+}
+
+void RecordingUartDriver::on_overflow() {
+    record(CaptureKind::UART_OVERFLOW, esp_timer_get_time());
+    listener_->on_overflow();
+}
@@ -0,0 +1,388 @@
+#include <cinttypes>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "console.hpp"
+#include "state_machine.hpp"
+#include "trace.hpp"
+#include "esp_timer.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char* TAG = "console";
+
+// Commands have no context argument; there is one console and one state machine
+static StateMachine* s_state_machine = nullptr;
+static BlobStore* s_calibration_store = nullptr;
+static char s_report[METRICS_REPORT_BYTES];
+
+// Newest entries "history" prints at most
+static constexpr size_t HISTORY_PRINT_MAX = 60;
+static HistorySample s_samples[HISTORY_PRINT_MAX];
+static HistoryRollup s_rollups[HISTORY_PRINT_MAX];
+static const char* const SENSOR_NAMES[SensorData::TYPE_COUNT] = { "tds", "ntc", "level", "ph" };
+
+// Points taken so far for one sensor, applied by "cal ... save"
+static CalibrationCurve s_pending = {};
+static const Calibration* s_pending_for = nullptr;
+
+// A calibration point averages the sensor's input over this long; the sampler may have
+// backed off to its slowest rate, so it spans a few of its readings
+static constexpr uint32_t CAL_POINT_MS = 6000;
+static constexpr uint32_t CAL_POINT_SAMPLES = 60;
+// Input spread over the average above which the probe has not settled
+static constexpr float CAL_SETTLED_V = 0.005f;
+
+static int metrics_command(int argc, char** argv) {
+    MetricsFormat format = argc > 1 && strcmp(argv[1], "json") == 0 ? MetricsFormat::JSON : MetricsFormat::TEXT;
+    s_state_machine->metrics_report(s_report, sizeof(s_report), format);
+    printf("%s\n", s_report);
+    return 0;
+}
+
+static int trace_command(int argc, char** argv) {
+    static const char* const LEVELS[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    if (argc == 1) {
+        for (size_t m = 0; m < TRACE_MODULE_COUNT; ++m) {
+            TraceModule module = static_cast<TraceModule>(m);
+            printf("%-14s %s\n", trace_module_name(module), LEVELS[trace_log().level(module)]);
+        }
+        printf("dropped %lu\n", trace_log().dropped());
+        return 0;
+    }
+    if (argc != 3) {
+        printf("usage: trace [<module|all> <none|error|warn|info|debug|verbose>]\n");
+        return 1;
+    }
+    int level = -1;
+    for (size_t l = 0; l < sizeof(LEVELS) / sizeof(LEVELS[0]); ++l) {
+        if (strcmp(argv[2], LEVELS[l]) == 0) {
+            level = static_cast<int>(l);
+        }
+    }
+    bool matched = false;
+    for (size_t m = 0; m < TRACE_MODULE_COUNT && level >= 0; ++m) {
+        TraceModule module = static_cast<TraceModule>(m);
+        if (strcmp(argv[1], "all") == 0 || strcmp(argv[1], trace_module_name(module)) == 0) {
+            trace_log().set_level(module, static_cast<esp_log_level_t>(level));
+            matched = true;
+        }
+    }
+    if (!matched) {
+        printf("unknown module or level\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Boot-relative, the only clock there is
+static void print_time(int64_t time_ms) {
+    int64_t s = time_ms / 1000;
+    printf("%3" PRId64 ":%02" PRId64 ":%02" PRId64, s / 3600, s / 60 % 60, s % 60);
+}
+
+static int history_command(int argc, char** argv) {
+    const History* history = s_state_machine->history();
+    if (history == nullptr) {
+        printf("no history\n");
+        return 1;
+    }
+    if (argc == 1) {
+        int64_t first_ms = 0;
+        int64_t last_ms = 0;
+        size_t bytes = 0;
+        size_t rows = 0;
+        history->raw_usage(bytes, rows);
+        if (history->raw_span(first_ms, last_ms)) {
+            printf("raw ");
+            print_time(first_ms);
+            printf(" to ");
+            print_time(last_ms);
+            printf(", %d rows in %d bytes, %lu chunks archived\n", rows, bytes, history->archived());
+        }
+        // Last full hour, or what there is of this one
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        for (size_t channel = 0; channel < history->channels(); ++channel) {
+            size_t n = history->query(channel, HistoryResolution::HOUR, now_ms - 2 * HISTORY_HOUR_MS, now_ms,
+                                      s_rollups, HISTORY_PRINT_MAX);
+            if (n > 0) {
+                const HistoryRollup& hour = s_rollups[n - 1];
+                printf("%-8s %-5s min %.2f max %.2f mean %.2f since ",
+                       s_state_machine->zone(channel / SensorData::TYPE_COUNT).name(),
+                       SENSOR_NAMES[static_cast<size_t>(history->type(channel))], hour.min, hour.max, hour.mean);
+                print_time(hour.start_ms);
+                printf("\n");
+            }
+        }
+        return 0;
+    }
+    if (argc < 3) {
+        printf("usage: history [<zone> <tds|ntc|level|ph> [raw|minute|hour] [count]]\n");
+        return 1;
+    }
+    size_t channel = history->channels();
+    for (size_t z = 0; z < s_state_machine->zone_count(); ++z) {
+        for (size_t t = 0; t < SensorData::TYPE_COUNT; ++t) {
+            size_t c = z * SensorData::TYPE_COUNT + t;
+            if (strcmp(argv[1], s_state_machine->zone(z).name()) == 0 && c < history->channels() &&
+                strcmp(argv[2], SENSOR_NAMES[static_cast<size_t>(history->type(c))]) == 0) {
+                channel = c;
+            }
+        }
+    }
+    if (channel == history->channels()) {
+        printf("unknown zone or sensor\n");
+        return 1;
+    }
+    const char* resolution = argc > 3 ? argv[3] : "minute";
+    size_t count = argc > 4 ? strtoul(argv[4], nullptr, 10) : 10;
+    count = count < 1 ? 1 : count > HISTORY_PRINT_MAX ? HISTORY_PRINT_MAX : count;
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    if (strcmp(resolution, "raw") == 0) {
+        // Rows are a control period apart; ask for a little more and print the newest
+        size_t n = history->query(channel, now_ms - static_cast<int64_t>(count + 2) * 1000, now_ms, s_samples,
+                                  HISTORY_PRINT_MAX);
+        for (size_t i = n > count ? n - count : 0; i < n; ++i) {
+            print_time(s_samples[i].time_ms);
+            printf(" %.2f\n", s_samples[i].value);
+        }
+        return 0;
+    }
+    bool hours = strcmp(resolution, "hour") == 0;
+    if (!hours && strcmp(resolution, "minute") != 0) {
+        printf("unknown resolution %s\n", resolution);
+        return 1;
+    }
+    int64_t length_ms = hours ? HISTORY_HOUR_MS : HISTORY_MINUTE_MS;
+    size_t n = history->query(channel, hours ? HistoryResolution::HOUR : HistoryResolution::MINUTE,
+                              now_ms - static_cast<int64_t>(count) * length_ms, now_ms, s_rollups, HISTORY_PRINT_MAX);
+    for (size_t i = n > count ? n - count : 0; i < n; ++i) {
+        print_time(s_rollups[i].start_ms);
+        printf(" min %.2f max %.2f mean %.2f (%lu)\n", s_rollups[i].min, s_rollups[i].max, s_rollups[i].mean,
+               s_rollups[i].count);
+    }
+    return 0;
+}
+
+static int actuators_command(int argc, char** argv) {
+    ActuatorEngine* actuators = s_state_machine->actuators();
+    if (actuators == nullptr) {
+        printf("no actuators\n");
+        return 1;
+    }
+    if (argc == 1) {
+        for (size_t i = 0; i < actuators->channels(); ++i) {
+            ActuatorStats stats = actuators->stats(i);
+            printf("%2d %-8s duty %.2f target %.2f pending %lums switches %lu doses %lu (%.1f s) on %.1f s "
+                   "held %lu limited %lu rejected %lu\n", i, actuators->config(i).name, stats.duty, stats.target,
+                   stats.pending_ms, stats.switches, stats.doses, stats.dosed_us / 1e6, stats.on_us / 1e6,
+                   stats.held, stats.limited, stats.rejected);
+        }
+        const LatencyHistogram& late = actuators->late_us();
+        printf("timer late p50/p99/max %lu/%lu/%luus, %lu commands dropped\n", late.percentile(50),
+               late.percentile(99), late.max(), actuators->dropped());
+        return 0;
+    }
+    size_t channel = argc == 4 ? strtoul(argv[1], nullptr, 10) : actuators->channels();
+    if (channel >= actuators->channels() || strcmp(argv[2], "dose") != 0 ||
+        actuators->config(channel).kind != ActuatorKind::PULSE) {
+        printf("usage: actuators [<dosing channel> dose <ms>]\n");
+        return 1;
+    }
+    // Through the same limits as the controller's doses; the next control tick may replace it
+    // while it waits
+    actuators->dose(channel, strtoul(argv[3], nullptr, 10));
+    return 0;
+}
+
+static int dashboard_command(int argc, char** argv) {
+    const Dashboard* dashboard = s_state_machine->dashboard();
+    if (dashboard == nullptr || !dashboard->running()) {
+        printf("no dashboard\n");
+        return 1;
+    }
+    DashboardStats stats = dashboard->stats();
+    printf("port %d, %lu of %d clients, %lu connections (%lu rejected, %lu timed out, %lu too slow), %lu pages\n",
+           dashboard->port(), stats.clients, dashboard->capacity(), stats.connections, stats.rejected, stats.timeouts,
+           stats.slow_dropped, stats.pages);
+    printf("%lu frames, sent %lu key + %lu delta, last %lu/%lu bytes, %" PRIu64 " bytes sent\n", stats.frames,
+           stats.key_frames_sent, stats.delta_frames_sent, stats.last_key_bytes, stats.last_delta_bytes,
+           stats.bytes_sent);
+    return 0;
+}
+
+static int power_command(int argc, char** argv) {
+    const PowerManager* power = s_state_machine->power();
+    if (power == nullptr || !power->enabled()) {
+        printf("not power-managed\n");
+        return 1;
+    }
+    PowerStats stats = power->stats();
+    printf("%lu.%lu%% in %lu light sleeps (%lu ended by UART) over %" PRIu64 " s, %lu waits\n",
+           stats.residency_permille / 10, stats.residency_permille % 10, stats.sleeps, stats.uart_wakeups,
+           stats.elapsed_us / 1000000, stats.waits);
+    printf("wake latency p50 %lu us, p99 %lu us, max %lu us\n", stats.wake_p50_us, stats.wake_p99_us,
+           stats.wake_max_us);
+    printf("%lu ADC re-arms, p99 %lu us, max %lu us; %lu SEN0311 listens\n", stats.rearms, stats.rearm_p99_us,
+           stats.rearm_max_us, stats.listens);
+    // Sensors, control and telemetry all run on the state task in this mode
+    TaskHandle_t state_task = xTaskGetHandle("state_machine_task");
+    if (state_task != nullptr) {
+        printf("state task stack: %lu bytes never used\n",
+               static_cast<unsigned long>(uxTaskGetStackHighWaterMark(state_task)));
+    }
+    return 0;
+}
+
+static void print_curve(const char* key, const Calibration& calibration) {
+    const CalibrationCurve& curve = calibration.curve();
+    printf("%-12s %s, table within %.4f:", key, calibration.is_default() ? "built-in" : "calibrated",
+           calibration.max_error());
+    for (size_t i = 0; i < curve.points; ++i) {
+        printf(" %.4fV=%.2f", curve.point[i].input, curve.point[i].output);
+    }
+    printf("\n");
+}
+
+static int calibration_command(int argc, char** argv) {
+    static const SensorData::Type TYPES[] = { SensorData::Type::TDS, SensorData::Type::PH };
+    char key[BLOB_KEY_MAX + 1];
+    if (argc == 1) {
+        for (size_t z = 0; z < s_state_machine->zone_count(); ++z) {
+            const Zone& zone = s_state_machine->zone(z);
+            for (SensorData::Type type : TYPES) {
+                zone.calibration_key(type, key, sizeof(key));
+                print_curve(key, *zone.calibration(type));
+            }
+        }
+        if (s_pending_for != nullptr) {
+            printf("%lu points taken, not saved\n", s_pending.points);
+        }
+        return 0;
+    }
+    if (argc < 4 || (strcmp(argv[2], "tds") != 0 && strcmp(argv[2], "ph") != 0)) {
+        printf("usage: cal [<zone> <tds|ph> <point <value>|save|clear|reset>]\n");
+        return 1;
+    }
+    Zone* zone = nullptr;
+    for (size_t z = 0; z < s_state_machine->zone_count(); ++z) {
+        if (strcmp(argv[1], s_state_machine->zone(z).name()) == 0) {
+            zone = &s_state_machine->zone(z);
+        }
+    }
+    if (zone == nullptr) {
+        printf("unknown zone %s\n", argv[1]);
+        return 1;
+    }
+    SensorData::Type type = strcmp(argv[2], "tds") == 0 ? SensorData::Type::TDS : SensorData::Type::PH;
+    Calibration& calibration = *zone->calibration(type);
+    zone->calibration_key(type, key, sizeof(key));
+    if (s_pending_for != &calibration) {
+        s_pending = {};
+        s_pending_for = &calibration;
+    }
+
+    if (strcmp(argv[3], "point") == 0 && argc == 5) {
+        char* end = nullptr;
+        float reference = strtof(argv[4], &end);
+        if (end == argv[4] || !isfinite(reference)) {
+            printf("not a number: %s\n", argv[4]);
+            return 1;
+        }
+        // Probe in the reference solution: average what the sensor converts meanwhile
+        float sum = 0.0f;
+        float low = INFINITY;
+        float high = -INFINITY;
+        for (uint32_t n = 0; n < CAL_POINT_SAMPLES; ++n) {
+            vTaskDelay(pdMS_TO_TICKS(CAL_POINT_MS / CAL_POINT_SAMPLES));
+            float input = calibration.last_input();
+            sum += input;
+            low = fminf(low, input);
+            high = fmaxf(high, input);
+        }
+        CalibrationPoint point = { sum / CAL_POINT_SAMPLES, reference };
+        if (high - low > CAL_SETTLED_V) {
+            printf("input moved by %.4f V, not settled; point not taken\n", high - low);
+            return 1;
+        }
+        if (calibration_add_point(s_pending, point) != ESP_OK) {
+            printf("already %d points\n", CAL_MAX_POINTS);
+            return 1;
+        }
+        printf("%s: %.4f V = %.2f, %lu points\n", key, point.input, point.output, s_pending.points);
+        return 0;
+    }
+    if (strcmp(argv[3], "save") == 0) {
+        esp_err_t ret = calibration.set(s_pending);
+        if (ret == ESP_OK && s_calibration_store != nullptr) {
+            ret = calibration.save(*s_calibration_store, key);
+        }
+        if (ret != ESP_OK) {
+            printf("%s: not saved: %s\n", key, esp_err_to_name(ret));
+            return 1;
+        }
+        s_pending_for = nullptr;
+        print_curve(key, calibration);
+        return 0;
+    }
+    if (strcmp(argv[3], "clear") == 0) {
+        s_pending_for = nullptr;
+        return 0;
+    }
+    if (strcmp(argv[3], "reset") == 0) {
+        calibration.reset();
+        if (s_calibration_store != nullptr) {
+            s_calibration_store->erase(key);
+        }
+        s_pending_for = nullptr;
+        print_curve(key, calibration);
+        return 0;
+    }
+    printf("unknown action %s\n", argv[3]);
+    return 1;
+}
+
+esp_err_t console_start(StateMachine& state_machine, BlobStore* calibration_store) {
+    s_state_machine = &state_machine;
+    s_calibration_store = calibration_store;
+
+    esp_console_repl_t* repl = nullptr;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "hydro>";
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t device_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_usb_serial_jtag(&device_config, &repl_config, &repl);
+#else
+    esp_console_dev_uart_config_t device_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&device_config, &repl_config, &repl);
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Console init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    const esp_console_cmd_t commands[] = {
+        { .command = "metrics", .help = "Read latency and error counters; 'metrics json' as sent in telemetry",
+          .hint = "[json]", .func = metrics_command },
+        { .command = "trace", .help = "Show or set trace verbosity per module",
+          .hint = "[<module|all> <level>]", .func = trace_command },
+        { .command = "cal", .help = "Show TDS and pH calibration, or take points in reference solutions and save them",
+          .hint = "[<zone> <tds|ph> <point <value>|save|clear|reset>]", .func = calibration_command },
+        { .command = "history", .help = "Raw samples and minute or hour min/max/mean of one sensor, newest last",
+          .hint = "[<zone> <tds|ntc|level|ph> [raw|minute|hour] [count]]", .func = history_command },
+        { .command = "actuators", .help = "Pump, heater and dosing outputs and their counters, or a manual dose",
+          .hint = "[<channel> dose <ms>]", .func = actuators_command },
+        { .command = "dashboard", .help = "Web dashboard clients and frames sent", .hint = nullptr,
+          .func = dashboard_command },
+        { .command = "power", .help = "Light sleep residency, wake latency and ADC re-arms", .hint = nullptr,
+          .func = power_command },
+    };
+    for (const esp_console_cmd_t& command : commands) {
+        ESP_ERROR_CHECK(esp_console_cmd_register(&command));
+    }
+    esp_console_register_help_command();
+    return esp_console_start_repl(repl);
+}
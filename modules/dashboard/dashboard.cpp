@@ -0,0 +1,562 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "dashboard.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "dashboard";
+
+static constexpr size_t MAX_VARINT_BYTES = 10;
+static constexpr size_t WS_HEADER_BYTES = 4;    // Server frames are never 64 KB or more
+static constexpr size_t MAX_PAYLOAD_BYTES = DASHBOARD_FRAME_BYTES - WS_HEADER_BYTES;
+static_assert(3 + 3 * MAX_VARINT_BYTES + DASHBOARD_MAX_ZONES * DASHBOARD_NAME_LEN + 1 + DASHBOARD_MAX_CHANNELS * 6
+                  <= MAX_PAYLOAD_BYTES, "a key frame must fit a slot");
+static constexpr int LISTEN_BACKLOG = 8;
+static const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char BAD_REQUEST[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static size_t put_varint(uint8_t* dst, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        dst[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    dst[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t quantize(float value, int32_t scale) {
+    float scaled = value * scale;
+    if (!(scaled == scaled)) {
+        return 0;   // NaN
+    }
+    if (scaled >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (scaled <= -2147483520.0f) {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+static uint32_t rotl(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// Only for the handshake's accept key, so no need for the mbedTLS one
+static void sha1(const uint8_t* data, size_t length, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint64_t bits = static_cast<uint64_t>(length) * 8;
+    size_t total = (length + 8) / 64 * 64 + 64;
+    for (size_t offset = 0; offset < total; offset += 64) {
+        uint8_t block[64];
+        for (size_t i = 0; i < 64; ++i) {
+            size_t pos = offset + i;
+            block[i] = pos < length ? data[pos] : pos == length ? 0x80 : 0;
+        }
+        if (offset + 64 == total) {
+            for (int i = 0; i < 8; ++i) {
+                block[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            }
+        }
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | static_cast<uint32_t>(block[4 * i + 1]) << 16 |
+                   static_cast<uint32_t>(block[4 * i + 2]) << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f = i < 20 ? ((b & c) | (~b & d)) + 0x5A827999
+                       : i < 40 ? (b ^ c ^ d) + 0x6ED9EBA1
+                       : i < 60 ? ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDC
+                       : (b ^ c ^ d) + 0xCA62C1D6;
+            uint32_t t = rotl(a, 5) + f + e + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 20; ++i) {
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static size_t base64(const uint8_t* data, size_t length, char* out) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t n = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = static_cast<uint32_t>(data[i]) << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) |
+                         (i + 2 < length ? data[i + 2] : 0);
+        out[n++] = ALPHABET[group >> 18 & 0x3F];
+        out[n++] = ALPHABET[group >> 12 & 0x3F];
+        out[n++] = i + 1 < length ? ALPHABET[group >> 6 & 0x3F] : '=';
+        out[n++] = i + 2 < length ? ALPHABET[group & 0x3F] : '=';
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Binary message, unmasked, in one frame; returns the frame length
+static size_t put_frame(uint8_t* dst, const uint8_t* payload, size_t length) {
+    size_t n = 0;
+    dst[n++] = 0x82;
+    if (length < 126) {
+        dst[n++] = static_cast<uint8_t>(length);
+    } else {
+        dst[n++] = 126;
+        dst[n++] = static_cast<uint8_t>(length >> 8);
+        dst[n++] = static_cast<uint8_t>(length);
+    }
+    memcpy(dst + n, payload, length);
+    return n + length;
+}
+
+static bool set_nonblocking(int socket) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+Dashboard::Dashboard(DashboardClient* clients, size_t capacity)
+    : clients_(clients), client_capacity_(capacity), stats_{}, frames_{}, sequence_(0), row_version_(0),
+      sent_time_ms_(0), sent_count_(0), sent_values_{}, names_{}, zone_count_(0), listen_socket_(-1), port_(0),
+      stopping_(false), running_(false), page_header_{}, page_header_length_(0) {
+    for (size_t i = 0; i < client_capacity_; ++i) {
+        clients_[i] = {};
+        clients_[i].socket = -1;
+    }
+}
+
+void Dashboard::set_zones(const char* const* names, size_t count) {
+    zone_count_ = count < DASHBOARD_MAX_ZONES ? count : DASHBOARD_MAX_ZONES;
+    for (size_t z = 0; z < zone_count_; ++z) {
+        snprintf(names_[z], sizeof(names_[z]), "%s", names[z]);
+    }
+}
+
+void Dashboard::publish(const SensorData* data, size_t count, int64_t time_ms) {
+    DashboardRow row;
+    row.time_ms = time_ms;
+    row.count = count < DASHBOARD_MAX_CHANNELS ? count : DASHBOARD_MAX_CHANNELS;
+    memcpy(row.data, data, row.count * sizeof(SensorData));
+    row_.store(row);
+}
+
+esp_err_t Dashboard::start(uint16_t port, UBaseType_t priority, uint32_t stack_size) {
+    if (running()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener < 0) {
+        ESP_LOGE(TAG, "socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    socklen_t address_length = sizeof(address);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, LISTEN_BACKLOG) != 0 || !set_nonblocking(listener) ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &address_length) != 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %d: errno %d", port, errno);
+        close(listener);
+        return ESP_FAIL;
+    }
+    listen_socket_ = listener;
+    port_ = ntohs(address.sin_port);
+    page_header_length_ = snprintf(page_header_, sizeof(page_header_),
+                                   "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\n"
+                                   "Content-Length: %d\r\nConnection: close\r\n\r\n", static_cast<int>(DASHBOARD_PAGE_LENGTH));
+    stopping_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    if (xTaskCreate(server_task, "dashboard", stack_size, this, priority, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dashboard task");
+        running_.store(false, std::memory_order_release);
+        close(listen_socket_);
+        listen_socket_ = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Dashboard on port %d, %d clients, %d bytes", port_, client_capacity_, sizeof(*this));
+    return ESP_OK;
+}
+
+void Dashboard::stop() {
+    stopping_.store(true, std::memory_order_relaxed);
+}
+
+void Dashboard::server_task(void* arg) {
+    static_cast<Dashboard*>(arg)->serve();
+    vTaskDelete(nullptr);
+}
+
+void Dashboard::serve() {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        fd_set readable;
+        fd_set writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(listen_socket_, &readable);
+        int max_socket = listen_socket_;
+        bool busy = false;
+        for (size_t i = 0; i < client_capacity_; ++i) {
+            const DashboardClient& client = clients_[i];
+            if (client.state == DashboardClientState::FREE) {
+                continue;
+            }
+            busy = true;
+            FD_SET(client.socket, &readable);
+            if (client.out_sent < client.out_length) {
+                FD_SET(client.socket, &writable);
+            }
+            max_socket = client.socket > max_socket ? client.socket : max_socket;
+        }
+        // Connections only wake the task when there is something to serve them
+        uint32_t wait_ms = busy ? DASHBOARD_POLL_MS : DASHBOARD_IDLE_MS;
+        timeval timeout = { static_cast<time_t>(wait_ms / 1000), static_cast<suseconds_t>(wait_ms % 1000 * 1000) };
+        int ready = select(max_socket + 1, &readable, &writable, nullptr, &timeout);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                ESP_LOGW(TAG, "select: errno %d", errno);
+                vTaskDelay(pdMS_TO_TICKS(DASHBOARD_POLL_MS));
+            }
+            continue;
+        }
+        if (ready > 0 && FD_ISSET(listen_socket_, &readable)) {
+            accept_clients();
+        }
+
+        uint32_t version = row_.version();
+        if (version != 0 && version != row_version_) {
+            row_version_ = version;
+            encode(row_.load());
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        for (size_t i = 0; i < client_capacity_; ++i) {
+            DashboardClient& client = clients_[i];
+            if (client.state == DashboardClientState::FREE) {
+                continue;
+            }
+            if (ready > 0 && FD_ISSET(client.socket, &readable)) {
+                receive(client);
+            }
+            if (client.state == DashboardClientState::REQUEST || client.state == DashboardClientState::RESPONSE) {
+                if (now_us - client.opened_us > static_cast<int64_t>(DASHBOARD_HTTP_TIMEOUT_MS) * 1000) {
+                    stats_.timeouts++;
+                    close_client(client);
+                    continue;
+                }
+            }
+            if (client.state == DashboardClientState::WEBSOCKET && !client.sending_frame && client.frame != sequence_) {
+                next_frame(client);
+            }
+            if (client.state != DashboardClientState::FREE) {
+                send_pending(client);
+            }
+        }
+        published_stats_.store(stats_);
+    }
+
+    for (size_t i = 0; i < client_capacity_; ++i) {
+        if (clients_[i].state != DashboardClientState::FREE) {
+            close_client(clients_[i]);
+        }
+    }
+    close(listen_socket_);
+    listen_socket_ = -1;
+    published_stats_.store(stats_);
+    ESP_LOGI(TAG, "Dashboard stopped");
+    running_.store(false, std::memory_order_release);
+}
+
+void Dashboard::accept_clients() {
+    while (true) {
+        int socket = accept(listen_socket_, nullptr, nullptr);
+        if (socket < 0) {
+            return;     // EAGAIN: none left
+        }
+        DashboardClient* slot = nullptr;
+        for (size_t i = 0; i < client_capacity_ && slot == nullptr; ++i) {
+            slot = clients_[i].state == DashboardClientState::FREE ? &clients_[i] : nullptr;
+        }
+        if (slot == nullptr || socket >= FD_SETSIZE || !set_nonblocking(socket)) {
+            stats_.rejected++;
+            close(socket);
+            continue;
+        }
+        int nodelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        *slot = {};
+        slot->socket = socket;
+        slot->state = DashboardClientState::REQUEST;
+        slot->opened_us = esp_timer_get_time();
+        stats_.connections++;
+    }
+}
+
+void Dashboard::encode(const DashboardRow& row) {
+    uint32_t sequence = sequence_ + 1;
+    Frame& frame = frames_[sequence % DASHBOARD_FRAME_SLOTS];
+    // Clients still sending what this slot held are too far behind to catch up mid-frame
+    for (size_t i = 0; i < client_capacity_; ++i) {
+        DashboardClient& client = clients_[i];
+        if (client.state == DashboardClientState::WEBSOCKET && client.sending_frame &&
+            client.frame == frame.sequence) {
+            stats_.slow_dropped++;
+            close_client(client);
+        }
+    }
+
+    size_t count = row.count;
+    int32_t values[DASHBOARD_MAX_CHANNELS];
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = quantize(row.data[i].value, telemetry_scale(row.data[i].type));
+    }
+
+    uint8_t payload[MAX_PAYLOAD_BYTES];
+    size_t n = 0;
+    payload[n++] = 'K';
+    payload[n++] = DASHBOARD_FORMAT_VERSION;
+    n += put_varint(payload + n, sequence);
+    n += put_varint(payload + n, row.time_ms > 0 ? static_cast<uint64_t>(row.time_ms) : 0);
+    payload[n++] = static_cast<uint8_t>(zone_count_);
+    for (size_t z = 0; z < zone_count_; ++z) {
+        size_t length = strlen(names_[z]);
+        payload[n++] = static_cast<uint8_t>(length);
+        memcpy(payload + n, names_[z], length);
+        n += length;
+    }
+    payload[n++] = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; ++i) {
+        payload[n++] = static_cast<uint8_t>(row.data[i].type);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        n += put_varint(payload + n, zigzag(values[i]));
+    }
+    frame.key_length = put_frame(frame.key, payload, n);
+
+    // Only the values that changed since the last frame
+    n = 0;
+    payload[n++] = 'D';
+    n += put_varint(payload + n, sequence);
+    n += put_varint(payload + n, row.time_ms > sent_time_ms_ ? static_cast<uint64_t>(row.time_ms - sent_time_ms_) : 0);
+    uint32_t changed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        changed |= values[i] != sent_values_[i] ? 1u << i : 0;
+    }
+    n += put_varint(payload + n, changed);
+    for (size_t i = 0; i < count; ++i) {
+        if (changed & (1u << i)) {
+            int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(values[i]) - static_cast<uint32_t>(sent_values_[i]));
+            n += put_varint(payload + n, zigzag(delta));
+        }
+    }
+    // A different layout only goes out as a key frame
+    frame.delta_length = count == sent_count_ ? put_frame(frame.delta, payload, n) : 0;
+    frame.sequence = sequence;
+    sequence_ = sequence;
+    sent_time_ms_ = row.time_ms;
+    sent_count_ = count;
+    memcpy(sent_values_, values, count * sizeof(values[0]));
+    stats_.frames++;
+    stats_.last_key_bytes = frame.key_length;
+    stats_.last_delta_bytes = frame.delta_length;
+}
+
+void Dashboard::receive(DashboardClient& client) {
+    uint8_t buffer[256];
+    ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(client);
+        return;
+    }
+    for (ssize_t i = 0; i < received && client.state == DashboardClientState::REQUEST; ++i) {
+        char c = static_cast<char>(buffer[i]);
+        if (c == '\n') {
+            if (client.line_length > 0 && client.line[client.line_length - 1] == '\r') {
+                client.line_length--;
+            }
+            client.line[client.line_length] = '\0';
+            parse_line(client);
+            client.line_length = 0;
+        } else if (client.line_length < sizeof(client.line) - 1) {
+            client.line[client.line_length++] = c;
+        }
+    }
+    if (client.state != DashboardClientState::WEBSOCKET) {
+        return;     // A body or pipelined requests: not served
+    }
+    // Frames from the browser: only a close matters, the rest is skipped
+    for (ssize_t i = 0; i < received && client.state == DashboardClientState::WEBSOCKET;) {
+        if (client.skip > 0) {
+            size_t skipped = static_cast<size_t>(received - i) < client.skip ? received - i : client.skip;
+            client.skip -= skipped;
+            i += skipped;
+            continue;
+        }
+        client.line[client.line_length++] = static_cast<char>(buffer[i++]);
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(client.line);
+        if (client.line_length < 2) {
+            continue;
+        }
+        size_t length_bytes = (header[1] & 0x7F) == 126 ? 2 : (header[1] & 0x7F) == 127 ? 8 : 0;
+        size_t header_length = 2 + length_bytes + ((header[1] & 0x80) ? 4 : 0);
+        if (client.line_length < header_length) {
+            continue;
+        }
+        uint64_t length = header[1] & 0x7F;
+        if (length_bytes > 0) {
+            length = 0;
+            for (size_t b = 0; b < length_bytes; ++b) {
+                length = length << 8 | header[2 + b];
+            }
+        }
+        client.line_length = 0;
+        if ((header[0] & 0x0F) == 0x8) {
+            close_client(client);
+            return;
+        }
+        client.skip = length;
+    }
+}
+
+void Dashboard::parse_line(DashboardClient& client) {
+    if (!client.requested) {
+        client.requested = true;
+        char method[8];
+        char path[32];
+        if (sscanf(client.line, "%7s %31s", method, path) == 2 && strcmp(method, "GET") == 0) {
+            client.page = strcmp(path, "/") == 0 || strcmp(path, "/index.html") == 0;
+            client.upgrade = strcmp(path, "/ws") == 0;
+        }
+        return;
+    }
+    if (client.line_length == 0) {
+        respond(client);
+        return;
+    }
+    static const char KEY_HEADER[] = "Sec-WebSocket-Key:";
+    if (strncasecmp(client.line, KEY_HEADER, sizeof(KEY_HEADER) - 1) == 0) {
+        const char* value = client.line + sizeof(KEY_HEADER) - 1;
+        while (*value == ' ') {
+            value++;
+        }
+        client.keyed = sscanf(value, "%31s", client.key) == 1;
+    }
+}
+
+void Dashboard::respond(DashboardClient& client) {
+    client.state = DashboardClientState::RESPONSE;
+    client.out_sent = 0;
+    if (client.upgrade && client.keyed) {
+        char accept_input[sizeof(client.key) + sizeof(WEBSOCKET_GUID)];
+        int length = snprintf(accept_input, sizeof(accept_input), "%s%s", client.key, WEBSOCKET_GUID);
+        uint8_t digest[20];
+        sha1(reinterpret_cast<const uint8_t*>(accept_input), length, digest);
+        char accept[32];
+        base64(digest, sizeof(digest), accept);
+        client.out_length = snprintf(client.line, sizeof(client.line),
+                                     "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                                     "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+        client.out = reinterpret_cast<const uint8_t*>(client.line);
+    } else if (client.page) {
+        client.out = reinterpret_cast<const uint8_t*>(page_header_);
+        client.out_length = page_header_length_;
+        client.next = reinterpret_cast<const uint8_t*>(DASHBOARD_PAGE);
+        client.next_length = DASHBOARD_PAGE_LENGTH;
+        stats_.pages++;
+    } else {
+        const char* response = client.upgrade ? BAD_REQUEST : NOT_FOUND;
+        client.out = reinterpret_cast<const uint8_t*>(response);
+        client.out_length = strlen(response);
+    }
+}
+
+void Dashboard::next_frame(DashboardClient& client) {
+    const Frame& frame = frames_[sequence_ % DASHBOARD_FRAME_SLOTS];
+    // A delta only applies on top of the frame just before it
+    bool follows = client.frame != 0 && client.frame + 1 == sequence_ && frame.delta_length > 0;
+    client.out = follows ? frame.delta : frame.key;
+    client.out_length = follows ? frame.delta_length : frame.key_length;
+    client.out_sent = 0;
+    client.frame = sequence_;
+    client.sending_frame = true;
+    if (follows) {
+        stats_.delta_frames_sent++;
+    } else {
+        stats_.key_frames_sent++;
+    }
+}
+
+bool Dashboard::send_pending(DashboardClient& client) {
+    while (client.out_sent < client.out_length) {
+        ssize_t sent = send(client.socket, client.out + client.out_sent, client.out_length - client.out_sent,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            close_client(client);
+            return false;
+        }
+        client.out_sent += static_cast<size_t>(sent);
+        stats_.bytes_sent += static_cast<uint64_t>(sent);
+        if (client.out_sent == client.out_length && client.next != nullptr) {
+            client.out = client.next;
+            client.out_length = client.next_length;
+            client.out_sent = 0;
+            client.next = nullptr;
+        }
+    }
+    client.out = nullptr;
+    client.out_length = 0;
+    client.out_sent = 0;
+    if (client.state == DashboardClientState::WEBSOCKET) {
+        client.sending_frame = false;
+    } else if (client.state == DashboardClientState::RESPONSE) {
+        if (client.upgrade && client.keyed) {
+            client.state = DashboardClientState::WEBSOCKET;
+            client.line_length = 0;
+            stats_.clients++;
+        } else {
+            close_client(client);
+            return false;
+        }
+    }
+    return true;
+}
+
+void Dashboard::close_client(DashboardClient& client) {
+    if (client.state == DashboardClientState::WEBSOCKET) {
+        stats_.clients--;
+    }
+    close(client.socket);
+    client.socket = -1;
+    client.state = DashboardClientState::FREE;
+}
@@ -0,0 +1,68 @@
+#include "dashboard.hpp"
+
+// Served as is from flash. Decodes the frames described in dashboard.hpp; the scales
+// follow telemetry_scale.
+const char DASHBOARD_PAGE[] = R"HTML(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><meta name="viewport" content="width=device-width,initial-scale=1">
+<title>Hydroponics</title>
+<style>
+body{font:15px system-ui,sans-serif;margin:1em;background:#f3f5f3;color:#222}
+h1{font-size:1.2em;margin:0 0 .8em}#s{color:#888;font-weight:normal;font-size:.8em;margin-left:.5em}
+.z{background:#fff;border-radius:6px;padding:.5em 1em;margin-bottom:1em;box-shadow:0 1px 3px #0002}
+h2{font-size:1em;margin:.3em 0}table{border-collapse:collapse;width:100%}td{padding:.2em .4em}
+td.v{text-align:right;font-variant-numeric:tabular-nums;width:6em}canvas{width:100%;height:28px;display:block}
+</style></head><body>
+<h1>Hydroponics<span id="s">connecting</span></h1><div id="z"></div>
+<script>
+const TYPES=[["TDS","ppm",1,0],["Temperature","°C",100,2],["Water level","cm",10,1],["pH","",100,2]];
+const POINTS=120;
+let seq=0,time=0,types=[],vals=[],trend=[],cells=[];
+function varint(b,p){let x=0,m=1,c;do{c=b[p.i++];x+=(c&127)*m;m*=128}while(c&128);return x}
+function unzigzag(x){return x%2?-(x+1)/2:x/2}
+function build(b,p){
+  const zones=b[p.i++],names=[];
+  for(let z=0;z<zones;z++){const n=b[p.i++];names.push(new TextDecoder().decode(b.subarray(p.i,p.i+n)));p.i+=n}
+  const count=b[p.i++];types=Array.from(b.subarray(p.i,p.i+count));p.i+=count;
+  vals=types.map(()=>unzigzag(varint(b,p)));trend=types.map(()=>[]);cells=[];
+  const root=document.getElementById("z");root.textContent="";
+  const per=zones?count/zones:count;
+  for(let i=0;i<count;i++){
+    if(i%per==0){const d=document.createElement("div");d.className="z";
+      d.innerHTML="<h2></h2><table></table>";d.firstChild.textContent=names[i/per]||"zone "+(i/per+1);root.appendChild(d)}
+    const row=root.lastChild.lastChild.insertRow(),t=TYPES[types[i]]||["?","",1,0];
+    row.insertCell().textContent=t[0];const v=row.insertCell();v.className="v";
+    const c=document.createElement("canvas");row.insertCell().appendChild(c);cells.push([v,c]);
+  }
+}
+function draw(){
+  for(let i=0;i<vals.length;i++){
+    const t=TYPES[types[i]]||["?","",1,0],x=vals[i]/t[2],h=trend[i];
+    h.push(x);if(h.length>POINTS)h.shift();
+    cells[i][0].textContent=x.toFixed(t[3])+" "+t[1];
+    const c=cells[i][1],g=c.getContext("2d");c.width=c.clientWidth;c.height=c.clientHeight;
+    const lo=Math.min(...h),hi=Math.max(...h),r=hi-lo||1;g.strokeStyle="#2a7";g.beginPath();
+    h.forEach((y,k)=>g.lineTo(k*c.width/(POINTS-1),c.height-2-(y-lo)/r*(c.height-4)));g.stroke();
+  }
+  const s=Math.floor(time/1000);
+  document.getElementById("s").textContent="live, up "+Math.floor(s/3600)+"h "+Math.floor(s/60)%60+"m "+s%60+"s";
+}
+function connect(){
+  const ws=new WebSocket((location.protocol=="https:"?"wss://":"ws://")+location.host+"/ws");
+  ws.binaryType="arraybuffer";
+  ws.onmessage=e=>{
+    const b=new Uint8Array(e.data),p={i:1};
+    if(b[0]==75){p.i=2;seq=varint(b,p);time=varint(b,p);build(b,p)}
+    else if(b[0]==68){
+      const n=varint(b,p);if(n!=seq+1){ws.close();return}
+      seq=n;time+=varint(b,p);const mask=varint(b,p);
+      for(let i=0;i<vals.length;i++)if(Math.floor(mask/2**i)%2)vals[i]+=unzigzag(varint(b,p));
+    }
+    draw();
+  };
+  ws.onclose=()=>{document.getElementById("s").textContent="reconnecting";seq=0;setTimeout(connect,2000)};
+}
+connect();
+</script></body></html>
+)HTML";
+
+const size_t DASHBOARD_PAGE_LENGTH = sizeof(DASHBOARD_PAGE) - 1;
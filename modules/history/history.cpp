@@ -0,0 +1,300 @@
+#include <string.h>
+
+#include "history.hpp"
+#include "telemetry.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "history";
+
+static constexpr size_t MAX_VARINT_BYTES = 10;
+static constexpr size_t MAX_ROW_BYTES = MAX_VARINT_BYTES + HISTORY_MAX_CHANNELS * 5;
+static_assert(MAX_ROW_BYTES <= HISTORY_CHUNK_BYTES, "a keyframe must fit an empty chunk");
+
+static size_t put_varint(uint8_t* dst, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        dst[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    dst[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+static bool get_varint(const uint8_t* data, size_t length, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < length; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+static int32_t quantize(float value, int32_t scale) {
+    float scaled = value * scale;
+    if (!(scaled == scaled)) {
+        return 0;   // NaN
+    }
+    if (scaled >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (scaled <= -2147483520.0f) {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+// A keyframe is a row coded against time 0 and all-zero values
+static size_t encode_row(uint8_t* dst, uint64_t dt_ms, const int32_t* values, const int32_t* previous,
+                         size_t channels) {
+    size_t n = put_varint(dst, dt_ms);
+    for (size_t i = 0; i < channels; ++i) {
+        int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(values[i]) - static_cast<uint32_t>(previous[i]));
+        n += put_varint(dst + n, zigzag(delta));
+    }
+    return n;
+}
+
+// Calls on_row(time_ms, values) for each row of a chunk's data; false if it is malformed
+template <typename OnRow>
+static bool decode_chunk(const uint8_t* data, size_t length, size_t channels, OnRow on_row) {
+    int64_t time_ms = 0;
+    int32_t values[HISTORY_MAX_CHANNELS] = {};
+    size_t pos = 0;
+    while (pos < length) {
+        uint64_t dt_ms;
+        if (!get_varint(data, length, pos, dt_ms)) {
+            return false;
+        }
+        time_ms += static_cast<int64_t>(dt_ms);
+        for (size_t i = 0; i < channels; ++i) {
+            uint64_t zz;
+            if (!get_varint(data, length, pos, zz)) {
+                return false;
+            }
+            values[i] = static_cast<int32_t>(static_cast<uint32_t>(values[i]) +
+                                             static_cast<uint32_t>(unzigzag(static_cast<uint32_t>(zz))));
+        }
+        if (!on_row(time_ms, values)) {
+            break;
+        }
+    }
+    return true;
+}
+
+History::History(const HistoryStorage& storage)
+    : storage_(storage), open_{}, last_values_{}, newest_chunk_(0), newest_minute_(0), archive_(nullptr),
+      archived_(0), archive_errors_(0) {
+}
+
+esp_err_t History::record(const SensorData* data, size_t count, int64_t time_ms) {
+    const size_t channels = storage_.channels;
+    if (count < channels) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (open_.sequence == 0) {
+        for (size_t i = 0; i < channels; ++i) {
+            storage_.types[i] = data[i].type;
+        }
+    }
+    if (open_.rows > 0 && time_ms < open_.last_ms) {
+        time_ms = open_.last_ms;
+    }
+    int32_t values[HISTORY_MAX_CHANNELS];
+    for (size_t i = 0; i < channels; ++i) {
+        values[i] = quantize(data[i].value, telemetry_scale(storage_.types[i]));
+    }
+
+    uint8_t row[MAX_ROW_BYTES];
+    size_t n = 0;
+    if (open_.rows > 0) {
+        n = encode_row(row, static_cast<uint64_t>(time_ms - open_.last_ms), values, last_values_, channels);
+    }
+    if (open_.rows == 0 || open_.length + n > HISTORY_CHUNK_BYTES) {
+        if (open_.rows > 0) {
+            seal();
+        }
+        static const int32_t ZERO[HISTORY_MAX_CHANNELS] = {};
+        open_.sequence++;
+        open_.length = 0;
+        open_.rows = 0;
+        open_.first_ms = time_ms;
+        n = encode_row(row, static_cast<uint64_t>(time_ms < 0 ? 0 : time_ms), values, ZERO, channels);
+    }
+    memcpy(open_.data + open_.length, row, n);
+    open_.length += n;
+    open_.rows++;
+    open_.last_ms = time_ms;
+    memcpy(last_values_, values, channels * sizeof(values[0]));
+    storage_.chunks[(open_.sequence - 1) % storage_.chunk_count].store(open_);
+    newest_chunk_.store(open_.sequence, std::memory_order_release);
+
+    for (size_t i = 0; i < channels; ++i) {
+        roll_up(i, data[i].value, time_ms);
+    }
+    newest_minute_.store(static_cast<uint32_t>(time_ms / HISTORY_MINUTE_MS) + 1, std::memory_order_release);
+    return ESP_OK;
+}
+
+// The open chunk is complete: to the archive, if any, with the layout in front
+void History::seal() {
+    if (archive_ == nullptr) {
+        return;
+    }
+    uint8_t record[HISTORY_ARCHIVE_HEADER_BYTES + HISTORY_MAX_CHANNELS + HISTORY_CHUNK_BYTES];
+    size_t n = 0;
+    record[n++] = 'H';
+    record[n++] = 'S';
+    record[n++] = HISTORY_FORMAT_VERSION;
+    record[n++] = static_cast<uint8_t>(storage_.channels);
+    for (size_t i = 0; i < storage_.channels; ++i) {
+        record[n++] = static_cast<uint8_t>(storage_.types[i]);
+    }
+    memcpy(record + n, open_.data, open_.length);
+    esp_err_t ret = archive_->push(record, n + open_.length);
+    if (ret == ESP_OK) {
+        archived_++;
+    } else if (archive_errors_++ == 0) {
+        ESP_LOGW(TAG, "Archive write failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void History::roll_up(size_t channel, float value, int64_t time_ms) {
+    if (!(value == value)) {
+        return;     // NaN: no reading
+    }
+    HistoryAccumulator& minute = storage_.open_minutes[channel];
+    int64_t start_ms = time_ms - time_ms % HISTORY_MINUTE_MS;
+    if (minute.count > 0 && minute.start_ms != start_ms) {
+        // The minute is complete: into its hour
+        HistoryAccumulator& hour = storage_.open_hours[channel];
+        int64_t hour_start_ms = minute.start_ms - minute.start_ms % HISTORY_HOUR_MS;
+        if (hour.count == 0 || hour.start_ms != hour_start_ms) {
+            hour = { hour_start_ms, 0, minute.min, minute.max, 0.0f };
+        }
+        hour.count += minute.count;
+        hour.min = minute.min < hour.min ? minute.min : hour.min;
+        hour.max = minute.max > hour.max ? minute.max : hour.max;
+        hour.sum += minute.sum;
+        publish(storage_.hours, storage_.hour_count, channel, hour, HISTORY_HOUR_MS);
+        minute.count = 0;
+    }
+    if (minute.count == 0) {
+        minute = { start_ms, 0, value, value, 0.0f };
+    }
+    minute.count++;
+    minute.min = value < minute.min ? value : minute.min;
+    minute.max = value > minute.max ? value : minute.max;
+    minute.sum += value;
+    publish(storage_.minutes, storage_.minute_count, channel, minute, HISTORY_MINUTE_MS);
+}
+
+// Bucket n of a ring lives in slot n % count, so a query finds it without searching
+void History::publish(Seqlock<HistoryRollup>* slots, size_t count, size_t channel, const HistoryAccumulator& bucket,
+                      int64_t length_ms) {
+    HistoryRollup rollup = { bucket.start_ms, bucket.count, bucket.min, bucket.max, bucket.sum / bucket.count };
+    size_t slot = static_cast<size_t>(bucket.start_ms / length_ms) % count;
+    slots[channel * count + slot].store(rollup);
+}
+
+size_t History::query(size_t channel, int64_t from_ms, int64_t to_ms, HistorySample* out, size_t max) const {
+    if (channel >= storage_.channels || max == 0) {
+        return 0;
+    }
+    const size_t channels = storage_.channels;
+    const float scale = static_cast<float>(telemetry_scale(storage_.types[channel]));
+    uint32_t newest = newest_chunk_.load(std::memory_order_acquire);
+    uint32_t first = newest > storage_.chunk_count ? newest - storage_.chunk_count + 1 : 1;
+    size_t found = 0;
+    for (uint32_t sequence = first; sequence <= newest && sequence != 0 && found < max; ++sequence) {
+        HistoryChunk chunk = storage_.chunks[(sequence - 1) % storage_.chunk_count].load();
+        if (chunk.sequence != sequence || chunk.last_ms < from_ms) {
+            continue;   // Overwritten since, or too old
+        }
+        if (chunk.first_ms > to_ms) {
+            break;
+        }
+        decode_chunk(chunk.data, chunk.length, channels, [&](int64_t time_ms, const int32_t* values) {
+            if (time_ms > to_ms) {
+                return false;
+            }
+            if (time_ms >= from_ms) {
+                out[found++] = { time_ms, static_cast<float>(values[channel]) / scale };
+            }
+            return found < max;
+        });
+    }
+    return found;
+}
+
+size_t History::query(size_t channel, HistoryResolution resolution, int64_t from_ms, int64_t to_ms,
+                      HistoryRollup* out, size_t max) const {
+    uint32_t newest_minute = newest_minute_.load(std::memory_order_acquire);
+    if (channel >= storage_.channels || newest_minute == 0) {
+        return 0;
+    }
+    int64_t newest_ms = static_cast<int64_t>(newest_minute - 1) * HISTORY_MINUTE_MS;
+    if (resolution == HistoryResolution::MINUTE) {
+        return query_buckets(storage_.minutes + channel * storage_.minute_count, storage_.minute_count,
+                             HISTORY_MINUTE_MS, newest_ms, from_ms, to_ms, out, max);
+    }
+    return query_buckets(storage_.hours + channel * storage_.hour_count, storage_.hour_count, HISTORY_HOUR_MS,
+                         newest_ms, from_ms, to_ms, out, max);
+}
+
+size_t History::query_buckets(const Seqlock<HistoryRollup>* slots, size_t count, int64_t length_ms, int64_t newest_ms,
+                              int64_t from_ms, int64_t to_ms, HistoryRollup* out, size_t max) const {
+    int64_t newest = newest_ms / length_ms;
+    int64_t last = to_ms / length_ms < newest ? to_ms / length_ms : newest;
+    int64_t first = from_ms <= 0 ? 0 : (from_ms + length_ms - 1) / length_ms;
+    if (first < newest - static_cast<int64_t>(count) + 1) {
+        first = newest - static_cast<int64_t>(count) + 1;
+    }
+    size_t found = 0;
+    for (int64_t bucket = first; bucket <= last && found < max; ++bucket) {
+        HistoryRollup rollup = slots[static_cast<size_t>(bucket) % count].load();
+        // A slot still holding an older bucket, or none: no samples in that one
+        if (rollup.count > 0 && rollup.start_ms == bucket * length_ms) {
+            out[found++] = rollup;
+        }
+    }
+    return found;
+}
+
+bool History::raw_span(int64_t& first_ms, int64_t& last_ms) const {
+    uint32_t newest = newest_chunk_.load(std::memory_order_acquire);
+    if (newest == 0) {
+        return false;
+    }
+    uint32_t first = newest > storage_.chunk_count ? newest - storage_.chunk_count + 1 : 1;
+    // The oldest chunk may be overwritten while it is read; the next one is then the oldest
+    for (uint32_t sequence = first; sequence <= newest; ++sequence) {
+        HistoryChunk chunk = storage_.chunks[(sequence - 1) % storage_.chunk_count].load();
+        if (chunk.sequence == sequence) {
+            first_ms = chunk.first_ms;
+            break;
+        }
+    }
+    last_ms = storage_.chunks[(newest - 1) % storage_.chunk_count].load().last_ms;
+    return true;
+}
+
+void History::raw_usage(size_t& bytes, size_t& rows) const {
+    bytes = 0;
+    rows = 0;
+    for (size_t i = 0; i < storage_.chunk_count; ++i) {
+        HistoryChunk chunk = storage_.chunks[i].load();
+        bytes += chunk.length;
+        rows += chunk.rows;
+    }
+}
@@ -0,0 +1,92 @@
+#include "esp_power_driver.hpp"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "power_driver";
+
+EspPowerDriver::EspPowerDriver() : wake_timer_(nullptr), waiting_task_(nullptr), counted_{} {
+}
+
+EspPowerDriver::~EspPowerDriver() {
+    if (wake_timer_) {
+        esp_timer_stop(wake_timer_);
+        esp_timer_delete(wake_timer_);
+    }
+}
+
+void EspPowerDriver::on_wake_timer(void* arg) {
+    xTaskNotifyGive(static_cast<EspPowerDriver*>(arg)->waiting_task_);
+}
+
+esp_err_t IRAM_ATTR EspPowerDriver::on_sleep_exit(int64_t slept_us, void* arg) {
+    EspPowerDriver* driver = static_cast<EspPowerDriver*>(arg);
+    driver->counted_.sleeps++;
+    driver->counted_.slept_us += slept_us > 0 ? static_cast<uint64_t>(slept_us) : 0;
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) {
+        driver->counted_.uart_wakeups++;
+    }
+    driver->totals_.store(driver->counted_);
+    return ESP_OK;
+}
+
+esp_err_t EspPowerDriver::start(const PowerConfig& config) {
+#if !CONFIG_PM_ENABLE || !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (config.light_sleep) {
+        ESP_LOGE(TAG, "Light sleep needs CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+    if (wake_timer_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_pm_config_t pm_config = {};
+    pm_config.max_freq_mhz = static_cast<int>(config.max_cpu_mhz);
+    pm_config.min_freq_mhz = static_cast<int>(config.min_cpu_mhz);
+    pm_config.light_sleep_enable = config.light_sleep;
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_wake_timer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "power_wake";
+    ret = esp_timer_create(&timer_args, &wake_timer_);
+    if (ret != ESP_OK) {
+        wake_timer_ = nullptr;
+        return ret;
+    }
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t callbacks = {};
+    callbacks.exit_cb = on_sleep_exit;
+    callbacks.exit_cb_user_arg = this;
+    ret = esp_pm_light_sleep_register_cbs(&callbacks);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Sleep callbacks: %s, residency is not counted", esp_err_to_name(ret));
+    }
+#else
+    ESP_LOGW(TAG, "No CONFIG_PM_LIGHT_SLEEP_CALLBACKS, residency is not counted");
+#endif
+    return ESP_OK;
+}
+
+void EspPowerDriver::sleep_until(int64_t wake_us) {
+    int64_t wait_us = wake_us - esp_timer_get_time();
+    if (wait_us <= 0 || !wake_timer_) {
+        return;
+    }
+    waiting_task_ = xTaskGetCurrentTaskHandle();
+    // Re-armed for every wait; the idle task sleeps until the nearer of it and the next tick timeout
+    if (esp_timer_start_once(wake_timer_, static_cast<uint64_t>(wait_us)) != ESP_OK) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) > 0 ? pdMS_TO_TICKS(wait_us / 1000) : 1);
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
@@ -0,0 +1,70 @@
+#include "power.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "power";
+
+PowerManager::PowerManager(PowerDriver& driver)
+    : driver_(driver), config_{}, enabled_(false), started_us_(0), waits_(0), rearms_(0), listens_(0) {
+}
+
+esp_err_t PowerManager::start(const PowerConfig& config) {
+    if (enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    config_ = config;
+    esp_err_t ret = driver_.start(config_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Power management unavailable: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    started_us_ = esp_timer_get_time();
+    enabled_.store(true, std::memory_order_release);
+    ESP_LOGI(TAG, "Power-managed, %lu..%lu MHz, light sleep %s, coalescing %lu ms", config_.min_cpu_mhz,
+             config_.max_cpu_mhz, config_.light_sleep ? "on" : "off", config_.coalesce_ms);
+    return ESP_OK;
+}
+
+void PowerManager::wait_until(int64_t deadline_us) {
+    waits_.fetch_add(1, std::memory_order_relaxed);
+    if (deadline_us <= esp_timer_get_time()) {
+        return;
+    }
+    uint32_t sleeps = driver_.totals().sleeps;
+    driver_.sleep_until(deadline_us);
+    // Waits the chip stayed awake through only show the scheduler's own latency
+    if (driver_.totals().sleeps != sleeps) {
+        int64_t late_us = esp_timer_get_time() - deadline_us;
+        wake_us_.record(late_us > 0 ? static_cast<uint32_t>(late_us) : 0);
+    }
+}
+
+void PowerManager::record_rearm(uint32_t duration_us) {
+    rearms_.fetch_add(1, std::memory_order_relaxed);
+    rearm_us_.record(duration_us);
+}
+
+PowerStats PowerManager::stats() const {
+    PowerStats stats = {};
+    stats.enabled = enabled();
+    if (!stats.enabled) {
+        return stats;
+    }
+    PowerSleepTotals totals = driver_.totals();
+    stats.waits = waits_.load(std::memory_order_relaxed);
+    stats.sleeps = totals.sleeps;
+    stats.uart_wakeups = totals.uart_wakeups;
+    stats.slept_us = totals.slept_us;
+    int64_t elapsed_us = esp_timer_get_time() - started_us_;
+    stats.elapsed_us = elapsed_us > 0 ? static_cast<uint64_t>(elapsed_us) : 0;
+    stats.residency_permille = stats.elapsed_us > 0
+        ? static_cast<uint32_t>(stats.slept_us * 1000 / stats.elapsed_us) : 0;
+    stats.wake_p50_us = wake_us_.percentile(50);
+    stats.wake_p99_us = wake_us_.percentile(99);
+    stats.wake_max_us = wake_us_.max();
+    stats.rearms = rearms_.load(std::memory_order_relaxed);
+    stats.rearm_p99_us = rearm_us_.percentile(99);
+    stats.rearm_max_us = rearm_us_.max();
+    stats.listens = listens_.load(std::memory_order_relaxed);
+    return stats;
+}
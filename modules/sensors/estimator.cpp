@@ -0,0 +1,67 @@
+#include "estimator.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "estimator";
+
+ScalarKalman::ScalarKalman(const EstimatorConfig& config)
+    : config_(config), estimate_(0.0f), variance_(0.0f), last_time_us_(0), valid_(false),
+      consecutive_rejects_(0), rejected_(0) {
+    configure(config);
+}
+
+void ScalarKalman::configure(const EstimatorConfig& config) {
+    config_ = config;
+    if (config_.process_noise < 0.0f) {
+        config_.process_noise = 0.0f;
+    }
+    if (!(config_.measurement_noise > 0.0f)) {
+        ESP_LOGW(TAG, "Measurement noise must be positive, using 1.0");
+        config_.measurement_noise = 1.0f;
+    }
+    reset();
+}
+
+void ScalarKalman::reset() {
+    estimate_ = 0.0f;
+    variance_ = 0.0f;
+    last_time_us_ = 0;
+    valid_ = false;
+    consecutive_rejects_ = 0;
+}
+
+bool ScalarKalman::update(float measurement, int64_t time_us) {
+    if (!valid_) {
+        estimate_ = measurement;
+        variance_ = config_.measurement_noise;
+        last_time_us_ = time_us;
+        valid_ = true;
+        return true;
+    }
+
+    // Predict: the value may have drifted by process_noise per second since the last reading
+    float dt_s = time_us > last_time_us_ ? (time_us - last_time_us_) * 1e-6f : 0.0f;
+    float predicted_variance = variance_ + config_.process_noise * dt_s;
+    last_time_us_ = time_us;
+
+    float innovation = measurement - estimate_;
+    float innovation_variance = predicted_variance + config_.measurement_noise;
+    if (config_.gate_sigma > 0.0f &&
+        innovation * innovation > config_.gate_sigma * config_.gate_sigma * innovation_variance) {
+        rejected_++;
+        variance_ = predicted_variance;
+        if (++consecutive_rejects_ >= config_.max_rejects) {
+            // Not a glitch but a real step: start over from the new level
+            estimate_ = measurement;
+            variance_ = config_.measurement_noise;
+            consecutive_rejects_ = 0;
+        }
+        return false;
+    }
+    consecutive_rejects_ = 0;
+
+    // Update
+    float gain = predicted_variance / innovation_variance;
+    estimate_ += gain * innovation;
+    variance_ = (1.0f - gain) * predicted_variance;
+    return true;
+}
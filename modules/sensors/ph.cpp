@@ -1,21 +1,23 @@
 #include "ph.hpp"
 #include "esp_log.h"
+#include "trace.hpp"
 
 static const char* TAG = "ph";
 
-// 2-point calibration constants
-static const float PH_CAL_M = 7.425742574257425f;   // slope (pH per V) 2 point calibration
-static const float PH_CAL_B = 0.04950495049504955f; // offset
+// Built-in 2-point calibration, until one is taken on the device (see Calibration)
+static constexpr float PH_CAL_M = 7.425742574257425f;   // slope (pH per V)
+static constexpr float PH_CAL_B = 0.04950495049504955f; // offset
+static constexpr CalibrationCurve PH_DEFAULT_CALIBRATION = {
+    2, { { (4.0f - PH_CAL_B) / PH_CAL_M, 4.0f }, { (7.0f - PH_CAL_B) / PH_CAL_M, 7.0f } } };
 
 // Temperature compensation
 #define TEMP_COEFF -0.03f // pH units per °C deviation from 25°C
 #define REF_TEMP 25.0f    // Reference temperature (°C)
 
-PH::PH(Adc& adc, const AdcConfig& config, size_t channel_idx, const std::vector<SensorData>& sensor_data)
+PH::PH(Adc& adc, const AdcConfig& config, size_t channel_idx)
     : Sensor(SensorData::Type::PH), 
     adc_(adc), config_(config), 
-    channel_idx_(channel_idx), 
-    sensor_data_(sensor_data) {
+    channel_idx_(channel_idx), calibration_(PH_DEFAULT_CALIBRATION) {
     ESP_LOGI(TAG, "PH Sensor initialized on ADC channel %d with 12dB attenuation", config_.channel);
 }
 
@@ -30,27 +32,19 @@ esp_err_t PH::read(float& value) {
             return ESP_ERR_INVALID_RESPONSE;
         }
 
-        // linear calibration formula
-        float pH_uncompensated = PH_CAL_M * voltage + PH_CAL_B;
-
-        // Temperature compensation
-        float temperature = 0.0f;
-        for (const auto& data : sensor_data_) {
-            if (data.type == SensorData::Type::NTC) {
-                temperature = data.value;
-                break;
-            }
-        }
-        float pH_compensated = pH_uncompensated + (TEMP_COEFF * (temperature - REF_TEMP));
-
-        // Range clamp
-        value = (pH_compensated < 0.0f) ? 0.0f : (pH_compensated > 14.0f) ? 14.0f : pH_compensated;
-
-        ESP_LOGD(TAG, "PH Sensor: Voltage=%.3fV, Temp=%.2f°C, pH_uncomp=%.3f, pH_comp=%.3f",
-                 voltage, temperature, pH_uncompensated, value);
+        value = calibration_.apply(voltage);
+        TRACE(PH_READING, voltage, value);
     } else {
         ESP_LOGW(TAG, "PH Sensor read failed: %s", esp_err_to_name(ret));
         value = 0.0f;
     }
     return ret;
-}
\ No newline at end of file
+}
+
+float PH::compensate(float ph_raw, const SensorSample* inputs) {
+    // Skipped while the NTC has no valid reading
+    const SensorSample& ntc = inputs[static_cast<size_t>(SensorData::Type::NTC)];
+    float temperature = ntc.status == ESP_OK ? ntc.value : REF_TEMP;
+    float ph = ph_raw + (TEMP_COEFF * (temperature - REF_TEMP));
+    return (ph < 0.0f) ? 0.0f : (ph > 14.0f) ? 14.0f : ph;
+}
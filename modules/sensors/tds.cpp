@@ -1,23 +1,25 @@
 #include "tds.hpp"
 #include "esp_log.h"
+#include "trace.hpp"
 
 static const char* TAG = "tds";
 
 // Sensor constants (Seeed datasheet)
 // const float CALIBRATION_FACTOR_C = 0.946f;  // C constant
-const float EC_TO_TDS_FACTOR_K = 1.0f;      // K factor
-const float EC_SCALING_FACTOR = 10000.0f;   // datasheet (0-200000 µS/cm)
+static constexpr float EC_TO_TDS_FACTOR_K = 1.0f;      // K factor
+static constexpr float EC_SCALING_FACTOR = 10000.0f;   // datasheet (0-200000 µS/cm)
 
 // Temperature compensation
 const float TEMP_COMP_COEFF = 0.02f; // 2% per °C deviation
 const float REF_TEMP = 25.0f;       // Reference temperature
 
-// 2-point calibration constants
-const float TDS_CAL_M = 1.725f;   
-const float TDS_CAL_B = -967.5f;   
+// Voltage -> EC -> TDS from the datasheet, until a calibration is taken on the device
+static constexpr CalibrationCurve TDS_DEFAULT_CALIBRATION = {
+    2, { { 0.0f, 0.0f }, { 1.0f, EC_SCALING_FACTOR * EC_TO_TDS_FACTOR_K } } };
 
-TDS::TDS(Adc& adc, const AdcConfig& config, size_t channel_idx, const std::vector<SensorData>& sensor_data)
-    : Sensor(SensorData::Type::TDS), adc_(adc), config_(config), channel_idx_(channel_idx), sensor_data_(sensor_data) {
+TDS::TDS(Adc& adc, const AdcConfig& config, size_t channel_idx)
+    : Sensor(SensorData::Type::TDS), adc_(adc), config_(config), channel_idx_(channel_idx),
+      calibration_(TDS_DEFAULT_CALIBRATION) {
     ESP_LOGI(TAG, "TDS Sensor initialized on ADC channel %d", config_.channel);
 }
 
@@ -26,15 +28,9 @@ esp_err_t TDS::read(float& value) {
     esp_err_t ret = adc_.read(channel_idx_, voltage);
 
     if (ret == ESP_OK) {
-        // 1) Voltage → EC
-        float ppm = EC_SCALING_FACTOR * voltage;
+        value = calibration_.apply(voltage);
 
-        // 2) EC → TDS
-        value = EC_TO_TDS_FACTOR_K * ppm;
-
-        // Logging
-        ESP_LOGD(TAG, "TDS Sensor: Voltage=%.3fV,  TDS=%.1f",
-                 voltage, value);
+        TRACE(TDS_READING, voltage, value);
     } else {
         ESP_LOGW(TAG, "TDS Sensor read failed: %s", esp_err_to_name(ret));
         value = 0.0f;
@@ -42,3 +38,12 @@ esp_err_t TDS::read(float& value) {
 
     return ret;
 }
+
+
+float TDS::compensate(float tds_raw, const SensorSample* inputs) {
+    // Conductivity rises ~2 %/°C; skipped while the NTC has no valid reading
+    const SensorSample& ntc = inputs[static_cast<size_t>(SensorData::Type::NTC)];
+    float temperature = ntc.status == ESP_OK ? ntc.value : REF_TEMP;
+    float coefficient = 1.0f + TEMP_COMP_COEFF * (temperature - REF_TEMP);
+    return coefficient > 0.0f ? tds_raw / coefficient : tds_raw;
+}
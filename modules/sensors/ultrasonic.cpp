@@ -1,20 +1,31 @@
 #include "ultrasonic.hpp"
 #include "esp_log.h"
+#include "trace.hpp"
+
+#include <algorithm>
 
 static const char* TAG = "ultrasonic";
 
-Ultrasonic::Ultrasonic(Uart& uart)
-    : Sensor(SensorData::Type::WATER_LEVEL), uart_(uart) {
+Ultrasonic::Ultrasonic(Uart& uart, float tank_height_cm)
+    : Sensor(SensorData::Type::WATER_LEVEL), uart_(uart), tank_height_cm_(tank_height_cm), age_ms_(UINT32_MAX) {
     ESP_LOGI(TAG, "Ultrasonic Sensor initialized on UART");
 }
 
 esp_err_t Ultrasonic::read(float& value) {
-    if (uart_.read_sen0311_distance(value)) {
-        ESP_LOGD(TAG, "Ultrasonic Sensor: Distance=%.1f cm", value);
-        return ESP_OK;
-    } else {
-        // ESP_LOGW(TAG, "Ultrasonic Sensor read failed");
+    // Returns immediately with whatever the UART receive task decoded last
+    float distance_cm = 0.0f;
+    if (!uart_.read_sen0311_distance(distance_cm, age_ms_)) {
+        age_ms_ = UINT32_MAX;
+        value = 0.0f;
+        return ESP_ERR_NOT_FINISHED;
+    }
+    if (age_ms_ > ULTRASONIC_STALE_MS) {
+        TRACE(LEVEL_STALE, age_ms_);
         value = 0.0f;
-        return ESP_FAIL;
+        return ESP_ERR_TIMEOUT;
     }
-}
\ No newline at end of file
+    // A ripple or an echo can read past the floor or above the sensor's own height
+    value = std::clamp(tank_height_cm_ - distance_cm, 0.0f, tank_height_cm_);
+    TRACE(LEVEL_READING, distance_cm, age_ms_);
+    return ESP_OK;
+}
@@ -0,0 +1,83 @@
+#include "adaptive_rate.hpp"
+
+#include <math.h>
+
+// Smoothing of the deviation estimate per reading
+static constexpr float ADAPTIVE_ALPHA = 0.3f;
+// A reading this many mean deviations (or quiet_deviation, if larger) off the prediction is a step
+static constexpr float ADAPTIVE_STEP_FACTOR = 4.0f;
+
+AdaptiveRate::AdaptiveRate()
+    : config_(), period_ms_(0), last_value_(0.0f), last_time_us_(0), anchor_value_(0.0f), anchor_time_us_(0),
+      slope_(0.0f), deviation_(0.0f),
+      quiet_count_(0), valid_(false) {
+}
+
+void AdaptiveRate::configure(const AdaptiveRateConfig& config) {
+    config_ = config;
+    reset();
+}
+
+void AdaptiveRate::reset() {
+    period_ms_ = config_.min_period_ms;
+    slope_ = 0.0f;
+    deviation_ = 0.0f;
+    anchor_time_us_ = 0;
+    quiet_count_ = 0;
+    valid_ = false;
+}
+
+uint32_t AdaptiveRate::update(float value, int64_t time_us, float watch, bool has_watch) {
+    if (!valid_ || time_us <= last_time_us_) {
+        last_value_ = anchor_value_ = value;
+        last_time_us_ = anchor_time_us_ = time_us;
+        valid_ = true;
+        return period_ms_;
+    }
+
+    float dt_s = (time_us - last_time_us_) * 1e-6f;
+    float predicted = last_value_ + slope_ * dt_s;
+    float residual = fabsf(value - predicted);
+    float step_limit = ADAPTIVE_STEP_FACTOR * fmaxf(deviation_, config_.quiet_deviation);
+    bool step = residual > step_limit;
+
+    // A step would inflate the deviation for many readings; the step itself is handled below
+    deviation_ += ADAPTIVE_ALPHA * (fminf(residual, step_limit) - deviation_);
+    last_value_ = value;
+    last_time_us_ = time_us;
+
+    // Reading-to-reading differences at a 50 ms period are all noise; over a window the
+    // noise stays the same while the change grows with it
+    int64_t window_us = time_us - anchor_time_us_;
+    if (step) {
+        slope_ = 0.0f;
+        anchor_value_ = value;
+        anchor_time_us_ = time_us;
+    } else if (window_us >= static_cast<int64_t>(config_.slope_window_ms) * 1000) {
+        slope_ = (value - anchor_value_) / (window_us * 1e-6f);
+        anchor_value_ = value;
+        anchor_time_us_ = time_us;
+    }
+
+    bool ramp = fabsf(slope_) > 2.0f * config_.quiet_slope;
+    bool near_watch = has_watch && config_.approach_band > 0.0f && fabsf(value - watch) < config_.approach_band;
+    if (step || ramp || near_watch) {
+        period_ms_ = config_.min_period_ms;
+        quiet_count_ = 0;
+    } else if (fabsf(slope_) < config_.quiet_slope && deviation_ < config_.quiet_deviation) {
+        if (++quiet_count_ >= config_.quiet_readings) {
+            uint32_t longer = period_ms_ * 2;
+            period_ms_ = longer < config_.max_period_ms ? longer : config_.max_period_ms;
+            quiet_count_ = 0;
+        }
+    } else {
+        quiet_count_ = 0;
+    }
+    return period_ms_;
+}
+
+uint32_t AdaptiveRate::on_error() {
+    period_ms_ = config_.min_period_ms;
+    quiet_count_ = 0;
+    return period_ms_;
+}
@@ -0,0 +1,195 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "control_config.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "control_config";
+
+static constexpr int MAX_DEPTH = 2;
+static constexpr size_t MAX_KEY_LENGTH = 31;
+static constexpr size_t MAX_NUMBER_LENGTH = 31;
+
+// Minimal JSON reader for config objects: nested objects, strings without
+// escapes and numbers. Booleans, null and arrays are not needed and rejected.
+class JsonReader {
+    const char* pos_;
+    const char* end_;
+
+    public:
+        JsonReader(const char* json, size_t length) : pos_(json), end_(json + length) {}
+
+        void skip_space() {
+            while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')) {
+                ++pos_;
+            }
+        }
+
+        bool consume(char c) {
+            skip_space();
+            if (pos_ < end_ && *pos_ == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        bool peek(char c) {
+            skip_space();
+            return pos_ < end_ && *pos_ == c;
+        }
+
+        bool at_end() {
+            skip_space();
+            return pos_ == end_;
+        }
+
+        bool string(char* dst, size_t capacity) {
+            if (!consume('"')) {
+                return false;
+            }
+            size_t n = 0;
+            while (pos_ < end_ && *pos_ != '"') {
+                if (*pos_ == '\\' || n + 1 >= capacity) {
+                    return false;
+                }
+                dst[n++] = *pos_++;
+            }
+            dst[n] = '\0';
+            return consume('"');
+        }
+
+        bool number(float& value) {
+            skip_space();
+            char buffer[MAX_NUMBER_LENGTH + 1];
+            size_t n = 0;
+            while (pos_ < end_ && n < MAX_NUMBER_LENGTH && strchr("+-.0123456789eE", *pos_) != nullptr) {
+                buffer[n++] = *pos_++;
+            }
+            buffer[n] = '\0';
+            char* parsed_end = nullptr;
+            value = strtof(buffer, &parsed_end);
+            return n > 0 && parsed_end == buffer + n;
+        }
+};
+
+static bool parse_mode(const char* name, ControlMode& mode) {
+    if (strcmp(name, "on_off") == 0) {
+        mode = ControlMode::ON_OFF_CONTROL;
+    } else if (strcmp(name, "pid") == 0) {
+        mode = ControlMode::PID_CONTROL;
+    } else if (strcmp(name, "fuzzy") == 0) {
+        mode = ControlMode::FUZZY_LOGIC_CONTROL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static float* gain_field(PidGains& gains, const char* key) {
+    if (strcmp(key, "kp") == 0) return &gains.kp;
+    if (strcmp(key, "ki") == 0) return &gains.ki;
+    if (strcmp(key, "kd") == 0) return &gains.kd;
+    if (strcmp(key, "out_min") == 0) return &gains.out_min;
+    if (strcmp(key, "out_max") == 0) return &gains.out_max;
+    return nullptr;
+}
+
+static PidGains* gains_object(ControlConfig& config, const char* key) {
+    if (strcmp(key, "pump_pid") == 0) return &config.pump_pid;
+    if (strcmp(key, "heater_pid") == 0) return &config.heater_pid;
+    if (strcmp(key, "dosing_pid") == 0) return &config.dosing_pid;
+    return nullptr;
+}
+
+static float* threshold_field(ControlConfig& config, const char* key) {
+    if (strcmp(key, "tds_threshold") == 0) return &config.tds_threshold;
+    if (strcmp(key, "temp_threshold") == 0) return &config.temp_threshold;
+    if (strcmp(key, "water_level_threshold") == 0) return &config.water_level_threshold;
+    return nullptr;
+}
+
+// Parses one object; gains is set while inside a *_pid object
+static esp_err_t parse_object(JsonReader& reader, ControlConfig& config, PidGains* gains, int depth) {
+    if (depth > MAX_DEPTH || !reader.consume('{')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (reader.consume('}')) {
+        return ESP_OK;
+    }
+    do {
+        char key[MAX_KEY_LENGTH + 1];
+        if (!reader.string(key, sizeof(key)) || !reader.consume(':')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        float* field = gains ? gain_field(*gains, key) : threshold_field(config, key);
+        PidGains* nested = gains ? nullptr : gains_object(config, key);
+        if (field != nullptr) {
+            if (!reader.number(*field)) {
+                ESP_LOGW(TAG, "'%s' must be a number", key);
+                return ESP_ERR_INVALID_ARG;
+            }
+        } else if (nested != nullptr) {
+            esp_err_t ret = parse_object(reader, config, nested, depth + 1);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        } else if (gains == nullptr && strcmp(key, "mode") == 0) {
+            char name[16];
+            if (!reader.string(name, sizeof(name)) || !parse_mode(name, config.mode)) {
+                ESP_LOGW(TAG, "'mode' must be \"on_off\", \"pid\" or \"fuzzy\"");
+                return ESP_ERR_INVALID_ARG;
+            }
+        } else {
+            ESP_LOGW(TAG, "Unknown key '%s'", key);
+            return ESP_ERR_NOT_FOUND;
+        }
+    } while (reader.consume(','));
+    return reader.consume('}') ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t control_config_parse(const char* json, size_t length, ControlConfig& config) {
+    JsonReader reader(json, length);
+    esp_err_t ret = parse_object(reader, config, nullptr, 0);
+    if (ret == ESP_OK && !reader.at_end()) {
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    if (ret == ESP_ERR_INVALID_ARG) {
+        ESP_LOGW(TAG, "Malformed config update");
+    }
+    return ret;
+}
+
+static bool in_range(float value, float lo, float hi) {
+    return isfinite(value) && value >= lo && value <= hi;
+}
+
+static bool gains_valid(const PidGains& gains, float control_dt_s) {
+    return in_range(gains.kp, 0.0f, 1000.0f) && in_range(gains.ki, 0.0f, 1000.0f) &&
+           in_range(gains.kd, 0.0f, 1000.0f) && in_range(gains.out_min, -1.0f, 1.0f) &&
+           in_range(gains.out_max, -1.0f, 1.0f) && gains.out_min < gains.out_max &&
+           Pid<ControlScalar>::gain_error(gains, control_dt_s) <= PID_GAIN_TOLERANCE;
+}
+
+esp_err_t control_config_validate(const ControlConfig& config, float tank_height_cm, float control_dt_s) {
+    const char* problem = nullptr;
+    if (!in_range(config.tds_threshold, 0.0f, 5000.0f)) {
+        problem = "tds_threshold outside 0..5000 ppm";
+    } else if (!in_range(config.temp_threshold, 0.0f, 40.0f)) {
+        problem = "temp_threshold outside 0..40 °C";
+    } else if (!in_range(config.water_level_threshold, 0.0f, tank_height_cm)) {
+        problem = "water_level_threshold outside the tank";
+    } else if (!gains_valid(config.pump_pid, control_dt_s)) {
+        problem = "pump_pid gains";
+    } else if (!gains_valid(config.heater_pid, control_dt_s)) {
+        problem = "heater_pid gains";
+    } else if (!gains_valid(config.dosing_pid, control_dt_s)) {
+        problem = "dosing_pid gains";
+    }
+    if (problem != nullptr) {
+        ESP_LOGW(TAG, "Rejected config: %s", problem);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
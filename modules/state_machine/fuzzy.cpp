@@ -0,0 +1,34 @@
+#include "fuzzy.hpp"
+
+void FuzzyController::evaluate(const float (&inputs)[FUZZY_INPUTS], float (&outputs)[FUZZY_OUTPUTS]) const {
+    // One load per evaluation, so a concurrent set_rules() never mixes two tables
+    const FuzzyRuleSet& set = rules();
+
+    // Fuzzify every term once
+    float degree[FUZZY_INPUTS][FUZZY_MAX_TERMS];
+    for (size_t i = 0; i < FUZZY_INPUTS; ++i) {
+        for (size_t t = 0; t < set.inputs[i].term_count; ++t) {
+            degree[i][t] = set.inputs[i].terms[t](inputs[i]);
+        }
+    }
+
+    float weighted[FUZZY_OUTPUTS] = {};
+    float weight[FUZZY_OUTPUTS] = {};
+    for (size_t r = 0; r < set.rule_count; ++r) {
+        const FuzzyRule& rule = set.rules[r];
+        float strength = 1.0f;
+        for (size_t i = 0; i < FUZZY_INPUTS; ++i) {
+            if (rule.terms[i] != FUZZY_ANY && degree[i][rule.terms[i]] < strength) {
+                strength = degree[i][rule.terms[i]];
+            }
+        }
+        size_t out = static_cast<size_t>(rule.output);
+        weighted[out] += strength * rule.value;
+        weight[out] += strength;
+    }
+
+    // Weighted average defuzzification; no active rule means the output is off
+    for (size_t o = 0; o < FUZZY_OUTPUTS; ++o) {
+        outputs[o] = weight[o] > 0.0f ? weighted[o] / weight[o] : 0.0f;
+    }
+}
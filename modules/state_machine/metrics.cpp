@@ -0,0 +1,40 @@
+#include "metrics.hpp"
+
+static const char* const ERROR_KIND_NAMES[ERROR_KIND_COUNT] = {
+    "no_data", "timeout", "over_range", "out_of_range", "driver",
+};
+
+ErrorKind error_kind(esp_err_t status) {
+    switch (status) {
+        case ESP_ERR_NOT_FINISHED:
+            return ErrorKind::NO_DATA;
+        case ESP_ERR_TIMEOUT:
+            return ErrorKind::TIMEOUT;
+        case ESP_ERR_INVALID_STATE:
+            return ErrorKind::OVER_RANGE;
+        case ESP_ERR_INVALID_RESPONSE:
+            return ErrorKind::OUT_OF_RANGE;
+        default:
+            return ErrorKind::DRIVER;
+    }
+}
+
+const char* error_kind_name(ErrorKind kind) {
+    size_t index = static_cast<size_t>(kind);
+    return index < ERROR_KIND_COUNT ? ERROR_KIND_NAMES[index] : "?";
+}
+
+void OpMetrics::reset() {
+    latency_us_.reset();
+    for (auto& errors : errors_) {
+        errors.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t OpMetrics::error_total() const {
+    uint32_t total = 0;
+    for (const auto& errors : errors_) {
+        total += errors.load(std::memory_order_relaxed);
+    }
+    return total;
+}
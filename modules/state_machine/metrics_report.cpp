@@ -0,0 +1,165 @@
+#include "state_machine.hpp"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace {
+
+const char* const SENSOR_NAMES[SensorData::TYPE_COUNT] = { "tds", "ntc", "level", "ph" };
+
+// snprintf into a fixed buffer, silently truncating once it is full
+struct ReportWriter {
+    char* out;
+    size_t size;
+    size_t length;
+
+    void add(const char* format, ...) {
+        if (length + 1 >= size) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(out + length, size - length, format, args);
+        va_end(args);
+        if (written > 0) {
+            length += static_cast<size_t>(written) < size - length ? static_cast<size_t>(written) : size - length - 1;
+        }
+    }
+
+    // Errors by kind, only the non-zero ones
+    void errors(const OpMetrics& metrics, MetricsFormat format) {
+        bool first = true;
+        if (format == MetricsFormat::JSON) {
+            add(",\"errors\":{");
+        }
+        for (size_t k = 0; k < ERROR_KIND_COUNT; ++k) {
+            uint32_t count = metrics.errors(static_cast<ErrorKind>(k));
+            if (count == 0) {
+                continue;
+            }
+            const char* name = error_kind_name(static_cast<ErrorKind>(k));
+            if (format == MetricsFormat::JSON) {
+                add("%s\"%s\":%lu", first ? "" : ",", name, count);
+            } else {
+                add(" %s=%lu", name, count);
+            }
+            first = false;
+        }
+        if (format == MetricsFormat::JSON) {
+            add("}");
+        } else if (first) {
+            add(" -");
+        }
+    }
+
+    void op(const char* name, const OpMetrics& metrics, MetricsFormat format) {
+        const LatencyHistogram& latency = metrics.latency_us();
+        if (format == MetricsFormat::JSON) {
+            add("\"%s\":{\"calls\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu", name, metrics.calls(),
+                latency.percentile(50), latency.percentile(99), latency.max());
+            errors(metrics, format);
+            add("}");
+        } else {
+            add("%-14s %8lu %7lu %7lu %7lu ", name, metrics.calls(), latency.percentile(50),
+                latency.percentile(99), latency.max());
+            errors(metrics, format);
+            add("\n");
+        }
+    }
+};
+
+}  // namespace
+
+size_t StateMachine::metrics_report(char* out, size_t size, MetricsFormat format) const {
+    if (size == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    ReportWriter w = { out, size, 0 };
+    bool json = format == MetricsFormat::JSON;
+
+    // Per zone: Sensor::read as the samplers see it, including the ADC or UART access
+    // below it, the current sample periods and the SEN0311 link
+    if (json) {
+        w.add("{\"zones\":{");
+    } else {
+        w.add("%-14s %8s %7s %7s %7s  errors\n", "read", "calls", "p50 us", "p99 us", "max us");
+    }
+    for (size_t z = 0; z < zone_count_; ++z) {
+        const Zone& zone = *zones_[z];
+        const auto& samplers = zone.samplers();
+        if (json) {
+            w.add("%s\"%s\":{", z > 0 ? "," : "", zone.name());
+        }
+        for (size_t i = 0; i < samplers.size(); ++i) {
+            size_t type = static_cast<size_t>(samplers[i].type());
+            const char* sensor = type < SensorData::TYPE_COUNT ? SENSOR_NAMES[type] : "?";
+            char name[24];
+            snprintf(name, sizeof(name), json ? "%s" : "%s.%s", json ? sensor : zone.name(), sensor);
+            if (json && i > 0) {
+                w.add(",");
+            }
+            w.op(name, samplers[i].metrics(), format);
+        }
+
+        if (json) {
+            w.add(",\"period_ms\":{");
+        } else {
+            w.add("%s period ms ", zone.name());
+        }
+        for (size_t i = 0; i < samplers.size(); ++i) {
+            size_t type = static_cast<size_t>(samplers[i].type());
+            const char* name = type < SensorData::TYPE_COUNT ? SENSOR_NAMES[type] : "?";
+            w.add(json ? "%s\"%s\":%lu" : "%s%s=%lu", i > 0 ? (json ? "," : " ") : "", name, samplers[i].period_ms());
+        }
+        w.add(json ? "}," : "\n");
+
+        char link_name[24];
+        snprintf(link_name, sizeof(link_name), json ? "sen0311" : "%s.sen0311", zone.name());
+        w.op(link_name, zone.uart().read_metrics(), format);
+        Sen0311Stats link = zone.uart().sen0311_stats();
+        if (json) {
+            w.add(",\"link\":{\"frames\":%lu,\"checksum\":%lu,\"range\":%lu,\"discarded\":%lu,\"timeouts\":%lu,"
+                  "\"overflows\":%lu}}", link.frames, link.checksum_errors, link.range_errors, link.discarded_bytes,
+                  link.timeouts, link.overflows);
+        } else {
+            w.add("%s frames=%lu checksum=%lu range=%lu discarded=%lu timeouts=%lu overflows=%lu\n", link_name,
+                  link.frames, link.checksum_errors, link.range_errors, link.discarded_bytes, link.timeouts,
+                  link.overflows);
+        }
+    }
+
+    // Adc::read per unit and channel
+    w.add(json ? "},\"adc\":{" : "");
+    for (size_t unit = 0; unit < adc_count_; ++unit) {
+        for (size_t channel = 0; channel < adcs_[unit]->channels(); ++channel) {
+            char name[16];
+            snprintf(name, sizeof(name), "adc%d.%d", static_cast<int>(unit), static_cast<int>(channel));
+            if (json && (unit > 0 || channel > 0)) {
+                w.add(",");
+            }
+            w.op(name, adcs_[unit]->metrics(channel), format);
+        }
+    }
+    w.add(json ? "}" : "");
+
+    // States, from the scheduler
+    if (json) {
+        w.add(",\"states\":{");
+    } else {
+        w.add("%-14s %8s %8s %7s %7s %7s\n", "state", "runs", "overruns", "p99 us", "max us", "jit p99");
+    }
+    for (size_t i = 0; i < STATE_COUNT; ++i) {
+        ScheduleStats stats = scheduler_.stats(i);
+        const char* name = state_name(static_cast<State>(i));
+        if (json) {
+            w.add("%s\"%s\":{\"runs\":%lu,\"overruns\":%lu,\"p99\":%lu,\"max\":%lu,\"jitter_p99\":%lu}", i > 0 ? "," : "",
+                  name, stats.runs, stats.overruns, stats.exec_p99_us, stats.exec_max_us, stats.jitter_p99_us);
+        } else {
+            w.add("%-14s %8lu %8lu %7lu %7lu %7lu\n", name, stats.runs, stats.overruns, stats.exec_p99_us,
+                  stats.exec_max_us, stats.jitter_p99_us);
+        }
+    }
+    w.add(json ? "}}" : "");
+    return w.length;
+}
@@ -0,0 +1,109 @@
+#include "scheduler.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "scheduler";
+
+Scheduler::Scheduler() : slot_count_(0), last_wake_(0) {
+}
+
+size_t Scheduler::add(uint32_t period_ms) {
+    if (slot_count_ >= MAX_SLOTS) {
+        ESP_LOGE(TAG, "No free schedule slot for period %lu ms", period_ms);
+        return MAX_SLOTS;
+    }
+    Slot& slot = slots_[slot_count_];
+    slot.period_ms = period_ms;
+    slot.period_ticks = pdMS_TO_TICKS(period_ms) > 0 ? pdMS_TO_TICKS(period_ms) : 1;
+    slot.deadline = 0;
+    slot.deadline_us = 0;
+    slot.started_us = 0;
+    slot.runs.store(0, std::memory_order_relaxed);
+    slot.overruns.store(0, std::memory_order_relaxed);
+    slot.exec_us.reset();
+    slot.jitter_us.reset();
+    return slot_count_++;
+}
+
+void Scheduler::start() {
+    last_wake_ = xTaskGetTickCount();
+    int64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < slot_count_; ++i) {
+        slots_[i].deadline = last_wake_;
+        slots_[i].deadline_us = now_us;
+    }
+}
+
+bool Scheduler::due(size_t id) const {
+    if (id >= slot_count_) {
+        return false;
+    }
+    return static_cast<int32_t>(xTaskGetTickCount() - slots_[id].deadline) >= 0;
+}
+
+void Scheduler::begin(size_t id) {
+    Slot& slot = slots_[id];
+    slot.started_us = esp_timer_get_time();
+    int64_t late_us = slot.started_us - slot.deadline_us;
+    slot.jitter_us.record(late_us > 0 ? static_cast<uint32_t>(late_us) : 0);
+}
+
+void Scheduler::end(size_t id) {
+    Slot& slot = slots_[id];
+    slot.exec_us.record(static_cast<uint32_t>(esp_timer_get_time() - slot.started_us));
+    slot.runs.fetch_add(1, std::memory_order_relaxed);
+
+    slot.deadline += slot.period_ticks;
+    slot.deadline_us += static_cast<int64_t>(slot.period_ms) * 1000;
+
+    // Ran past the next deadline: count it and skip the missed periods instead of bursting
+    TickType_t now = xTaskGetTickCount();
+    if (static_cast<int32_t>(now - slot.deadline) >= 0) {
+        slot.overruns.fetch_add(1, std::memory_order_relaxed);
+        while (static_cast<int32_t>(now - slot.deadline) >= 0) {
+            slot.deadline += slot.period_ticks;
+            slot.deadline_us += static_cast<int64_t>(slot.period_ms) * 1000;
+        }
+    }
+}
+
+TickType_t Scheduler::next_deadline() const {
+    if (slot_count_ == 0) {
+        return xTaskGetTickCount() + portMAX_DELAY / 2;
+    }
+    TickType_t earliest = slots_[0].deadline;
+    for (size_t i = 1; i < slot_count_; ++i) {
+        if (static_cast<int32_t>(slots_[i].deadline - earliest) < 0) {
+            earliest = slots_[i].deadline;
+        }
+    }
+    return earliest;
+}
+
+void Scheduler::wait_next() {
+    TickType_t earliest = next_deadline();
+    if (static_cast<int32_t>(earliest - last_wake_) <= 0) {
+        // Already due; keep last_wake_ on the schedule without sleeping
+        last_wake_ = xTaskGetTickCount();
+        return;
+    }
+    xTaskDelayUntil(&last_wake_, earliest - last_wake_);
+}
+
+ScheduleStats Scheduler::stats(size_t id) const {
+    ScheduleStats stats = {};
+    if (id >= slot_count_) {
+        return stats;
+    }
+    const Slot& slot = slots_[id];
+    stats.period_ms = slot.period_ms;
+    stats.runs = slot.runs.load(std::memory_order_relaxed);
+    stats.overruns = slot.overruns.load(std::memory_order_relaxed);
+    stats.exec_min_us = slot.exec_us.min();
+    stats.exec_p50_us = slot.exec_us.percentile(50);
+    stats.exec_p99_us = slot.exec_us.percentile(99);
+    stats.exec_max_us = slot.exec_us.max();
+    stats.jitter_p99_us = slot.jitter_us.percentile(99);
+    stats.jitter_max_us = slot.jitter_us.max();
+    return stats;
+}
@@ -0,0 +1,98 @@
+#include "sensor_registry.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "sensor_registry";
+
+SensorRegistry::SensorRegistry()
+    : nodes_{}, order_{}, order_count_(0), cycle_(0), recomputed_(0), skipped_(0) {
+    for (auto& value : values_) {
+        value = { 0.0f, ESP_ERR_NOT_FOUND, 0, 0.0f };
+    }
+}
+
+esp_err_t SensorRegistry::add(SensorData::Type type, uint32_t depends_on, SensorDerive derive) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= SensorData::TYPE_COUNT || (depends_on & sensor_bit(type)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nodes_[index] = { true, depends_on, derive, 0, 0 };
+    values_[index] = { 0.0f, ESP_ERR_NOT_FINISHED, 0, 0.0f };
+    order_count_ = 0;
+    return ESP_OK;
+}
+
+esp_err_t SensorRegistry::finalize() {
+    // Kahn's algorithm; with a handful of sensors a repeated scan is simplest
+    uint32_t registered = 0;
+    for (size_t i = 0; i < SensorData::TYPE_COUNT; ++i) {
+        if (nodes_[i].registered) {
+            registered |= 1u << i;
+        }
+    }
+    for (size_t i = 0; i < SensorData::TYPE_COUNT; ++i) {
+        if (nodes_[i].registered && (nodes_[i].depends_on & ~registered) != 0) {
+            ESP_LOGE(TAG, "Sensor %d depends on an unregistered sensor", i);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    uint32_t placed = 0;
+    order_count_ = 0;
+    bool progress = true;
+    while (placed != registered && progress) {
+        progress = false;
+        for (size_t i = 0; i < SensorData::TYPE_COUNT; ++i) {
+            uint32_t bit = 1u << i;
+            if ((registered & bit) && !(placed & bit) && (nodes_[i].depends_on & ~placed) == 0) {
+                order_[order_count_++] = static_cast<SensorData::Type>(i);
+                placed |= bit;
+                progress = true;
+            }
+        }
+    }
+    if (placed != registered) {
+        ESP_LOGE(TAG, "Sensor dependencies form a cycle");
+        order_count_ = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+void SensorRegistry::evaluate(const SensorBoard& board) {
+    cycle_++;
+    for (size_t k = 0; k < order_count_; ++k) {
+        SensorData::Type type = order_[k];
+        size_t index = static_cast<size_t>(type);
+        Node& node = nodes_[index];
+
+        // Dependencies come earlier in the order, so theirs are already this cycle's values
+        uint32_t raw_version = board.version(type);
+        bool inputs_changed = false;
+        for (uint32_t deps = node.depends_on; deps != 0; deps &= deps - 1) {
+            if (nodes_[__builtin_ctz(deps)].changed_cycle == cycle_) {
+                inputs_changed = true;
+                break;
+            }
+        }
+        if (raw_version == node.raw_version && !inputs_changed) {
+            skipped_++;
+            continue;
+        }
+        recomputed_++;
+        node.raw_version = raw_version;
+
+        SensorSample raw = board.latest(type);
+        SensorSample result = raw;
+        if (raw.status != ESP_OK) {
+            result.value = 0.0f;
+            result.variance = 0.0f;
+        } else if (node.derive != nullptr) {
+            result.value = node.derive(raw.value, values_);
+        }
+        SensorSample& current = values_[index];
+        if (result.value != current.value || result.status != current.status) {
+            node.changed_cycle = cycle_;
+        }
+        current = result;
+    }
+}
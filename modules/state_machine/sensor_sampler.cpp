@@ -0,0 +1,96 @@
+#include "sensor_sampler.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <math.h>
+
+static const char* TAG = "sampler";
+
+SensorSampler::SensorSampler(Sensor& sensor, SensorBoard& board, const char* name, uint32_t period_ms)
+    : sensor_(sensor), board_(board), name_(name), period_ms_(period_ms), task_(nullptr),
+      ready_variance_(0.0f), ready_(false), watch_(NAN), next_us_(0) {
+}
+
+SensorSampler::~SensorSampler() {
+    if (task_) {
+        vTaskDelete(task_);
+    }
+}
+
+void SensorSampler::set_estimator(const EstimatorConfig& config) {
+    estimator_.configure(config);
+    ready_variance_ = config.ready_variance;
+}
+
+void SensorSampler::set_adaptive(const AdaptiveRateConfig& config) {
+    rate_.configure(config);
+    if (rate_.enabled()) {
+        set_period_ms(config.min_period_ms);
+    }
+}
+
+esp_err_t SensorSampler::start(UBaseType_t priority, uint32_t stack_size) {
+    if (task_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTaskCreate(task, name_, stack_size, this, priority, &task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sampler task %s", name_);
+        task_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Sampler %s started, period %lu ms", name_, period_ms());
+    return ESP_OK;
+}
+
+void SensorSampler::sample_once() {
+    SensorSample sample;
+    int64_t start_us = esp_timer_get_time();
+    sample.status = sensor_.read(sample.value);
+    sample.timestamp_us = esp_timer_get_time();
+    metrics_.record(sample.status, static_cast<uint32_t>(sample.timestamp_us - start_us));
+    sample.variance = 0.0f;
+    if (sample.status == ESP_OK && estimator_.enabled()) {
+        // Failed reads are skipped; the variance grows over the gap on the next update
+        estimator_.update(sample.value, sample.timestamp_us);
+        sample.value = estimator_.estimate();
+        sample.variance = estimator_.variance();
+    }
+    if (sample.status == ESP_OK && !ready_.load(std::memory_order_relaxed)) {
+        if (ready_variance_ > 0.0f && estimator_.enabled() && sample.variance > ready_variance_) {
+            sample.status = ESP_ERR_NOT_FINISHED;
+        } else {
+            ready_.store(true, std::memory_order_release);
+            ESP_LOGI(TAG, "Sampler %s ready at %lld us", name_, sample.timestamp_us);
+        }
+    }
+    board_.publish(sensor_.get_type(), sample);
+
+    if (rate_.enabled()) {
+        float watch = watch_.load(std::memory_order_relaxed);
+        set_period_ms(sample.status == ESP_OK ? rate_.update(sample.value, sample.timestamp_us, watch, !isnan(watch))
+                                              : rate_.on_error());
+    }
+}
+
+bool SensorSampler::poll(int64_t horizon_us) {
+    if (next_us_ > horizon_us) {
+        return false;
+    }
+    sample_once();
+    int64_t now_us = esp_timer_get_time();
+    int64_t period_us = static_cast<int64_t>(period_ms()) * 1000;
+    next_us_ = next_us_ + period_us > now_us ? next_us_ + period_us : now_us + period_us;
+    return true;
+}
+
+void SensorSampler::task(void* arg) {
+    SensorSampler* sampler = static_cast<SensorSampler*>(arg);
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        sampler->sample_once();
+
+        // Absolute deadlines so the sample period does not drift with read time
+        TickType_t period = pdMS_TO_TICKS(sampler->period_ms());
+        xTaskDelayUntil(&last_wake, period > 0 ? period : 1);
+    }
+}
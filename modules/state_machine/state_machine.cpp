@@ -1,113 +1,409 @@
 #include "state_machine.hpp"
-#include "tds.hpp"
-#include "ntc.hpp"
-#include "ph.hpp"
-#include "ultrasonic.hpp"
+#include "fuzzy_rules.hpp"
+#include "trace.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#include <stdio.h> // Add this for fflush
+#include <algorithm>
+#include <math.h>
 
 static const char* TAG = "state_machine";
 
-StateMachine::StateMachine(const std::vector<AdcConfig>& adc_configs, const UartConfig& uart_config, float tank_height_cm)
-    : adc_(adc_configs),
-      uart_(uart_config),
-      tank_height_cm_(tank_height_cm),
-      sensor_data_(4),
+static constexpr UBaseType_t SAMPLER_TASK_PRIORITY = 6;
+static constexpr uint32_t SAMPLER_TASK_STACK = 3072;
+// Continuous mode delivers its first frame within a few ms
+static constexpr uint32_t ADC_PRIME_TIMEOUT_MS = 100;
+
+// PID gains, outputs are duty 0..1
+static constexpr PidGains PUMP_PID_GAINS = { .kp = 0.05f, .ki = 0.002f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f };
+static constexpr PidGains HEATER_PID_GAINS = { .kp = 0.4f, .ki = 0.01f, .kd = 2.0f, .out_min = 0.0f, .out_max = 1.0f };
+static constexpr PidGains DOSING_PID_GAINS = { .kp = 0.002f, .ki = 0.0001f, .kd = 0.0f, .out_min = 0.0f, .out_max = 1.0f };
+
+// Until a config update arrives over MQTT
+static constexpr ControlConfig DEFAULT_CONTROL_CONFIG = {
+    .tds_threshold = 1000.0f,
+    .temp_threshold = 25.0f,
+    .water_level_threshold = 50.0f,
+    .mode = ControlMode::ON_OFF_CONTROL,
+    .pump_pid = PUMP_PID_GAINS,
+    .heater_pid = HEATER_PID_GAINS,
+    .dosing_pid = DOSING_PID_GAINS,
+    .version = 0,
+};
+
+StateMachine::StateMachine(Zone* const* zones, size_t zone_count, const StateSchedule& schedule)
+    : zones_{},
+      zone_count_(0),
+      adcs_{},
+      adc_count_(0),
+      telemetry_row_{},
       current_state_(State::SENSOR_DATA_ACQUISITION),
-      actuator_substate_(ActuatorSubstate::ON_OFF_CONTROL) {
-    // Initialize sensors
-    sensors_.push_back(std::make_unique<TDS>(adc_, adc_configs[0], 0, sensor_data_));
-    sensors_.push_back(std::make_unique<NTC>(adc_, adc_configs[1], 1));
-    sensors_.push_back(std::make_unique<PH>(adc_, adc_configs[2], 2, sensor_data_));
-    sensors_.push_back(std::make_unique<Ultrasonic>(uart_));
+      fuzzy_(FUZZY_RULES_GROWTH),
+      telemetry_(nullptr),
+      history_(nullptr),
+      actuators_(nullptr),
+      dashboard_(nullptr),
+      power_(nullptr),
+      listened_for_us_{},
+      config_(DEFAULT_CONTROL_CONFIG),
+      applied_config_version_(config_.latest().version),
+      startup_{},
+      startup_done_(false),
+      inputs_ready_(false) {
+    if (zone_count > MAX_ZONES) {
+        ESP_LOGE(TAG, "%d zones exceed the limit of %d, driving the first %d", zone_count, MAX_ZONES, MAX_ZONES);
+        zone_count = MAX_ZONES;
+    }
+    float control_dt_s = schedule.control_ms / 1000.0f;
+    for (size_t i = 0; i < zone_count; ++i) {
+        Zone* zone = zones[i];
+        zones_[zone_count_++] = zone;
+        zone->configure(DEFAULT_CONTROL_CONFIG, control_dt_s);
+        // Zones on the same ADC unit share one Adc
+        bool known = false;
+        for (size_t a = 0; a < adc_count_; ++a) {
+            known = known || adcs_[a] == &zone->adc();
+        }
+        if (!known) {
+            adcs_[adc_count_++] = &zone->adc();
+        }
+    }
+
+    // Slot ids follow the State enum order
+    scheduler_.add(schedule.acquisition_ms);
+    scheduler_.add(schedule.control_ms);
+    scheduler_.add(schedule.telemetry_ms);
+
+    // Fill the ADC filters from real conversions now, so the first samples are already settled
+    bool primed = true;
+    for (size_t a = 0; a < adc_count_; ++a) {
+        primed = adcs_[a]->prime(ADC_PRIME_TIMEOUT_MS) == ESP_OK && primed;
+    }
+    if (primed) {
+        startup_.adc_primed_us = esp_timer_get_time();
+    }
+
+    ESP_LOGI(TAG, "State machine initialized with %d zones on %d ADC units, %d bytes", zone_count_, adc_count_,
+             sizeof(*this));
+}
+
+StateMachine::StateMachine(Zone& zone, const StateSchedule& schedule)
+    : StateMachine(std::array<Zone*, 1>{ &zone }.data(), 1, schedule) {
+}
 
-    // Initialize sensor data
-    sensor_data_[0].type = SensorData::Type::TDS;
-    sensor_data_[1].type = SensorData::Type::NTC;
-    sensor_data_[2].type = SensorData::Type::WATER_LEVEL;
-    sensor_data_[3].type = SensorData::Type::PH;
+esp_err_t StateMachine::set_history(History* history) {
+    if (history && history->channels() != zone_count_ * SensorData::TYPE_COUNT) {
+        ESP_LOGE(TAG, "History has %d channels, %d zones need %d", history->channels(), zone_count_,
+                 zone_count_ * SensorData::TYPE_COUNT);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    history_ = history;
+    return ESP_OK;
+}
+
+esp_err_t StateMachine::set_actuators(ActuatorEngine* actuators) {
+    if (actuators && actuators->channels() < zone_count_ * ZONE_ACTUATORS) {
+        ESP_LOGE(TAG, "Actuator engine has %d channels, %d zones need %d", actuators->channels(), zone_count_,
+                 zone_count_ * ZONE_ACTUATORS);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    actuators_ = actuators;
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "State machine initialized with %d sensors", sensors_.size());
+void StateMachine::set_dashboard(Dashboard* dashboard) {
+    dashboard_ = dashboard;
+    if (dashboard) {
+        const char* names[MAX_ZONES];
+        for (size_t z = 0; z < zone_count_; ++z) {
+            names[z] = zones_[z]->name();
+        }
+        dashboard->set_zones(names, zone_count_);
+    }
 }
 
 void StateMachine::run() {
+    if (power_ && power_->enabled()) {
+        while (1) {
+            power_->wait_until(power_step());
+        }
+    }
+    startup_.started_us = esp_timer_get_time();
+    for (size_t z = 0; z < zone_count_; ++z) {
+        zones_[z]->start_samplers(SAMPLER_TASK_PRIORITY, SAMPLER_TASK_STACK);
+    }
+
+    scheduler_.start();
     while (1) {
-        switch (current_state_) {
-            case State::SENSOR_DATA_ACQUISITION:
-                sensor_data_acquisition();
-                current_state_ = State::SENSOR_DATA_ACQUISITION;
-                break;
-            case State::ACTUATOR_CONTROL:
-                actuator_control();
-                current_state_ = State::MQTT_COMMUNICATION;
-                break;
-            case State::MQTT_COMMUNICATION:
-                mqtt_communication();
-                current_state_ = State::SENSOR_DATA_ACQUISITION;
-                break;
+        // Run every due state in pipeline order, so control always sees this pass's data
+        for (size_t i = 0; i < STATE_COUNT; ++i) {
+            if (!scheduler_.due(i)) {
+                // Until the first valid decision control follows acquisition instead of
+                // its own period, so it acts as soon as the last sensor has settled
+                if (static_cast<State>(i) == State::ACTUATOR_CONTROL && inputs_ready_ &&
+                    startup_.first_control_us == 0) {
+                    run_state(State::ACTUATOR_CONTROL);
+                }
+                continue;
+            }
+            scheduler_.begin(i);
+            run_state(static_cast<State>(i));
+            scheduler_.end(i);
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS); // 100ms per cycle
+        scheduler_.wait_next();
     }
 }
 
-void StateMachine::sensor_data_acquisition() {
-    for (size_t i = 0; i < sensors_.size(); ++i) {
-        float value;
-        esp_err_t ret = sensors_[i]->read(value);
-        if (ret == ESP_OK) {
-            sensor_data_[i].value = value;
-        } else {
-            sensor_data_[i].value = 0.0f;
+int64_t StateMachine::power_step() {
+    int64_t now_us = esp_timer_get_time();
+    if (startup_.started_us == 0) {
+        startup_.started_us = now_us;
+        scheduler_.start();
+    }
+    const PowerConfig& config = power_->config();
+    int64_t horizon_us = now_us + static_cast<int64_t>(config.coalesce_ms) * 1000;
+
+    // The ADC scans only while its sensors are read; a stopped scan keeps the chip from sleeping
+    bool adc_due = false;
+    for (size_t z = 0; z < zone_count_; ++z) {
+        adc_due = adc_due || zones_[z]->next_adc_sample_us() <= horizon_us;
+    }
+    if (adc_due) {
+        bool rearmed = false;
+        for (size_t a = 0; a < adc_count_; ++a) {
+            if (!adcs_[a]->suspended()) {
+                continue;
+            }
+            rearmed = true;
+            esp_err_t ret = adcs_[a]->resume(config.adc_rearm_timeout_ms);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "ADC %d not re-armed: %s", a, esp_err_to_name(ret));
+            }
+        }
+        if (rearmed) {
+            power_->record_rearm(static_cast<uint32_t>(esp_timer_get_time() - now_us));
+        }
+    }
+    size_t sampled = 0;
+    for (size_t z = 0; z < zone_count_; ++z) {
+        sampled += zones_[z]->sample_due(horizon_us);
+    }
+    for (size_t a = 0; a < adc_count_; ++a) {
+        adcs_[a]->suspend();
+    }
+
+    if (sampled > 0) {
+        run_state(State::SENSOR_DATA_ACQUISITION);
+        if (inputs_ready_ && startup_.first_control_us == 0) {
+            run_state(State::ACTUATOR_CONTROL);
+        }
+    }
+    for (size_t i = static_cast<size_t>(State::ACTUATOR_CONTROL); i < STATE_COUNT; ++i) {
+        if (scheduler_.deadline_us(i) <= esp_timer_get_time()) {
+            scheduler_.begin(i);
+            run_state(static_cast<State>(i));
+            scheduler_.end(i);
+        }
+    }
+
+    // Next pass: the earliest sample, stage or listen. The SEN0311 streams whether or not
+    // anyone listens, so its link is woken once per level reading, ahead of the earliest
+    // pass that may read it.
+    now_us = esp_timer_get_time();
+    int64_t lead_us = static_cast<int64_t>(config.listen_lead_ms + config.coalesce_ms) * 1000;
+    int64_t next_us = INT64_MAX;
+    for (size_t z = 0; z < zone_count_; ++z) {
+        Zone& zone = *zones_[z];
+        next_us = std::min(next_us, zone.next_sample_us());
+        int64_t level_us = zone.next_level_sample_us();
+        if (level_us - lead_us > now_us) {
+            next_us = std::min(next_us, level_us - lead_us);
+        } else if (listened_for_us_[z] != level_us && zone.listen_level() == ESP_OK) {
+            listened_for_us_[z] = level_us;
+            power_->record_listen();
         }
     }
+    for (size_t i = static_cast<size_t>(State::ACTUATOR_CONTROL); i < STATE_COUNT; ++i) {
+        next_us = std::min(next_us, scheduler_.deadline_us(i));
+    }
+    return next_us;
+}
 
-    ESP_LOGI(TAG, "TDS: %.2f ppm, pH: %.2f pH, Tem: %.2f °C, Water-Level : %.2f",
-             sensor_data_[0].value, sensor_data_[2].value, sensor_data_[1].value, sensor_data_[3].value);
+void StateMachine::step() {
+    if (startup_.started_us == 0) {
+        startup_.started_us = esp_timer_get_time();
+    }
+    // Every state is due at the start of the pass, so the schedule stats show each stage's
+    // run time and how long it waited behind the sampling and the stages before it
+    scheduler_.start();
+    for (size_t z = 0; z < zone_count_; ++z) {
+        zones_[z]->sample_once();
+    }
+    for (size_t i = 0; i < STATE_COUNT; ++i) {
+        scheduler_.begin(i);
+        run_state(static_cast<State>(i));
+        scheduler_.end(i);
+    }
 }
 
-void StateMachine::actuator_control() {
-    switch (actuator_substate_) {
-        case ActuatorSubstate::ON_OFF_CONTROL:
-            on_off_control();
+void StateMachine::run_state(State state) {
+    current_state_ = state;
+    switch (current_state_) {
+        case State::SENSOR_DATA_ACQUISITION:
+            sensor_data_acquisition();
             break;
-        case ActuatorSubstate::PID_CONTROL:
-            pid_control();
+        case State::ACTUATOR_CONTROL:
+            actuator_control();
             break;
-        case ActuatorSubstate::FUZZY_LOGIC_CONTROL:
-            fuzzy_logic_control();
+        case State::MQTT_COMMUNICATION:
+            mqtt_communication();
             break;
     }
 }
 
-void StateMachine::on_off_control() {
-    // Placeholder: Simple threshold-based pump control
-    bool pump_on = sensor_data_[0].value > tds_threshold_ ||
-                   sensor_data_[1].value > temp_threshold_ ||
-                   sensor_data_[2].value < water_level_threshold_;
-    ESP_LOGI(TAG, "On/Off Control: Pump %s", pump_on ? "ON" : "OFF");
-    // Add GPIO control for pump here (e.g., gpio_set_level)
+void StateMachine::sensor_data_acquisition() {
+    bool all_ready = true;
+    for (size_t z = 0; z < zone_count_; ++z) {
+        Zone& zone = *zones_[z];
+        all_ready = zone.acquire() && all_ready;
+        const auto& data = zone.data();
+        for (size_t i = 0; i < data.size(); ++i) {
+            telemetry_row_[z * SensorData::TYPE_COUNT + i] = data[i];
+        }
+
+        // Estimates with their standard deviation; formatted later by the trace drain
+        const SensorRegistry& registry = zone.registry();
+        TRACE_ZONE(z, ACQUISITION,
+                   data[0].value, sqrtf(registry.value(SensorData::Type::TDS).variance),
+                   data[3].value, sqrtf(registry.value(SensorData::Type::PH).variance),
+                   data[1].value, sqrtf(registry.value(SensorData::Type::NTC).variance),
+                   data[2].value, sqrtf(registry.value(SensorData::Type::WATER_LEVEL).variance));
+    }
+    if (!inputs_ready_ && all_ready) {
+        inputs_ready_ = true;
+        startup_.inputs_ready_us = esp_timer_get_time();
+    }
+    // One sample carries every zone, so the batches need no per-zone headers
+    if (telemetry_) {
+        telemetry_->add(telemetry_row_.data(), zone_count_ * SensorData::TYPE_COUNT, esp_timer_get_time() / 1000);
+    }
+    // A copy into the dashboard's seqlock; its own task encodes and sends it
+    if (dashboard_) {
+        dashboard_->publish(telemetry_row_.data(), zone_count_ * SensorData::TYPE_COUNT, esp_timer_get_time() / 1000);
+    }
+}
+
+esp_err_t StateMachine::update_config(const char* json, size_t length, uint32_t* version) {
+    ControlConfig config = config_.latest();
+    esp_err_t ret = control_config_parse(json, length, config);
+    // The level threshold has to fit the shallowest tank
+    for (size_t z = 0; z < zone_count_ && ret == ESP_OK; ++z) {
+        ret = control_config_validate(config, zones_[z]->tank_height_cm(), zones_[z]->control_dt_s());
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint32_t published = config_.publish(config);
+    if (version) {
+        *version = published;
+    }
+    return ESP_OK;
+}
+
+// Runs on the control task, so the PIDs and thresholds are only ever touched from here
+void StateMachine::apply_config(const ControlConfig& config) {
+    for (size_t z = 0; z < zone_count_; ++z) {
+        zones_[z]->apply_config(config);
+    }
+    applied_config_version_ = config.version;
+    ESP_LOGI(TAG, "Applied config v%lu to %d zones: TDS<=%.0f ppm, Temp<=%.2f °C, Level>=%.1f cm, mode %d",
+             config.version, zone_count_, config.tds_threshold, config.temp_threshold, config.water_level_threshold,
+             static_cast<int>(config.mode));
 }
 
-void StateMachine::pid_control() {
-    // Placeholder: PID control for actuators
-    ESP_LOGI(TAG, "PID Control: Processing TDS=%.0f, Temp=%.2f, Level=%.1f",
-             sensor_data_[0].value, sensor_data_[1].value, sensor_data_[2].value);
-    // Implement PID logic here
+void StateMachine::actuator_control() {
+    const ControlConfig& config = config_.acquire();
+    if (config.version != applied_config_version_) {
+        apply_config(config);
+    }
+
+    if (!inputs_ready_) {
+        // Every zone waits for the last one, so boot behaves the same with one tank or eight
+        for (size_t z = 0; z < zone_count_; ++z) {
+            zones_[z]->hold();
+        }
+        TRACE(CONTROL_WAITING);
+        return;
+    }
+    if (startup_.first_control_us == 0) {
+        startup_.first_control_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "First valid control decision %lld ms after boot (%lld ms after start, ADC primed at %lld ms)",
+                 startup_.first_control_us / 1000, (startup_.first_control_us - startup_.started_us) / 1000,
+                 startup_.adc_primed_us / 1000);
+        startup_done_.store(true, std::memory_order_release);
+    }
+
+    for (size_t z = 0; z < zone_count_; ++z) {
+        zones_[z]->control(fuzzy_, z);
+    }
+    drive_actuators();
+    // The values this decision was taken on
+    if (history_) {
+        history_->record(telemetry_row_.data(), zone_count_ * SensorData::TYPE_COUNT, esp_timer_get_time() / 1000);
+    }
 }
 
-void StateMachine::fuzzy_logic_control() {
-    // Placeholder: Fuzzy logic control
-    ESP_LOGI(TAG, "Fuzzy Logic Control: Processing TDS=%.0f, Temp=%.2f, Level=%.1f",
-             sensor_data_[0].value, sensor_data_[1].value, sensor_data_[2].value);
-    // Implement fuzzy logic here
+// Queued only: the engine switches the outputs on its own timer, so how long this task's
+// stages take does not change when a pump starts or how long a dose lasts
+void StateMachine::drive_actuators() {
+    if (!actuators_) {
+        return;
+    }
+    for (size_t z = 0; z < zone_count_; ++z) {
+        const ActuatorOutputs& outputs = zones_[z]->outputs();
+        size_t first = z * ZONE_ACTUATORS;
+        size_t dosing = first + static_cast<size_t>(ZoneActuator::DOSING);
+        float dose_ms = outputs.dosing * actuators_->config(dosing).full_dose_ms;
+        actuators_->set_duty(first + static_cast<size_t>(ZoneActuator::PUMP), outputs.pump);
+        actuators_->set_duty(first + static_cast<size_t>(ZoneActuator::HEATER), outputs.heater);
+        actuators_->dose(dosing, dose_ms > 0.0f ? static_cast<uint32_t>(dose_ms) : 0);
+    }
 }
 
 void StateMachine::mqtt_communication() {
-    // Placeholder: Publish sensor data and receive threshold updates
-    ESP_LOGI(TAG, "MQTT: Publishing TDS=%.0f, Temp=%.2f, Level=%.1f",
-             sensor_data_[0].value, sensor_data_[1].value, sensor_data_[2].value);
-    // Implement MQTT client logic here (e.g., using esp-mqtt)
+    if (telemetry_) {
+        telemetry_->service();
+        const TelemetryStats& stats = telemetry_->stats();
+        ESP_LOGI(TAG, "Telemetry: samples=%lu batches=%lu published=%lu (%lu bytes) spilled=%lu drained=%lu dropped=%lu",
+                 stats.samples, stats.batches, stats.published, stats.bytes_published,
+                 stats.spilled, stats.drained, stats.dropped);
+        // Current metrics only: not batched, and skipped while offline
+        size_t length = metrics_report(metrics_json_, sizeof(metrics_json_), MetricsFormat::JSON);
+        telemetry_->publish_metrics(metrics_json_, length);
+    } else {
+        for (size_t z = 0; z < zone_count_; ++z) {
+            const auto& data = zones_[z]->data();
+            ESP_LOGI(TAG, "MQTT: %s TDS=%.0f, Temp=%.2f, Level=%.1f", zones_[z]->name(),
+                     data[0].value, data[1].value, data[2].value);
+        }
+    }
+    log_schedule_stats();
+}
+
+const char* StateMachine::state_name(State state) {
+    static const char* const STATE_NAMES[STATE_COUNT] = { "acquisition", "control", "telemetry" };
+    size_t index = static_cast<size_t>(state);
+    return index < STATE_COUNT ? STATE_NAMES[index] : "?";
+}
+
+void StateMachine::log_schedule_stats() const {
+    for (size_t i = 0; i < STATE_COUNT; ++i) {
+        ScheduleStats stats = scheduler_.stats(i);
+        ESP_LOGI(TAG, "%s: period=%lums runs=%lu overruns=%lu exec min/p50/p99/max=%lu/%lu/%lu/%luus jitter p99/max=%lu/%luus",
+                 state_name(static_cast<State>(i)), stats.period_ms, stats.runs, stats.overruns,
+                 stats.exec_min_us, stats.exec_p50_us, stats.exec_p99_us, stats.exec_max_us,
+                 stats.jitter_p99_us, stats.jitter_max_us);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "zone.hpp"
+#include "trace.hpp"
+#include "esp_log.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+static const char* TAG = "zone";
+
+// Per-sensor sampling periods while the signal changes; the SEN0311 reports at ~10 Hz
+static constexpr uint32_t TDS_PERIOD_MS = 50;
+static constexpr uint32_t NTC_PERIOD_MS = 200;
+static constexpr uint32_t PH_PERIOD_MS = 50;
+static constexpr uint32_t WATER_LEVEL_PERIOD_MS = 100;
+
+// Estimator tuning, in each sensor's units: measurement noise is the variance of one
+// reading after the ADC filters, process noise how fast the water can really change.
+// The gate drops electrode spikes and SEN0311 echoes off ripples; a sustained change
+// gets through after max_rejects readings (see estimator_bench). The ADC channels are
+// settled from their first reading, which Adc::prime averages over a burst; a level
+// reading needs a second frame to agree before control acts on it. TDS process noise is
+// set so the estimate is no noisier than the median + 50-tap average it replaced, at the
+// same ramp lag; a faster estimator would follow dosing closer but pass more noise.
+static constexpr EstimatorConfig TDS_ESTIMATOR = { .process_noise = 0.75f, .measurement_noise = 25.0f,
+                                                   .gate_sigma = 4.0f };
+static constexpr EstimatorConfig NTC_ESTIMATOR = { .process_noise = 1e-3f, .measurement_noise = 0.01f };
+static constexpr EstimatorConfig PH_ESTIMATOR = { .process_noise = 2.5e-4f, .measurement_noise = 0.0025f,
+                                                  .gate_sigma = 4.0f };
+static constexpr EstimatorConfig WATER_LEVEL_ESTIMATOR = { .process_noise = 0.05f, .measurement_noise = 0.25f,
+                                                           .gate_sigma = 4.0f, .ready_variance = 0.15f };
+
+// Adaptive sampling: each sensor backs off to its max period while steady and returns to
+// the rates above on a step, a ramp, or near the control threshold (see adaptive_bench).
+// Slopes and deviations apply to the estimator output, in each sensor's units.
+static constexpr AdaptiveRateConfig TDS_RATE = { .min_period_ms = TDS_PERIOD_MS, .max_period_ms = 2000,
+                                                 .quiet_slope = 1.0f, .quiet_deviation = 3.0f,
+                                                 .approach_band = 50.0f };
+static constexpr AdaptiveRateConfig NTC_RATE = { .min_period_ms = NTC_PERIOD_MS, .max_period_ms = 5000,
+                                                 .quiet_slope = 0.01f, .quiet_deviation = 0.05f,
+                                                 .approach_band = 0.5f };
+static constexpr AdaptiveRateConfig PH_RATE = { .min_period_ms = PH_PERIOD_MS, .max_period_ms = 2000,
+                                                .quiet_slope = 0.005f, .quiet_deviation = 0.02f };
+static constexpr AdaptiveRateConfig WATER_LEVEL_RATE = { .min_period_ms = WATER_LEVEL_PERIOD_MS, .max_period_ms = 1000,
+                                                         .quiet_slope = 0.02f, .quiet_deviation = 0.5f,
+                                                         .approach_band = 2.0f };
+
+// Sampler task names, "<zone>.<sensor>", in samplers_ order
+static const char* const SAMPLER_SUFFIXES[ZONE_SENSORS] = { "tds", "ntc", "ph", "level" };
+
+Zone::Zone(const char* name, Adc& adc, size_t first_channel, Uart& uart, float tank_height_cm)
+    : name_(name),
+      adc_(adc),
+      uart_(uart),
+      tank_height_cm_(tank_height_cm),
+      sensors_(TDS(adc, adc.config(first_channel), first_channel),
+               NTC(adc, adc.config(first_channel + 1), first_channel + 1),
+               PH(adc, adc.config(first_channel + 2), first_channel + 2),
+               Ultrasonic(uart, tank_height_cm)),
+      sampler_names_{},
+      samplers_{{
+          SensorSampler(std::get<TDS>(sensors_), board_, sampler_names_[0], TDS_PERIOD_MS),
+          SensorSampler(std::get<NTC>(sensors_), board_, sampler_names_[1], NTC_PERIOD_MS),
+          SensorSampler(std::get<PH>(sensors_), board_, sampler_names_[2], PH_PERIOD_MS),
+          SensorSampler(std::get<Ultrasonic>(sensors_), board_, sampler_names_[3], WATER_LEVEL_PERIOD_MS),
+      }},
+      sensor_data_{},
+      inputs_ready_(false),
+      mode_(ControlMode::ON_OFF_CONTROL),
+      active_mode_(ControlMode::ON_OFF_CONTROL),
+      outputs_{},
+      pump_pid_(PidGains{}, 1.0f),
+      heater_pid_(PidGains{}, 1.0f),
+      dosing_pid_(PidGains{}, 1.0f),
+      control_dt_s_(1.0f),
+      tds_threshold_(0.0f),
+      temp_threshold_(0.0f),
+      water_level_threshold_(0.0f) {
+    for (size_t i = 0; i < ZONE_SENSORS; ++i) {
+        snprintf(sampler_names_[i], ZONE_TASK_NAME_LEN, "%s.%s", name_, SAMPLER_SUFFIXES[i]);
+    }
+    samplers_[0].set_estimator(TDS_ESTIMATOR);
+    samplers_[1].set_estimator(NTC_ESTIMATOR);
+    samplers_[2].set_estimator(PH_ESTIMATOR);
+    samplers_[3].set_estimator(WATER_LEVEL_ESTIMATOR);
+    samplers_[0].set_adaptive(TDS_RATE);
+    samplers_[1].set_adaptive(NTC_RATE);
+    samplers_[2].set_adaptive(PH_RATE);
+    samplers_[3].set_adaptive(WATER_LEVEL_RATE);
+
+    // sensor_data_ is indexed by SensorData::Type
+    for (size_t i = 0; i < sensor_data_.size(); ++i) {
+        sensor_data_[i].type = static_cast<SensorData::Type>(i);
+    }
+
+    // TDS and pH are compensated to 25 °C with the temperature of the same cycle
+    registry_.add(SensorData::Type::NTC);
+    registry_.add(SensorData::Type::WATER_LEVEL);
+    registry_.add(SensorData::Type::TDS, sensor_bit(SensorData::Type::NTC), TDS::compensate);
+    registry_.add(SensorData::Type::PH, sensor_bit(SensorData::Type::NTC), PH::compensate);
+    ESP_ERROR_CHECK(registry_.finalize());
+
+    ESP_LOGI(TAG, "Zone %s: ADC channels %d..%d, %d bytes", name_, first_channel, first_channel + 2, sizeof(*this));
+}
+
+Calibration* Zone::calibration(SensorData::Type type) {
+    return const_cast<Calibration*>(static_cast<const Zone*>(this)->calibration(type));
+}
+
+const Calibration* Zone::calibration(SensorData::Type type) const {
+    switch (type) {
+        case SensorData::Type::TDS: return &std::get<TDS>(sensors_).calibration();
+        case SensorData::Type::PH: return &std::get<PH>(sensors_).calibration();
+        default: return nullptr;
+    }
+}
+
+bool Zone::calibration_key(SensorData::Type type, char* key, size_t size) const {
+    const char* suffix = type == SensorData::Type::TDS ? SAMPLER_SUFFIXES[0] : SAMPLER_SUFFIXES[2];
+    int length = snprintf(key, size, "%s.%s", name_, suffix);
+    return calibration(type) != nullptr && length >= 0 && static_cast<size_t>(length) < size &&
+           static_cast<size_t>(length) <= BLOB_KEY_MAX;
+}
+
+void Zone::load_calibration(BlobStore& store) {
+    for (SensorData::Type type : { SensorData::Type::TDS, SensorData::Type::PH }) {
+        char key[BLOB_KEY_MAX + 1];
+        if (!calibration_key(type, key, sizeof(key))) {
+            ESP_LOGW(TAG, "Zone %s: name too long for a calibration key", name_);
+            return;
+        }
+        esp_err_t ret = calibration(type)->load(store, key);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGI(TAG, "%s: built-in calibration", key);
+        } else if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "%s: %s, keeping the built-in calibration", key, esp_err_to_name(ret));
+        }
+    }
+}
+
+void Zone::configure(const ControlConfig& config, float control_dt_s) {
+    control_dt_s_ = control_dt_s;
+    apply_config(config);
+    active_mode_ = mode_;
+}
+
+void Zone::apply_config(const ControlConfig& config) {
+    tds_threshold_ = config.tds_threshold;
+    temp_threshold_ = config.temp_threshold;
+    water_level_threshold_ = config.water_level_threshold;
+    pump_pid_.set_gains(config.pump_pid, control_dt_s_);
+    heater_pid_.set_gains(config.heater_pid, control_dt_s_);
+    dosing_pid_.set_gains(config.dosing_pid, control_dt_s_);
+    mode_ = config.mode;
+    // Sample at full rate while a value is close to where control acts on it
+    samplers_[0].set_watch(tds_threshold_);
+    samplers_[1].set_watch(temp_threshold_);
+    samplers_[3].set_watch(water_level_threshold_);
+}
+
+void Zone::start_samplers(UBaseType_t priority, uint32_t stack_size) {
+    for (auto& sampler : samplers_) {
+        sampler.start(priority, stack_size);
+    }
+}
+
+void Zone::sample_once() {
+    for (auto& sampler : samplers_) {
+        sampler.sample_once();
+    }
+}
+
+size_t Zone::sample_due(int64_t horizon_us) {
+    size_t sampled = 0;
+    for (auto& sampler : samplers_) {
+        sampled += sampler.poll(horizon_us) ? 1 : 0;
+    }
+    return sampled;
+}
+
+int64_t Zone::next_sample_us() const {
+    return std::min(next_adc_sample_us(), next_level_sample_us());
+}
+
+int64_t Zone::next_adc_sample_us() const {
+    int64_t next_us = INT64_MAX;
+    for (size_t i = 0; i < ZONE_LEVEL_SAMPLER; ++i) {
+        next_us = std::min(next_us, samplers_[i].next_sample_us());
+    }
+    return next_us;
+}
+
+bool Zone::acquire() {
+    // Samplers run on their own tasks and publish raw readings; derive this cycle's values
+    registry_.evaluate(board_);
+    bool all_valid = true;
+    for (auto& data : sensor_data_) {
+        const SensorSample& sample = registry_.value(data.type);
+        data.value = sample.status == ESP_OK ? sample.value : 0.0f;
+        all_valid = all_valid && sample.status == ESP_OK;
+    }
+    if (!inputs_ready_ && all_valid) {
+        inputs_ready_ = true;
+        ESP_LOGI(TAG, "Zone %s: every sensor settled", name_);
+    }
+    return inputs_ready_;
+}
+
+void Zone::hold() {
+    // A decision on the zeros of unsettled sensors would switch the pumps at random
+    outputs_ = { 0.0f, 0.0f, 0.0f };
+}
+
+void Zone::control(const FuzzyController& fuzzy, size_t index) {
+    if (mode_ != active_mode_) {
+        if (mode_ == ControlMode::PID_CONTROL) {
+            // Bumpless transfer: start the PIDs from the outputs currently applied
+            pump_pid_.transfer(ControlScalar(water_level_threshold_), ControlScalar(sensor_data_[2].value),
+                               ControlScalar(outputs_.pump));
+            heater_pid_.transfer(ControlScalar(temp_threshold_), ControlScalar(sensor_data_[1].value),
+                                 ControlScalar(outputs_.heater));
+            dosing_pid_.transfer(ControlScalar(tds_threshold_), ControlScalar(sensor_data_[0].value),
+                                 ControlScalar(outputs_.dosing));
+        }
+        active_mode_ = mode_;
+    }
+
+    switch (mode_) {
+        case ControlMode::ON_OFF_CONTROL:
+            on_off_control(index);
+            break;
+        case ControlMode::PID_CONTROL:
+            pid_control(index);
+            break;
+        case ControlMode::FUZZY_LOGIC_CONTROL:
+            fuzzy_logic_control(fuzzy, index);
+            break;
+    }
+}
+
+void Zone::on_off_control(size_t index) {
+    // Pump full on while TDS or temperature is above its threshold or the level below it;
+    // StateMachine::drive_actuators() applies the duty to the pump
+    bool pump_on = sensor_data_[0].value > tds_threshold_ ||
+                   sensor_data_[1].value > temp_threshold_ ||
+                   sensor_data_[2].value < water_level_threshold_;
+    outputs_ = { pump_on ? 1.0f : 0.0f, 0.0f, 0.0f };
+    TRACE_ZONE(index, CONTROL_ON_OFF, sensor_data_[0].value, sensor_data_[1].value, sensor_data_[2].value, outputs_.pump);
+}
+
+void Zone::pid_control(size_t index) {
+    // Fill pump tracks the level setpoint, heater the temperature, dosing the TDS
+    ControlScalar pump = pump_pid_.update(ControlScalar(water_level_threshold_), ControlScalar(sensor_data_[2].value));
+    ControlScalar heater = heater_pid_.update(ControlScalar(temp_threshold_), ControlScalar(sensor_data_[1].value));
+    ControlScalar dosing = dosing_pid_.update(ControlScalar(tds_threshold_), ControlScalar(sensor_data_[0].value));
+    outputs_ = { static_cast<float>(pump), static_cast<float>(heater), static_cast<float>(dosing) };
+    TRACE_ZONE(index, CONTROL_PID, sensor_data_[0].value, sensor_data_[1].value, sensor_data_[2].value,
+               outputs_.pump, outputs_.heater, outputs_.dosing);
+}
+
+void Zone::fuzzy_logic_control(const FuzzyController& fuzzy, size_t index) {
+    const float inputs[FUZZY_INPUTS] = {
+        sensor_data_[0].value,  // TDS
+        sensor_data_[1].value,  // Temperature
+        sensor_data_[3].value,  // pH
+        sensor_data_[2].value,  // Water level
+    };
+    float outputs[FUZZY_OUTPUTS];
+    fuzzy.evaluate(inputs, outputs);
+    outputs_ = {
+        outputs[static_cast<size_t>(FuzzyOutput::PUMP)],
+        outputs[static_cast<size_t>(FuzzyOutput::HEATER)],
+        outputs[static_cast<size_t>(FuzzyOutput::DOSING)],
+    };
+    TRACE_ZONE(index, CONTROL_FUZZY, inputs[0], inputs[1], inputs[2], inputs[3], outputs_.pump, outputs_.heater,
+               outputs_.dosing);
+}
@@ -0,0 +1,256 @@
+#include <string.h>
+
+#include "flash_ring.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "flash_ring";
+
+static constexpr uint16_t MAGIC_PENDING = 0xA55A;
+static constexpr uint16_t MAGIC_CONSUMED = 0x0000;
+static constexpr uint16_t MAGIC_ERASED = 0xFFFF;
+
+struct RecordHeader {
+    uint16_t magic;
+    uint16_t length;
+    uint32_t seq;
+    uint32_t crc;
+};
+static_assert(sizeof(RecordHeader) == 12, "RecordHeader must be packed");
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static size_t record_size(size_t payload) {
+    return (sizeof(RecordHeader) + payload + 3) & ~static_cast<size_t>(3);
+}
+
+FlashRing::FlashRing(FlashRegion& region)
+    : region_(region), head_(0), tail_(0), next_seq_(0), pending_(0), dropped_(0) {
+}
+
+size_t FlashRing::max_record_size() const {
+    return region_.sector_size() - sizeof(RecordHeader);
+}
+
+esp_err_t FlashRing::mount() {
+    const size_t sector_size = region_.sector_size();
+    if (region_.size() < 2 * sector_size) {
+        ESP_LOGE(TAG, "Region of %d bytes is too small, need at least two sectors", region_.size());
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    bool found = false;
+    uint32_t max_seq = 0;
+    uint32_t min_pending_seq = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    pending_ = 0;
+
+    for (size_t sector = 0; sector < region_.size(); sector += sector_size) {
+        size_t offset = sector;
+        while (offset + sizeof(RecordHeader) <= sector + sector_size) {
+            RecordHeader header;
+            esp_err_t ret = region_.read(offset, &header, sizeof(header));
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            bool valid = (header.magic == MAGIC_PENDING || header.magic == MAGIC_CONSUMED) &&
+                         offset + record_size(header.length) <= sector + sector_size;
+            if (!valid) {
+                break;  // Erased space or a torn write: nothing more in this sector
+            }
+            if (!found || static_cast<int32_t>(header.seq - max_seq) > 0) {
+                max_seq = header.seq;
+                head = offset + record_size(header.length);
+            }
+            if (header.magic == MAGIC_PENDING) {
+                if (pending_ == 0 || static_cast<int32_t>(header.seq - min_pending_seq) < 0) {
+                    min_pending_seq = header.seq;
+                    tail = offset;
+                }
+                pending_++;
+            }
+            found = true;
+            offset += record_size(header.length);
+        }
+    }
+
+    next_seq_ = found ? max_seq + 1 : 0;
+    head_ = head % region_.size();
+    tail_ = pending_ > 0 ? tail : head_;
+
+    // The write position must be erased; otherwise start over in the next sector
+    RecordHeader at_head;
+    esp_err_t ret = region_.read(head_, &at_head, sizeof(at_head));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    bool head_erased = at_head.magic == MAGIC_ERASED && at_head.length == 0xFFFF &&
+                       at_head.seq == 0xFFFFFFFFu && at_head.crc == 0xFFFFFFFFu;
+    if (!head_erased || head_ % sector_size + record_size(0) > sector_size) {
+        size_t target = head_ % sector_size == 0 ? head_ : (sector_of(head_) + sector_size) % region_.size();
+        ret = erase_for_write(target);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    ESP_LOGI(TAG, "Mounted %d KB ring: %d pending records, head=0x%x tail=0x%x",
+             region_.size() / 1024, pending_, head_, tail_);
+    return ESP_OK;
+}
+
+// Opens the sector at sector_offset for writing, dropping any pending records in it
+esp_err_t FlashRing::erase_for_write(size_t sector_offset) {
+    while (pending_ > 0 && sector_of(tail_) == sector_offset) {
+        dropped_++;
+        pending_--;
+        esp_err_t ret = advance_tail();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    esp_err_t ret = region_.erase_sector(sector_offset);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Erase at 0x%x failed: %s", sector_offset, esp_err_to_name(ret));
+        return ret;
+    }
+    bool was_empty = pending_ == 0;
+    head_ = sector_offset;
+    if (was_empty) {
+        tail_ = head_;
+    }
+    return ESP_OK;
+}
+
+// Moves tail_ to the next pending record after the current one, or to head_
+esp_err_t FlashRing::advance_tail() {
+    const size_t sector_size = region_.sector_size();
+    if (pending_ == 0) {
+        tail_ = head_;
+        return ESP_OK;
+    }
+
+    RecordHeader header;
+    esp_err_t ret = region_.read(tail_, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t offset = tail_ + record_size(header.length);
+    size_t steps = region_.size() / record_size(0) + 1;
+    while (steps-- > 0) {
+        if (offset % sector_size == 0 || offset % sector_size + sizeof(RecordHeader) > sector_size) {
+            offset = (sector_of(offset - 1) + sector_size) % region_.size();
+        }
+        if (offset == head_) {
+            break;
+        }
+        ret = region_.read(offset, &header, sizeof(header));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        bool valid = (header.magic == MAGIC_PENDING || header.magic == MAGIC_CONSUMED) &&
+                     offset % sector_size + record_size(header.length) <= sector_size;
+        if (!valid) {
+            // End of this sector's records, continue in the next one
+            offset = (sector_of(offset) + sector_size) % region_.size();
+            continue;
+        }
+        if (header.magic == MAGIC_PENDING) {
+            tail_ = offset;
+            return ESP_OK;
+        }
+        offset += record_size(header.length);
+    }
+    // Nothing pending before the write position; the counters disagree with flash
+    ESP_LOGW(TAG, "Lost track of %d pending records", pending_);
+    pending_ = 0;
+    tail_ = head_;
+    return ESP_OK;
+}
+
+esp_err_t FlashRing::push(const uint8_t* data, size_t length) {
+    if (length > max_record_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const size_t sector_size = region_.sector_size();
+    if (head_ % sector_size + record_size(length) > sector_size) {
+        esp_err_t ret = erase_for_write((sector_of(head_) + sector_size) % region_.size());
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    RecordHeader header = {
+        .magic = MAGIC_PENDING,
+        .length = static_cast<uint16_t>(length),
+        .seq = next_seq_,
+        .crc = crc32(data, length),
+    };
+    esp_err_t ret = region_.write(head_, &header, sizeof(header));
+    if (ret == ESP_OK && length > 0) {
+        ret = region_.write(head_ + sizeof(header), data, length);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Write at 0x%x failed: %s", head_, esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (pending_ == 0) {
+        tail_ = head_;
+    }
+    pending_++;
+    next_seq_++;
+    head_ += record_size(length);
+
+    // Keep head_ inside a sector with room for at least a header
+    if (head_ % sector_size == 0 || head_ % sector_size + record_size(0) > sector_size) {
+        return erase_for_write((sector_of(head_ - 1) + sector_size) % region_.size());
+    }
+    return ESP_OK;
+}
+
+esp_err_t FlashRing::peek(uint8_t* dst, size_t capacity, size_t& length) {
+    if (pending_ == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    RecordHeader header;
+    esp_err_t ret = region_.read(tail_, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (header.magic != MAGIC_PENDING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (header.length > capacity) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ret = region_.read(tail_ + sizeof(header), dst, header.length);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    length = header.length;
+    return crc32(dst, length) == header.crc ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t FlashRing::pop() {
+    if (pending_ == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Clearing bits is allowed without an erase
+    uint16_t consumed = MAGIC_CONSUMED;
+    esp_err_t ret = region_.write(tail_, &consumed, sizeof(consumed));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    pending_--;
+    return advance_tail();
+}
@@ -0,0 +1,91 @@
+#include <string.h>
+
+#include "mqtt_transport.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "mqtt";
+
+static constexpr int TELEMETRY_QOS = 1;
+
+EspMqttTransport::EspMqttTransport(const char* broker_uri, const char* client_id)
+    : client_(nullptr), connected_(false), subscriptions_{}, subscription_count_(0) {
+    esp_mqtt_client_config_t config = {};
+    config.broker.address.uri = broker_uri;
+    config.credentials.client_id = client_id;
+    client_ = esp_mqtt_client_init(&config);
+    if (client_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create MQTT client for %s", broker_uri);
+        return;
+    }
+    esp_mqtt_client_register_event(client_, MQTT_EVENT_ANY, event_handler, this);
+}
+
+EspMqttTransport::~EspMqttTransport() {
+    if (client_ != nullptr) {
+        esp_mqtt_client_destroy(client_);
+    }
+}
+
+esp_err_t EspMqttTransport::start() {
+    if (client_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_mqtt_client_start(client_);
+}
+
+void EspMqttTransport::event_handler(void* arg, esp_event_base_t base, int32_t event_id, void* event_data) {
+    EspMqttTransport* transport = static_cast<EspMqttTransport*>(arg);
+    switch (static_cast<esp_mqtt_event_id_t>(event_id)) {
+        case MQTT_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "Connected to broker");
+            // Clean session: the broker forgot our subscriptions
+            for (size_t i = 0; i < transport->subscription_count_; ++i) {
+                esp_mqtt_client_subscribe(transport->client_, transport->subscriptions_[i].topic, TELEMETRY_QOS);
+            }
+            transport->connected_.store(true, std::memory_order_relaxed);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGW(TAG, "Disconnected from broker");
+            transport->connected_.store(false, std::memory_order_relaxed);
+            break;
+        case MQTT_EVENT_DATA:
+            transport->dispatch(*static_cast<esp_mqtt_event_t*>(event_data));
+            break;
+        default:
+            break;
+    }
+}
+
+esp_err_t EspMqttTransport::publish(const char* topic, const uint8_t* data, size_t length) {
+    if (!connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int msg_id = esp_mqtt_client_enqueue(client_, topic, reinterpret_cast<const char*>(data), length,
+                                         TELEMETRY_QOS, 0, true);
+    return msg_id < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t EspMqttTransport::subscribe(const char* topic, MessageHandler handler, void* arg) {
+    if (subscription_count_ == MAX_SUBSCRIPTIONS) {
+        return ESP_ERR_NO_MEM;
+    }
+    subscriptions_[subscription_count_++] = { topic, handler, arg };
+    return ESP_OK;
+}
+
+void EspMqttTransport::dispatch(const esp_mqtt_event_t& event) {
+    if (event.data_len != event.total_data_len) {
+        // Larger than the client's buffer; none of our messages should be
+        ESP_LOGW(TAG, "Dropping fragmented %d byte message", event.total_data_len);
+        return;
+    }
+    for (size_t i = 0; i < subscription_count_; ++i) {
+        const Subscription& subscription = subscriptions_[i];
+        if (strlen(subscription.topic) == static_cast<size_t>(event.topic_len) &&
+            memcmp(subscription.topic, event.topic, event.topic_len) == 0) {
+            subscription.handler(subscription.arg, subscription.topic,
+                                 reinterpret_cast<const uint8_t*>(event.data), event.data_len);
+            return;
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#include "partition_region.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "partition_region";
+
+PartitionRegion::PartitionRegion(const char* label)
+    : partition_(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label)) {
+    if (partition_ == nullptr) {
+        ESP_LOGE(TAG, "Partition '%s' not found", label);
+        return;
+    }
+    ESP_LOGI(TAG, "Partition '%s': %lu KB at 0x%lx", label, partition_->size / 1024, partition_->address);
+}
+
+esp_err_t PartitionRegion::read(size_t offset, void* dst, size_t length) {
+    return partition_ ? esp_partition_read(partition_, offset, dst, length) : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t PartitionRegion::write(size_t offset, const void* src, size_t length) {
+    return partition_ ? esp_partition_write(partition_, offset, src, length) : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t PartitionRegion::erase_sector(size_t offset) {
+    return partition_ ? esp_partition_erase_range(partition_, offset, partition_->erase_size) : ESP_ERR_INVALID_STATE;
+}
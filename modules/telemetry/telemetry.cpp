@@ -0,0 +1,225 @@
+#include <string.h>
+
+#include "telemetry.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "telemetry";
+
+static constexpr size_t MAX_VARINT_BYTES = 10;
+
+static size_t put_varint(uint8_t* dst, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        dst[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    dst[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t telemetry_scale(SensorData::Type type) {
+    switch (type) {
+        case SensorData::Type::TDS: return 1;           // ppm
+        case SensorData::Type::NTC: return 100;         // 0.01 °C
+        case SensorData::Type::WATER_LEVEL: return 10;  // 0.1 cm
+        case SensorData::Type::PH: return 100;          // 0.01 pH
+    }
+    return 1;
+}
+
+static int32_t quantize(float value, int32_t scale) {
+    float scaled = value * scale;
+    if (!(scaled == scaled)) {
+        return 0;   // NaN
+    }
+    if (scaled >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (scaled <= -2147483520.0f) {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+TelemetryEncoder::TelemetryEncoder()
+    : length_(0), count_offset_(0), channels_(0), samples_(0), last_time_ms_(0), last_values_{} {
+}
+
+void TelemetryEncoder::begin(const SensorData* layout, size_t count, int64_t time_ms) {
+    channels_ = static_cast<uint8_t>(count < TELEMETRY_MAX_CHANNELS ? count : TELEMETRY_MAX_CHANNELS);
+    length_ = 0;
+    buffer_[length_++] = 'H';
+    buffer_[length_++] = 'T';
+    buffer_[length_++] = TELEMETRY_FORMAT_VERSION;
+    buffer_[length_++] = channels_;
+    for (size_t i = 0; i < channels_; ++i) {
+        buffer_[length_++] = static_cast<uint8_t>(layout[i].type);
+        last_values_[i] = 0;
+    }
+    count_offset_ = length_;
+    buffer_[length_++] = 0;
+    length_ += put_varint(buffer_ + length_, static_cast<uint64_t>(time_ms < 0 ? 0 : time_ms));
+    last_time_ms_ = time_ms;
+    samples_ = 0;
+}
+
+bool TelemetryEncoder::add(const SensorData* data, size_t count, int64_t time_ms) {
+    if (count < channels_ || samples_ == UINT8_MAX) {
+        return false;
+    }
+    uint8_t sample[MAX_VARINT_BYTES + TELEMETRY_MAX_CHANNELS * 5];
+    int32_t values[TELEMETRY_MAX_CHANNELS];
+    size_t n = put_varint(sample, static_cast<uint64_t>(time_ms > last_time_ms_ ? time_ms - last_time_ms_ : 0));
+    for (size_t i = 0; i < channels_; ++i) {
+        values[i] = quantize(data[i].value, telemetry_scale(data[i].type));
+        int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(values[i]) - static_cast<uint32_t>(last_values_[i]));
+        n += put_varint(sample + n, zigzag(delta));
+    }
+    if (length_ + n > sizeof(buffer_)) {
+        return false;
+    }
+    memcpy(buffer_ + length_, sample, n);
+    length_ += n;
+    memcpy(last_values_, values, channels_ * sizeof(values[0]));
+    if (time_ms > last_time_ms_) {
+        last_time_ms_ = time_ms;
+    }
+    buffer_[count_offset_] = ++samples_;
+    return true;
+}
+
+TelemetryPublisher::TelemetryPublisher(TelemetryTransport& transport, FlashRing* spill, const TelemetryConfig& config)
+    : transport_(transport),
+      spill_(spill),
+      config_(config),
+      open_(false),
+      last_sample_ms_(0),
+      queue_head_(0),
+      queue_count_(0),
+      stats_{} {
+    if (config_.samples_per_batch == 0 || config_.samples_per_batch > UINT8_MAX) {
+        ESP_LOGW(TAG, "samples_per_batch %d out of range, using 30", config_.samples_per_batch);
+        config_.samples_per_batch = 30;
+    }
+}
+
+void TelemetryPublisher::add(const SensorData* data, size_t count, int64_t time_ms) {
+    if (stats_.samples > 0 && time_ms - last_sample_ms_ < static_cast<int64_t>(config_.sample_interval_ms)) {
+        return;
+    }
+    if (!open_) {
+        encoder_.begin(data, count, time_ms);
+        open_ = true;
+    }
+    if (!encoder_.add(data, count, time_ms)) {
+        // Batch is full in bytes before reaching samples_per_batch
+        close_batch();
+        encoder_.begin(data, count, time_ms);
+        open_ = true;
+        if (!encoder_.add(data, count, time_ms)) {
+            open_ = false;
+            stats_.dropped++;
+            return;
+        }
+    }
+    stats_.samples++;
+    last_sample_ms_ = time_ms;
+    if (encoder_.samples() >= config_.samples_per_batch) {
+        close_batch();
+    }
+}
+
+void TelemetryPublisher::flush() {
+    if (open_) {
+        close_batch();
+    }
+}
+
+void TelemetryPublisher::close_batch() {
+    open_ = false;
+    if (encoder_.samples() == 0) {
+        return;
+    }
+    if (queue_count_ == TELEMETRY_QUEUE_DEPTH) {
+        // service() has not run for a while; keep the newest data
+        queue_head_ = (queue_head_ + 1) % TELEMETRY_QUEUE_DEPTH;
+        queue_count_--;
+        stats_.dropped++;
+    }
+    Batch& batch = queue_[(queue_head_ + queue_count_) % TELEMETRY_QUEUE_DEPTH];
+    memcpy(batch.data, encoder_.data(), encoder_.length());
+    batch.length = encoder_.length();
+    queue_count_++;
+    stats_.batches++;
+}
+
+esp_err_t TelemetryPublisher::send(const uint8_t* data, size_t length) {
+    esp_err_t ret = transport_.publish(config_.topic, data, length);
+    if (ret == ESP_OK) {
+        stats_.published++;
+        stats_.bytes_published += length;
+    }
+    return ret;
+}
+
+esp_err_t TelemetryPublisher::publish_metrics(const char* json, size_t length) {
+    if (!transport_.connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = transport_.publish(config_.metrics_topic, reinterpret_cast<const uint8_t*>(json), length);
+    if (ret == ESP_OK) {
+        stats_.metrics_published++;
+    }
+    return ret;
+}
+
+void TelemetryPublisher::service() {
+    bool online = transport_.connected();
+
+    // Older spilled batches go first so the broker sees them in order
+    if (online && spill_ != nullptr) {
+        for (size_t i = 0; i < config_.drain_per_service && spill_->pending() > 0; ++i) {
+            size_t length = 0;
+            esp_err_t ret = spill_->peek(drain_buffer_, sizeof(drain_buffer_), length);
+            if (ret == ESP_OK) {
+                ret = send(drain_buffer_, length);
+                if (ret != ESP_OK) {
+                    online = false;
+                    break;
+                }
+                stats_.drained++;
+            } else {
+                ESP_LOGW(TAG, "Discarding unreadable spilled batch: %s", esp_err_to_name(ret));
+                stats_.dropped++;
+            }
+            if (spill_->pop() != ESP_OK) {
+                break;
+            }
+        }
+    }
+
+    while (queue_count_ > 0) {
+        Batch& batch = queue_[queue_head_];
+        bool direct = online && (spill_ == nullptr || spill_->pending() == 0);
+        if (direct && send(batch.data, batch.length) == ESP_OK) {
+            // Published
+        } else if (spill_ != nullptr) {
+            online = false;
+            uint32_t overwritten = spill_->dropped();
+            if (spill_->push(batch.data, batch.length) == ESP_OK) {
+                stats_.spilled++;
+            } else {
+                stats_.dropped++;
+            }
+            stats_.dropped += spill_->dropped() - overwritten;
+        } else {
+            break;  // No spill store: keep it in RAM and retry next time
+        }
+        queue_head_ = (queue_head_ + 1) % TELEMETRY_QUEUE_DEPTH;
+        queue_count_--;
+    }
+}
@@ -0,0 +1,207 @@
+#include "trace.hpp"
+#include "esp_timer.h"
+
+#include <cinttypes>
+#include <string.h>
+
+static const char* TAG = "trace";
+
+static const char* const MODULE_NAMES[TRACE_MODULE_COUNT] = { "sensors", "state_machine", "control" };
+static const char LEVEL_LETTERS[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+TraceLog& trace_log() {
+    static TraceLog log;
+    return log;
+}
+
+const char* trace_module_name(TraceModule module) {
+    size_t index = static_cast<size_t>(module);
+    return index < TRACE_MODULE_COUNT ? MODULE_NAMES[index] : "?";
+}
+
+TraceLog::TraceLog()
+    : sink_(nullptr), drain_period_ms_(0), drain_task_(nullptr) {
+    for (auto& level : levels_) {
+        level.store(ESP_LOG_INFO, std::memory_order_relaxed);
+    }
+}
+
+void TraceLog::set_level(TraceModule module, esp_log_level_t level) {
+    size_t index = static_cast<size_t>(module);
+    if (index < TRACE_MODULE_COUNT) {
+        levels_[index].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+}
+
+esp_log_level_t TraceLog::level(TraceModule module) const {
+    size_t index = static_cast<size_t>(module);
+    return index < TRACE_MODULE_COUNT
+        ? static_cast<esp_log_level_t>(levels_[index].load(std::memory_order_relaxed))
+        : ESP_LOG_NONE;
+}
+
+bool TraceLog::record(TraceEvent event, const uint32_t* args, size_t argc, uint8_t zone) {
+    int64_t now_us = esp_timer_get_time();
+    return ring_.push([&](TraceRecord& record) {
+        record.timestamp_us = static_cast<uint32_t>(now_us);
+        record.event = static_cast<uint16_t>(event);
+        record.argc = static_cast<uint8_t>(argc < TRACE_MAX_ARGS ? argc : TRACE_MAX_ARGS);
+        record.zone = zone;
+        memcpy(record.args, args, record.argc * sizeof(uint32_t));
+    });
+}
+
+size_t TraceLog::drain(TraceSink& sink) {
+    TraceRecord batch[16];
+    size_t total = 0;
+    uint32_t dropped_before = ring_.take_dropped();
+    while (true) {
+        size_t count = 0;
+        while (count < sizeof(batch) / sizeof(batch[0]) && ring_.pop(batch[count])) {
+            count++;
+        }
+        if (count == 0 && dropped_before == 0) {
+            return total;
+        }
+        sink.write(batch, count, dropped_before);
+        dropped_before = 0;
+        total += count;
+        if (count == 0) {
+            return total;
+        }
+    }
+}
+
+esp_err_t TraceLog::start_drain(TraceSink& sink, UBaseType_t priority, uint32_t stack_size, uint32_t period_ms) {
+    if (drain_task_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sink_ = &sink;
+    drain_period_ms_ = period_ms;
+    if (xTaskCreate(drain_task, "trace_drain", stack_size, this, priority, &drain_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create trace drain task");
+        drain_task_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void TraceLog::drain_task(void* arg) {
+    TraceLog* log = static_cast<TraceLog*>(arg);
+    while (true) {
+        log->drain(*log->sink_);
+        vTaskDelay(pdMS_TO_TICKS(log->drain_period_ms_) > 0 ? pdMS_TO_TICKS(log->drain_period_ms_) : 1);
+    }
+}
+
+int trace_format(const TraceRecord& record, char* buffer, size_t size) {
+    if (record.event >= TRACE_EVENT_COUNT) {
+        return snprintf(buffer, size, "unknown event %u", record.event);
+    }
+    // Copy the literal text, and format one conversion at a time with its own argument
+    const char* format = TRACE_EVENT_INFO[record.event].format;
+    size_t length = 0;
+    size_t arg = 0;
+    if (record.zone != TRACE_NO_ZONE) {
+        int written = snprintf(buffer, size, "zone %u: ", record.zone);
+        length = written > 0 && static_cast<size_t>(written) < size ? written : 0;
+    }
+    for (const char* p = format; *p != '\0' && length + 1 < size;) {
+        if (*p != '%') {
+            buffer[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            buffer[length++] = '%';
+            p += 2;
+            continue;
+        }
+        const char* end = p + 1;
+        while (*end != '\0' && !trace_is_conversion(*end)) {
+            ++end;
+        }
+        if (*end == '\0') {
+            break;
+        }
+        char spec[16];
+        size_t spec_length = static_cast<size_t>(end - p + 1);
+        if (spec_length >= sizeof(spec)) {
+            break;
+        }
+        memcpy(spec, p, spec_length);
+        spec[spec_length] = '\0';
+        uint32_t word = arg < record.argc ? record.args[arg] : 0;
+        arg++;
+        bool is_long = end[-1] == 'l';
+        int written;
+        if (trace_is_float_conversion(*end)) {
+            float value;
+            memcpy(&value, &word, sizeof(value));
+            written = snprintf(buffer + length, size - length, spec, static_cast<double>(value));
+        } else if (*end == 'd' || *end == 'i') {
+            written = is_long ? snprintf(buffer + length, size - length, spec, static_cast<long>(static_cast<int32_t>(word)))
+                              : snprintf(buffer + length, size - length, spec, static_cast<int>(static_cast<int32_t>(word)));
+        } else if (*end == 'u' || *end == 'x' || *end == 'X') {
+            written = is_long ? snprintf(buffer + length, size - length, spec, static_cast<unsigned long>(word))
+                              : snprintf(buffer + length, size - length, spec, static_cast<unsigned>(word));
+        } else {
+            written = snprintf(buffer + length, size - length, "?");
+        }
+        if (written < 0) {
+            break;
+        }
+        length += static_cast<size_t>(written) < size - length ? static_cast<size_t>(written) : size - length - 1;
+        p = end + 1;
+    }
+    buffer[length] = '\0';
+    return static_cast<int>(length);
+}
+
+TextTraceSink::TextTraceSink(FILE* out) : out_(out), time_us_(-1), last_timestamp_us_(0) {
+}
+
+void TextTraceSink::write(const TraceRecord* records, size_t count, uint32_t dropped) {
+    if (dropped > 0) {
+        fprintf(out_, "W (%" PRId64 ") %s: %lu records dropped\n", time_us_ / 1000, TAG,
+                static_cast<unsigned long>(dropped));
+    }
+    char message[192];
+    for (size_t i = 0; i < count; ++i) {
+        const TraceRecord& record = records[i];
+        if (record.event == TRACE_DROPPED_EVENT) {
+            fprintf(out_, "W (%" PRId64 ") %s: %lu records dropped\n", time_us_ / 1000, TAG,
+                    static_cast<unsigned long>(record.args[0]));
+            continue;
+        }
+        // Producers on different tasks may land slightly out of order: signed deltas
+        if (time_us_ < 0) {
+            time_us_ = record.timestamp_us;
+        } else {
+            time_us_ += static_cast<int32_t>(record.timestamp_us - last_timestamp_us_);
+        }
+        last_timestamp_us_ = record.timestamp_us;
+        trace_format(record, message, sizeof(message));
+        if (record.event < TRACE_EVENT_COUNT) {
+            const TraceEventInfo& info = TRACE_EVENT_INFO[record.event];
+            fprintf(out_, "%c (%" PRId64 ") %s: %s\n", LEVEL_LETTERS[info.level], time_us_ / 1000,
+                    trace_module_name(info.module), message);
+        } else {
+            fprintf(out_, "? (%" PRId64 ") %s: %s\n", time_us_ / 1000, TAG, message);
+        }
+    }
+    fflush(out_);
+}
+
+void BinaryTraceSink::write(const TraceRecord* records, size_t count, uint32_t dropped) {
+    if (!header_written_) {
+        TraceCaptureHeader header = { { 'H', 'T', 'R', 'C' }, TRACE_CAPTURE_VERSION, sizeof(TraceRecord) };
+        fwrite(&header, sizeof(header), 1, out_);
+        header_written_ = true;
+    }
+    if (dropped > 0) {
+        TraceRecord marker = { 0, TRACE_DROPPED_EVENT, 1, TRACE_NO_ZONE, { dropped } };
+        fwrite(&marker, sizeof(marker), 1, out_);
+    }
+    fwrite(records, sizeof(TraceRecord), count, out_);
+    fflush(out_);
+}
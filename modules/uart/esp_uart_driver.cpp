@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "esp_uart_driver.hpp"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+static const char* TAG = "uart";
+
+EspUartDriver::EspUartDriver()
+    : config_{},
+      rx_buffer_(new uint8_t[RX_BUFFER_SIZE]),
+      event_queue_(nullptr),
+      rx_task_(nullptr),
+      listener_(nullptr),
+      rx_lock_(nullptr),
+      listening_(false),
+      managed_(false),
+      locked_(false) {
+}
+
+EspUartDriver::~EspUartDriver() {
+    stop();
+    if (rx_lock_) {
+        esp_pm_lock_delete(rx_lock_);
+    }
+    delete[] rx_buffer_;
+}
+
+esp_err_t EspUartDriver::start(const UartConfig& config, UartListener& listener) {
+    config_ = config;
+    listener_ = &listener;
+    uart_config_t uart_config = {
+        .baud_rate = config_.baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 122,
+#if CONFIG_PM_ENABLE
+        // Keeps the baud rate through frequency scaling and light sleep
+        .source_clk = UART_SCLK_XTAL,
+#else
+        .source_clk = UART_SCLK_DEFAULT,
+#endif
+    };
+    ESP_ERROR_CHECK(uart_driver_install(config_.port, RX_BUFFER_SIZE * 2, 0, EVENT_QUEUE_SIZE, &event_queue_, 0));
+    ESP_ERROR_CHECK(uart_param_config(config_.port, &uart_config));
+    ESP_ERROR_CHECK(uart_set_pin(config_.port, config_.tx_pin, config_.rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+    ESP_ERROR_CHECK(uart_flush(config_.port));
+#if CONFIG_PM_ENABLE
+    // Before the receive task, which takes it
+    if (!rx_lock_) {
+        esp_err_t ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "uart_rx", &rx_lock_);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "UART%d: no power management lock, cannot listen: %s", config_.port, esp_err_to_name(ret));
+            rx_lock_ = nullptr;
+        }
+    }
+    ESP_ERROR_CHECK(uart_set_wakeup_threshold(config_.port, UART_WAKEUP_EDGES));
+#endif
+    if (xTaskCreate(rx_task, "uart_rx", 2048, this, 8, &rx_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create UART%d receive task", config_.port);
+        rx_task_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "UART%d initialized: TX=%d, RX=%d, Baud=%d", config_.port, config_.tx_pin, config_.rx_pin, config_.baud_rate);
+    return ESP_OK;
+}
+
+void EspUartDriver::stop() {
+    if (rx_task_) {
+        vTaskDelete(rx_task_);
+        rx_task_ = nullptr;
+    }
+    if (event_queue_) {
+        uart_driver_delete(config_.port);
+        event_queue_ = nullptr;
+    }
+}
+
+esp_err_t EspUartDriver::set_listening(bool listening) {
+    if (!event_queue_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!listening) {
+        listening_.store(false, std::memory_order_relaxed);
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+        if (locked_) {
+            esp_pm_lock_release(rx_lock_);
+            locked_ = false;
+        }
+        return ESP_OK;
+    }
+    if (!rx_lock_) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    managed_.store(true, std::memory_order_relaxed);
+    listening_.store(true, std::memory_order_relaxed);
+    // Re-armed for every listen: the chip sleeps on until the sender's next frame starts
+    return esp_sleep_enable_uart_wakeup(config_.port);
+}
+
+void EspUartDriver::hold_awake() {
+    if (listening_.load(std::memory_order_relaxed) && !locked_) {
+        esp_pm_lock_acquire(rx_lock_);
+        locked_ = true;
+    }
+}
+
+void EspUartDriver::rx_task(void* arg) {
+    EspUartDriver* uart = static_cast<EspUartDriver*>(arg);
+    uart_event_t event;
+    while (true) {
+        bool idle_timeout = !uart->managed_.load(std::memory_order_relaxed) ||
+                            uart->listening_.load(std::memory_order_relaxed);
+        if (xQueueReceive(uart->event_queue_, &event,
+                          idle_timeout ? pdMS_TO_TICKS(READ_TIMEOUT_MS) : portMAX_DELAY) != pdTRUE) {
+            uart->listener_->on_idle();
+            continue;
+        }
+        switch (event.type) {
+            case UART_WAKEUP:
+                // The rest of the waking frame is garbage to the decoder; stay up for the next
+                uart->hold_awake();
+                break;
+            case UART_DATA: {
+                uart->hold_awake();
+                // Drain everything the driver reported in one go and hand it to the decoder
+                size_t remaining = event.size;
+                while (remaining > 0) {
+                    int len = uart_read_bytes(uart->config_.port, uart->rx_buffer_,
+                                              std::min(remaining, RX_BUFFER_SIZE), 0);
+                    if (len <= 0) {
+                        break;
+                    }
+                    uart->listener_->on_data(uart->rx_buffer_, len, esp_timer_get_time());
+                    remaining -= len;
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "UART%d RX overflow, flushing", uart->config_.port);
+                uart_flush_input(uart->config_.port);
+                xQueueReset(uart->event_queue_);
+                uart->listener_->on_overflow();
+                break;
+            default:
+                ESP_LOGD(TAG, "UART%d event type %d", uart->config_.port, event.type);
+                break;
+        }
+    }
+}
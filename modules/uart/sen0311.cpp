@@ -0,0 +1,99 @@
+#include "sen0311.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "sen0311";
+
+static constexpr uint8_t SEN0311_HEADER = 0xFF;
+static constexpr uint16_t SEN0311_MIN_MM = 30;
+static constexpr uint16_t SEN0311_MAX_MM = 4500;
+
+Sen0311Parser::Sen0311Parser()
+    : stage_(Stage::HEADER),
+      frame_{},
+      frames_(0),
+      checksum_errors_(0),
+      range_errors_(0),
+      discarded_bytes_(0),
+      timeouts_(0),
+      overflows_(0) {
+}
+
+void Sen0311Parser::reset() {
+    stage_ = Stage::HEADER;
+}
+
+void Sen0311Parser::feed(const uint8_t* data, size_t length, int64_t now_us) {
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t byte = data[i];
+        switch (stage_) {
+            case Stage::HEADER:
+                if (byte == SEN0311_HEADER) {
+                    frame_[0] = byte;
+                    stage_ = Stage::HIGH;
+                } else {
+                    discarded_bytes_.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case Stage::HIGH:
+                frame_[1] = byte;
+                stage_ = Stage::LOW;
+                break;
+            case Stage::LOW:
+                frame_[2] = byte;
+                stage_ = Stage::CHECKSUM;
+                break;
+            case Stage::CHECKSUM:
+                frame_[3] = byte;
+                stage_ = Stage::HEADER;
+                if (!complete_frame(now_us)) {
+                    resync();
+                }
+                break;
+        }
+    }
+}
+
+// After a bad checksum the real header may already be inside the rejected frame
+void Sen0311Parser::resync() {
+    for (size_t k = 1; k < 4; ++k) {
+        if (frame_[k] == SEN0311_HEADER) {
+            for (size_t j = k; j < 4; ++j) {
+                frame_[j - k] = frame_[j];
+            }
+            static const Stage next[] = { Stage::HEADER, Stage::HIGH, Stage::LOW, Stage::CHECKSUM };
+            stage_ = next[4 - k];
+            discarded_bytes_.fetch_add(k, std::memory_order_relaxed);
+            return;
+        }
+    }
+    discarded_bytes_.fetch_add(4, std::memory_order_relaxed);
+}
+
+bool Sen0311Parser::complete_frame(int64_t now_us) {
+    uint8_t checksum = (frame_[0] + frame_[1] + frame_[2]) & 0xFF;
+    if (checksum != frame_[3]) {
+        checksum_errors_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGD(TAG, "Checksum error: expected 0x%02X, got 0x%02X", checksum, frame_[3]);
+        return false;
+    }
+    uint16_t distance_mm = (frame_[1] << 8) + frame_[2];
+    if (distance_mm < SEN0311_MIN_MM || distance_mm > SEN0311_MAX_MM) {
+        range_errors_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGD(TAG, "Distance out of range: %d mm", distance_mm);
+        return true;
+    }
+    latest_.store({ distance_mm / 10.0f, now_us });
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+Sen0311Stats Sen0311Parser::stats() const {
+    return {
+        frames_.load(std::memory_order_relaxed),
+        checksum_errors_.load(std::memory_order_relaxed),
+        range_errors_.load(std::memory_order_relaxed),
+        discarded_bytes_.load(std::memory_order_relaxed),
+        timeouts_.load(std::memory_order_relaxed),
+        overflows_.load(std::memory_order_relaxed),
+    };
+}